@@ -818,6 +818,24 @@ rhtable, [
 ])
 ]) # LIBCFS_RHLTABLE
 
+#
+# LIBCFS_RHASHTABLE_WALK_ENTER
+#
+# Kernel version 4.9 added rhashtable_walk_enter() which replaces
+# rhashtable_walk_init() and doesn't allocate memory
+#
+AC_DEFUN([LIBCFS_RHASHTABLE_WALK_ENTER], [
+LB_CHECK_COMPILE([if 'rhashtable_walk_enter' exists],
+rhashtable_walk_enter, [
+	#include <linux/rhashtable.h>
+],[
+	rhashtable_walk_enter(NULL, NULL);
+],[
+	AC_DEFINE(HAVE_RHASHTABLE_WALK_ENTER, 1,
+		[rhashtable_walk_enter() is available])
+])
+]) # LIBCFS_RHASHTABLE_WALK_ENTER
+
 #
 # LIBCFS_STACKTRACE_OPS
 #
@@ -1204,6 +1222,7 @@ LIBCFS_RHLTABLE
 LIBCFS_STACKTRACE_OPS
 # 4.9
 LIBCFS_GET_USER_PAGES_GUP_FLAGS
+LIBCFS_RHASHTABLE_WALK_ENTER
 # 4.10
 LIBCFS_HOTPLUG_STATE_MACHINE
 # 4.11
@@ -155,6 +155,13 @@ enum cfs_hash_tag {
          * change on hash table is non-blocking
          */
         CFS_HASH_NBLK_CHANGE    = 1 << 13,
+	/**
+	 * items are linked with RCU-safe hlist primitives so that
+	 * cfs_hash_bd_lookup_rcu() can search a bucket without its lock,
+	 * the caller must RCU-free items removed from the hash.
+	 * Can't be used with CFS_HASH_REHASH.
+	 */
+	CFS_HASH_RCU		= 1 << 14,
         /** NB, we typed hs_flags as  __u16, please change it
          * if you need to extend >=16 flags */
 };
@@ -422,6 +429,12 @@ cfs_hash_with_nblk_change(struct cfs_hash *hs)
         return (hs->hs_flags & CFS_HASH_NBLK_CHANGE) != 0;
 }
 
+static inline int
+cfs_hash_with_rcu(struct cfs_hash *hs)
+{
+	return (hs->hs_flags & CFS_HASH_RCU) != 0;
+}
+
 static inline int
 cfs_hash_is_exiting(struct cfs_hash *hs)
 {       /* cfs_hash_destroy is called */
@@ -630,6 +643,9 @@ struct hlist_node *
 cfs_hash_bd_lookup_locked(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 			  const void *key);
 struct hlist_node *
+cfs_hash_bd_lookup_rcu(struct cfs_hash *hs, struct cfs_hash_bd *bd,
+		       const void *key);
+struct hlist_node *
 cfs_hash_bd_peek_locked(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 			const void *key);
 struct hlist_node *
@@ -196,6 +196,14 @@ static inline void *rhashtable_lookup_get_insert_fast(
 }
 #endif /* !HAVE_RHASHTABLE_LOOKUP_GET_INSERT_FAST */
 
+#ifndef HAVE_RHASHTABLE_WALK_ENTER
+static inline void rhashtable_walk_enter(struct rhashtable *ht,
+					 struct rhashtable_iter *iter)
+{
+	rhashtable_walk_init(ht, iter);
+}
+#endif /* !HAVE_RHASHTABLE_WALK_ENTER */
+
 #ifndef HAVE_RHASHTABLE_LOOKUP
 /*
  * The function rhashtable_lookup() and rhashtable_lookup_fast()
@@ -104,6 +104,7 @@
  */
 #include <linux/seq_file.h>
 #include <linux/log2.h>
+#include <linux/rculist.h>
 
 #include <libcfs/linux/linux-list.h>
 #include <libcfs/libcfs.h>
@@ -233,6 +234,39 @@ cfs_hash_lock_setup(struct cfs_hash *hs)
         }
 }
 
+/**
+ * hlist helpers, with CFS_HASH_RCU the RCU variants are used so that
+ * cfs_hash_bd_lookup_rcu() always sees a consistent chain
+ */
+static inline void
+cfs_hash_hlist_add_head(struct cfs_hash *hs, struct hlist_node *hnode,
+			struct hlist_head *hhead)
+{
+	if (cfs_hash_with_rcu(hs))
+		hlist_add_head_rcu(hnode, hhead);
+	else
+		hlist_add_head(hnode, hhead);
+}
+
+static inline void
+cfs_hash_hlist_add_behind(struct cfs_hash *hs, struct hlist_node *hnode,
+			  struct hlist_node *prev)
+{
+	if (cfs_hash_with_rcu(hs))
+		hlist_add_behind_rcu(hnode, prev);
+	else
+		hlist_add_behind(hnode, prev);
+}
+
+static inline void
+cfs_hash_hlist_del_init(struct cfs_hash *hs, struct hlist_node *hnode)
+{
+	if (cfs_hash_with_rcu(hs))
+		hlist_del_init_rcu(hnode);
+	else
+		hlist_del_init(hnode);
+}
+
 /**
  * Simple hash head without depth tracking
  * new element is always added to head of hlist
@@ -260,7 +294,7 @@ static int
 cfs_hash_hh_hnode_add(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 		      struct hlist_node *hnode)
 {
-	hlist_add_head(hnode, cfs_hash_hh_hhead(hs, bd));
+	cfs_hash_hlist_add_head(hs, hnode, cfs_hash_hh_hhead(hs, bd));
 	return -1; /* unknown depth */
 }
 
@@ -268,7 +302,7 @@ static int
 cfs_hash_hh_hnode_del(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 		      struct hlist_node *hnode)
 {
-	hlist_del_init(hnode);
+	cfs_hash_hlist_del_init(hs, hnode);
 	return -1; /* unknown depth */
 }
 
@@ -304,7 +338,7 @@ cfs_hash_hd_hnode_add(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 
 	hh = container_of(cfs_hash_hd_hhead(hs, bd),
 			  struct cfs_hash_head_dep, hd_head);
-	hlist_add_head(hnode, &hh->hd_head);
+	cfs_hash_hlist_add_head(hs, hnode, &hh->hd_head);
 	return ++hh->hd_depth;
 }
 
@@ -316,7 +350,7 @@ cfs_hash_hd_hnode_del(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 
 	hh = container_of(cfs_hash_hd_hhead(hs, bd),
 			  struct cfs_hash_head_dep, hd_head);
-	hlist_del_init(hnode);
+	cfs_hash_hlist_del_init(hs, hnode);
 	return --hh->hd_depth;
 }
 
@@ -353,9 +387,9 @@ cfs_hash_dh_hnode_add(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 	dh = container_of(cfs_hash_dh_hhead(hs, bd),
 			  struct cfs_hash_dhead, dh_head);
 	if (dh->dh_tail != NULL) /* not empty */
-		hlist_add_behind(hnode, dh->dh_tail);
+		cfs_hash_hlist_add_behind(hs, hnode, dh->dh_tail);
 	else /* empty list */
-		hlist_add_head(hnode, &dh->dh_head);
+		cfs_hash_hlist_add_head(hs, hnode, &dh->dh_head);
 	dh->dh_tail = hnode;
 	return -1; /* unknown depth */
 }
@@ -372,7 +406,7 @@ cfs_hash_dh_hnode_del(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 		dh->dh_tail = (hnd->pprev == &dh->dh_head.first) ? NULL :
 			      container_of(hnd->pprev, struct hlist_node, next);
 	}
-	hlist_del_init(hnd);
+	cfs_hash_hlist_del_init(hs, hnd);
 	return -1; /* unknown depth */
 }
 
@@ -410,9 +444,9 @@ cfs_hash_dd_hnode_add(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 	dh = container_of(cfs_hash_dd_hhead(hs, bd),
 			  struct cfs_hash_dhead_dep, dd_head);
 	if (dh->dd_tail != NULL) /* not empty */
-		hlist_add_behind(hnode, dh->dd_tail);
+		cfs_hash_hlist_add_behind(hs, hnode, dh->dd_tail);
 	else /* empty list */
-		hlist_add_head(hnode, &dh->dd_head);
+		cfs_hash_hlist_add_head(hs, hnode, &dh->dd_head);
 	dh->dd_tail = hnode;
 	return ++dh->dd_depth;
 }
@@ -429,7 +463,7 @@ cfs_hash_dd_hnode_del(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 		dh->dd_tail = (hnd->pprev == &dh->dd_head.first) ? NULL :
 			      container_of(hnd->pprev, struct hlist_node, next);
 	}
-	hlist_del_init(hnd);
+	cfs_hash_hlist_del_init(hs, hnd);
 	return --dh->dd_depth;
 }
 
@@ -670,6 +704,32 @@ cfs_hash_bd_lookup_locked(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 }
 EXPORT_SYMBOL(cfs_hash_bd_lookup_locked);
 
+/**
+ * Search bucket \a bd for \a key without taking the bucket lock.
+ *
+ * Only for hashes created with CFS_HASH_RCU, the caller must hold
+ * rcu_read_lock(). No reference is taken: the returned item may be
+ * removed from the hash concurrently, so the caller should take its own
+ * reference with an "increment unless zero" primitive and treat a failure
+ * as a miss. A miss does not prove the key is absent, callers creating
+ * items have to repeat the lookup under the bucket lock.
+ */
+struct hlist_node *
+cfs_hash_bd_lookup_rcu(struct cfs_hash *hs, struct cfs_hash_bd *bd,
+		       const void *key)
+{
+	struct hlist_node *ehnode;
+
+	LASSERT(cfs_hash_with_rcu(hs));
+
+	__hlist_for_each_rcu(ehnode, cfs_hash_bd_hhead(hs, bd)) {
+		if (cfs_hash_keycmp(hs, key, ehnode))
+			return ehnode;
+	}
+	return NULL;
+}
+EXPORT_SYMBOL(cfs_hash_bd_lookup_rcu);
+
 struct hlist_node *
 cfs_hash_bd_peek_locked(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 			const void *key)
@@ -1017,6 +1077,9 @@ cfs_hash_create(char *name, unsigned cur_bits, unsigned max_bits,
                      (flags & CFS_HASH_NO_LOCK) == 0));
         LASSERT(ergo((flags & CFS_HASH_REHASH_KEY) != 0,
                       ops->hs_keycpy != NULL));
+	/* lockless readers can't follow buckets being reallocated */
+	LASSERT(ergo((flags & CFS_HASH_RCU) != 0,
+		     (flags & CFS_HASH_REHASH) == 0));
 
         len = (flags & CFS_HASH_BIGNAME) == 0 ?
               CFS_HASH_NAME_LEN : CFS_HASH_BIGNAME_LEN;
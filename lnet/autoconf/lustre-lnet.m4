@@ -763,6 +763,35 @@ kern_sock_getname_2args, [
 EXTRA_KCFLAGS="$tmp_flags"
 ]) # LN_CONFIG_SOCK_GETNAME
 
+#
+# LN_CONFIG_SOCK_RECVMSG_BVEC
+#
+# 4.20 commit aa563d7bca6e882ec2bdae24f5fd0d2a2dc20bd7 separated the
+# type of an iov_iter from its direction, a kernel socket can be read
+# straight into pages through a bvec iov_iter and sock_recvmsg()
+#
+AC_DEFUN([LN_CONFIG_SOCK_RECVMSG_BVEC], [
+tmp_flags="$EXTRA_KCFLAGS"
+EXTRA_KCFLAGS="-Werror"
+LB_CHECK_COMPILE([if a socket can be read into a bvec iov_iter],
+sock_recvmsg_bvec, [
+	#include <linux/bvec.h>
+	#include <linux/net.h>
+	#include <linux/socket.h>
+	#include <linux/uio.h>
+],[
+	struct msghdr msg = {};
+	struct bio_vec bvec = {};
+
+	iov_iter_bvec(&msg.msg_iter, READ, &bvec, 1, 0);
+	sock_recvmsg(NULL, &msg, MSG_DONTWAIT);
+],[
+	AC_DEFINE(HAVE_SOCK_RECVMSG_BVEC, 1,
+		[a socket can be read into a bvec iov_iter])
+])
+EXTRA_KCFLAGS="$tmp_flags"
+]) # LN_CONFIG_SOCK_RECVMSG_BVEC
+
 #
 # LN_IB_DEVICE_OPS_EXISTS
 #
@@ -815,6 +844,8 @@ LN_CONFIG_SOCK_CREATE_KERN
 LN_CONFIG_SOCK_ACCEPT
 # 4.17
 LN_CONFIG_SOCK_GETNAME
+# 4.20
+LN_CONFIG_SOCK_RECVMSG_BVEC
 # 5.0
 LN_IB_DEVICE_OPS_EXISTS
 ]) # LN_PROG_LINUX
@@ -39,6 +39,7 @@
 
 /* LNET has 0xeXXX */
 #define CFS_FAIL_PTLRPC_OST_BULK_CB2	0xe000
+#define CFS_FAIL_LNET_RTRPOOL_BUSY	0xe001
 
 #ifndef __KERNEL__
 # error This include is only for kernel use.
@@ -193,9 +194,17 @@ lnet_net_lock_current(void)
 #define MAX_PORTALS	64
 
 #define LNET_SMALL_MD_SIZE   offsetof(struct lnet_libmd, md_iov.iov[1])
-extern struct kmem_cache *lnet_mes_cachep;	 /* MEs kmem_cache */
-extern struct kmem_cache *lnet_small_mds_cachep; /* <= LNET_SMALL_MD_SIZE bytes
-						  * MDs kmem_cache */
+extern struct lnet_obj_pool lnet_msg_pool;
+extern struct lnet_obj_pool lnet_me_pool;
+extern struct lnet_obj_pool lnet_small_md_pool; /* <= LNET_SMALL_MD_SIZE
+						 * bytes MDs */
+
+int lnet_pools_create(void);
+void lnet_pools_destroy(void);
+void lnet_pools_trim(void);
+void lnet_pools_get_stats(struct lnet_counters_pools *pools);
+void *lnet_pool_alloc(struct lnet_obj_pool *pool);
+void lnet_pool_free(struct lnet_obj_pool *pool, void *obj);
 
 static inline struct lnet_eq *
 lnet_eq_alloc (void)
@@ -229,10 +238,9 @@ lnet_md_alloc(struct lnet_md *umd)
 	}
 
 	if (size <= LNET_SMALL_MD_SIZE) {
-		md = kmem_cache_alloc(lnet_small_mds_cachep,
-				      GFP_NOFS | __GFP_ZERO);
+		md = lnet_pool_alloc(&lnet_small_md_pool);
 		if (md) {
-			CDEBUG(D_MALLOC, "slab-alloced 'md' of size %u at "
+			CDEBUG(D_MALLOC, "pool-alloced 'md' of size %u at "
 			       "%p.\n", size, md);
 		} else {
 			CDEBUG(D_MALLOC, "failed to allocate 'md' of size %u\n",
@@ -264,8 +272,8 @@ lnet_md_free(struct lnet_libmd *md)
 		size = offsetof(struct lnet_libmd, md_iov.iov[md->md_niov]);
 
 	if (size <= LNET_SMALL_MD_SIZE) {
-		CDEBUG(D_MALLOC, "slab-freed 'md' at %p.\n", md);
-		kmem_cache_free(lnet_small_mds_cachep, md);
+		CDEBUG(D_MALLOC, "pool-freed 'md' at %p.\n", md);
+		lnet_pool_free(&lnet_small_md_pool, md);
 	} else {
 		LIBCFS_FREE(md, size);
 	}
@@ -276,10 +284,10 @@ lnet_me_alloc (void)
 {
 	struct lnet_me *me;
 
-	me = kmem_cache_alloc(lnet_mes_cachep, GFP_NOFS | __GFP_ZERO);
+	me = lnet_pool_alloc(&lnet_me_pool);
 
 	if (me)
-		CDEBUG(D_MALLOC, "slab-alloced 'me' at %p.\n", me);
+		CDEBUG(D_MALLOC, "pool-alloced 'me' at %p.\n", me);
 	else
 		CDEBUG(D_MALLOC, "failed to allocate 'me'\n");
 
@@ -289,8 +297,8 @@ lnet_me_alloc (void)
 static inline void
 lnet_me_free(struct lnet_me *me)
 {
-	CDEBUG(D_MALLOC, "slab-freed 'me' at %p.\n", me);
-	kmem_cache_free(lnet_mes_cachep, me);
+	CDEBUG(D_MALLOC, "pool-freed 'me' at %p.\n", me);
+	lnet_pool_free(&lnet_me_pool, me);
 }
 
 struct lnet_libhandle *lnet_res_lh_lookup(struct lnet_res_container *rec,
@@ -484,9 +492,8 @@ lnet_msg_alloc(void)
 {
 	struct lnet_msg *msg;
 
-	LIBCFS_ALLOC(msg, sizeof(*msg));
-
-	/* no need to zero, LIBCFS_ALLOC does for us */
+	/* no need to zero, lnet_pool_alloc does for us */
+	msg = lnet_pool_alloc(&lnet_msg_pool);
 	return (msg);
 }
 
@@ -494,7 +501,7 @@ static inline void
 lnet_msg_free(struct lnet_msg *msg)
 {
 	LASSERT(!msg->msg_onactivelist);
-	LIBCFS_FREE(msg, sizeof(*msg));
+	lnet_pool_free(&lnet_msg_pool, msg);
 }
 
 static inline struct lnet_rsp_tracker *
@@ -603,6 +610,7 @@ int  lnet_rtrpools_adjust(int tiny, int small, int large);
 int lnet_rtrpools_enable(void);
 void lnet_rtrpools_disable(void);
 void lnet_rtrpools_free(int keep_pools);
+void lnet_rtrpools_autoscale(void);
 void lnet_rtr_transfer_to_peer(struct lnet_peer *src,
 			       struct lnet_peer *target);
 struct lnet_remotenet *lnet_find_rnet_locked(__u32 net);
@@ -622,6 +630,8 @@ void lnet_msg_attach_md(struct lnet_msg *msg, struct lnet_libmd *md,
 void lnet_build_unlink_event(struct lnet_libmd *md, struct lnet_event *ev);
 void lnet_build_msg_event(struct lnet_msg *msg, enum lnet_event_kind ev_type);
 void lnet_msg_commit(struct lnet_msg *msg, int cpt);
+void lnet_msg_numa_locality(struct lnet_msg *msg, struct lnet_ni *ni,
+			    int md_cpt);
 void lnet_msg_decommit(struct lnet_msg *msg, int cpt, int status);
 
 void lnet_eq_enqueue_event(struct lnet_eq *eq, struct lnet_event *ev);
@@ -746,6 +756,17 @@ bool lnet_delay_rule_match_locked(struct lnet_hdr *hdr, struct lnet_msg *msg);
 
 /** @} lnet_fault_simulation */
 
+/** \addtogroup lnet_udsp @{ */
+
+int lnet_udsp_add(struct lnet_ioctl_udsp *info);
+int lnet_udsp_del(int idx);
+int lnet_udsp_get(struct lnet_ioctl_udsp *info);
+void lnet_udsp_destroy(void);
+void lnet_udsp_apply_to_ni(struct lnet_ni *ni);
+void lnet_udsp_apply_to_lpni_locked(struct lnet_peer_ni *lpni);
+
+/** @} lnet_udsp */
+
 void lnet_counters_get_common(struct lnet_counters_common *common);
 void lnet_counters_get(struct lnet_counters *counters);
 void lnet_counters_reset(void);
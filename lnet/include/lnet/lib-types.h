@@ -152,6 +152,10 @@ struct lnet_msg {
 	unsigned int          msg_peerrtrcredit:1; /* taken a peer router credit */
 	unsigned int          msg_onactivelist:1; /* on the activelist */
 	unsigned int	      msg_rdma_get:1;
+	/* payload is on the NUMA node of the NI moving it */
+	unsigned int	      msg_numa_local:1;
+	/* payload is on another NUMA node than the NI moving it */
+	unsigned int	      msg_numa_remote:1;
 
 	struct lnet_peer_ni  *msg_txpeer;         /* peer I'm sending to */
 	struct lnet_peer_ni  *msg_rxpeer;         /* peer I received from */
@@ -484,6 +488,9 @@ struct lnet_ni {
 	/* sequence number used to round robin over nis within a net */
 	__u32			ni_seq;
 
+	/* UDSP priority, lower is preferred */
+	__u32			ni_sel_priority;
+
 	/*
 	 * health value
 	 *	initialized to LNET_MAX_HEALTH_VALUE
@@ -582,6 +589,10 @@ struct lnet_peer_ni {
 	__u32			lpni_seq;
 	/* sequence number used to round robin over gateways */
 	__u32			lpni_gw_seq;
+	/* UDSP priority as a destination, lower is preferred */
+	__u32			lpni_sel_priority;
+	/* UDSP priority as a gateway, lower is preferred */
+	__u32			lpni_rtr_sel_priority;
 	/* returned RC ping features. Protected with lpni_lock */
 	unsigned int		lpni_ping_feats;
 	/* time last message was received from the peer */
@@ -811,6 +822,49 @@ struct lnet_peer_table {
 					((lp)->lpni_net) && \
 					(lp)->lpni_net->net_tunables.lct_peer_timeout > 0)
 
+/* # of free objects moved between a CPT cache and the depot at once */
+#define LNET_POOL_MAG_SIZE	32
+/* most free objects a CPT cache keeps, however busy the CPT is */
+#define LNET_POOL_CPT_MAX	4096
+/* seconds between two trims of the pools by the monitor thread */
+#define LNET_POOL_TRIM_INTERVAL	1
+
+/* free objects of a pool cached on one CPT */
+struct lnet_pool_cpt {
+	spinlock_t		pc_lock;
+	struct list_head	pc_free;
+	int			pc_nfree;
+	/* free objects kept, set from the allocations of the last interval */
+	int			pc_max;
+	/* allocations since the last trim */
+	int			pc_allocs;
+	/* allocations minus frees on this CPT, can be negative */
+	int			pc_inuse;
+};
+
+/* fixed size objects cached per CPT, backed by a global depot */
+struct lnet_obj_pool {
+	const char		*op_name;
+	size_t			op_size;
+	struct kmem_cache	*op_cache;
+	struct lnet_pool_cpt	**op_cpts;
+	spinlock_t		op_depot_lock;
+	struct list_head	op_depot;
+	int			op_depot_nfree;
+};
+
+/* User defined selection policy rule */
+struct lnet_udsp {
+	/* chain on the_lnet.ln_udsp_list */
+	struct list_head	udsp_on_list;
+	/* enum lnet_udsp_type */
+	__u32			udsp_type;
+	__u32			udsp_priority;
+	/* parsed udsp_nids */
+	struct list_head	udsp_nidlist;
+	char			udsp_nids[LNET_UDSP_NIDS_LEN];
+};
+
 struct lnet_route {
 	struct list_head	lr_list;	/* chain on net */
 	struct list_head	lr_gwlist;	/* chain on gateway */
@@ -843,21 +897,46 @@ struct lnet_remotenet {
 /** lnet message is waiting for discovery */
 #define LNET_DC_WAIT		2
 
+/* seconds between two autoscaling passes over the router buffer pools */
+#define LNET_RTRPOOL_SCALE_INTERVAL	1
+
+/* # of queues the messages blocking for a router buffer are hashed to */
+#define LNET_RTRQ_HASH_BITS	6
+#define LNET_RTRQ_HASH_SIZE	(1 << LNET_RTRQ_HASH_BITS)
+
+/* messages of the peers hashing to the same queue, blocking for a buffer */
+struct lnet_rtrbuf_queue {
+	/* chain on rbp_active while rq_msgs isn't empty */
+	struct list_head	rq_list;
+	/* blocked messages, oldest first */
+	struct list_head	rq_msgs;
+};
+
 struct lnet_rtrbufpool {
 	/* my free buffer pool */
 	struct list_head	rbp_bufs;
-	/* messages blocking for a buffer */
-	struct list_head	rbp_msgs;
+	/* queues of messages blocking for a buffer, served round-robin so
+	 * one busy peer can't starve the others */
+	struct list_head	rbp_active;
+	struct lnet_rtrbuf_queue rbp_queues[LNET_RTRQ_HASH_SIZE];
 	/* # pages in each buffer */
 	int			rbp_npages;
 	/* requested number of buffers */
 	int			rbp_req_nbuffers;
+	/* configured number of buffers, autoscaling never goes below it */
+	int			rbp_base_nbuffers;
 	/* # buffers actually allocated */
 	int			rbp_nbuffers;
 	/* # free buffers / blocked messages */
 	int			rbp_credits;
 	/* low water mark */
 	int			rbp_mincredits;
+	/* low water mark since the last autoscaling pass */
+	int			rbp_scale_mincredits;
+	/* # consecutive autoscaling passes with half the buffers idle */
+	int			rbp_idle_passes;
+	/* when the shrinker last took buffers away */
+	time64_t		rbp_shrink_time;
 };
 
 struct lnet_rtrbuf {
@@ -933,6 +1012,9 @@ struct lnet_match_table {
 #define	LNET_PTL_ROTOR_RR_RT	2
 /* dispatch routed PUT message by hashing source NID for wildcard portals */
 #define	LNET_PTL_ROTOR_HASH_RT	3
+/* dispatch PUT message to the CPT of the receiving NI's device, so it is
+ * handled by threads on the NUMA node of the NI */
+#define	LNET_PTL_ROTOR_DEV_CPT	4
 
 struct lnet_portal {
 	spinlock_t		ptl_lock;
@@ -1143,6 +1225,8 @@ struct lnet {
 	/* recovery eq handler */
 	struct lnet_handle_eq		ln_mt_eqh;
 
+	/* user defined selection policies, protected by ln_api_mutex */
+	struct list_head		ln_udsp_list;
 };
 
 #endif
@@ -292,4 +292,27 @@ struct lnet_ioctl_lnet_stats {
 	struct lnet_counters st_cntrs;
 };
 
+/* User defined selection policies */
+#define LNET_UDSP_NIDS_LEN	256
+#define LNET_UDSP_MAX_PRIORITY	((__u32) -1)
+
+enum lnet_udsp_type {
+	/* local NIs used to send */
+	LNET_UDSP_SRC	= 0,
+	/* peer NIs sent to */
+	LNET_UDSP_DST	= 1,
+	/* gateways used to reach a remote net */
+	LNET_UDSP_RTE	= 2,
+};
+
+struct lnet_ioctl_udsp {
+	struct libcfs_ioctl_hdr iou_hdr;
+	/* position in the rule list, -1 appends on add */
+	__s32 iou_idx;
+	__u32 iou_type;
+	/* lower values are preferred */
+	__u32 iou_priority;
+	char iou_nids[LNET_UDSP_NIDS_LEN];
+};
+
 #endif /* _LNET_DLC_H_ */
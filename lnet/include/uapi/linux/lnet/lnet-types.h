@@ -253,9 +253,33 @@ struct lnet_counters_health {
 	__u32	lch_network_timeout_count;
 };
 
+/* payload placement relative to the NUMA node of the NI moving it */
+struct lnet_counters_numa {
+	__u32	lcn_local_count;
+	__u32	lcn_remote_count;
+	__u64	lcn_local_length;
+	__u64	lcn_remote_length;
+};
+
+/* occupancy of the message, ME and small MD pools */
+struct lnet_counters_pools {
+	__u32	lcp_msg_inuse;
+	__u32	lcp_msg_cached;
+	__u32	lcp_me_inuse;
+	__u32	lcp_me_cached;
+	__u32	lcp_md_inuse;
+	__u32	lcp_md_cached;
+};
+
+/*
+ * IOC_LIBCFS_GET_LNET_STATS only copies out as much of this as the caller
+ * passed, new counters must be added at the end.
+ */
 struct lnet_counters {
 	struct lnet_counters_common lct_common;
 	struct lnet_counters_health lct_health;
+	struct lnet_counters_numa lct_numa;
+	struct lnet_counters_pools lct_pools;
 };
 
 #define LNET_NI_STATUS_UP	0x15aac0de
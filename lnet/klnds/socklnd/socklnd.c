@@ -81,6 +81,9 @@ ksocknal_create_route(__u32 ipaddr, int port)
         route->ksnr_deleted = 0;
         route->ksnr_conn_count = 0;
         route->ksnr_share_count = 0;
+	memset(route->ksnr_conn_counts, 0, sizeof(route->ksnr_conn_counts));
+	route->ksnr_conns_full = 0;
+	route->ksnr_conns_refused = 0;
 
         return (route);
 }
@@ -356,6 +359,8 @@ ksocknal_associate_route_conn_locked(struct ksock_route *route, struct ksock_con
 
         route->ksnr_connected |= (1<<type);
         route->ksnr_conn_count++;
+	route->ksnr_conn_counts[type]++;
+	route->ksnr_conns_refused &= ~(1 << type);
 
         /* Successful connection => further attempts can
          * proceed immediately */
@@ -682,6 +687,36 @@ ksocknal_choose_scheduler_locked(unsigned int cpt)
 	return sched;
 }
 
+/*
+ * Pick the least loaded scheduler of \a ni for another connection of a type
+ * the peer_ni already has, so that a single flow isn't bound to the cores
+ * of one CPT.
+ */
+static unsigned int
+ksocknal_spread_cpt_locked(struct lnet_ni *ni, unsigned int cpt)
+{
+	struct ksock_sched *sched;
+	int ncpts;
+	int nconns;
+	int i;
+
+	ncpts = ni->ni_cpts == NULL ? cfs_cpt_number(lnet_cpt_table()) :
+				      ni->ni_ncpts;
+	nconns = ksocknal_data.ksnd_schedulers[cpt]->kss_nconns;
+
+	for (i = 0; i < ncpts; i++) {
+		int c = ni->ni_cpts == NULL ? i : ni->ni_cpts[i];
+
+		sched = ksocknal_data.ksnd_schedulers[c];
+		if (sched->kss_nthreads > 0 && sched->kss_nconns < nconns) {
+			nconns = sched->kss_nconns;
+			cpt = c;
+		}
+	}
+
+	return cpt;
+}
+
 static int
 ksocknal_local_ipvec(struct lnet_ni *ni, __u32 *ipaddrs)
 {
@@ -1032,6 +1067,7 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
 	int rc;
 	int rc2;
 	int active;
+	int ndup = 0;
 	char *warn = NULL;
 
         active = (route != NULL);
@@ -1206,8 +1242,8 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
                 goto failed_2;
         }
 
-	/* Refuse to duplicate an existing connection, unless this is a
-	 * loopback connection */
+	/* Refuse to duplicate an existing connection beyond conns_per_peer,
+	 * unless this is a loopback connection */
 	if (conn->ksnc_ipaddr != conn->ksnc_myipaddr) {
 		list_for_each(tmp, &peer_ni->ksnp_conns) {
 			conn2 = list_entry(tmp, struct ksock_conn, ksnc_list);
@@ -1217,6 +1253,9 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
                             conn2->ksnc_type != conn->ksnc_type)
                                 continue;
 
+			if (++ndup < ksocknal_conns_per_type(conn->ksnc_type))
+				continue;
+
                         /* Reply on a passive connection attempt so the peer_ni
                          * realises we're connected. */
                         LASSERT (rc == 0);
@@ -1258,6 +1297,10 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
 	peer_ni->ksnp_send_keepalive = 0;
 	peer_ni->ksnp_error = 0;
 
+	/* spread the extra connections of a type over the schedulers */
+	if (ndup > 0)
+		cpt = ksocknal_spread_cpt_locked(ni, cpt);
+
 	sched = ksocknal_choose_scheduler_locked(cpt);
 	if (!sched) {
 		CERROR("no schedulers available. node is unhealthy\n");
@@ -1271,7 +1314,7 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
         sched->kss_nconns++;
         conn->ksnc_scheduler = sched;
 
-	conn->ksnc_tx_last_post = ktime_get_seconds();
+	conn->ksnc_tx_last_post = ktime_get();
 	/* Set the deadline for the outgoing HELLO to drain */
 	conn->ksnc_tx_bufnob = sock->sk->sk_wmem_queued;
 	conn->ksnc_tx_deadline = ktime_get_seconds() +
@@ -1423,8 +1466,6 @@ ksocknal_close_conn_locked(struct ksock_conn *conn, int error)
          * Caller holds ksnd_global_lock exclusively in irq context */
 	struct ksock_peer_ni *peer_ni = conn->ksnc_peer;
 	struct ksock_route *route;
-	struct ksock_conn *conn2;
-	struct list_head *tmp;
 
 	LASSERT(peer_ni->ksnp_error == 0);
 	LASSERT(!conn->ksnc_closing);
@@ -1438,19 +1479,13 @@ ksocknal_close_conn_locked(struct ksock_conn *conn, int error)
 		/* dissociate conn from route... */
 		LASSERT(!route->ksnr_deleted);
 		LASSERT((route->ksnr_connected & (1 << conn->ksnc_type)) != 0);
+		LASSERT(route->ksnr_conn_counts[conn->ksnc_type] > 0);
 
-		conn2 = NULL;
-		list_for_each(tmp, &peer_ni->ksnp_conns) {
-			conn2 = list_entry(tmp, struct ksock_conn, ksnc_list);
-
-			if (conn2->ksnc_route == route &&
-			    conn2->ksnc_type == conn->ksnc_type)
-				break;
-
-			conn2 = NULL;
-		}
-		if (conn2 == NULL)
+		if (--route->ksnr_conn_counts[conn->ksnc_type] == 0) {
 			route->ksnr_connected &= ~(1 << conn->ksnc_type);
+			route->ksnr_conns_full &= ~(1 << conn->ksnc_type);
+			route->ksnr_conns_refused &= ~(1 << conn->ksnc_type);
+		}
 
 		conn->ksnc_route = NULL;
 
@@ -50,6 +50,9 @@
 #include <linux/unistd.h>
 #include <net/sock.h>
 #include <net/tcp.h>
+#ifdef HAVE_SOCK_RECVMSG_BVEC
+#include <linux/bvec.h>
+#endif
 
 #include <lnet/lib-lnet.h>
 #include <lnet/socklnd.h>
@@ -74,6 +77,7 @@
 #define SOCKNAL_RESCHED         100             /* # scheduler loops before reschedule */
 #define SOCKNAL_INSANITY_RECONN 5000            /* connd is trying on reconn infinitely */
 #define SOCKNAL_ENOMEM_RETRY    1		/* seconds between retries */
+#define SOCKNAL_CONNS_PER_PEER_MAX 16		/* max conns_per_peer */
 
 #define SOCKNAL_SINGLE_FRAG_TX      0           /* disable multi-fragment sends */
 #define SOCKNAL_SINGLE_FRAG_RX      0           /* disable multi-fragment receives */
@@ -152,6 +156,7 @@ struct ksock_tunables {
         unsigned int     *ksnd_zc_min_payload;  /* minimum zero copy payload size */
         int              *ksnd_zc_recv;         /* enable ZC receive (for Chelsio TOE) */
         int              *ksnd_zc_recv_min_nfrags; /* minimum # of fragments to enable ZC receive */
+	int		 *ksnd_conns_per_peer;	/* # conns of each bulk type per peer_ni */
 #ifdef CPU_AFFINITY
         int              *ksnd_irq_affinity;    /* enable IRQ affinity? */
 #endif
@@ -368,7 +373,7 @@ struct ksock_conn {
 	/* being progressed */
 	int			ksnc_tx_scheduled;
 	/* time stamp of the last posted TX */
-	time64_t		ksnc_tx_last_post;
+	ktime_t			ksnc_tx_last_post;
 };
 
 struct ksock_route {
@@ -387,6 +392,12 @@ struct ksock_route {
         unsigned int          ksnr_deleted:1;   /* been removed from peer_ni? */
         unsigned int          ksnr_share_count; /* created explicitly? */
         int                   ksnr_conn_count;  /* # conns established by this route */
+	/* # conns established by type */
+	unsigned int	      ksnr_conn_counts[SOCKLND_CONN_NTYPES];
+	/* types the peer_ni refused more conns of */
+	unsigned int	      ksnr_conns_full:4;
+	/* types the peer_ni refused the last conn attempt of */
+	unsigned int	      ksnr_conns_refused:4;
 };
 
 #define SOCKNAL_KEEPALIVE_PING          1       /* cookie for keepalive ping */
@@ -483,6 +494,35 @@ ksocknal_route_mask(void)
                 (1 << SOCKLND_CONN_BULK_OUT));
 }
 
+/* # connections of \a type to establish to each peer_ni */
+static inline int
+ksocknal_conns_per_type(int type)
+{
+	/* only bulk data gains from more than one socket */
+	if (type == SOCKLND_CONN_CONTROL)
+		return 1;
+
+	/* conns_per_peer can be changed at any time through sysfs */
+	return clamp_t(int, *ksocknal_tunables.ksnd_conns_per_peer,
+		       1, SOCKNAL_CONNS_PER_PEER_MAX);
+}
+
+/* types of connection \a route still has to establish */
+static inline int
+ksocknal_route_wanted(struct ksock_route *route)
+{
+	int wanted = ksocknal_route_mask() & ~route->ksnr_conns_full;
+	int type;
+
+	for (type = 0; type < SOCKLND_CONN_NTYPES; type++) {
+		if (route->ksnr_conn_counts[type] >=
+		    ksocknal_conns_per_type(type))
+			wanted &= ~(1 << type);
+	}
+
+	return wanted;
+}
+
 static inline struct list_head *
 ksocknal_nid2peerlist (lnet_nid_t nid)
 {
@@ -663,7 +703,8 @@ extern void ksocknal_lib_eager_ack(struct ksock_conn *conn);
 extern int ksocknal_lib_recv_iov(struct ksock_conn *conn,
 				 struct kvec *scratchiov);
 extern int ksocknal_lib_recv_kiov(struct ksock_conn *conn, struct page **pages,
-		       struct kvec *scratchiov);
+				  struct kvec *scratchiov,
+				  struct bio_vec *scratch_bvec);
 extern int ksocknal_lib_get_conn_tunables(struct ksock_conn *conn, int *txmem,
 					  int *rxmem, int *nagle);
 
@@ -301,7 +301,7 @@ ksocknal_recv_iov(struct ksock_conn *conn, struct kvec *scratchiov)
 
 static int
 ksocknal_recv_kiov(struct ksock_conn *conn, struct page **rx_scratch_pgs,
-		   struct kvec *scratch_iov)
+		   struct kvec *scratch_iov, struct bio_vec *rx_scratch_bvec)
 {
 	lnet_kiov_t *kiov = conn->ksnc_rx_kiov;
 	int nob;
@@ -310,7 +310,8 @@ ksocknal_recv_kiov(struct ksock_conn *conn, struct page **rx_scratch_pgs,
 
 	/* Never touch conn->ksnc_rx_kiov or change connection
 	 * status inside ksocknal_lib_recv_iov */
-	rc = ksocknal_lib_recv_kiov(conn, rx_scratch_pgs, scratch_iov);
+	rc = ksocknal_lib_recv_kiov(conn, rx_scratch_pgs, scratch_iov,
+				    rx_scratch_bvec);
 
 	if (rc <= 0)
 		return rc;
@@ -346,7 +347,7 @@ ksocknal_recv_kiov(struct ksock_conn *conn, struct page **rx_scratch_pgs,
 
 static int
 ksocknal_receive(struct ksock_conn *conn, struct page **rx_scratch_pgs,
-		 struct kvec *scratch_iov)
+		 struct kvec *scratch_iov, struct bio_vec *rx_scratch_bvec)
 {
 	/* Return 1 on success, 0 on EOF, < 0 on error.
 	 * Caller checks ksnc_rx_nob_wanted to determine
@@ -370,7 +371,7 @@ ksocknal_receive(struct ksock_conn *conn, struct page **rx_scratch_pgs,
 			rc = ksocknal_recv_iov(conn, scratch_iov);
 		else
 			rc = ksocknal_recv_kiov(conn, rx_scratch_pgs,
-						 scratch_iov);
+						scratch_iov, rx_scratch_bvec);
 
 		if (rc <= 0) {
 			/* error/EOF or partial receive */
@@ -647,7 +648,7 @@ ksocknal_launch_connection_locked(struct ksock_route *route)
 
         LASSERT (!route->ksnr_scheduled);
         LASSERT (!route->ksnr_connecting);
-        LASSERT ((ksocknal_route_mask() & ~route->ksnr_connected) != 0);
+	LASSERT(ksocknal_route_wanted(route) != 0);
 
         route->ksnr_scheduled = 1;              /* scheduling conn for connd */
         ksocknal_route_addref(route);           /* extra ref for connd */
@@ -709,7 +710,8 @@ ksocknal_find_conn_locked(struct ksock_peer_ni *peer_ni, struct ksock_tx *tx, in
                 case SOCKNAL_MATCH_YES: /* typed connection */
                         if (typed == NULL || tnob > nob ||
                             (tnob == nob && *ksocknal_tunables.ksnd_round_robin &&
-			     typed->ksnc_tx_last_post > c->ksnc_tx_last_post)) {
+			     ktime_after(typed->ksnc_tx_last_post,
+					 c->ksnc_tx_last_post))) {
                                 typed = c;
                                 tnob  = nob;
                         }
@@ -718,7 +720,8 @@ ksocknal_find_conn_locked(struct ksock_peer_ni *peer_ni, struct ksock_tx *tx, in
                 case SOCKNAL_MATCH_MAY: /* fallback connection */
                         if (fallback == NULL || fnob > nob ||
                             (fnob == nob && *ksocknal_tunables.ksnd_round_robin &&
-			     fallback->ksnc_tx_last_post > c->ksnc_tx_last_post)) {
+			     ktime_after(fallback->ksnc_tx_last_post,
+					 c->ksnc_tx_last_post))) {
                                 fallback = c;
                                 fnob     = nob;
                         }
@@ -730,7 +733,7 @@ ksocknal_find_conn_locked(struct ksock_peer_ni *peer_ni, struct ksock_tx *tx, in
         conn = (typed != NULL) ? typed : fallback;
 
         if (conn != NULL)
-		conn->ksnc_tx_last_post = ktime_get_seconds();
+		conn->ksnc_tx_last_post = ktime_get();
 
         return conn;
 }
@@ -848,9 +851,9 @@ ksocknal_find_connectable_route_locked(struct ksock_peer_ni *peer_ni)
                 if (route->ksnr_scheduled)      /* connections being established */
                         continue;
 
-                /* all route types connected ? */
-                if ((ksocknal_route_mask() & ~route->ksnr_connected) == 0)
-                        continue;
+		/* all route types connected ? */
+		if (ksocknal_route_wanted(route) == 0)
+			continue;
 
                 if (!(route->ksnr_retry_interval == 0 || /* first attempt */
 		      now >= route->ksnr_timeout)) {
@@ -1173,7 +1176,8 @@ ksocknal_new_packet(struct ksock_conn *conn, int nob_to_skip)
 static int
 ksocknal_process_receive(struct ksock_conn *conn,
 			 struct page **rx_scratch_pgs,
-			 struct kvec *scratch_iov)
+			 struct kvec *scratch_iov,
+			 struct bio_vec *rx_scratch_bvec)
 {
 	struct lnet_hdr *lhdr;
 	struct lnet_process_id *id;
@@ -1190,7 +1194,7 @@ ksocknal_process_receive(struct ksock_conn *conn,
  again:
 	if (conn->ksnc_rx_nob_wanted != 0) {
 		rc = ksocknal_receive(conn, rx_scratch_pgs,
-				      scratch_iov);
+				      scratch_iov, rx_scratch_bvec);
 
 		if (rc <= 0) {
 			struct lnet_process_id ksnp_id;
@@ -1467,6 +1471,7 @@ int ksocknal_scheduler(void *arg)
 	long id = (long)arg;
 	struct page **rx_scratch_pgs;
 	struct kvec *scratch_iov;
+	struct bio_vec *rx_scratch_bvec = NULL;
 
 	sched = ksocknal_data.ksnd_schedulers[KSOCK_THREAD_CPT(id)];
 
@@ -1484,6 +1489,15 @@ int ksocknal_scheduler(void *arg)
 		return -ENOMEM;
 	}
 
+#ifdef HAVE_SOCK_RECVMSG_BVEC
+	LIBCFS_CPT_ALLOC(rx_scratch_bvec, lnet_cpt_table(), sched->kss_cpt,
+			 sizeof(*rx_scratch_bvec) * LNET_MAX_IOV);
+	if (!rx_scratch_bvec) {
+		CERROR("Unable to allocate scratch bvec\n");
+		return -ENOMEM;
+	}
+#endif
+
 	cfs_block_allsigs();
 
 	rc = cfs_cpt_bind(lnet_cpt_table(), sched->kss_cpt);
@@ -1515,7 +1529,8 @@ int ksocknal_scheduler(void *arg)
 			spin_unlock_bh(&sched->kss_lock);
 
 			rc = ksocknal_process_receive(conn, rx_scratch_pgs,
-						      scratch_iov);
+						      scratch_iov,
+						      rx_scratch_bvec);
 
 			spin_lock_bh(&sched->kss_lock);
 
@@ -1639,6 +1654,10 @@ int ksocknal_scheduler(void *arg)
 		    LNET_MAX_IOV);
 	LIBCFS_FREE(scratch_iov, sizeof(*scratch_iov) *
 		    LNET_MAX_IOV);
+#ifdef HAVE_SOCK_RECVMSG_BVEC
+	LIBCFS_FREE(rx_scratch_bvec, sizeof(*rx_scratch_bvec) *
+		    LNET_MAX_IOV);
+#endif
 	ksocknal_thread_fini();
 	return 0;
 }
@@ -1952,7 +1971,7 @@ ksocknal_connect(struct ksock_route *route)
         route->ksnr_connecting = 1;
 
         for (;;) {
-                wanted = ksocknal_route_mask() & ~route->ksnr_connected;
+		wanted = ksocknal_route_wanted(route);
 
                 /* stop connecting if peer_ni/route got closed under me, or
                  * route got connected while queued */
@@ -2016,6 +2035,25 @@ ksocknal_connect(struct ksock_route *route)
                                libcfs_nid2str(peer_ni->ksnp_id.nid));
 
 		write_lock_bh(&ksocknal_data.ksnd_global_lock);
+
+		/* The peer_ni already has a connection of this type and
+		 * refused another one: it has a lower conns_per_peer.
+		 * A peer_ni with a higher NID also refuses me to resolve a
+		 * race with its own connection to me, so only believe it
+		 * once it refused two attempts in a row. */
+		if (rc == EALREADY && route->ksnr_conn_counts[type] > 0) {
+			if (peer_ni->ksnp_id.nid < peer_ni->ksnp_ni->ni_nid ||
+			    (route->ksnr_conns_refused & (1 << type)) != 0) {
+				CDEBUG(D_NET,
+				       "peer_ni %s: no more conns of type %d\n",
+				       libcfs_nid2str(peer_ni->ksnp_id.nid),
+				       type);
+				route->ksnr_conns_full |= (1 << type);
+				retry_later = 0;
+			} else {
+				route->ksnr_conns_refused |= (1 << type);
+			}
+		}
         }
 
         route->ksnr_scheduled = 0;
@@ -299,9 +299,65 @@ ksocknal_lib_kiov_vmap(lnet_kiov_t *kiov, int niov,
         return addr;
 }
 
+#ifdef HAVE_SOCK_RECVMSG_BVEC
+/*
+ * Receive into the pages of the bulk through a bvec iterator, all fragments
+ * at once and without kmap()ing or vmap()ing them into a kvec first. The
+ * socket still copies the payload out of its skbs, this only saves the
+ * mappings.
+ */
+static int
+ksocknal_lib_recv_bvec(struct ksock_conn *conn, struct bio_vec *bvec)
+{
+	unsigned int niov = conn->ksnc_rx_nkiov;
+	lnet_kiov_t *kiov = conn->ksnc_rx_kiov;
+	struct msghdr msg = {
+		.msg_flags	= 0
+	};
+	void *base;
+	int fragnob;
+	int sum;
+	int nob;
+	int i;
+	int rc;
+
+	for (nob = i = 0; i < niov; i++) {
+		bvec[i].bv_page = kiov[i].kiov_page;
+		bvec[i].bv_offset = kiov[i].kiov_offset;
+		bvec[i].bv_len = kiov[i].kiov_len;
+		nob += kiov[i].kiov_len;
+	}
+
+	LASSERT(nob <= conn->ksnc_rx_nob_wanted);
+
+	iov_iter_bvec(&msg.msg_iter, READ, bvec, niov, nob);
+	rc = sock_recvmsg(conn->ksnc_sock, &msg, MSG_DONTWAIT);
+	if (rc <= 0)
+		return rc;
+
+	if (conn->ksnc_msg.ksm_csum != 0) {
+		for (i = 0, sum = rc; sum > 0; i++, sum -= fragnob) {
+			LASSERT(i < niov);
+
+			base = kmap(kiov[i].kiov_page) + kiov[i].kiov_offset;
+			fragnob = kiov[i].kiov_len;
+			if (fragnob > sum)
+				fragnob = sum;
+
+			conn->ksnc_rx_csum = ksocknal_csum(conn->ksnc_rx_csum,
+							   base, fragnob);
+
+			kunmap(kiov[i].kiov_page);
+		}
+	}
+
+	return rc;
+}
+#endif
+
 int
 ksocknal_lib_recv_kiov(struct ksock_conn *conn, struct page **pages,
-		       struct kvec *scratchiov)
+		       struct kvec *scratchiov, struct bio_vec *scratch_bvec)
 {
 #if SOCKNAL_SINGLE_FRAG_RX || !SOCKNAL_RISK_KMAP_DEADLOCK
 	struct kvec   scratch;
@@ -327,6 +383,12 @@ ksocknal_lib_recv_kiov(struct ksock_conn *conn, struct page **pages,
         int          fragnob;
 	int n;
 
+#ifdef HAVE_SOCK_RECVMSG_BVEC
+	/* the vmap()ed receive of zc_recv is kept for TOE drivers */
+	if (!*ksocknal_tunables.ksnd_zc_recv && scratch_bvec != NULL)
+		return ksocknal_lib_recv_bvec(conn, scratch_bvec);
+#endif
+
         /* NB we can't trust socket ops to either consume our iovs
          * or leave them alone. */
 	if ((addr = ksocknal_lib_kiov_vmap(kiov, niov, scratchiov, pages)) != NULL) {
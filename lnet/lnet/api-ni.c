@@ -555,43 +555,19 @@ lnet_fini_locks(void)
 {
 }
 
-struct kmem_cache *lnet_mes_cachep;	   /* MEs kmem_cache */
-struct kmem_cache *lnet_small_mds_cachep;  /* <= LNET_SMALL_MD_SIZE bytes
-					    *  MDs kmem_cache */
-
 static int
 lnet_descriptor_setup(void)
 {
-	/* create specific kmem_cache for MEs and small MDs (i.e., originally
-	 * allocated in <size-xxx> kmem_cache).
+	/* create per-CPT pools for messages, MEs and small MDs, which
+	 * every RPC allocates
 	 */
-	lnet_mes_cachep = kmem_cache_create("lnet_MEs", sizeof(struct lnet_me),
-					    0, 0, NULL);
-	if (!lnet_mes_cachep)
-		return -ENOMEM;
-
-	lnet_small_mds_cachep = kmem_cache_create("lnet_small_MDs",
-						  LNET_SMALL_MD_SIZE, 0, 0,
-						  NULL);
-	if (!lnet_small_mds_cachep)
-		return -ENOMEM;
-
-	return 0;
+	return lnet_pools_create();
 }
 
 static void
 lnet_descriptor_cleanup(void)
 {
-
-	if (lnet_small_mds_cachep) {
-		kmem_cache_destroy(lnet_small_mds_cachep);
-		lnet_small_mds_cachep = NULL;
-	}
-
-	if (lnet_mes_cachep) {
-		kmem_cache_destroy(lnet_mes_cachep);
-		lnet_mes_cachep = NULL;
-	}
+	lnet_pools_destroy();
 }
 
 static int
@@ -883,6 +859,7 @@ lnet_counters_get(struct lnet_counters *counters)
 {
 	struct lnet_counters *ctr;
 	struct lnet_counters_health *health = &counters->lct_health;
+	struct lnet_counters_numa *numa = &counters->lct_numa;
 	int		i;
 
 	memset(counters, 0, sizeof(*counters));
@@ -916,6 +893,10 @@ lnet_counters_get(struct lnet_counters *counters)
 				ctr->lct_health.lch_remote_timeout_count;
 		health->lch_network_timeout_count +=
 				ctr->lct_health.lch_network_timeout_count;
+		numa->lcn_local_count += ctr->lct_numa.lcn_local_count;
+		numa->lcn_remote_count += ctr->lct_numa.lcn_remote_count;
+		numa->lcn_local_length += ctr->lct_numa.lcn_local_length;
+		numa->lcn_remote_length += ctr->lct_numa.lcn_remote_length;
 	}
 	lnet_net_unlock(LNET_LOCK_EX);
 }
@@ -1132,6 +1113,7 @@ lnet_prepare(lnet_pid_t requested_pid)
 	INIT_LIST_HEAD(&the_lnet.ln_dc_expired);
 	INIT_LIST_HEAD(&the_lnet.ln_mt_localNIRecovq);
 	INIT_LIST_HEAD(&the_lnet.ln_mt_peerNIRecovq);
+	INIT_LIST_HEAD(&the_lnet.ln_udsp_list);
 	init_waitqueue_head(&the_lnet.ln_dc_waitq);
 	LNetInvalidateEQHandle(&the_lnet.ln_mt_eqh);
 
@@ -1238,6 +1220,7 @@ lnet_unprepare (void)
 	lnet_msg_containers_destroy();
 	lnet_peer_uninit();
 	lnet_rtrpools_free(0);
+	lnet_udsp_destroy();
 
 	if (the_lnet.ln_counters != NULL) {
 		cfs_percpt_free(the_lnet.ln_counters);
@@ -2235,6 +2218,7 @@ lnet_startup_lndni(struct lnet_ni *ni, struct lnet_lnd_tunables *tun)
 	atomic_set(&ni->ni_tx_credits,
 		   lnet_ni_tq_credits(ni) * ni->ni_ncpts);
 	atomic_set(&ni->ni_healthv, LNET_MAX_HEALTH_VALUE);
+	lnet_udsp_apply_to_ni(ni);
 
 	CDEBUG(D_LNI, "Added LNI %s [%d/%d/%d/%d]\n",
 		libcfs_nid2str(ni->ni_nid),
@@ -3674,13 +3658,32 @@ LNetCtl(unsigned int cmd, void *arg)
 	case IOC_LIBCFS_GET_LNET_STATS:
 	{
 		struct lnet_ioctl_lnet_stats *lnet_stats = arg;
-
-		if (lnet_stats->st_hdr.ioc_len < sizeof(*lnet_stats))
+		struct lnet_counters *counters;
+		size_t len = lnet_stats->st_hdr.ioc_len;
+
+		/* tools built before the NUMA and pool counters were added
+		 * pass a shorter struct, only fill in as much as they asked
+		 * for */
+		if (len < offsetof(struct lnet_ioctl_lnet_stats,
+				   st_cntrs.lct_numa))
 			return -EINVAL;
+		len = min(len, sizeof(*lnet_stats)) -
+		      offsetof(struct lnet_ioctl_lnet_stats, st_cntrs);
+
+		LIBCFS_ALLOC(counters, sizeof(*counters));
+		if (counters == NULL)
+			return -ENOMEM;
 
 		mutex_lock(&the_lnet.ln_api_mutex);
-		lnet_counters_get(&lnet_stats->st_cntrs);
+		lnet_counters_get(counters);
+		/* only walk the pools of every CPT for callers who see them */
+		if (len >= offsetof(struct lnet_counters, lct_pools) +
+			   sizeof(counters->lct_pools))
+			lnet_pools_get_stats(&counters->lct_pools);
 		mutex_unlock(&the_lnet.ln_api_mutex);
+
+		memcpy(&lnet_stats->st_cntrs, counters, len);
+		LIBCFS_FREE(counters, sizeof(*counters));
 		return 0;
 	}
 
@@ -3780,6 +3783,25 @@ LNetCtl(unsigned int cmd, void *arg)
 		return rc;
 	}
 
+	case IOC_LIBCFS_ADD_UDSP:
+	case IOC_LIBCFS_DEL_UDSP:
+	case IOC_LIBCFS_GET_UDSP: {
+		struct lnet_ioctl_udsp *udsp = arg;
+
+		if (udsp->iou_hdr.ioc_len < sizeof(*udsp))
+			return -EINVAL;
+
+		mutex_lock(&the_lnet.ln_api_mutex);
+		if (cmd == IOC_LIBCFS_ADD_UDSP)
+			rc = lnet_udsp_add(udsp);
+		else if (cmd == IOC_LIBCFS_DEL_UDSP)
+			rc = lnet_udsp_del(udsp->iou_idx);
+		else
+			rc = lnet_udsp_get(udsp);
+		mutex_unlock(&the_lnet.ln_api_mutex);
+		return rc;
+	}
+
 	case IOC_LIBCFS_ADD_PEER_NI: {
 		struct lnet_ioctl_peer_cfg *cfg = arg;
 
@@ -478,6 +478,9 @@ lnet_ni_alloc_common(struct lnet_net *net, char *iface)
 	ni->ni_net = net;
 	/* LND will fill in the address part of the NID */
 	ni->ni_nid = LNET_MKNID(net->net_id, 0);
+	/* and the CPT of its device if it knows it, the loopback NI has
+	 * none */
+	ni->ni_dev_cpt = CFS_CPT_ANY;
 
 	/* Store net namespace in which current ni is being created */
 	if (current->nsproxy->net_ns != NULL)
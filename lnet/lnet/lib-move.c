@@ -988,6 +988,21 @@ lnet_msg2bufpool(struct lnet_msg *msg)
 	return rbp;
 }
 
+/* queue \a msg behind the blocked messages of the peers hashing with its
+ * sender, the queues are served round-robin by lnet_schedule_blocked_locked
+ */
+static void
+lnet_rtrbuf_queue_msg(struct lnet_rtrbufpool *rbp, struct lnet_msg *msg)
+{
+	struct lnet_rtrbuf_queue *rq;
+
+	rq = &rbp->rbp_queues[hash_long(msg->msg_rxpeer->lpni_nid,
+					LNET_RTRQ_HASH_BITS)];
+	if (list_empty(&rq->rq_msgs))
+		list_add_tail(&rq->rq_list, &rbp->rbp_active);
+	list_add_tail(&msg->msg_list, &rq->rq_msgs);
+}
+
 static int
 lnet_post_routed_recv_locked(struct lnet_msg *msg, int do_recv)
 {
@@ -1045,12 +1060,14 @@ lnet_post_routed_recv_locked(struct lnet_msg *msg, int do_recv)
 		rbp->rbp_credits--;
 		if (rbp->rbp_credits < rbp->rbp_mincredits)
 			rbp->rbp_mincredits = rbp->rbp_credits;
+		if (rbp->rbp_credits < rbp->rbp_scale_mincredits)
+			rbp->rbp_scale_mincredits = rbp->rbp_credits;
 
 		if (rbp->rbp_credits < 0) {
 			/* must have checked eager_recv before here */
 			LASSERT(msg->msg_rx_ready_delay);
 			msg->msg_rx_delayed = 1;
-			list_add_tail(&msg->msg_list, &rbp->rbp_msgs);
+			lnet_rtrbuf_queue_msg(rbp, msg);
 			return LNET_CREDIT_WAIT;
 		}
 	}
@@ -1172,14 +1189,23 @@ lnet_return_tx_credits_locked(struct lnet_msg *msg)
 void
 lnet_schedule_blocked_locked(struct lnet_rtrbufpool *rbp)
 {
+	struct lnet_rtrbuf_queue *rq;
 	struct lnet_msg	*msg;
 
-	if (list_empty(&rbp->rbp_msgs))
+	if (list_empty(&rbp->rbp_active))
 		return;
-	msg = list_entry(rbp->rbp_msgs.next,
+	rq = list_entry(rbp->rbp_active.next,
+			struct lnet_rtrbuf_queue, rq_list);
+	msg = list_entry(rq->rq_msgs.next,
 			 struct lnet_msg, msg_list);
 	list_del(&msg->msg_list);
 
+	/* the next buffer goes to the next queue */
+	if (list_empty(&rq->rq_msgs))
+		list_del(&rq->rq_list);
+	else
+		list_move_tail(&rq->rq_list, &rbp->rbp_active);
+
 	(void)lnet_post_routed_recv_locked(msg, 1);
 }
 
@@ -1216,7 +1242,7 @@ lnet_return_rx_credits_locked(struct lnet_msg *msg)
 		struct lnet_rtrbuf *rb;
 		struct lnet_rtrbufpool *rbp;
 
-		/* NB If a msg ever blocks for a buffer in rbp_msgs, it stays
+		/* NB If a msg ever blocks for a buffer in rbp_queues, it stays
 		 * there until it gets one allocated, or aborts the wait
 		 * itself */
 		LASSERT(msg->msg_kiov != NULL);
@@ -1357,6 +1383,8 @@ lnet_select_peer_ni(struct lnet_ni *best_ni, lnet_nid_t dst_nid,
 	bool ni_is_pref;
 	int best_lpni_healthv = 0;
 	int lpni_healthv;
+	__u32 best_sel_prio = LNET_UDSP_MAX_PRIORITY;
+	__u32 lpni_sel_prio;
 
 	while ((lpni = lnet_get_next_peer_ni_locked(peer, peer_net, lpni))) {
 		/*
@@ -1373,18 +1401,25 @@ lnet_select_peer_ni(struct lnet_ni *best_ni, lnet_nid_t dst_nid,
 		}
 
 		lpni_healthv = atomic_read(&lpni->lpni_healthv);
+		lpni_sel_prio = lpni->lpni_sel_priority;
 
 		if (best_lpni)
-			CDEBUG(D_NET, "%s c:[%d, %d], s:[%d, %d]\n",
+			CDEBUG(D_NET, "%s c:[%d, %d], s:[%d, %d], p:[%u, %u]\n",
 				libcfs_nid2str(lpni->lpni_nid),
 				lpni->lpni_txcredits, best_lpni_credits,
-				lpni->lpni_seq, best_lpni->lpni_seq);
+				lpni->lpni_seq, best_lpni->lpni_seq,
+				lpni_sel_prio, best_sel_prio);
 
 		/* pick the healthiest peer ni */
 		if (lpni_healthv < best_lpni_healthv) {
 			continue;
 		} else if (lpni_healthv > best_lpni_healthv) {
 			best_lpni_healthv = lpni_healthv;
+		/* then the one the selection policies prefer */
+		} else if (lpni_sel_prio > best_sel_prio) {
+			continue;
+		} else if (lpni_sel_prio < best_sel_prio) {
+			preferred = ni_is_pref;
 		/* if this is a preferred peer use it */
 		} else if (!preferred && ni_is_pref) {
 			preferred = true;
@@ -1416,6 +1451,7 @@ lnet_select_peer_ni(struct lnet_ni *best_ni, lnet_nid_t dst_nid,
 
 		best_lpni = lpni;
 		best_lpni_credits = lpni->lpni_txcredits;
+		best_sel_prio = lpni_sel_prio;
 	}
 
 	/* if we still can't find a peer ni then we can't reach it */
@@ -1478,6 +1514,17 @@ lnet_compare_routes(struct lnet_route *r1, struct lnet_route *r2,
 	lpni2 = lnet_find_best_lpni_on_net(&sd, lp2, r2->lr_lnet);
 	LASSERT(lpni1 && lpni2);
 
+	/* gateways ranked by the selection policies come first */
+	if (lpni1->lpni_rtr_sel_priority < lpni2->lpni_rtr_sel_priority) {
+		*best_lpni = lpni1;
+		return 1;
+	}
+
+	if (lpni1->lpni_rtr_sel_priority > lpni2->lpni_rtr_sel_priority) {
+		*best_lpni = lpni2;
+		return -1;
+	}
+
 	if (r1->lr_priority < r2->lr_priority) {
 		*best_lpni = lpni1;
 		return 1;
@@ -1577,6 +1624,7 @@ lnet_get_best_ni(struct lnet_net *local_net, struct lnet_ni *best_ni,
 	unsigned int shortest_distance;
 	int best_credits;
 	int best_healthv;
+	__u32 best_sel_prio;
 
 	/*
 	 * If there is no peer_ni that we can send to on this network,
@@ -1589,11 +1637,13 @@ lnet_get_best_ni(struct lnet_net *local_net, struct lnet_ni *best_ni,
 		shortest_distance = UINT_MAX;
 		best_credits = INT_MIN;
 		best_healthv = 0;
+		best_sel_prio = LNET_UDSP_MAX_PRIORITY;
 	} else {
 		shortest_distance = cfs_cpt_distance(lnet_cpt_table(), md_cpt,
 						     best_ni->ni_dev_cpt);
 		best_credits = atomic_read(&best_ni->ni_tx_credits);
 		best_healthv = atomic_read(&best_ni->ni_healthv);
+		best_sel_prio = best_ni->ni_sel_priority;
 	}
 
 	while ((ni = lnet_get_next_ni_locked(local_net, ni))) {
@@ -1601,10 +1651,12 @@ lnet_get_best_ni(struct lnet_net *local_net, struct lnet_ni *best_ni,
 		int ni_credits;
 		int ni_healthv;
 		int ni_fatal;
+		__u32 ni_sel_prio;
 
 		ni_credits = atomic_read(&ni->ni_tx_credits);
 		ni_healthv = atomic_read(&ni->ni_healthv);
 		ni_fatal = atomic_read(&ni->ni_fatal_error_on);
+		ni_sel_prio = ni->ni_sel_priority;
 
 		/*
 		 * calculate the distance from the CPT on which
@@ -1615,11 +1667,12 @@ lnet_get_best_ni(struct lnet_net *local_net, struct lnet_ni *best_ni,
 					    md_cpt,
 					    ni->ni_dev_cpt);
 
-		CDEBUG(D_NET, "compare ni %s [c:%d, d:%d, s:%d] with best_ni %s [c:%d, d:%d, s:%d]\n",
+		CDEBUG(D_NET, "compare ni %s [c:%d, d:%d, s:%d, p:%u] with best_ni %s [c:%d, d:%d, s:%d, p:%u]\n",
 		       libcfs_nid2str(ni->ni_nid), ni_credits, distance,
-		       ni->ni_seq, (best_ni) ? libcfs_nid2str(best_ni->ni_nid)
+		       ni->ni_seq, ni_sel_prio,
+		       (best_ni) ? libcfs_nid2str(best_ni->ni_nid)
 			: "not seleced", best_credits, shortest_distance,
-			(best_ni) ? best_ni->ni_seq : 0);
+			(best_ni) ? best_ni->ni_seq : 0, best_sel_prio);
 
 		/*
 		 * All distances smaller than the NUMA range
@@ -1629,8 +1682,8 @@ lnet_get_best_ni(struct lnet_net *local_net, struct lnet_ni *best_ni,
 			distance = lnet_numa_range;
 
 		/*
-		 * Select on health, shorter distance, available
-		 * credits, then round-robin.
+		 * Select on health, selection policy priority, shorter
+		 * distance, available credits, then round-robin.
 		 */
 		if (ni_fatal) {
 			continue;
@@ -1647,6 +1700,10 @@ lnet_get_best_ni(struct lnet_net *local_net, struct lnet_ni *best_ni,
 			 */
 			if (distance < shortest_distance)
 				shortest_distance = distance;
+		} else if (ni_sel_prio > best_sel_prio) {
+			continue;
+		} else if (ni_sel_prio < best_sel_prio) {
+			shortest_distance = distance;
 		} else if (distance > shortest_distance) {
 			continue;
 		} else if (distance < shortest_distance) {
@@ -1659,6 +1716,7 @@ lnet_get_best_ni(struct lnet_net *local_net, struct lnet_ni *best_ni,
 		}
 		best_ni = ni;
 		best_credits = ni_credits;
+		best_sel_prio = ni_sel_prio;
 	}
 
 	CDEBUG(D_NET, "selected best_ni %s\n",
@@ -1803,6 +1861,9 @@ lnet_handle_send(struct lnet_send_data *sd)
 	 */
 	lnet_msg_commit(msg, sd->sd_cpt);
 
+	if (msg->msg_md)
+		lnet_msg_numa_locality(msg, best_ni, sd->sd_md_cpt);
+
 	/*
 	 * If we are routing the message then we keep the src_nid that was
 	 * set by the originator. If we are not routing then we are the
@@ -3442,6 +3503,8 @@ lnet_monitor_thread(void *arg)
 {
 	time64_t recovery_timeout = 0;
 	time64_t rsp_timeout = 0;
+	time64_t pool_timeout = 0;
+	time64_t rtrpool_timeout = 0;
 	int interval;
 	time64_t now;
 
@@ -3454,6 +3517,8 @@ lnet_monitor_thread(void *arg)
 	 *     pings them
 	 *  4. Checks if there are any NIs on the remote recovery queue
 	 *     and pings them.
+	 *  5. Trims the message and descriptor pools to the traffic.
+	 *  6. Grows or shrinks the router buffer pools with the demand.
 	 */
 	cfs_block_allsigs();
 
@@ -3476,6 +3541,16 @@ lnet_monitor_thread(void *arg)
 			recovery_timeout = now + lnet_recovery_interval;
 		}
 
+		if (now >= pool_timeout) {
+			lnet_pools_trim();
+			pool_timeout = now + LNET_POOL_TRIM_INTERVAL;
+		}
+
+		if (now >= rtrpool_timeout) {
+			lnet_rtrpools_autoscale();
+			rtrpool_timeout = now + LNET_RTRPOOL_SCALE_INTERVAL;
+		}
+
 		/*
 		 * TODO do we need to check if we should sleep without
 		 * timeout?  Technically, an active system will always
@@ -4828,6 +4903,7 @@ lnet_create_reply_msg(struct lnet_ni *ni, struct lnet_msg *getmsg)
 	msg->msg_receiving = 1; /* required by lnet_msg_attach_md */
 
 	lnet_msg_attach_md(msg, getmd, getmd->md_offset, getmd->md_length);
+	lnet_msg_numa_locality(msg, ni, lnet_cpt_of_md(getmd, 0));
 	lnet_res_unlock(cpt);
 
 	cpt = lnet_cpt_of_nid(peer_id.nid, ni);
@@ -177,6 +177,45 @@ lnet_msg_commit(struct lnet_msg *msg, int cpt)
 		common->lcc_msgs_max = common->lcc_msgs_alloc;
 }
 
+/*
+ * Note whether the payload of \a msg, which starts in CPT \a md_cpt, is
+ * on the NUMA node of the device of \a ni. Payload in a CPT farther away
+ * than the device's own CPT crosses the processor interconnect.
+ */
+void
+lnet_msg_numa_locality(struct lnet_msg *msg, struct lnet_ni *ni, int md_cpt)
+{
+	struct cfs_cpt_table *cptab = lnet_cpt_table();
+
+	msg->msg_numa_local = 0;
+	msg->msg_numa_remote = 0;
+
+	if (!ni || ni->ni_dev_cpt < 0 || md_cpt == CFS_CPT_ANY ||
+	    LNET_CPT_NUMBER == 1)
+		return;
+
+	if (cfs_cpt_distance(cptab, md_cpt, ni->ni_dev_cpt) >
+	    cfs_cpt_distance(cptab, ni->ni_dev_cpt, ni->ni_dev_cpt))
+		msg->msg_numa_remote = 1;
+	else
+		msg->msg_numa_local = 1;
+}
+
+static void
+lnet_msg_numa_stats(struct lnet_msg *msg, int cpt, __u64 nob)
+{
+	struct lnet_counters_numa *numa;
+
+	numa = &the_lnet.ln_counters[cpt]->lct_numa;
+	if (msg->msg_numa_local) {
+		numa->lcn_local_count++;
+		numa->lcn_local_length += nob;
+	} else if (msg->msg_numa_remote) {
+		numa->lcn_remote_count++;
+		numa->lcn_remote_length += nob;
+	}
+}
+
 static void
 lnet_msg_decommit_tx(struct lnet_msg *msg, int status)
 {
@@ -208,8 +247,11 @@ lnet_msg_decommit_tx(struct lnet_msg *msg, int status)
 
 	case LNET_EVENT_SEND:
 		LASSERT(!msg->msg_rx_committed);
-		if (msg->msg_type == LNET_MSG_PUT)
+		if (msg->msg_type == LNET_MSG_PUT) {
 			common->lcc_send_length += msg->msg_len;
+			lnet_msg_numa_stats(msg, msg->msg_tx_cpt,
+					    msg->msg_len);
+		}
 		break;
 
 	case LNET_EVENT_GET:
@@ -268,6 +310,7 @@ lnet_msg_decommit_rx(struct lnet_msg *msg, int status)
 		LASSERT(msg->msg_type == LNET_MSG_REPLY ||
 			msg->msg_type == LNET_MSG_GET);
 		common->lcc_send_length += msg->msg_wanted;
+		lnet_msg_numa_stats(msg, msg->msg_rx_cpt, msg->msg_wanted);
 		break;
 
 	case LNET_EVENT_PUT:
@@ -293,8 +336,10 @@ incr_stats:
 		lnet_incr_stats(&msg->msg_rxni->ni_stats,
 				msg->msg_type,
 				LNET_STATS_TYPE_RECV);
-	if (ev->type == LNET_EVENT_PUT || ev->type == LNET_EVENT_REPLY)
+	if (ev->type == LNET_EVENT_PUT || ev->type == LNET_EVENT_REPLY) {
 		common->lcc_recv_length += msg->msg_wanted;
+		lnet_msg_numa_stats(msg, msg->msg_rx_cpt, msg->msg_wanted);
+	}
 
  out:
 	lnet_return_rx_credits_locked(msg);
@@ -350,6 +395,8 @@ lnet_msg_attach_md(struct lnet_msg *msg, struct lnet_libmd *md,
 	if (msg->msg_receiving) { /* committed for receiving */
 		msg->msg_offset = offset;
 		msg->msg_wanted = mlen;
+		lnet_msg_numa_locality(msg, msg->msg_rxni,
+				       lnet_cpt_of_md(md, offset));
 	}
 
 	md->md_refcount++;
@@ -0,0 +1,304 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 021110-1307, USA
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lnet/lnet/lib-pool.c
+ *
+ * Per-CPT object pools for messages, MEs and small MDs
+ *
+ * Every CPT keeps a list of free objects. When it grows beyond what the
+ * CPT allocated in the last trim interval, a magazine of the coldest
+ * objects moves to a global depot, and an empty CPT list is refilled
+ * with a magazine from the depot before falling back to the slab. The
+ * monitor thread trims the CPT lists and the depot once per interval,
+ * so the cached objects follow the traffic.
+ */
+
+#define DEBUG_SUBSYSTEM S_LNET
+
+#include <lnet/lib-lnet.h>
+
+struct lnet_obj_pool lnet_msg_pool;
+struct lnet_obj_pool lnet_me_pool;
+struct lnet_obj_pool lnet_small_md_pool;
+
+/* move the \a count coldest free objects of \a pc to the depot */
+static void
+lnet_pool_drain(struct lnet_obj_pool *pool, struct lnet_pool_cpt *pc,
+		int count)
+{
+	LIST_HEAD(mag);
+	int i;
+
+	for (i = 0; i < count && pc->pc_nfree > 0; i++) {
+		list_move(pc->pc_free.prev, &mag);
+		pc->pc_nfree--;
+	}
+
+	spin_lock(&pool->op_depot_lock);
+	list_splice_tail(&mag, &pool->op_depot);
+	pool->op_depot_nfree += i;
+	spin_unlock(&pool->op_depot_lock);
+}
+
+/* move a magazine from the depot to the empty free list of \a pc */
+static void
+lnet_pool_refill(struct lnet_obj_pool *pool, struct lnet_pool_cpt *pc)
+{
+	int i;
+
+	spin_lock(&pool->op_depot_lock);
+	for (i = 0; i < LNET_POOL_MAG_SIZE && pool->op_depot_nfree > 0; i++) {
+		list_move(pool->op_depot.next, &pc->pc_free);
+		pool->op_depot_nfree--;
+	}
+	spin_unlock(&pool->op_depot_lock);
+
+	pc->pc_nfree += i;
+}
+
+void *
+lnet_pool_alloc(struct lnet_obj_pool *pool)
+{
+	struct lnet_pool_cpt *pc;
+	struct list_head *obj = NULL;
+
+	pc = pool->op_cpts[lnet_cpt_current()];
+
+	spin_lock(&pc->pc_lock);
+	pc->pc_allocs++;
+	pc->pc_inuse++;
+	if (pc->pc_nfree == 0)
+		lnet_pool_refill(pool, pc);
+	if (pc->pc_nfree > 0) {
+		obj = pc->pc_free.next;
+		list_del(obj);
+		pc->pc_nfree--;
+	}
+	spin_unlock(&pc->pc_lock);
+
+	if (obj) {
+		memset(obj, 0, pool->op_size);
+	} else {
+		obj = kmem_cache_alloc(pool->op_cache, GFP_NOFS | __GFP_ZERO);
+		if (!obj) {
+			CDEBUG(D_MALLOC, "failed to allocate '%s'\n",
+			       pool->op_name);
+			spin_lock(&pc->pc_lock);
+			pc->pc_inuse--;
+			spin_unlock(&pc->pc_lock);
+			return NULL;
+		}
+	}
+
+	return obj;
+}
+
+void
+lnet_pool_free(struct lnet_obj_pool *pool, void *obj)
+{
+	struct lnet_pool_cpt *pc;
+
+	pc = pool->op_cpts[lnet_cpt_current()];
+
+	spin_lock(&pc->pc_lock);
+	pc->pc_inuse--;
+	list_add((struct list_head *)obj, &pc->pc_free);
+	if (++pc->pc_nfree > pc->pc_max + LNET_POOL_MAG_SIZE)
+		lnet_pool_drain(pool, pc, LNET_POOL_MAG_SIZE);
+	spin_unlock(&pc->pc_lock);
+}
+
+static void
+lnet_pool_trim(struct lnet_obj_pool *pool)
+{
+	struct lnet_pool_cpt *pc;
+	struct list_head *obj;
+	struct list_head *tmp;
+	LIST_HEAD(zombies);
+	int i;
+
+	cfs_percpt_for_each(pc, i, pool->op_cpts) {
+		spin_lock(&pc->pc_lock);
+		pc->pc_max = clamp(pc->pc_allocs, LNET_POOL_MAG_SIZE,
+				   LNET_POOL_CPT_MAX);
+		pc->pc_allocs = 0;
+		if (pc->pc_nfree > pc->pc_max)
+			lnet_pool_drain(pool, pc, pc->pc_nfree - pc->pc_max);
+		spin_unlock(&pc->pc_lock);
+	}
+
+	/* the depot keeps one magazine per CPT for bursts */
+	spin_lock(&pool->op_depot_lock);
+	while (pool->op_depot_nfree > LNET_POOL_MAG_SIZE * LNET_CPT_NUMBER) {
+		list_move(pool->op_depot.prev, &zombies);
+		pool->op_depot_nfree--;
+	}
+	spin_unlock(&pool->op_depot_lock);
+
+	list_for_each_safe(obj, tmp, &zombies) {
+		list_del(obj);
+		kmem_cache_free(pool->op_cache, obj);
+	}
+}
+
+/* objects of \a pool allocated and not freed yet, over all CPTs */
+static int
+lnet_pool_inuse(struct lnet_obj_pool *pool)
+{
+	struct lnet_pool_cpt *pc;
+	int inuse = 0;
+	int i;
+
+	cfs_percpt_for_each(pc, i, pool->op_cpts)
+		inuse += READ_ONCE(pc->pc_inuse);
+
+	return inuse;
+}
+
+static void
+lnet_pool_get_stats(struct lnet_obj_pool *pool, __u32 *inuse,
+		    __u32 *cached)
+{
+	struct lnet_pool_cpt *pc;
+	int i;
+
+	*inuse = max(lnet_pool_inuse(pool), 0);
+	*cached = pool->op_depot_nfree;
+	cfs_percpt_for_each(pc, i, pool->op_cpts)
+		*cached += pc->pc_nfree;
+}
+
+static void
+lnet_pool_fini(struct lnet_obj_pool *pool)
+{
+	struct lnet_pool_cpt *pc;
+	struct list_head *obj;
+	struct list_head *tmp;
+	int inuse;
+	int i;
+
+	if (pool->op_cpts) {
+		inuse = lnet_pool_inuse(pool);
+		if (inuse != 0)
+			CERROR("%d '%s' still in use\n", inuse, pool->op_name);
+
+		cfs_percpt_for_each(pc, i, pool->op_cpts) {
+			list_splice_init(&pc->pc_free, &pool->op_depot);
+			pc->pc_nfree = 0;
+		}
+		cfs_percpt_free(pool->op_cpts);
+		pool->op_cpts = NULL;
+	}
+
+	if (pool->op_cache) {
+		list_for_each_safe(obj, tmp, &pool->op_depot) {
+			list_del(obj);
+			kmem_cache_free(pool->op_cache, obj);
+		}
+		pool->op_depot_nfree = 0;
+
+		kmem_cache_destroy(pool->op_cache);
+		pool->op_cache = NULL;
+	}
+}
+
+static int
+lnet_pool_init(struct lnet_obj_pool *pool, const char *name, size_t size)
+{
+	struct lnet_pool_cpt *pc;
+	int i;
+
+	LASSERT(size >= sizeof(struct list_head));
+
+	pool->op_name = name;
+	pool->op_size = size;
+	spin_lock_init(&pool->op_depot_lock);
+	INIT_LIST_HEAD(&pool->op_depot);
+	pool->op_depot_nfree = 0;
+
+	pool->op_cache = kmem_cache_create(name, size, 0, 0, NULL);
+	if (!pool->op_cache)
+		return -ENOMEM;
+
+	pool->op_cpts = cfs_percpt_alloc(lnet_cpt_table(), sizeof(*pc));
+	if (!pool->op_cpts) {
+		lnet_pool_fini(pool);
+		return -ENOMEM;
+	}
+
+	cfs_percpt_for_each(pc, i, pool->op_cpts) {
+		spin_lock_init(&pc->pc_lock);
+		INIT_LIST_HEAD(&pc->pc_free);
+		pc->pc_max = LNET_POOL_MAG_SIZE;
+	}
+
+	return 0;
+}
+
+int
+lnet_pools_create(void)
+{
+	int rc;
+
+	rc = lnet_pool_init(&lnet_msg_pool, "lnet_msgs",
+			    sizeof(struct lnet_msg));
+	if (rc == 0)
+		rc = lnet_pool_init(&lnet_me_pool, "lnet_MEs",
+				    sizeof(struct lnet_me));
+	if (rc == 0)
+		rc = lnet_pool_init(&lnet_small_md_pool, "lnet_small_MDs",
+				    LNET_SMALL_MD_SIZE);
+	if (rc != 0)
+		lnet_pools_destroy();
+
+	return rc;
+}
+
+void
+lnet_pools_destroy(void)
+{
+	lnet_pool_fini(&lnet_small_md_pool);
+	lnet_pool_fini(&lnet_me_pool);
+	lnet_pool_fini(&lnet_msg_pool);
+}
+
+void
+lnet_pools_trim(void)
+{
+	lnet_pool_trim(&lnet_msg_pool);
+	lnet_pool_trim(&lnet_me_pool);
+	lnet_pool_trim(&lnet_small_md_pool);
+}
+
+void
+lnet_pools_get_stats(struct lnet_counters_pools *pools)
+{
+	lnet_pool_get_stats(&lnet_msg_pool, &pools->lcp_msg_inuse,
+			    &pools->lcp_msg_cached);
+	lnet_pool_get_stats(&lnet_me_pool, &pools->lcp_me_inuse,
+			    &pools->lcp_me_cached);
+	lnet_pool_get_stats(&lnet_small_md_pool, &pools->lcp_md_inuse,
+			    &pools->lcp_md_cached);
+}
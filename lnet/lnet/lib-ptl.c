@@ -283,6 +283,14 @@ lnet_mt_of_match(struct lnet_match_info *info, struct lnet_msg *msg)
 	routed = LNET_NIDNET(msg->msg_hdr.src_nid) !=
 		 LNET_NIDNET(msg->msg_hdr.dest_nid);
 
+	if (portal_rotor == LNET_PTL_ROTOR_DEV_CPT && msg->msg_rxni &&
+	    msg->msg_rxni->ni_dev_cpt >= 0 &&
+	    msg->msg_rxni->ni_dev_cpt < LNET_CPT_NUMBER) {
+		cpt = msg->msg_rxni->ni_dev_cpt;
+		if (ptl->ptl_mtables[cpt]->mt_enabled)
+			return ptl->ptl_mtables[cpt];
+	}
+
 	if (portal_rotor == LNET_PTL_ROTOR_OFF ||
 	    (portal_rotor != LNET_PTL_ROTOR_ON && !routed)) {
 		cpt = lnet_cpt_current();
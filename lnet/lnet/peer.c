@@ -178,6 +178,8 @@ lnet_peer_ni_alloc(lnet_nid_t nid)
 	lpni->lpni_nid = nid;
 	lpni->lpni_cpt = cpt;
 	atomic_set(&lpni->lpni_healthv, LNET_MAX_HEALTH_VALUE);
+	lpni->lpni_sel_priority = LNET_UDSP_MAX_PRIORITY;
+	lpni->lpni_rtr_sel_priority = LNET_UDSP_MAX_PRIORITY;
 
 	net = lnet_get_net_locked(LNET_NIDNET(nid));
 	lpni->lpni_net = net;
@@ -1223,6 +1225,7 @@ lnet_peer_attach_peer_ni(struct lnet_peer *lp,
 		ptable->pt_number++;
 		/* This is the 1st refcount on lpni. */
 		atomic_inc(&lpni->lpni_refcount);
+		lnet_udsp_apply_to_lpni_locked(lpni);
 	}
 
 	/* Detach the peer_ni from an existing peer, if necessary. */
@@ -23,6 +23,7 @@
 #define DEBUG_SUBSYSTEM S_LNET
 
 #include <linux/random.h>
+#include <libcfs/linux/linux-mem.h>
 #include <lnet/lib-lnet.h>
 
 #define LNET_NRB_TINY_MIN	512	/* min value for each CPT */
@@ -34,9 +35,20 @@
 #define LNET_NRB_LARGE		(LNET_NRB_LARGE_MIN * 4)
 #define LNET_NRB_LARGE_PAGES	((LNET_MTU + PAGE_SIZE - 1) >> \
 				  PAGE_SHIFT)
+/* most times a pool can grow beyond its configured size */
+#define LNET_RTRPOOL_AUTOSCALE_MAX	16
+/* autoscaling passes a pool stays half idle before it shrinks */
+#define LNET_RTRPOOL_IDLE_PASSES	30
+/* seconds a pool doesn't grow after the shrinker took buffers away */
+#define LNET_RTRPOOL_SHRINK_BACKOFF	30
+/* most pages a pool grows by in one autoscaling pass, which allocates
+ * them with ln_api_mutex held */
+#define LNET_RTRPOOL_GROW_PAGES		4096
 
 extern unsigned int lnet_current_net_count;
 
+static struct shrinker *lnet_rtrpools_shrinker;
+
 static char *forwarding = "";
 module_param(forwarding, charp, 0444);
 MODULE_PARM_DESC(forwarding, "Explicitly enable/disable forwarding between networks");
@@ -50,6 +62,44 @@ MODULE_PARM_DESC(small_router_buffers, "# of small (1 page) messages to buffer i
 static int large_router_buffers;
 module_param(large_router_buffers, int, 0444);
 MODULE_PARM_DESC(large_router_buffers, "# of large messages to buffer in the router");
+static int router_buffer_autoscale = 4;
+static int rtr_autoscale_set(const char *val, cfs_kernel_param_arg_t *kp);
+static struct kernel_param_ops param_ops_rtr_autoscale = {
+	.set = rtr_autoscale_set,
+	.get = param_get_int,
+};
+#define param_check_rtr_autoscale(name, p) \
+		__param_check(name, p, int)
+#ifdef HAVE_KERNEL_PARAM_OPS
+module_param(router_buffer_autoscale, rtr_autoscale, 0644);
+#else
+module_param_call(router_buffer_autoscale, rtr_autoscale_set, param_get_int,
+		  &router_buffer_autoscale, 0644);
+#endif
+MODULE_PARM_DESC(router_buffer_autoscale, "Max times a router buffer pool grows beyond its configured size under load (0 or 1 to disable, up to 16)");
+
+static int
+rtr_autoscale_set(const char *val, cfs_kernel_param_arg_t *kp)
+{
+	int value, rc;
+
+	rc = kstrtoint(val, 0, &value);
+	if (rc) {
+		CERROR("Invalid module parameter value for 'router_buffer_autoscale'\n");
+		return rc;
+	}
+
+	if (value < 0 || value > LNET_RTRPOOL_AUTOSCALE_MAX) {
+		CERROR("router_buffer_autoscale must be between 0 and %d\n",
+		       LNET_RTRPOOL_AUTOSCALE_MAX);
+		return -EINVAL;
+	}
+
+	*(int *)kp->arg = value;
+
+	return 0;
+}
+
 static int peer_buffer_credits;
 module_param(peer_buffer_credits, int, 0444);
 MODULE_PARM_DESC(peer_buffer_credits, "# router buffer credits per peer");
@@ -1044,6 +1094,7 @@ static void
 lnet_rtrpool_free_bufs(struct lnet_rtrbufpool *rbp, int cpt)
 {
 	int npages = rbp->rbp_npages;
+	struct lnet_rtrbuf_queue *rq;
 	struct lnet_rtrbuf *rb;
 	struct list_head tmp;
 
@@ -1053,7 +1104,12 @@ lnet_rtrpool_free_bufs(struct lnet_rtrbufpool *rbp, int cpt)
 	INIT_LIST_HEAD(&tmp);
 
 	lnet_net_lock(cpt);
-	list_splice_init(&rbp->rbp_msgs, &tmp);
+	while (!list_empty(&rbp->rbp_active)) {
+		rq = list_entry(rbp->rbp_active.next,
+				struct lnet_rtrbuf_queue, rq_list);
+		list_splice_tail_init(&rq->rq_msgs, &tmp);
+		list_del(&rq->rq_list);
+	}
 	lnet_drop_routed_msgs_locked(&tmp, cpt);
 	list_splice_init(&rbp->rbp_bufs, &tmp);
 	rbp->rbp_req_nbuffers = 0;
@@ -1069,8 +1125,11 @@ lnet_rtrpool_free_bufs(struct lnet_rtrbufpool *rbp, int cpt)
 	}
 }
 
+/* \a reset_min restarts the low water mark of the credits when the pool
+ * is configured, autoscaling keeps it */
 static int
-lnet_rtrpool_adjust_bufs(struct lnet_rtrbufpool *rbp, int nbufs, int cpt)
+lnet_rtrpool_adjust_bufs(struct lnet_rtrbufpool *rbp, int nbufs, int cpt,
+			 bool reset_min)
 {
 	struct list_head rb_list;
 	struct lnet_rtrbuf *rb;
@@ -1127,11 +1186,12 @@ lnet_rtrpool_adjust_bufs(struct lnet_rtrbufpool *rbp, int nbufs, int cpt)
 	list_splice_tail(&rb_list, &rbp->rbp_bufs);
 	rbp->rbp_nbuffers += num_buffers;
 	rbp->rbp_credits += num_buffers;
-	rbp->rbp_mincredits = rbp->rbp_credits;
+	if (reset_min)
+		rbp->rbp_mincredits = rbp->rbp_credits;
 	/* We need to schedule blocked msg using the newly
 	 * added buffers. */
 	while (!list_empty(&rbp->rbp_bufs) &&
-	       !list_empty(&rbp->rbp_msgs))
+	       !list_empty(&rbp->rbp_active))
 		lnet_schedule_blocked_locked(rbp);
 
 	lnet_net_unlock(cpt);
@@ -1148,10 +1208,110 @@ failed:
 	return -ENOMEM;
 }
 
+/* set the configured size of \a rbp, autoscaling starts again from it */
+static int
+lnet_rtrpool_set_bufs(struct lnet_rtrbufpool *rbp, int nbufs, int cpt)
+{
+	lnet_net_lock(cpt);
+	rbp->rbp_base_nbuffers = nbufs;
+	rbp->rbp_idle_passes = 0;
+	lnet_net_unlock(cpt);
+
+	return lnet_rtrpool_adjust_bufs(rbp, nbufs, cpt, true);
+}
+
+/* free up to \a nr idle buffers of \a rbp beyond rbp_req_nbuffers, the
+ * coldest first
+ */
+static int
+lnet_rtrpool_trim_bufs(struct lnet_rtrbufpool *rbp, int nr, int cpt)
+{
+	struct lnet_rtrbuf *rb;
+	LIST_HEAD(tmp);
+	int count = 0;
+
+	lnet_net_lock(cpt);
+	while (count < nr && rbp->rbp_nbuffers > rbp->rbp_req_nbuffers &&
+	       rbp->rbp_credits > 0) {
+		rb = list_entry(rbp->rbp_bufs.prev, struct lnet_rtrbuf,
+				rb_list);
+		list_move(&rb->rb_list, &tmp);
+		rbp->rbp_nbuffers--;
+		rbp->rbp_credits--;
+		count++;
+	}
+	lnet_net_unlock(cpt);
+
+	while (!list_empty(&tmp)) {
+		rb = list_entry(tmp.next, struct lnet_rtrbuf, rb_list);
+		list_del(&rb->rb_list);
+		lnet_destroy_rtrbuf(rb, rbp->rbp_npages);
+	}
+
+	return count;
+}
+
+/* grow \a rbp when messages had to wait for a buffer since the last pass,
+ * shrink it back when half of it stayed idle for a while
+ */
+static void
+lnet_rtrpool_autoscale(struct lnet_rtrbufpool *rbp, int cpt)
+{
+	int req_nbufs;
+	int max_nbufs;
+	int nbufs;
+
+	lnet_net_lock(cpt);
+	req_nbufs = nbufs = rbp->rbp_req_nbuffers;
+	max_nbufs = min_t(s64, (s64)rbp->rbp_base_nbuffers *
+				max(router_buffer_autoscale, 1), INT_MAX);
+
+	/* pretend messages were blocked waiting for buffers */
+	if (CFS_FAIL_CHECK_QUIET(CFS_FAIL_LNET_RTRPOOL_BUSY))
+		rbp->rbp_scale_mincredits = min(rbp->rbp_scale_mincredits, -1);
+
+	if (rbp->rbp_scale_mincredits < 0) {
+		rbp->rbp_idle_passes = 0;
+		/* grow by the shortfall, and at least by a quarter, but
+		 * not by more than LNET_RTRPOOL_GROW_PAGES at once */
+		if (ktime_get_seconds() - rbp->rbp_shrink_time >
+		    LNET_RTRPOOL_SHRINK_BACKOFF)
+			nbufs += min(max(-rbp->rbp_scale_mincredits,
+					 nbufs / 4),
+				     max(LNET_RTRPOOL_GROW_PAGES /
+					 max(rbp->rbp_npages, 1), 1));
+	} else if (rbp->rbp_scale_mincredits > nbufs / 2) {
+		if (++rbp->rbp_idle_passes >= LNET_RTRPOOL_IDLE_PASSES) {
+			rbp->rbp_idle_passes = 0;
+			nbufs -= nbufs / 4;
+		}
+	} else {
+		rbp->rbp_idle_passes = 0;
+	}
+
+	nbufs = clamp(nbufs, rbp->rbp_base_nbuffers, max_nbufs);
+	rbp->rbp_scale_mincredits = rbp->rbp_credits;
+	lnet_net_unlock(cpt);
+
+	if (nbufs == req_nbufs)
+		return;
+
+	CDEBUG(D_NET, "CPT %d: %d page router buffers %d -> %d\n",
+	       cpt, rbp->rbp_npages, req_nbufs, nbufs);
+
+	lnet_rtrpool_adjust_bufs(rbp, nbufs, cpt, false);
+	if (nbufs < req_nbufs)
+		lnet_rtrpool_trim_bufs(rbp, req_nbufs - nbufs, cpt);
+}
+
 static void
 lnet_rtrpool_init(struct lnet_rtrbufpool *rbp, int npages)
 {
-	INIT_LIST_HEAD(&rbp->rbp_msgs);
+	int i;
+
+	INIT_LIST_HEAD(&rbp->rbp_active);
+	for (i = 0; i < LNET_RTRQ_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&rbp->rbp_queues[i].rq_msgs);
 	INIT_LIST_HEAD(&rbp->rbp_bufs);
 
 	rbp->rbp_npages = npages;
@@ -1159,6 +1319,92 @@ lnet_rtrpool_init(struct lnet_rtrbufpool *rbp, int npages)
 	rbp->rbp_mincredits = 0;
 }
 
+/* # of idle buffers of \a rbp the shrinker can take back */
+static int
+lnet_rtrpool_excess(struct lnet_rtrbufpool *rbp)
+{
+	return max(min(rbp->rbp_credits,
+		       rbp->rbp_nbuffers - rbp->rbp_base_nbuffers), 0);
+}
+
+/* lower the size of \a rbp by up to \a nr buffers, but not below the
+ * configured size
+ */
+static int
+lnet_rtrpool_shrink(struct lnet_rtrbufpool *rbp, int nr, int cpt)
+{
+	lnet_net_lock(cpt);
+	nr = min(nr, lnet_rtrpool_excess(rbp));
+	if (nr > 0) {
+		rbp->rbp_req_nbuffers = max(rbp->rbp_nbuffers - nr,
+					    rbp->rbp_base_nbuffers);
+		rbp->rbp_shrink_time = ktime_get_seconds();
+	}
+	lnet_net_unlock(cpt);
+
+	return nr > 0 ? lnet_rtrpool_trim_bufs(rbp, nr, cpt) : 0;
+}
+
+/*
+ * buffers added by autoscaling can be reclaimed under memory pressure,
+ * a little race here is fine.
+ */
+static unsigned long lnet_rtrpools_shrink_count(struct shrinker *s,
+						struct shrink_control *sc)
+{
+	struct lnet_rtrbufpool *rtrp;
+	unsigned long count = 0;
+	int i;
+	int j;
+
+	cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
+		for (j = 0; j < LNET_NRBPOOLS; j++)
+			count += lnet_rtrpool_excess(&rtrp[j]);
+	}
+
+	return count;
+}
+
+static unsigned long lnet_rtrpools_shrink_scan(struct shrinker *s,
+					       struct shrink_control *sc)
+{
+	struct lnet_rtrbufpool *rtrp;
+	unsigned long freed = 0;
+	int i;
+	int j;
+
+	cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
+		for (j = LNET_NRBPOOLS - 1; j >= 0; j--) {
+			if (freed >= sc->nr_to_scan)
+				break;
+			freed += lnet_rtrpool_shrink(&rtrp[j],
+				min_t(unsigned long, sc->nr_to_scan - freed,
+				      INT_MAX), i);
+		}
+	}
+
+	CDEBUG(D_NET, "released %lu router buffers\n", freed);
+
+	return freed;
+}
+
+#ifndef HAVE_SHRINKER_COUNT
+static int lnet_rtrpools_shrink(SHRINKER_ARGS(sc, nr_to_scan, gfp_mask))
+{
+	struct shrink_control scv = {
+		.nr_to_scan = shrink_param(sc, nr_to_scan),
+		.gfp_mask   = shrink_param(sc, gfp_mask)
+	};
+#if !defined(HAVE_SHRINKER_WANT_SHRINK_PTR) && !defined(HAVE_SHRINK_CONTROL)
+	struct shrinker *shrinker = NULL;
+#endif
+
+	lnet_rtrpools_shrink_scan(shrinker, &scv);
+
+	return lnet_rtrpools_shrink_count(shrinker, &scv);
+}
+#endif /* HAVE_SHRINKER_COUNT */
+
 void
 lnet_rtrpools_free(int keep_pools)
 {
@@ -1175,6 +1421,8 @@ lnet_rtrpools_free(int keep_pools)
 	}
 
 	if (!keep_pools) {
+		remove_shrinker(lnet_rtrpools_shrinker);
+		lnet_rtrpools_shrinker = NULL;
 		cfs_percpt_free(the_lnet.ln_rtrpools);
 		the_lnet.ln_rtrpools = NULL;
 	}
@@ -1240,6 +1488,8 @@ lnet_nrb_large_calculate(void)
 int
 lnet_rtrpools_alloc(int im_a_router)
 {
+	DEF_SHRINKER_VAR(shvar, lnet_rtrpools_shrink,
+			 lnet_rtrpools_shrink_count, lnet_rtrpools_shrink_scan);
 	struct lnet_rtrbufpool *rtrp;
 	int	nrb_tiny;
 	int	nrb_small;
@@ -1285,26 +1535,32 @@ lnet_rtrpools_alloc(int im_a_router)
 
 	cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
 		lnet_rtrpool_init(&rtrp[LNET_TINY_BUF_IDX], 0);
-		rc = lnet_rtrpool_adjust_bufs(&rtrp[LNET_TINY_BUF_IDX],
-					      nrb_tiny, i);
+		rc = lnet_rtrpool_set_bufs(&rtrp[LNET_TINY_BUF_IDX],
+					   nrb_tiny, i);
 		if (rc != 0)
 			goto failed;
 
 		lnet_rtrpool_init(&rtrp[LNET_SMALL_BUF_IDX],
 				  LNET_NRB_SMALL_PAGES);
-		rc = lnet_rtrpool_adjust_bufs(&rtrp[LNET_SMALL_BUF_IDX],
-					      nrb_small, i);
+		rc = lnet_rtrpool_set_bufs(&rtrp[LNET_SMALL_BUF_IDX],
+					   nrb_small, i);
 		if (rc != 0)
 			goto failed;
 
 		lnet_rtrpool_init(&rtrp[LNET_LARGE_BUF_IDX],
 				  LNET_NRB_LARGE_PAGES);
-		rc = lnet_rtrpool_adjust_bufs(&rtrp[LNET_LARGE_BUF_IDX],
-					      nrb_large, i);
+		rc = lnet_rtrpool_set_bufs(&rtrp[LNET_LARGE_BUF_IDX],
+					   nrb_large, i);
 		if (rc != 0)
 			goto failed;
 	}
 
+	lnet_rtrpools_shrinker = set_shrinker(DEFAULT_SEEKS, &shvar);
+	if (lnet_rtrpools_shrinker == NULL) {
+		rc = -ENOMEM;
+		goto failed;
+	}
+
 	lnet_net_lock(LNET_LOCK_EX);
 	the_lnet.ln_routing = 1;
 	lnet_net_unlock(LNET_LOCK_EX);
@@ -1330,8 +1586,8 @@ lnet_rtrpools_adjust_helper(int tiny, int small, int large)
 		tiny_router_buffers = tiny;
 		nrb = lnet_nrb_tiny_calculate();
 		cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
-			rc = lnet_rtrpool_adjust_bufs(&rtrp[LNET_TINY_BUF_IDX],
-						      nrb, i);
+			rc = lnet_rtrpool_set_bufs(&rtrp[LNET_TINY_BUF_IDX],
+						   nrb, i);
 			if (rc != 0)
 				return rc;
 		}
@@ -1340,8 +1596,8 @@ lnet_rtrpools_adjust_helper(int tiny, int small, int large)
 		small_router_buffers = small;
 		nrb = lnet_nrb_small_calculate();
 		cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
-			rc = lnet_rtrpool_adjust_bufs(&rtrp[LNET_SMALL_BUF_IDX],
-						      nrb, i);
+			rc = lnet_rtrpool_set_bufs(&rtrp[LNET_SMALL_BUF_IDX],
+						   nrb, i);
 			if (rc != 0)
 				return rc;
 		}
@@ -1350,8 +1606,8 @@ lnet_rtrpools_adjust_helper(int tiny, int small, int large)
 		large_router_buffers = large;
 		nrb = lnet_nrb_large_calculate();
 		cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
-			rc = lnet_rtrpool_adjust_bufs(&rtrp[LNET_LARGE_BUF_IDX],
-						      nrb, i);
+			rc = lnet_rtrpool_set_bufs(&rtrp[LNET_LARGE_BUF_IDX],
+						   nrb, i);
 			if (rc != 0)
 				return rc;
 		}
@@ -1373,6 +1629,29 @@ lnet_rtrpools_adjust(int tiny, int small, int large)
 	return lnet_rtrpools_adjust_helper(tiny, small, large);
 }
 
+/* called from the monitor thread about once a second */
+void
+lnet_rtrpools_autoscale(void)
+{
+	struct lnet_rtrbufpool *rtrp;
+	int i;
+	int j;
+
+	/* the monitor thread is stopped with ln_api_mutex held, so skip
+	 * this pass rather than wait for it */
+	if (!mutex_trylock(&the_lnet.ln_api_mutex))
+		return;
+
+	if (the_lnet.ln_routing && the_lnet.ln_rtrpools != NULL) {
+		cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
+			for (j = 0; j < LNET_NRBPOOLS; j++)
+				lnet_rtrpool_autoscale(&rtrp[j], i);
+		}
+	}
+
+	mutex_unlock(&the_lnet.ln_api_mutex);
+}
+
 int
 lnet_rtrpools_enable(void)
 {
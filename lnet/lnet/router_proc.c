@@ -784,6 +784,12 @@ static struct lnet_portal_rotors	portal_rotors[] = {
 		.pr_desc  = "dispatch routed PUT message by hashing source "
 			    "NID for wildcard portals"
 	},
+	{
+		.pr_value = LNET_PTL_ROTOR_DEV_CPT,
+		.pr_name  = "DEV_CPT",
+		.pr_desc  = "dispatch PUT message to the CPT of the receiving "
+			    "NI's device for wildcard portals"
+	},
 	{
 		.pr_value = -1,
 		.pr_name  = NULL,
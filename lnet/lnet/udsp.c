@@ -0,0 +1,220 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 021110-1307, USA
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lnet/lnet/udsp.c
+ *
+ * User defined selection policies
+ *
+ * A rule maps a NID list to a priority for one kind of selection: the
+ * local NI messages are sent from, the peer NI they are sent to, or the
+ * gateway used to reach a remote net. The first matching rule wins and
+ * lower priorities are preferred. Priorities are resolved when a rule
+ * changes or a NI appears, so the send path only compares integers.
+ */
+
+#define DEBUG_SUBSYSTEM S_LNET
+
+#include <lnet/lib-lnet.h>
+
+/* the_lnet.ln_udsp_list is changed with both ln_api_mutex and the
+ * exclusive net lock held, so holding either one is enough to walk it.
+ */
+
+static __u32
+lnet_udsp_match(enum lnet_udsp_type type, lnet_nid_t nid)
+{
+	struct lnet_udsp *udsp;
+
+	list_for_each_entry(udsp, &the_lnet.ln_udsp_list, udsp_on_list) {
+		if (udsp->udsp_type == type &&
+		    cfs_match_nid(nid, &udsp->udsp_nidlist))
+			return udsp->udsp_priority;
+	}
+
+	return LNET_UDSP_MAX_PRIORITY;
+}
+
+void
+lnet_udsp_apply_to_ni(struct lnet_ni *ni)
+{
+	ni->ni_sel_priority = lnet_udsp_match(LNET_UDSP_SRC, ni->ni_nid);
+}
+
+void
+lnet_udsp_apply_to_lpni_locked(struct lnet_peer_ni *lpni)
+{
+	lpni->lpni_sel_priority = lnet_udsp_match(LNET_UDSP_DST,
+						  lpni->lpni_nid);
+	lpni->lpni_rtr_sel_priority = lnet_udsp_match(LNET_UDSP_RTE,
+						      lpni->lpni_nid);
+}
+
+/* called with ln_api_mutex and the exclusive net lock held */
+static void
+lnet_udsp_apply_all_locked(void)
+{
+	struct lnet_peer_table *ptable;
+	struct lnet_peer_ni *lpni;
+	struct lnet_net *net;
+	struct lnet_ni *ni;
+	int cpt;
+	int i;
+
+	list_for_each_entry(net, &the_lnet.ln_nets, net_list) {
+		list_for_each_entry(ni, &net->net_ni_list, ni_netlist)
+			lnet_udsp_apply_to_ni(ni);
+	}
+
+	cfs_percpt_for_each(ptable, cpt, the_lnet.ln_peer_tables) {
+		for (i = 0; i < LNET_PEER_HASH_SIZE; i++) {
+			list_for_each_entry(lpni, &ptable->pt_hash[i],
+					    lpni_hashlist)
+				lnet_udsp_apply_to_lpni_locked(lpni);
+		}
+	}
+}
+
+static struct lnet_udsp *
+lnet_udsp_find(int idx)
+{
+	struct lnet_udsp *udsp;
+
+	list_for_each_entry(udsp, &the_lnet.ln_udsp_list, udsp_on_list) {
+		if (idx-- == 0)
+			return udsp;
+	}
+
+	return NULL;
+}
+
+static void
+lnet_udsp_free(struct lnet_udsp *udsp)
+{
+	cfs_free_nidlist(&udsp->udsp_nidlist);
+	LIBCFS_FREE(udsp, sizeof(*udsp));
+}
+
+int
+lnet_udsp_add(struct lnet_ioctl_udsp *info)
+{
+	struct lnet_udsp *udsp;
+	struct lnet_udsp *pos;
+	int len;
+
+	if (info->iou_type > LNET_UDSP_RTE)
+		return -EINVAL;
+
+	len = strnlen(info->iou_nids, sizeof(info->iou_nids));
+	if (len == 0 || len == sizeof(info->iou_nids))
+		return -EINVAL;
+
+	LIBCFS_ALLOC(udsp, sizeof(*udsp));
+	if (!udsp)
+		return -ENOMEM;
+
+	memcpy(udsp->udsp_nids, info->iou_nids, len);
+	if (!cfs_parse_nidlist(udsp->udsp_nids, len, &udsp->udsp_nidlist)) {
+		LIBCFS_FREE(udsp, sizeof(*udsp));
+		return -EINVAL;
+	}
+	udsp->udsp_type = info->iou_type;
+	udsp->udsp_priority = info->iou_priority;
+
+	lnet_net_lock(LNET_LOCK_EX);
+	pos = info->iou_idx < 0 ? NULL : lnet_udsp_find(info->iou_idx);
+	if (pos)
+		list_add_tail(&udsp->udsp_on_list, &pos->udsp_on_list);
+	else
+		list_add_tail(&udsp->udsp_on_list, &the_lnet.ln_udsp_list);
+	lnet_udsp_apply_all_locked();
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	CDEBUG(D_NET, "added udsp type %u nids %s priority %u\n",
+	       udsp->udsp_type, udsp->udsp_nids, udsp->udsp_priority);
+
+	return 0;
+}
+
+/* a negative \a idx removes every rule */
+int
+lnet_udsp_del(int idx)
+{
+	struct lnet_udsp *udsp;
+	struct lnet_udsp *tmp;
+	LIST_HEAD(zombies);
+
+	lnet_net_lock(LNET_LOCK_EX);
+	if (idx < 0) {
+		list_splice_init(&the_lnet.ln_udsp_list, &zombies);
+	} else {
+		udsp = lnet_udsp_find(idx);
+		if (!udsp) {
+			lnet_net_unlock(LNET_LOCK_EX);
+			return -ENOENT;
+		}
+		list_move(&udsp->udsp_on_list, &zombies);
+	}
+	lnet_udsp_apply_all_locked();
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	list_for_each_entry_safe(udsp, tmp, &zombies, udsp_on_list) {
+		list_del(&udsp->udsp_on_list);
+		lnet_udsp_free(udsp);
+	}
+
+	return 0;
+}
+
+int
+lnet_udsp_get(struct lnet_ioctl_udsp *info)
+{
+	struct lnet_udsp *udsp;
+
+	if (info->iou_idx < 0)
+		return -EINVAL;
+
+	udsp = lnet_udsp_find(info->iou_idx);
+	if (!udsp)
+		return -ENOENT;
+
+	info->iou_type = udsp->udsp_type;
+	info->iou_priority = udsp->udsp_priority;
+	strlcpy(info->iou_nids, udsp->udsp_nids, sizeof(info->iou_nids));
+
+	return 0;
+}
+
+void
+lnet_udsp_destroy(void)
+{
+	struct lnet_udsp *udsp;
+	struct lnet_udsp *tmp;
+
+	list_for_each_entry_safe(udsp, tmp, &the_lnet.ln_udsp_list,
+				 udsp_on_list) {
+		list_del(&udsp->udsp_on_list);
+		lnet_udsp_free(udsp);
+	}
+}
@@ -1353,6 +1353,199 @@ out:
 	return rc;
 }
 
+static char *udsp_type2str[] = {
+	[LNET_UDSP_SRC] = "src",
+	[LNET_UDSP_DST] = "dst",
+	[LNET_UDSP_RTE] = "rte",
+};
+
+int lustre_lnet_add_udsp(char *src, char *dst, char *rte, long prio,
+			 int idx, int seq_no, struct cYAML **err_rc)
+{
+	struct lnet_ioctl_udsp data;
+	char err_str[LNET_MAX_STR_LEN];
+	char *nids;
+	int rc = LUSTRE_CFG_RC_NO_ERR;
+
+	snprintf(err_str, sizeof(err_str), "\"Success\"");
+
+	if (!!src + !!dst + !!rte != 1) {
+		snprintf(err_str, sizeof(err_str),
+			 "\"exactly one of src, dst or rte must be given\"");
+		rc = LUSTRE_CFG_RC_BAD_PARAM;
+		goto out;
+	}
+
+	if (prio < 0 || prio >= LNET_UDSP_MAX_PRIORITY) {
+		snprintf(err_str, sizeof(err_str),
+			 "\"invalid priority %ld, must be between 0 and %u\"",
+			 prio, LNET_UDSP_MAX_PRIORITY - 1);
+		rc = LUSTRE_CFG_RC_OUT_OF_RANGE_PARAM;
+		goto out;
+	}
+
+	LIBCFS_IOC_INIT_V2(data, iou_hdr);
+	if (src) {
+		data.iou_type = LNET_UDSP_SRC;
+		nids = src;
+	} else if (dst) {
+		data.iou_type = LNET_UDSP_DST;
+		nids = dst;
+	} else {
+		data.iou_type = LNET_UDSP_RTE;
+		nids = rte;
+	}
+
+	if (strlen(nids) >= sizeof(data.iou_nids)) {
+		snprintf(err_str, sizeof(err_str),
+			 "\"NID list too long, max %zu characters\"",
+			 sizeof(data.iou_nids) - 1);
+		rc = LUSTRE_CFG_RC_BAD_PARAM;
+		goto out;
+	}
+	strncpy(data.iou_nids, nids, sizeof(data.iou_nids) - 1);
+	data.iou_priority = prio;
+	data.iou_idx = idx;
+
+	rc = l_ioctl(LNET_DEV_ID, IOC_LIBCFS_ADD_UDSP, &data);
+	if (rc != 0) {
+		rc = -errno;
+		snprintf(err_str, sizeof(err_str),
+			 "\"cannot add udsp: %s\"", strerror(errno));
+	}
+
+out:
+	cYAML_build_error(rc, seq_no, ADD_CMD, "udsp", err_str, err_rc);
+
+	return rc;
+}
+
+int lustre_lnet_del_udsp(int idx, int seq_no, struct cYAML **err_rc)
+{
+	struct lnet_ioctl_udsp data;
+	char err_str[LNET_MAX_STR_LEN];
+	int rc;
+
+	snprintf(err_str, sizeof(err_str), "\"Success\"");
+
+	LIBCFS_IOC_INIT_V2(data, iou_hdr);
+	data.iou_idx = idx;
+
+	rc = l_ioctl(LNET_DEV_ID, IOC_LIBCFS_DEL_UDSP, &data);
+	if (rc != 0) {
+		rc = -errno;
+		snprintf(err_str, sizeof(err_str),
+			 "\"cannot delete udsp: %s\"", strerror(errno));
+	}
+
+	cYAML_build_error(rc, seq_no, DEL_CMD, "udsp", err_str, err_rc);
+
+	return rc;
+}
+
+int lustre_lnet_show_udsp(int idx, int seq_no, struct cYAML **show_rc,
+			  struct cYAML **err_rc)
+{
+	struct lnet_ioctl_udsp data;
+	struct cYAML *root = NULL, *udsp = NULL, *item = NULL;
+	struct cYAML *first_seq = NULL;
+	char err_str[LNET_MAX_STR_LEN];
+	int rc = LUSTRE_CFG_RC_OUT_OF_MEM;
+	int l_errno = 0;
+	bool exist = false;
+	int i;
+
+	snprintf(err_str, sizeof(err_str), "\"out of memory\"");
+
+	root = cYAML_create_object(NULL, NULL);
+	if (root == NULL)
+		goto out;
+
+	udsp = cYAML_create_seq(root, "udsp");
+	if (udsp == NULL)
+		goto out;
+
+	for (i = idx < 0 ? 0 : idx;; i++) {
+		LIBCFS_IOC_INIT_V2(data, iou_hdr);
+		data.iou_idx = i;
+
+		rc = l_ioctl(LNET_DEV_ID, IOC_LIBCFS_GET_UDSP, &data);
+		if (rc != 0) {
+			l_errno = errno;
+			break;
+		}
+
+		/* default rc to -1 incase we hit the goto */
+		rc = -1;
+		exist = true;
+
+		item = cYAML_create_seq_item(udsp);
+		if (item == NULL)
+			goto out;
+
+		if (first_seq == NULL)
+			first_seq = item;
+
+		if (cYAML_create_number(item, "idx", i) == NULL)
+			goto out;
+
+		if (data.iou_type > LNET_UDSP_RTE ||
+		    cYAML_create_string(item, udsp_type2str[data.iou_type],
+					data.iou_nids) == NULL)
+			goto out;
+
+		if (cYAML_create_number(item, "priority",
+					data.iou_priority) == NULL)
+			goto out;
+
+		if (idx >= 0) {
+			l_errno = ENOENT;
+			break;
+		}
+	}
+
+	/* print output iff show_rc is not provided */
+	if (show_rc == NULL)
+		cYAML_print_tree(root);
+
+	if (l_errno != ENOENT) {
+		snprintf(err_str, sizeof(err_str),
+			 "\"cannot get udsp: %s\"", strerror(l_errno));
+		rc = -l_errno;
+		goto out;
+	} else {
+		rc = LUSTRE_CFG_RC_NO_ERR;
+	}
+
+	snprintf(err_str, sizeof(err_str), "\"success\"");
+out:
+	if (show_rc == NULL || rc != LUSTRE_CFG_RC_NO_ERR || !exist) {
+		cYAML_free_tree(root);
+	} else if (show_rc != NULL && *show_rc != NULL) {
+		struct cYAML *show_node;
+		/* find the udsp node, if one doesn't exist then
+		 * insert one.  Otherwise add to the one there
+		 */
+		show_node = cYAML_get_object_item(*show_rc, "udsp");
+		if (show_node != NULL && cYAML_is_sequence(show_node)) {
+			cYAML_insert_child(show_node, first_seq);
+			free(udsp);
+			free(root);
+		} else if (show_node == NULL) {
+			cYAML_insert_sibling((*show_rc)->cy_child, udsp);
+			free(root);
+		} else {
+			cYAML_free_tree(root);
+		}
+	} else {
+		*show_rc = root;
+	}
+
+	cYAML_build_error(rc, seq_no, SHOW_CMD, "udsp", err_str, err_rc);
+
+	return rc;
+}
+
 static int socket_intf_query(int request, char *intf,
 			     struct ifreq *ifr)
 {
@@ -3919,6 +4112,46 @@ int lustre_lnet_show_stats(int seq_no, struct cYAML **show_rc,
 				 cntrs->lct_common.lcc_drop_length))
 		goto out;
 
+	if (!cYAML_create_number(stats, "numa_local_count",
+				 cntrs->lct_numa.lcn_local_count))
+		goto out;
+
+	if (!cYAML_create_number(stats, "numa_remote_count",
+				 cntrs->lct_numa.lcn_remote_count))
+		goto out;
+
+	if (!cYAML_create_number(stats, "numa_local_length",
+				 cntrs->lct_numa.lcn_local_length))
+		goto out;
+
+	if (!cYAML_create_number(stats, "numa_remote_length",
+				 cntrs->lct_numa.lcn_remote_length))
+		goto out;
+
+	if (!cYAML_create_number(stats, "msg_pool_inuse",
+				 cntrs->lct_pools.lcp_msg_inuse))
+		goto out;
+
+	if (!cYAML_create_number(stats, "msg_pool_cached",
+				 cntrs->lct_pools.lcp_msg_cached))
+		goto out;
+
+	if (!cYAML_create_number(stats, "me_pool_inuse",
+				 cntrs->lct_pools.lcp_me_inuse))
+		goto out;
+
+	if (!cYAML_create_number(stats, "me_pool_cached",
+				 cntrs->lct_pools.lcp_me_cached))
+		goto out;
+
+	if (!cYAML_create_number(stats, "md_pool_inuse",
+				 cntrs->lct_pools.lcp_md_inuse))
+		goto out;
+
+	if (!cYAML_create_number(stats, "md_pool_cached",
+				 cntrs->lct_pools.lcp_md_cached))
+		goto out;
+
 	if (!show_rc)
 		cYAML_print_tree(root);
 
@@ -135,6 +135,46 @@ int lustre_lnet_show_route(char *nw, char *gw,
 			   int seq_no, struct cYAML **show_rc,
 			   struct cYAML **err_rc, bool backup);
 
+/*
+ * lustre_lnet_add_udsp
+ *   Add a user defined selection policy rule. Messages prefer the
+ *   local NIs (src), peer NIs (dst) or gateways (rte) matching nids,
+ *   lower priorities first.
+ *
+ *   src - NID list of local NIs.
+ *   dst - NID list of peer NIs.
+ *   rte - NID list of gateways.
+ *	   Exactly one of src, dst and rte must be given.
+ *   prio - priority of the matching NIs, lower is preferred
+ *   idx - position in the rule list, -1 to append
+ *   seq_no - sequence number of the request
+ *   err_rc - [OUT] struct cYAML tree describing the error. Freed by caller
+ */
+int lustre_lnet_add_udsp(char *src, char *dst, char *rte, long prio,
+			 int idx, int seq_no, struct cYAML **err_rc);
+
+/*
+ * lustre_lnet_del_udsp
+ *   Delete a user defined selection policy rule
+ *
+ *   idx - position of the rule in the list, -1 to delete all rules
+ *   seq_no - sequence number of the request
+ *   err_rc - [OUT] struct cYAML tree describing the error. Freed by caller
+ */
+int lustre_lnet_del_udsp(int idx, int seq_no, struct cYAML **err_rc);
+
+/*
+ * lustre_lnet_show_udsp
+ *   Show the user defined selection policy rules in list order
+ *
+ *   idx - position of the rule to show, -1 to show all rules
+ *   seq_no - sequence number of the request
+ *   show_rc - [OUT] The show output in YAML.  Must be freed by caller.
+ *   err_rc - [OUT] struct cYAML tree describing the error. Freed by caller
+ */
+int lustre_lnet_show_udsp(int idx, int seq_no, struct cYAML **show_rc,
+			  struct cYAML **err_rc);
+
 /*
  * lustre_lnet_config_ni
  *   Send down an IOCTL to configure a network interface. It implicitly
@@ -82,6 +82,10 @@ static int jt_global(int argc, char **argv);
 static int jt_peers(int argc, char **argv);
 static int jt_set_ni_value(int argc, char **argv);
 static int jt_set_peer_ni_value(int argc, char **argv);
+static int jt_udsp(int argc, char **argv);
+static int jt_add_udsp(int argc, char **argv);
+static int jt_del_udsp(int argc, char **argv);
+static int jt_show_udsp(int argc, char **argv);
 
 command_t cmd_list[] = {
 	{"lnet", jt_lnet, 0, "lnet {configure | unconfigure} [--all]"},
@@ -99,6 +103,7 @@ command_t cmd_list[] = {
 	{"peer", jt_peers, 0, "peer {add | del | show | help}"},
 	{"ping", jt_ping, 0, "ping nid,[nid,...]"},
 	{"discover", jt_discover, 0, "discover nid[,nid,...]"},
+	{"udsp", jt_udsp, 0, "udsp {add | del | show | help}"},
 	{"help", Parser_help, 0, "help"},
 	{"exit", Parser_quit, 0, "quit"},
 	{"quit", Parser_quit, 0, "quit"},
@@ -242,6 +247,21 @@ command_t peer_cmds[] = {
 	{ 0, 0, 0, NULL }
 };
 
+command_t udsp_cmds[] = {
+	{"add", jt_add_udsp, 0, "add a selection policy rule\n"
+	 "\t--src: local NIs to prefer (e.g. 10.1.1.[2-5]@o2ib)\n"
+	 "\t--dst: peer NIs to prefer (e.g. *@tcp1)\n"
+	 "\t--rte: gateways to prefer (e.g. 10.1.1.2@tcp)\n"
+	 "\t--priority: priority of the matching NIs (0 - highest prio)\n"
+	 "\t--idx: position of the rule, appended if not given\n"},
+	{"del", jt_del_udsp, 0, "delete selection policy rules\n"
+	 "\t--idx: position of the rule to delete\n"
+	 "\t--all: delete all rules\n"},
+	{"show", jt_show_udsp, 0, "show selection policy rules\n"
+	 "\t--idx: position of the rule to show\n"},
+	{ 0, 0, 0, NULL }
+};
+
 static inline void print_help(const command_t cmds[], const char *cmd_type,
 			      const char *pc_name)
 {
@@ -1092,6 +1112,171 @@ static int jt_show_route(int argc, char **argv)
 	return rc;
 }
 
+static int jt_add_udsp(int argc, char **argv)
+{
+	char *src = NULL, *dst = NULL, *rte = NULL;
+	long int prio = -1, idx = -1;
+	struct cYAML *err_rc = NULL;
+	int rc, opt;
+
+	const char *const short_options = "s:d:r:p:i:";
+	static const struct option long_options[] = {
+	{ .name = "src",      .has_arg = required_argument, .val = 's' },
+	{ .name = "dst",      .has_arg = required_argument, .val = 'd' },
+	{ .name = "rte",      .has_arg = required_argument, .val = 'r' },
+	{ .name = "priority", .has_arg = required_argument, .val = 'p' },
+	{ .name = "idx",      .has_arg = required_argument, .val = 'i' },
+	{ .name = NULL } };
+
+	rc = check_cmd(udsp_cmds, "udsp", "add", 0, argc, argv);
+	if (rc)
+		return rc;
+
+	while ((opt = getopt_long(argc, argv, short_options,
+				   long_options, NULL)) != -1) {
+		switch (opt) {
+		case 's':
+			src = optarg;
+			break;
+		case 'd':
+			dst = optarg;
+			break;
+		case 'r':
+			rte = optarg;
+			break;
+		case 'p':
+			rc = parse_long(optarg, &prio);
+			if (rc != 0)
+				prio = -1;
+			break;
+		case 'i':
+			rc = parse_long(optarg, &idx);
+			if (rc != 0 || idx < 0) {
+				cYAML_build_error(-1, -1, "parser", "udsp",
+						  "bad index value", &err_rc);
+				rc = -1;
+				goto out;
+			}
+			break;
+		case '?':
+			print_help(udsp_cmds, "udsp", "add");
+		default:
+			return 0;
+		}
+	}
+
+	rc = lustre_lnet_add_udsp(src, dst, rte, prio, idx, -1, &err_rc);
+
+out:
+	if (rc != LUSTRE_CFG_RC_NO_ERR)
+		cYAML_print_tree2file(stderr, err_rc);
+
+	cYAML_free_tree(err_rc);
+
+	return rc;
+}
+
+static int jt_del_udsp(int argc, char **argv)
+{
+	long int idx = -1;
+	bool all = false;
+	struct cYAML *err_rc = NULL;
+	int rc, opt;
+
+	const char *const short_options = "i:a";
+	static const struct option long_options[] = {
+	{ .name = "idx", .has_arg = required_argument, .val = 'i' },
+	{ .name = "all", .has_arg = no_argument,	.val = 'a' },
+	{ .name = NULL } };
+
+	rc = check_cmd(udsp_cmds, "udsp", "del", 0, argc, argv);
+	if (rc)
+		return rc;
+
+	while ((opt = getopt_long(argc, argv, short_options,
+				   long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'i':
+			rc = parse_long(optarg, &idx);
+			if (rc != 0 || idx < 0) {
+				cYAML_build_error(-1, -1, "parser", "udsp",
+						  "bad index value", &err_rc);
+				rc = -1;
+				goto out;
+			}
+			break;
+		case 'a':
+			all = true;
+			break;
+		case '?':
+			print_help(udsp_cmds, "udsp", "del");
+		default:
+			return 0;
+		}
+	}
+
+	if (all == (idx >= 0)) {
+		cYAML_build_error(-1, -1, "parser", "udsp",
+				  "specify exactly one of --idx or --all",
+				  &err_rc);
+		rc = -1;
+		goto out;
+	}
+
+	rc = lustre_lnet_del_udsp(idx, -1, &err_rc);
+
+out:
+	if (rc != LUSTRE_CFG_RC_NO_ERR)
+		cYAML_print_tree2file(stderr, err_rc);
+
+	cYAML_free_tree(err_rc);
+
+	return rc;
+}
+
+static int jt_show_udsp(int argc, char **argv)
+{
+	long int idx = -1;
+	struct cYAML *err_rc = NULL, *show_rc = NULL;
+	int rc, opt;
+
+	const char *const short_options = "i:";
+	static const struct option long_options[] = {
+	{ .name = "idx", .has_arg = required_argument, .val = 'i' },
+	{ .name = NULL } };
+
+	rc = check_cmd(udsp_cmds, "udsp", "show", 0, argc, argv);
+	if (rc)
+		return rc;
+
+	while ((opt = getopt_long(argc, argv, short_options,
+				   long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'i':
+			rc = parse_long(optarg, &idx);
+			if (rc != 0 || idx < 0)
+				idx = -1;
+			break;
+		case '?':
+			print_help(udsp_cmds, "udsp", "show");
+		default:
+			return 0;
+		}
+	}
+
+	rc = lustre_lnet_show_udsp(idx, -1, &show_rc, &err_rc);
+
+	if (rc != LUSTRE_CFG_RC_NO_ERR)
+		cYAML_print_tree2file(stderr, err_rc);
+	else if (show_rc)
+		cYAML_print_tree(show_rc);
+
+	cYAML_free_tree(err_rc);
+	cYAML_free_tree(show_rc);
+
+	return rc;
+}
+
 static int set_value_helper(int argc, char **argv,
 			    int (*cb)(int, bool, char*, int, struct cYAML**))
 {
@@ -1382,6 +1567,17 @@ static int jt_route(int argc, char **argv)
 	return Parser_execarg(argc - 1, &argv[1], route_cmds);
 }
 
+static int jt_udsp(int argc, char **argv)
+{
+	int rc;
+
+	rc = check_cmd(udsp_cmds, "udsp", NULL, 2, argc, argv);
+	if (rc)
+		return rc;
+
+	return Parser_execarg(argc - 1, &argv[1], udsp_cmds);
+}
+
 static int jt_net(int argc, char **argv)
 {
 	int rc;
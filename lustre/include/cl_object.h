@@ -742,6 +742,11 @@ struct cl_page {
          * creation.
          */
         enum cl_page_type        cp_type;
+	/**
+	 * Index of the slab pool this page was allocated from, or -1 if it
+	 * was allocated with OBD_ALLOC_GFP(). Immutable after creation.
+	 */
+	short			 cp_kmem_index;
 
         /**
          * Owning IO in cl_page_state::CPS_OWNED state. Sub-page can be owned
@@ -1893,6 +1898,11 @@ struct cl_io {
 			     ci_noatime:1,
 	/* Tell sublayers not to expand LDLM locks requested for this IO */
 			     ci_lock_no_expand:1,
+	/**
+	 * This is a read-ahead IO started by the async read-ahead worker,
+	 * it only reads pages covered by already granted DLM locks.
+	 */
+			     ci_async_readahead:1,
 	/**
 	 * Set if non-delay RPC should be used for this IO.
 	 *
@@ -1952,6 +1962,18 @@ enum cache_stats_item {
 
 #define CS_NAMES { "lookup", "hit", "total", "busy", "create" }
 
+enum cl_page_pool_item {
+	/** how many cl_pages were allocated from a per-size slab pool */
+	CPP_hit = 0,
+	/** how many cl_pages had to fall back to generic allocation */
+	CPP_miss,
+	/** how many cl_pages were returned to a per-size slab pool */
+	CPP_free,
+	CPP_NR
+};
+
+#define CPP_NAMES { "hit", "miss", "free" }
+
 /**
  * Stats for a generic cache (similar to inode, lu_object, etc. caches).
  */
@@ -1981,6 +2003,8 @@ struct cl_site {
 	 */
 	struct cache_stats	cs_pages;
 	atomic_t		cs_pages_state[CPS_NR];
+	/** cl_page slab pool usage, see cl_page_alloc() */
+	atomic_t		cs_page_pool[CPP_NR];
 };
 
 int  cl_site_init(struct cl_site *s, struct cl_device *top);
@@ -355,6 +355,9 @@ enum {
         PTLRPC_REQACTIVE_CNTR,
         PTLRPC_TIMEOUT,
         PTLRPC_REQBUF_AVAIL_CNTR,
+	PTLRPC_REQSTOLEN_CNTR,
+	PTLRPC_RSCACHE_HIT_CNTR,
+	PTLRPC_RSCACHE_MISS_CNTR,
         PTLRPC_LAST_CNTR
 };
 
@@ -36,6 +36,7 @@
 #include <stdarg.h>
 #include <libcfs/libcfs.h>
 #include <uapi/linux/lustre/lustre_idl.h>
+#include <libcfs/linux/linux-hash.h>
 #include <lu_ref.h>
 #include <linux/percpu_counter.h>
 
@@ -224,7 +225,10 @@ struct lu_object_operations {
                                   struct lu_object *o);
         /**
          * Dual to lu_device_operations::ldo_object_alloc(). Called when
-         * object is removed from memory.
+         * object is removed from memory. The layer owning the
+         * lu_object_header must free its memory with call_rcu() on
+         * lu_object_header::loh_rcu, as concurrent lookups may still
+         * look at it.
          */
         void (*loo_object_free)(const struct lu_env *env,
                                 struct lu_object *o);
@@ -467,6 +471,12 @@ enum lu_object_header_flags {
 	 * Mark this object has already been taken out of cache.
 	 */
 	LU_OBJECT_UNHASHED = 1,
+	/**
+	 * Object was looked up since the last LRU scan. Cleared by
+	 * lu_site_purge_objects() which gives such objects a second chance
+	 * instead of reordering the LRU list on every access.
+	 */
+	LU_OBJECT_ACCESSED = 2,
 };
 
 enum lu_object_header_attr {
@@ -502,7 +512,9 @@ struct lu_object_header {
 	 */
 	unsigned long		loh_flags;
 	/**
-	 * Object reference count. Protected by lu_site::ls_guard.
+	 * Object reference count. Transitions from and to 0 are protected by
+	 * the lock of the lu_site bucket the object belongs to, other
+	 * changes are lockless.
 	 */
 	atomic_t		loh_ref;
 	/**
@@ -511,11 +523,13 @@ struct lu_object_header {
 	 */
 	__u32			loh_attr;
 	/**
-	 * Linkage into per-site hash table. Protected by lu_site::ls_guard.
+	 * Linkage into per-site hash table. Lookups are done under RCU,
+	 * insertion and removal under the lu_site bucket lock.
 	 */
-	struct hlist_node	loh_hash;
+	struct rhash_head	loh_hash;
 	/**
-	 * Linkage into per-site LRU list. Protected by lu_site::ls_guard.
+	 * Linkage into per-site LRU list. Protected by the lu_site bucket
+	 * lock.
 	 */
 	struct list_head	loh_lru;
 	/**
@@ -527,6 +541,12 @@ struct lu_object_header {
 	 * A list of references to this object, for debugging.
 	 */
 	struct lu_ref		loh_reference;
+	/**
+	 * Lookups do not hold a reference until they checked loh_ref, so
+	 * the memory holding the header has to be freed after a RCU grace
+	 * period, see lu_object_operations::loo_object_free().
+	 */
+	struct rcu_head		loh_rcu;
 };
 
 struct fld;
@@ -552,13 +572,20 @@ enum {
  * lu_object.
  */
 struct lu_site {
-        /**
-         * objects hash table
-         */
-	struct cfs_hash		*ls_obj_hash;
-        /**
-         * index of bucket on hash table while purging
-         */
+	/**
+	 * objects hash table, resized online
+	 */
+	struct rhashtable	ls_obj_hash;
+	/**
+	 * LRU lists and wait queues, the object is mapped to one of them by
+	 * its fid
+	 */
+	struct lu_site_bkt_data	*ls_bkts;
+	unsigned int		ls_bkt_cnt;
+	u32			ls_bkt_seed;
+	/**
+	 * index of bucket in ls_bkts while purging
+	 */
 	unsigned int		ls_purge_start;
 	/**
 	 * Top-level device for this stack.
@@ -596,7 +623,8 @@ struct lu_site {
 	struct lu_target	*ls_tgt;
 
 	/**
-	 * Number of objects in lsb_lru_lists - used for shrinking
+	 * Number of unreferenced objects in lsb_lru lists - used for
+	 * shrinking
 	 */
 	struct percpu_counter   ls_lru_len_counter;
 };
@@ -624,6 +652,7 @@ int  lu_device_init       (struct lu_device *d, struct lu_device_type *t);
 void lu_device_fini       (struct lu_device *d);
 int  lu_object_header_init(struct lu_object_header *h);
 void lu_object_header_fini(struct lu_object_header *h);
+void lu_object_header_free(struct lu_object_header *h);
 int  lu_object_init       (struct lu_object *o,
                            struct lu_object_header *h, struct lu_device *d);
 void lu_object_fini       (struct lu_object *o);
@@ -692,6 +721,8 @@ struct lu_object *lu_object_find_slice(const struct lu_env *env,
                                        struct lu_device *dev,
                                        const struct lu_fid *f,
                                        const struct lu_object_conf *conf);
+struct lu_object *lu_object_get_first(struct lu_object_header *h,
+				      struct lu_device *dev);
 /** @} caching */
 
 /** \name helpers
@@ -1039,6 +1039,9 @@ int llapi_mirror_copy(int fd, unsigned int src, unsigned int dst,
 int llapi_heat_get(int fd, struct lu_heat *heat);
 int llapi_heat_set(int fd, __u64 flags);
 
+int llapi_statahead(int dirfd, const char **names, int count);
+int llapi_batch_ops(int dirfd, struct lu_batch_op *ops, int count);
+
 /** @} llapi */
 
 #if defined(__cplusplus)
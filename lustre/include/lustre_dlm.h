@@ -68,6 +68,9 @@ extern struct kset *ldlm_svc_kset;
  * client shows interest in that lock, e.g. glimpse is occured. */
 #define LDLM_DIRTY_AGE_LIMIT (10)
 #define LDLM_DEFAULT_PARALLEL_AST_LIMIT 1024
+/* locks per blocking AST RPC, the upper limit fits in LDLM_MAXREQSIZE */
+#define LDLM_DEFAULT_BL_AST_BATCH 256
+#define LDLM_MAX_BL_AST_BATCH 512
 
 /**
  * LDLM non-error return states
@@ -313,12 +316,13 @@ enum ldlm_appetite {
 };
 
 /**
- * Default values for the "max_nolock_size", "contention_time" and
- * "contended_locks" namespace tunables.
+ * Default values for the "max_nolock_size", "contention_time",
+ * "contended_locks" and "extent_hist_seconds" namespace tunables.
  */
 #define NS_DEFAULT_MAX_NOLOCK_BYTES 0
 #define NS_DEFAULT_CONTENTION_SECONDS 2
 #define NS_DEFAULT_CONTENDED_LOCKS 32
+#define NS_DEFAULT_EXTENT_HIST_SECONDS 10
 
 struct ldlm_ns_bucket {
 	/** back pointer to namespace */
@@ -338,6 +342,12 @@ struct ldlm_ns_bucket {
 enum {
 	/** LDLM namespace lock stats */
 	LDLM_NSS_LOCKS          = 0,
+	/** resource found by the lockless RCU lookup */
+	LDLM_NSS_RES_LOOKUP_RCU,
+	/** resource lookup done under the hash bucket lock */
+	LDLM_NSS_RES_LOOKUP_LOCKED,
+	/** new resource dropped, someone else inserted it first */
+	LDLM_NSS_RES_CREATE_RACE,
 	LDLM_NSS_LAST
 };
 
@@ -509,6 +519,19 @@ struct ldlm_namespace {
 	/** Limit of parallel AST RPC count. */
 	unsigned		ns_max_parallel_ast;
 
+	/**
+	 * Max number of extent locks of one client called back by a single
+	 * blocking AST RPC, 1 sends one RPC per lock.
+	 */
+	unsigned		ns_max_bl_ast_batch;
+
+	/**
+	 * Write extents enqueued by each client on an extent resource are
+	 * remembered for \a ns_extent_hist_time seconds and used to size the
+	 * locks granted to concurrent writers. 0 disables learned sizing.
+	 */
+	time64_t		ns_extent_hist_time;
+
 	/**
 	 * Callback to check if a lock is good to be canceled by ELC or
 	 * during recovery.
@@ -611,6 +634,8 @@ struct ldlm_bl_desc {
 		     bl_cos_incompat:1;
 };
 
+struct ldlm_bl_batch;
+
 struct ldlm_cb_set_arg {
 	struct ptlrpc_request_set	*set;
 	int				 type; /* LDLM_{CP,BL,GL}_CALLBACK */
@@ -620,11 +645,15 @@ struct ldlm_cb_set_arg {
 	ptlrpc_interpterer_t		 gl_interpret_reply;
 	void				*gl_interpret_data;
 	struct ldlm_bl_desc		*bl_desc;
+	/* blocking ASTs being batched per export, see ldlm_bl_batch_add() */
+	struct list_head		 bl_batches;
+	unsigned int			 bl_batch_max;
 };
 
 struct ldlm_cb_async_args {
 	struct ldlm_cb_set_arg	*ca_set_arg;
 	struct ldlm_lock	*ca_lock;
+	struct ldlm_bl_batch	*ca_batch;
 };
 
 /** The ldlm_glimpse_work was slab allocated & must be freed accordingly.*/
@@ -965,6 +994,33 @@ struct lustre_handle_array {
 	struct lustre_handle	ha_handles[0];
 };
 
+/** Number of clients remembered per extent resource */
+#define LDLM_EXTENT_HIST_SIZE	8
+
+/**
+ * Region written by one client on an extent resource, as seen from the
+ * write locks it enqueued.
+ */
+struct ldlm_extent_hist_entry {
+	/** export handle cookie of the client, 0 if the slot is unused */
+	__u64			eh_cookie;
+	/** region the client wrote sequentially so far */
+	__u64			eh_start;
+	__u64			eh_end;
+	/** start of the last request */
+	__u64			eh_last;
+	/** distance between the last two requests */
+	__u64			eh_stride;
+	/** when the last request was seen */
+	time64_t		eh_time;
+	/** the last requests were evenly spaced and not contiguous */
+	unsigned int		eh_strided:1;
+};
+
+struct ldlm_extent_hist {
+	struct ldlm_extent_hist_entry	eh_entries[LDLM_EXTENT_HIST_SIZE];
+};
+
 /**
  * LDLM resource description.
  * Basically, resource is a representation for a single object.
@@ -981,7 +1037,8 @@ struct ldlm_resource {
 
 	/**
 	 * List item for list in namespace hash.
-	 * protected by ns_lock
+	 * Modified under the hash bucket lock, walked under RCU by
+	 * ldlm_resource_get().
 	 */
 	struct hlist_node	lr_hash;
 
@@ -1010,6 +1067,12 @@ struct ldlm_resource {
 	 */
 	struct ldlm_interval_tree *lr_itree;
 
+	/**
+	 * Recent write extents of each client (only for extent locks on the
+	 * server), allocated on first use, protected by lr_lock.
+	 */
+	struct ldlm_extent_hist	*lr_extent_hist;
+
 	union {
 		/**
 		 * When the resource was considered as contended,
@@ -1038,6 +1101,9 @@ struct ldlm_resource {
 
 	/** List of references to this resource. For debugging. */
 	struct lu_ref		lr_reference;
+
+	/** Resource is freed after an RCU grace period */
+	struct rcu_head		lr_rcu;
 };
 
 static inline int ldlm_is_granted(struct ldlm_lock *lock)
@@ -1349,6 +1415,9 @@ int ldlm_handle_enqueue0(struct ldlm_namespace *ns, struct ptlrpc_request *req,
 			 const struct ldlm_callback_suite *cbs);
 int ldlm_handle_convert0(struct ptlrpc_request *req,
 			 const struct ldlm_request *dlm_req);
+int ldlm_lock_export_local(struct obd_export *exp, struct ldlm_lock *lock,
+			   const struct lustre_handle *remote,
+			   struct ldlm_reply *dlm_rep);
 int ldlm_handle_cancel(struct ptlrpc_request *req);
 int ldlm_request_cancel(struct ptlrpc_request *req,
 			const struct ldlm_request *dlm_req,
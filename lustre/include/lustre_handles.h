@@ -43,7 +43,12 @@
 #include <libcfs/libcfs.h>
 
 struct portals_handle_ops {
-	void (*hop_addref)(void *object);
+	/**
+	 * Take a reference on \a object unless it is already being freed.
+	 * Called under rcu_read_lock() without any lock held, returns false
+	 * if the last reference has been dropped.
+	 */
+	bool (*hop_addref)(void *object);
 	void (*hop_free)(void *object, int size);
 };
 
@@ -66,9 +71,9 @@ struct portals_handle {
 
 	/* newly added fields to handle the RCU issue. -jxiong */
 	struct rcu_head			h_rcu;
-	spinlock_t			h_lock;
-	unsigned int			h_size:31;
-	unsigned int			h_in:1;
+	unsigned int			h_size;
+	/* set under the bucket lock, read locklessly by lookups */
+	unsigned int			h_in;
 };
 
 /* handles.c */
@@ -656,6 +656,7 @@ struct ptlrpc_reply_state {
         unsigned long          rs_handled:1;  /* been handled yet? */
         unsigned long          rs_on_net:1;   /* reply_out_callback pending? */
         unsigned long          rs_prealloc:1; /* rs from prealloc list */
+	unsigned long		rs_cached:1;   /* rs from scp_rs_cache */
         unsigned long          rs_committed:1;/* the transaction was committed
                                                  and the rs was dispatched
                                                  by ptlrpc_commit_replies */
@@ -1667,6 +1668,24 @@ struct ptlrpc_service_ops {
  */
 #define PTLRPC_SVC_HP_RATIO 10
 
+/**
+ * Minimum # of queued normal priority requests on a partition before idle
+ * threads of another partition may steal from it, see
+ * ptlrpc_server_steal_victim()
+ */
+#define PTLRPC_SVC_STEAL_THRESHOLD 8
+
+/**
+ * Reply states of up to PTLRPC_RS_CACHE_SIZE(PTLRPC_RS_CACHE_CLASSES - 1)
+ * bytes are recycled through per-partition caches, one per power of two
+ * size class starting at 1 << PTLRPC_RS_CACHE_MIN_SHIFT.
+ */
+#define PTLRPC_RS_CACHE_CLASSES		4
+#define PTLRPC_RS_CACHE_MIN_SHIFT	10
+#define PTLRPC_RS_CACHE_SIZE(idx)	(1 << (PTLRPC_RS_CACHE_MIN_SHIFT + (idx)))
+/** default # of cached reply states per size class and partition */
+#define PTLRPC_RS_CACHE_MAX		64
+
 /**
  * Definition of PortalRPC service.
  * The service is listening on a particular portal (like tcp port)
@@ -1697,6 +1716,16 @@ struct ptlrpc_service {
         struct lprocfs_stats           *srv_stats;
         /** # hp per lp reqs to handle */
         int                             srv_hpreq_ratio;
+	/**
+	 * queue depth from which other partitions may steal requests,
+	 * 0 disables work stealing
+	 */
+	int				srv_steal_threshold;
+	/**
+	 * max # of idle reply states cached per size class and partition,
+	 * 0 disables the cache
+	 */
+	int				srv_rs_cache_max;
         /** biggest request to receive */
         int                             srv_max_req_size;
         /** biggest reply to send */
@@ -1830,6 +1859,12 @@ struct ptlrpc_service_part {
 	int				scp_nhreqs_active;
 	/** # hp requests handled */
 	int				scp_hreq_count;
+	/** # reqs handled by threads of other partitions */
+	__u64				scp_nreqs_stolen;
+	/** # of our active reqs being served by other partitions */
+	int				scp_nreqs_lent;
+	/** # reqs of other partitions being served by our threads */
+	int				scp_nreqs_stealing;
 
 	/** NRS head for regular requests */
 	struct ptlrpc_nrs		scp_nrs_reg;
@@ -1865,6 +1900,10 @@ struct ptlrpc_service_part {
 	struct list_head		scp_rep_active;
 	/** List of free reply_states */
 	struct list_head		scp_rep_idle;
+	/** Idle reply states recycled by size class */
+	struct list_head		scp_rs_cache[PTLRPC_RS_CACHE_CLASSES];
+	/** # of reply states in each scp_rs_cache list */
+	int				scp_rs_cached[PTLRPC_RS_CACHE_CLASSES];
 	/** waitq to run, when adding stuff to srv_free_rs_list */
 	wait_queue_head_t		scp_rep_waitq;
 	/** # 'difficult' replies */
@@ -2163,6 +2202,8 @@ int ptlrpc_request_bufs_pack(struct ptlrpc_request *request,
                              __u32 version, int opcode, char **bufs,
                              struct ptlrpc_cli_ctx *ctx);
 void ptlrpc_req_finished(struct ptlrpc_request *request);
+int ptlrpc_req_set_subreply(struct ptlrpc_request *req, struct lustre_msg *msg,
+			    int len);
 void ptlrpc_req_finished_with_imp_lock(struct ptlrpc_request *request);
 struct ptlrpc_request *ptlrpc_request_addref(struct ptlrpc_request *req);
 struct ptlrpc_bulk_desc *ptlrpc_prep_bulk_imp(struct ptlrpc_request *req,
@@ -2290,6 +2331,16 @@ struct ptlrpc_service_conf {
  */
 void ptlrpc_save_lock(struct ptlrpc_request *req, struct lustre_handle *lock,
 		      int mode, bool no_ack, bool convert_lock);
+struct ptlrpc_request *ptlrpc_server_subreq_alloc(struct ptlrpc_request *req,
+						  struct lustre_msg *msg,
+						  int len, __u64 xid);
+int ptlrpc_server_subreq_reply(struct ptlrpc_request *sub, void *buf,
+			       int buflen);
+void ptlrpc_server_subreq_free(struct ptlrpc_request *req,
+			       struct ptlrpc_request *sub);
+bool ptlrpc_rs_lock_conflict(struct ptlrpc_reply_state *rs,
+			     const struct ldlm_res_id *res_id,
+			     enum ldlm_mode mode, __u64 bits);
 void ptlrpc_commit_replies(struct obd_export *exp);
 void ptlrpc_dispatch_difficult_reply(struct ptlrpc_reply_state *rs);
 void ptlrpc_schedule_difficult_reply(struct ptlrpc_reply_state *rs);
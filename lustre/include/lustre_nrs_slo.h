@@ -0,0 +1,126 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ *
+ * Network Request Scheduler (NRS) SLO policy
+ *
+ */
+
+#ifndef _LUSTRE_NRS_SLO_H
+#define _LUSTRE_NRS_SLO_H
+
+/* \name slo
+ *
+ * SLO (latency target) policy
+ * @{
+ */
+
+#define NRS_SLO_NAME_LEN	16
+
+enum nrs_slo_match {
+	NRS_SLO_MATCH_JOBID	= 1,
+	NRS_SLO_MATCH_UID,
+	NRS_SLO_MATCH_OPCODE,
+};
+
+/**
+ * A latency target for the requests matching a jobid, uid or opcode
+ */
+struct nrs_slo_rule {
+	/** link into nrs_slo_head::sh_rules */
+	struct list_head	sr_linkage;
+	char			sr_name[NRS_SLO_NAME_LEN];
+	enum nrs_slo_match	sr_match;
+	union {
+		/** jobid, a trailing '*' matches any suffix */
+		char		sr_jobid[LUSTRE_JOBID_SIZE];
+		__u32		sr_uid;
+		__u32		sr_opcode;
+	};
+	/** latency target, in milliseconds */
+	__u32			sr_target;
+	/** # of requests which matched this rule */
+	__u64			sr_nreqs;
+};
+
+/**
+ * Private data structure for the SLO policy
+ */
+struct nrs_slo_head {
+	struct ptlrpc_nrs_resource	 sh_res;
+
+	/**
+	 * Requests which can still meet their deadline, earliest deadline
+	 * first.
+	 */
+	struct cfs_binheap		*sh_binheap;
+	/**
+	 * Requests which can't meet their deadline any more, only served
+	 * when sh_binheap is empty or every sh_late_ratio requests.
+	 */
+	struct cfs_binheap		*sh_late_binheap;
+	/** protects sh_rules and sh_default_target */
+	rwlock_t			 sh_rule_lock;
+	struct list_head		 sh_rules;
+	/** target of unmatched requests in ms, 0 uses the RPC deadline */
+	__u32				 sh_default_target;
+	/** # of requests served from sh_binheap since the last late one */
+	__u32				 sh_since_late;
+	/** ordering of requests with the same deadline */
+	__u64				 sh_sequence;
+	/** running average of the request service time, in ns */
+	__u64				 sh_service_time;
+	/** # of requests handled */
+	__u64				 sh_nreqs;
+	/** # of requests handled after missing their deadline */
+	__u64				 sh_nreqs_late;
+};
+
+struct nrs_slo_req {
+	/** real time deadline, in ns */
+	__u64		sr_deadline;
+	__u64		sr_sequence;
+	/** when the request was taken for handling */
+	ktime_t		sr_start;
+	/** in nrs_slo_head::sh_late_binheap */
+	unsigned int	sr_late:1;
+};
+
+enum nrs_slo_cmd_type {
+	NRS_SLO_CMD_START	= 1,
+	NRS_SLO_CMD_STOP,
+	NRS_SLO_CMD_DEFAULT,
+};
+
+struct nrs_slo_cmd {
+	enum nrs_slo_cmd_type	sc_cmd;
+	/** rule to start or stop, unused by NRS_SLO_CMD_DEFAULT */
+	struct nrs_slo_rule	sc_rule;
+};
+
+enum nrs_ctl_slo {
+	NRS_CTL_SLO_RD_RULE = PTLRPC_NRS_CTL_1ST_POL_SPEC,
+	NRS_CTL_SLO_WR_RULE,
+};
+
+/** @} slo */
+
+#endif
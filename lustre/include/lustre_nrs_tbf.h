@@ -184,6 +184,33 @@ struct nrs_tbf_rule {
 	atomic_t			 tr_ref;
 	/** Generation of the rule. */
 	__u64				 tr_generation;
+	/**
+	 * Parent rule, the classes of this rule may borrow the spare
+	 * tokens of their ancestors.
+	 */
+	struct nrs_tbf_rule		*tr_parent;
+	/** Linkage into the tr_children list of the parent rule. */
+	struct list_head		 tr_sibling;
+	/** List of child rules. */
+	struct list_head		 tr_children;
+	/**
+	 * Weight of the rule among its siblings; the RPC rate of the rule
+	 * is its part of the parent rate. 0 if the rate is explicit.
+	 */
+	__u32				 tr_share;
+	/** Depth of the rule in the hierarchy, 0 for top-level rules. */
+	__u32				 tr_level;
+	/**
+	 * Token bucket shared by all the classes below a parent rule. Every
+	 * request of the subtree is charged to it, and borrowing needs a
+	 * spare token, so the subtree only exceeds tr_rpc_rate when the own
+	 * rates of its classes do. Negative when they did.
+	 */
+	__s64				 tr_agg_ntoken;
+	/** Time check-point of the aggregate token bucket. */
+	__u64				 tr_agg_check_time;
+	/** # of requests dispatched with tokens borrowed from ancestors. */
+	__u64				 tr_nborrowed;
 };
 
 struct nrs_tbf_ops {
@@ -313,10 +340,13 @@ struct nrs_tbf_cmd {
 			__u32			 ts_valid_type;
 			enum nrs_rule_flags	 ts_rule_flags;
 			char			*ts_next_name;
+			char			*ts_parent_name;
+			__u32			 ts_share;
 		} tc_start;
 		struct nrs_tbf_cmd_change {
 			__u64			 tc_rpc_rate;
 			char			*tc_next_name;
+			__u32			 tc_share;
 		} tc_change;
 	} u;
 };
@@ -545,12 +545,26 @@ struct osc_page {
 	 * lru page list. See osc_lru_{del|use}() in osc_page.c for usage.
 	 */
 	struct list_head	ops_lru;
+	/**
+	 * CPT of the client_obd::cl_lru_pcpt staging list ops_lru is linked
+	 * on, or -1 if it is on client_obd::cl_lru_list (or on no list).
+	 * Only changed with the corresponding list lock held.
+	 */
+	int			ops_lru_cpt;
 	/**
 	 * Submit time - the time when the page is starting RPC. For debugging.
 	 */
 	ktime_t			ops_submit_time;
 };
 
+/* one object of a multi-object write RPC, see osc_build_rpc() */
+struct osc_brw_obj {
+	/* attributes of the object, aa_oa is used for the first one */
+	struct obdo		 obo_oa;
+	/* number of pages of the object in aa_ppga */
+	u32			 obo_page_count;
+};
+
 struct osc_brw_async_args {
 	struct obdo		*aa_oa;
 	int			 aa_requested_nob;
@@ -561,6 +575,9 @@ struct osc_brw_async_args {
 	struct client_obd	*aa_cli;
 	struct list_head	 aa_oaps;
 	struct list_head	 aa_exts;
+	/* objects of the RPC in FID order, NULL if it has only one */
+	struct osc_brw_obj	*aa_objs;
+	u32			 aa_obj_count;
 };
 
 extern struct kmem_cache *osc_lock_kmem;
@@ -66,11 +66,21 @@ struct req_capsule {
         const struct req_format *rc_fmt;
         enum req_location        rc_loc;
         __u32                    rc_area[RCL_NR][REQ_MAX_FIELD_NR];
+	/* sub-request packed inside rc_req, see req_capsule_subreq_init() */
+	struct lustre_msg	*rc_reqmsg;
+	struct lustre_msg	*rc_repmsg;
+	__u32			 rc_replen;
+	__u32			 rc_repbuf_len;
 };
 
 void req_capsule_init(struct req_capsule *pill, struct ptlrpc_request *req,
                       enum req_location location);
 void req_capsule_fini(struct req_capsule *pill);
+void req_capsule_subreq_init(struct req_capsule *pill,
+			     const struct req_format *fmt,
+			     struct ptlrpc_request *req,
+			     struct lustre_msg *reqmsg);
+void req_capsule_subreq_fini(struct req_capsule *pill);
 
 void req_capsule_set(struct req_capsule *pill, const struct req_format *fmt);
 void req_capsule_client_dump(struct req_capsule *pill);
@@ -177,6 +187,8 @@ extern struct req_format RQF_MDS_REINT_SETXATTR;
 extern struct req_format RQF_MDS_QUOTACTL;
 extern struct req_format RQF_QUOTA_DQACQ;
 extern struct req_format RQF_MDS_SWAP_LAYOUTS;
+extern struct req_format RQF_MDS_BATCH_GETATTR;
+extern struct req_format RQF_MDS_BATCH_REINT;
 extern struct req_format RQF_MDS_REINT_MIGRATE;
 extern struct req_format RQF_MDS_REINT_RESYNC;
 /* MDS hsm formats */
@@ -224,6 +236,7 @@ extern struct req_format RQF_LDLM_CANCEL;
 extern struct req_format RQF_LDLM_CALLBACK;
 extern struct req_format RQF_LDLM_CP_CALLBACK;
 extern struct req_format RQF_LDLM_BL_CALLBACK;
+extern struct req_format RQF_LDLM_BL_CALLBACK_BATCH;
 extern struct req_format RQF_LDLM_GL_CALLBACK;
 extern struct req_format RQF_LDLM_GL_CALLBACK_DESC;
 /* LOG req_format */
@@ -283,6 +296,9 @@ extern struct req_msg_field RMF_OBD_QUOTACTL;
 extern struct req_msg_field RMF_QUOTA_BODY;
 extern struct req_msg_field RMF_STRING;
 extern struct req_msg_field RMF_SWAP_LAYOUTS;
+extern struct req_msg_field RMF_BATCH_HEADER;
+extern struct req_msg_field RMF_BATCH_BUF;
+extern struct req_msg_field RMF_BATCH_XID;
 extern struct req_msg_field RMF_MDS_HSM_PROGRESS;
 extern struct req_msg_field RMF_MDS_HSM_REQUEST;
 extern struct req_msg_field RMF_MDS_HSM_USER_ITEM;
@@ -310,6 +326,7 @@ extern struct req_msg_field RMF_MGS_TARGET_INFO;
 extern struct req_msg_field RMF_MGS_SEND_PARAM;
 
 extern struct req_msg_field RMF_OST_BODY;
+extern struct req_msg_field RMF_OST_BODIES;
 extern struct req_msg_field RMF_OBD_IOOBJ;
 extern struct req_msg_field RMF_OBD_ID;
 extern struct req_msg_field RMF_FID;
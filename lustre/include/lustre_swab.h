@@ -69,6 +69,7 @@ void lustre_swab_barrier_lvb(struct barrier_lvb *lvb);
 void lustre_swab_generic_32s(__u32 *val);
 void lustre_swab_mdt_body(struct mdt_body *b);
 void lustre_swab_mdt_ioepoch(struct mdt_ioepoch *b);
+void lustre_swab_mdt_batch_header(struct mdt_batch_header *b);
 void lustre_swab_mdt_rec_setattr(struct mdt_rec_setattr *sa);
 void lustre_swab_mdt_rec_reint(struct mdt_rec_reint *rr);
 void lustre_swab_lmv_desc(struct lmv_desc *ld);
@@ -170,6 +170,18 @@ enum obd_cl_sem_lock_class {
 
 struct mdc_rpc_lock;
 struct obd_import;
+/**
+ * Per-CPT staging list of LRU pages. Pages finishing transfer are queued
+ * here first and moved to client_obd::cl_lru_list in batches, so that
+ * writers running on different CPTs do not contend on cl_lru_list_lock.
+ */
+struct cl_lru_pcpt {
+	spinlock_t		 clp_lock;
+	struct list_head	 clp_list;
+	/** # of pages on clp_list */
+	long			 clp_count;
+};
+
 struct client_obd {
 	struct rw_semaphore	 cl_sem;
 	struct obd_uuid		 cl_target_uuid;
@@ -269,6 +281,8 @@ struct client_obd {
 	u32			cl_max_pages_per_rpc;
 	u32			cl_max_rpcs_in_flight;
 	u32			cl_max_short_io_bytes;
+	/* max number of objects in one write RPC, 1 disables aggregation */
+	u32			cl_max_objs_per_rpc;
 	struct obd_histogram	cl_read_rpc_hist;
 	struct obd_histogram	cl_write_rpc_hist;
 	struct obd_histogram	cl_read_page_hist;
@@ -304,6 +318,8 @@ struct client_obd {
 	struct list_head         cl_lru_list;
 	/** Lock for LRU page list */
 	spinlock_t		 cl_lru_list_lock;
+	/** Per-CPT staging lists merged into cl_lru_list in batches */
+	struct cl_lru_pcpt	**cl_lru_pcpt;
 	/** # of unstable pages in this client_obd.
 	 * An unstable page is a page state that WRITE RPC has finished but
 	 * the transaction has NOT yet committed. */
@@ -928,6 +944,18 @@ struct md_enqueue_info {
 	void			       *mi_cbdata;
 };
 
+/* one create, setattr or unlink of md_batch_reint() */
+struct md_batch_item {
+	/* REINT_CREATE, REINT_SETATTR or REINT_UNLINK */
+	__u32			 mbi_opc;
+	/* mode, uid and gid of REINT_CREATE */
+	umode_t			 mbi_mode;
+	uid_t			 mbi_uid;
+	gid_t			 mbi_gid;
+	struct md_op_data	*mbi_op_data;
+	int			 mbi_result;
+};
+
 struct obd_ops {
 	struct module *o_owner;
 	int (*o_iocontrol)(unsigned int cmd, struct obd_export *exp, int len,
@@ -1106,6 +1134,11 @@ struct md_ops {
 	int (*m_intent_getattr_async)(struct obd_export *,
 				      struct md_enqueue_info *);
 
+	int (*m_intent_getattr_batch)(struct obd_export *,
+				      struct md_enqueue_info **, int);
+
+	int (*m_batch_reint)(struct obd_export *, struct md_batch_item *, int);
+
         int (*m_revalidate_lock)(struct obd_export *, struct lookup_intent *,
                                  struct lu_fid *, __u64 *bits);
 
@@ -1295,6 +1295,8 @@ enum mps_stat_idx {
 	LPROC_MD_SETXATTR,
 	LPROC_MD_GETXATTR,
 	LPROC_MD_INTENT_GETATTR_ASYNC,
+	LPROC_MD_INTENT_GETATTR_BATCH,
+	LPROC_MD_BATCH_REINT,
 	LPROC_MD_REVALIDATE_LOCK,
 	LPROC_MD_LAST_OPC,
 };
@@ -1713,6 +1715,46 @@ static inline int md_intent_getattr_async(struct obd_export *exp,
 	return MDP(exp->exp_obd, intent_getattr_async)(exp, minfo);
 }
 
+/*
+ * Unlike md_intent_getattr_async(), every entry of \a minfo is completed by
+ * its mi_cb() unless an error is returned.
+ */
+static inline int md_intent_getattr_batch(struct obd_export *exp,
+					  struct md_enqueue_info **minfo,
+					  int count)
+{
+	int rc;
+
+	rc = exp_check_ops(exp);
+	if (rc)
+		return rc;
+
+	lprocfs_counter_incr(exp->exp_obd->obd_md_stats,
+			     LPROC_MD_INTENT_GETATTR_BATCH);
+
+	return MDP(exp->exp_obd, intent_getattr_batch)(exp, minfo, count);
+}
+
+/*
+ * Execute \a count creates, setattrs or unlinks of \a items, in as few RPCs
+ * as possible. The result of each one is returned in its mbi_result, the
+ * return value only reports a failure to try them at all.
+ */
+static inline int md_batch_reint(struct obd_export *exp,
+				 struct md_batch_item *items, int count)
+{
+	int rc;
+
+	rc = exp_check_ops(exp);
+	if (rc)
+		return rc;
+
+	lprocfs_counter_incr(exp->exp_obd->obd_md_stats,
+			     LPROC_MD_BATCH_REINT);
+
+	return MDP(exp->exp_obd, batch_reint)(exp, items, count);
+}
+
 static inline int md_revalidate_lock(struct obd_export *exp,
                                      struct lookup_intent *it,
                                      struct lu_fid *fid, __u64 *bits)
@@ -839,6 +839,10 @@ struct ptlrpc_body_v2 {
 #define OBD_CONNECT2_PCC		0x1000ULL /* Persistent Client Cache */
 #define OBD_CONNECT2_PLAIN_LAYOUT	0x2000ULL /* Plain Directory Layout */
 #define OBD_CONNECT2_ASYNC_DISCARD	0x4000ULL /* support async DoM data discard */
+#define OBD_CONNECT2_BATCH_GETATTR	0x8000ULL /* MDS_BATCH_GETATTR RPC */
+#define OBD_CONNECT2_MULTI_OBJ_BRW	0x10000ULL /* OST_WRITE of many objects */
+#define OBD_CONNECT2_BATCH_REINT	0x20000ULL /* MDS_BATCH_REINT RPC */
+#define OBD_CONNECT2_BATCH_BL_AST	0x40000ULL /* many locks per BL AST */
 
 /* XXX README XXX:
  * Please DO NOT add flag values here before first ensuring that this same
@@ -899,7 +903,9 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT2_SELINUX_POLICY | \
 				OBD_CONNECT2_LSOM | \
 				OBD_CONNECT2_ASYNC_DISCARD | \
-				OBD_CONNECT2_PCC)
+				OBD_CONNECT2_PCC | \
+				OBD_CONNECT2_BATCH_GETATTR | \
+				OBD_CONNECT2_BATCH_REINT)
 
 #define OST_CONNECT_SUPPORTED  (OBD_CONNECT_SRVLOCK | OBD_CONNECT_GRANT | \
 				OBD_CONNECT_REQPORTAL | OBD_CONNECT_VERSION | \
@@ -920,7 +926,9 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT_GRANT_PARAM | \
 				OBD_CONNECT_SHORTIO | OBD_CONNECT_FLAGS2)
 
-#define OST_CONNECT_SUPPORTED2 OBD_CONNECT2_LOCKAHEAD
+#define OST_CONNECT_SUPPORTED2 (OBD_CONNECT2_LOCKAHEAD | \
+				OBD_CONNECT2_MULTI_OBJ_BRW | \
+				OBD_CONNECT2_BATCH_BL_AST)
 
 #define ECHO_CONNECT_SUPPORTED (OBD_CONNECT_FID)
 #define ECHO_CONNECT_SUPPORTED2 0
@@ -1641,6 +1649,8 @@ enum mds_cmd {
 	MDS_HSM_CT_REGISTER	= 59,
 	MDS_HSM_CT_UNREGISTER	= 60,
 	MDS_SWAP_LAYOUTS	= 61,
+	MDS_BATCH_GETATTR	= 62,
+	MDS_BATCH_REINT		= 63,
 	MDS_LAST_OPC
 };
 
@@ -1871,6 +1881,21 @@ struct mdt_ioepoch {
 	__u32 mio_padding;
 };
 
+/*
+ * Header of MDS_BATCH_GETATTR and MDS_BATCH_REINT requests and replies. The
+ * RMF_BATCH_BUF buffer following it holds mbh_count LDLM_INTENT_GETATTR
+ * enqueue or MDS_REINT messages in the request, and their replies in the
+ * same order in the reply. Each message is a complete lustre_msg, 8-byte
+ * aligned. A MDS_BATCH_REINT reply may hold fewer messages than the request
+ * if the MDT stopped early, the client resends the rest.
+ */
+struct mdt_batch_header {
+	__u32 mbh_count;	/* # of packed messages */
+	__u32 mbh_flags;	/* reserved */
+	__u32 mbh_reply_size;	/* room for replies, in bytes */
+	__u32 mbh_padding;
+};
+
 /* permissions for md_perm.mp_perm */
 enum {
         CFS_SETUID_PERM = 0x01,
@@ -482,9 +482,12 @@ struct ll_ioc_lease_id {
 #define LL_IOC_LADVISE			_IOR('f', 250, struct llapi_lu_ladvise)
 #define LL_IOC_HEAT_GET			_IOWR('f', 251, struct lu_heat)
 #define LL_IOC_HEAT_SET			_IOW('f', 251, __u64)
+#define LL_IOC_PCC_ATTACH		_IOW('f', 252, struct lu_pcc_attach)
 #define LL_IOC_PCC_DETACH		_IOW('f', 252, struct lu_pcc_detach)
 #define LL_IOC_PCC_DETACH_BY_FID	_IOW('f', 252, struct lu_pcc_detach_fid)
 #define LL_IOC_PCC_STATE		_IOR('f', 252, struct lu_pcc_state)
+#define LL_IOC_STATAHEAD		_IOW('f', 253, struct ll_statahead_names)
+#define LL_IOC_BATCH_OPS		_IOWR('f', 254, struct ll_batch_ops)
 
 #ifndef	FS_IOC_FSGETXATTR
 /*
@@ -2304,6 +2307,7 @@ struct lu_heat {
 enum lu_pcc_type {
 	LU_PCC_NONE = 0,
 	LU_PCC_READWRITE,
+	LU_PCC_READONLY,
 	LU_PCC_MAX
 };
 
@@ -2314,6 +2318,8 @@ static inline const char *pcc_type2string(enum lu_pcc_type type)
 		return "none";
 	case LU_PCC_READWRITE:
 		return "readwrite";
+	case LU_PCC_READONLY:
+		return "readonly";
 	default:
 		return "fault";
 	}
@@ -2357,6 +2363,53 @@ struct lu_pcc_state {
 	char	pccs_path[PATH_MAX];
 };
 
+#define LL_STATAHEAD_MAGIC	0x5A4EAD01
+#define LL_STATAHEAD_SIZE_MAX	(1 << 20)
+
+/* names in a directory to stat ahead by LL_IOC_STATAHEAD, in the order they
+ * will be accessed */
+struct ll_statahead_names {
+	__u32	lsn_magic;	/* LL_STATAHEAD_MAGIC */
+	__u32	lsn_count;	/* number of names */
+	__u32	lsn_size;	/* bytes used in lsn_names */
+	__u32	lsn_padding;
+	char	lsn_names[0];	/* NUL terminated names, one after another */
+};
+
+#define LL_BATCH_OPS_MAGIC	0x0BA7C401
+#define LL_BATCH_OPS_MAX	1024
+
+enum lu_batch_opc {
+	LU_BATCH_CREATE		= 1,
+	LU_BATCH_SETATTR	= 2,
+	LU_BATCH_UNLINK		= 3,
+};
+
+/* lbo_valid bits, only used by LU_BATCH_SETATTR */
+#define LU_BATCH_VALID_MODE	0x01
+#define LU_BATCH_VALID_UID	0x02
+#define LU_BATCH_VALID_GID	0x04
+
+/* one operation in a directory done by LL_IOC_BATCH_OPS */
+struct lu_batch_op {
+	__u32		lbo_opc;	/* enum lu_batch_opc */
+	__s32		lbo_result;	/* 0 or -errno, set on return */
+	__u32		lbo_mode;	/* create mode, or mode to set */
+	__u32		lbo_valid;	/* LU_BATCH_VALID_* */
+	__u32		lbo_uid;
+	__u32		lbo_gid;
+	struct lu_fid	lbo_fid;	/* file to setattr, fid of the new file
+					 * on return of create */
+	char		lbo_name[NAME_MAX + 1]; /* create and unlink */
+};
+
+struct ll_batch_ops {
+	__u32			lbo_magic;	/* LL_BATCH_OPS_MAGIC */
+	__u32			lbo_count;	/* number of lbo_ops */
+	__u64			lbo_padding;
+	struct lu_batch_op	lbo_ops[0];
+};
+
 #if defined(__cplusplus)
 }
 #endif
@@ -264,6 +264,139 @@ ldlm_extent_internal_policy_waiting(struct ldlm_lock *req,
 }
 
 
+static inline bool ldlm_extent_is_write(enum ldlm_mode mode)
+{
+	return mode == LCK_PW || mode == LCK_CW;
+}
+
+/**
+ * Remember the extent of a write lock request in the resource history.
+ *
+ * For each client the history keeps the region it wrote sequentially so far
+ * and whether its requests are evenly strided, which is used by
+ * ldlm_extent_learned_policy() to size the locks of concurrent writers.
+ */
+static void ldlm_extent_hist_update(struct ldlm_lock *req)
+{
+	struct ldlm_resource *res = req->l_resource;
+	struct ldlm_namespace *ns = ldlm_res_to_ns(res);
+	__u64 cookie = req->l_export->exp_handle.h_cookie;
+	__u64 req_start = req->l_req_extent.start;
+	__u64 req_end = req->l_req_extent.end;
+	struct ldlm_extent_hist_entry *entry = NULL;
+	struct ldlm_extent_hist_entry *e;
+	time64_t now = ktime_get_seconds();
+	__u64 stride;
+	int i;
+
+	check_res_locked(res);
+
+	if (ns->ns_extent_hist_time == 0)
+		return;
+
+	if (res->lr_extent_hist == NULL) {
+		OBD_ALLOC_GFP(res->lr_extent_hist, sizeof(*res->lr_extent_hist),
+			      GFP_ATOMIC);
+		if (res->lr_extent_hist == NULL)
+			return;
+	}
+
+	for (i = 0; i < LDLM_EXTENT_HIST_SIZE; i++) {
+		e = &res->lr_extent_hist->eh_entries[i];
+		if (e->eh_cookie == cookie) {
+			entry = e;
+			break;
+		}
+		/* otherwise reuse the slot of the least recent client */
+		if (entry == NULL || e->eh_time < entry->eh_time)
+			entry = e;
+	}
+
+	if (entry->eh_cookie != cookie ||
+	    entry->eh_time + ns->ns_extent_hist_time < now) {
+		memset(entry, 0, sizeof(*entry));
+		entry->eh_cookie = cookie;
+		entry->eh_start = req_start;
+		entry->eh_end = req_end;
+	} else if (req_start >= entry->eh_start &&
+		   (req_start <= entry->eh_end ||
+		    req_start == entry->eh_end + 1)) {
+		/* sequential write, the region grows */
+		entry->eh_end = max(entry->eh_end, req_end);
+		entry->eh_strided = 0;
+	} else {
+		/* a jump, strided if it is the same as the previous one and
+		 * leaves a hole for other writers */
+		stride = req_start > entry->eh_last ?
+			 req_start - entry->eh_last : 0;
+		entry->eh_strided = stride != 0 && stride == entry->eh_stride &&
+				    stride > req_end - req_start + 1;
+		entry->eh_stride = stride;
+		entry->eh_start = req_start;
+		entry->eh_end = req_end;
+	}
+	entry->eh_last = req_start;
+	entry->eh_time = now;
+}
+
+/**
+ * Limit the extent of a write lock by the regions other clients recently
+ * wrote on the resource.
+ *
+ * The lock does not grow into the region of another writer, so that writers
+ * of separate regions of a shared file settle on one lock each instead of
+ * passing a whole-file lock back and forth. A client writing with an even
+ * stride between the blocks of other writers gets only what it asked for.
+ */
+static void ldlm_extent_learned_policy(struct ldlm_lock *req,
+				       struct ldlm_extent *new_ex)
+{
+	struct ldlm_resource *res = req->l_resource;
+	struct ldlm_namespace *ns = ldlm_res_to_ns(res);
+	__u64 cookie = req->l_export->exp_handle.h_cookie;
+	__u64 req_start = req->l_req_extent.start;
+	__u64 req_end = req->l_req_extent.end;
+	struct ldlm_extent_hist_entry *own = NULL;
+	struct ldlm_extent_hist_entry *e;
+	time64_t now = ktime_get_seconds();
+	int writers = 0;
+	int i;
+
+	if (res->lr_extent_hist == NULL || ns->ns_extent_hist_time == 0)
+		return;
+
+	for (i = 0; i < LDLM_EXTENT_HIST_SIZE; i++) {
+		e = &res->lr_extent_hist->eh_entries[i];
+		if (e->eh_cookie == 0 ||
+		    e->eh_time + ns->ns_extent_hist_time < now)
+			continue;
+
+		if (e->eh_cookie == cookie) {
+			own = e;
+			continue;
+		}
+
+		writers++;
+		/* regions overlapping the request conflict whatever extent
+		 * is granted, they can't limit it */
+		if (e->eh_end < req_start)
+			new_ex->start = max(new_ex->start, e->eh_end + 1);
+		else if (e->eh_start > req_end)
+			new_ex->end = min(new_ex->end, e->eh_start - 1);
+	}
+
+	if (writers == 0)
+		return;
+
+	if (own != NULL && own->eh_strided) {
+		new_ex->start = req_start;
+		new_ex->end = req_end;
+	}
+
+	LDLM_DEBUG(req, "%d other writers, learned extent [%llu->%llu]",
+		   writers, new_ex->start, new_ex->end);
+}
+
 /* In order to determine the largest possible extent we can grant, we need
  * to scan all of the queues. */
 static void ldlm_extent_policy(struct ldlm_resource *res,
@@ -290,6 +423,8 @@ static void ldlm_extent_policy(struct ldlm_resource *res,
 	 * LDLM_FL_LOCK_CHANGED, we must check for the NO_EXPANSION flag
 	 * in the lock flags rather than the 'flags' argument */
 	if (likely(!(lock->l_flags & LDLM_FL_NO_EXPANSION))) {
+		if (ldlm_extent_is_write(lock->l_req_mode))
+			ldlm_extent_learned_policy(lock, &new_ex);
 		ldlm_extent_internal_policy_granted(lock, &new_ex);
 		ldlm_extent_internal_policy_waiting(lock, &new_ex);
 	} else {
@@ -798,6 +933,10 @@ int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
 	check_res_locked(res);
 	*err = ELDLM_OK;
 
+	if (intention == LDLM_PROCESS_ENQUEUE && lock->l_export != NULL &&
+	    ldlm_extent_is_write(lock->l_req_mode))
+		ldlm_extent_hist_update(lock);
+
 	if (intention == LDLM_PROCESS_RESCAN) {
 		/* Careful observers will note that we don't handle -EWOULDBLOCK
 		 * here, but it's ok for a non-obvious reason -- compat_queue
@@ -189,6 +189,9 @@ int ldlm_bl_to_thread_list(struct ldlm_namespace *ns,
 			   struct list_head *cancels, int count,
 			   enum ldlm_cancel_flags cancel_flags);
 int ldlm_bl_thread_wakeup(void);
+#ifdef HAVE_SERVER_SUPPORT
+int ldlm_bl_batch_flush(struct ldlm_cb_set_arg *arg);
+#endif
 
 void ldlm_handle_bl_callback(struct ldlm_namespace *ns,
                              struct ldlm_lock_desc *ld, struct ldlm_lock *lock);
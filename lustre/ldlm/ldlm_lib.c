@@ -275,7 +275,9 @@ int client_obd_setup(struct obd_device *obddev, struct lustre_cfg *lcfg)
 	char *cli_name = lustre_cfg_buf(lcfg, 0);
 	struct ptlrpc_connection fake_conn = { .c_self = 0,
 					       .c_remote_uuid.uuid[0] = 0 };
+	struct cl_lru_pcpt *lru;
 	int rc;
+	int i;
 	ENTRY;
 
 	/* In a more perfect world, we would hang a ptlrpc_client off of
@@ -391,6 +393,7 @@ int client_obd_setup(struct obd_device *obddev, struct lustre_cfg *lcfg)
 	atomic_long_set(&cli->cl_lru_in_list, 0);
 	INIT_LIST_HEAD(&cli->cl_lru_list);
 	spin_lock_init(&cli->cl_lru_list_lock);
+	cli->cl_lru_pcpt = NULL;
 	atomic_long_set(&cli->cl_unstable_count, 0);
 	INIT_LIST_HEAD(&cli->cl_shrink_list);
 	INIT_LIST_HEAD(&cli->cl_grant_chain);
@@ -419,6 +422,7 @@ int client_obd_setup(struct obd_device *obddev, struct lustre_cfg *lcfg)
 	cli->cl_max_pages_per_rpc = PTLRPC_MAX_BRW_PAGES;
 
 	cli->cl_max_short_io_bytes = OBD_MAX_SHORT_IO_BYTES;
+	cli->cl_max_objs_per_rpc = 1;
 
 	/* set cl_chunkbits default value to PAGE_SHIFT,
 	 * it will be updated at OSC connection time. */
@@ -449,6 +453,16 @@ int client_obd_setup(struct obd_device *obddev, struct lustre_cfg *lcfg)
 
 	INIT_LIST_HEAD(&cli->cl_chg_dev_linkage);
 
+	cli->cl_lru_pcpt = cfs_percpt_alloc(cfs_cpt_tab,
+					    sizeof(**cli->cl_lru_pcpt));
+	if (cli->cl_lru_pcpt == NULL)
+		GOTO(err, rc = -ENOMEM);
+	cfs_percpt_for_each(lru, i, cli->cl_lru_pcpt) {
+		spin_lock_init(&lru->clp_lock);
+		INIT_LIST_HEAD(&lru->clp_list);
+		lru->clp_count = 0;
+	}
+
 	if (connect_op == MDS_CONNECT) {
 		cli->cl_max_mod_rpcs_in_flight = cli->cl_max_rpcs_in_flight - 1;
 		OBD_ALLOC(cli->cl_mod_tag_bitmap,
@@ -532,6 +546,9 @@ err:
 		OBD_FREE(cli->cl_mod_tag_bitmap,
 			 BITS_TO_LONGS(OBD_MAX_RIF_MAX) * sizeof(long));
 	cli->cl_mod_tag_bitmap = NULL;
+	if (cli->cl_lru_pcpt != NULL)
+		cfs_percpt_free(cli->cl_lru_pcpt);
+	cli->cl_lru_pcpt = NULL;
         RETURN(rc);
 
 }
@@ -555,6 +572,16 @@ int client_obd_cleanup(struct obd_device *obddev)
 			 BITS_TO_LONGS(OBD_MAX_RIF_MAX) * sizeof(long));
 	cli->cl_mod_tag_bitmap = NULL;
 
+	if (cli->cl_lru_pcpt != NULL) {
+		struct cl_lru_pcpt *lru;
+		int i;
+
+		cfs_percpt_for_each(lru, i, cli->cl_lru_pcpt)
+			LASSERT(list_empty(&lru->clp_list));
+		cfs_percpt_free(cli->cl_lru_pcpt);
+		cli->cl_lru_pcpt = NULL;
+	}
+
 	RETURN(0);
 }
 EXPORT_SYMBOL(client_obd_cleanup);
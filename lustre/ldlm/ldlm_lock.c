@@ -421,10 +421,10 @@ void ldlm_lock_destroy_nolock(struct ldlm_lock *lock)
         EXIT;
 }
 
-/* this is called by portals_handle2object with the handle lock taken */
-static void lock_handle_addref(void *lock)
+/* this is called by class_handle2object() under rcu_read_lock() */
+static bool lock_handle_addref(void *lock)
 {
-        LDLM_LOCK_GET((struct ldlm_lock *)lock);
+	return atomic_inc_not_zero(&((struct ldlm_lock *)lock)->l_refc);
 }
 
 static void lock_handle_free(void *lock, int size)
@@ -2048,8 +2048,9 @@ ldlm_work_bl_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 
 	ENTRY;
 
+	/* send the batches of ASTs once every lock is processed */
 	if (list_empty(arg->list))
-		RETURN(-ENOENT);
+		RETURN(ldlm_bl_batch_flush(arg) ? 0 : -ENOENT);
 
 	lock = list_entry(arg->list->next, struct ldlm_lock, l_bl_ast);
 
@@ -2237,6 +2238,7 @@ int ldlm_run_ast_work(struct ldlm_namespace *ns, struct list_head *rpc_list,
 
 	atomic_set(&arg->restart, 0);
 	arg->list = rpc_list;
+	INIT_LIST_HEAD(&arg->bl_batches);
 
 	switch (ast_type) {
 	case LDLM_WORK_CP_AST:
@@ -2246,6 +2248,7 @@ int ldlm_run_ast_work(struct ldlm_namespace *ns, struct list_head *rpc_list,
 #ifdef HAVE_SERVER_SUPPORT
 	case LDLM_WORK_BL_AST:
 		arg->type = LDLM_BL_CALLBACK;
+		arg->bl_batch_max = ns->ns_max_bl_ast_batch;
 		work_ast_lock = ldlm_work_bl_ast_lock;
 		break;
 	case LDLM_WORK_REVOKE_AST:
@@ -2272,6 +2275,7 @@ int ldlm_run_ast_work(struct ldlm_namespace *ns, struct list_head *rpc_list,
 
 	ptlrpc_set_wait(NULL, arg->set);
 	ptlrpc_set_destroy(arg->set);
+	LASSERT(list_empty(&arg->bl_batches));
 
 	rc = atomic_read(&arg->restart) ? -ERESTART : 0;
 	GOTO(out, rc);
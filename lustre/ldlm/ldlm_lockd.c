@@ -113,6 +113,9 @@ struct ldlm_bl_work_item {
 	struct ldlm_lock	*blwi_lock;
 	struct list_head	blwi_head;
 	int			blwi_count;
+	/* locks of a batched blocking AST */
+	struct ldlm_lock	**blwi_locks;
+	int			blwi_nlocks;
 	struct completion	blwi_comp;
 	enum ldlm_cancel_flags	blwi_flags;
 	int			blwi_mem_pressure;
@@ -857,6 +860,309 @@ static void ldlm_lock_reorder_req(struct ldlm_lock *lock)
 	EXIT;
 }
 
+/**
+ * Blocking ASTs of extent locks held by one client, sent together in one
+ * LDLM_BL_CALLBACK RPC. The locks share the description of the blocking lock
+ * and the AST flags, and the client cancels them in as few RPCs as possible.
+ */
+struct ldlm_bl_batch {
+	/* link into ldlm_cb_set_arg::bl_batches until it is sent */
+	struct list_head	 lbb_list;
+	struct obd_export	*lbb_exp;
+	struct ptlrpc_request	*lbb_req;
+	__u32			 lbb_flags;
+	int			 lbb_count;
+	int			 lbb_max;
+	struct ldlm_lock	*lbb_locks[0];
+};
+
+#define LDLM_BL_BATCH_SIZE(max)	offsetof(struct ldlm_bl_batch, lbb_locks[max])
+
+static int ldlm_cb_batch_interpret(const struct lu_env *env,
+				   struct ptlrpc_request *req, void *args,
+				   int rc)
+{
+	struct ldlm_cb_async_args *ca = args;
+	struct ldlm_cb_set_arg *arg = ca->ca_set_arg;
+	struct ldlm_bl_batch *lbb = ca->ca_batch;
+	struct ldlm_request *stale = NULL;
+	struct ldlm_lock *failed = NULL;
+	int i;
+	int j;
+
+	ENTRY;
+
+	/* the reply lists the locks the client didn't have any more */
+	if (rc == 0) {
+		stale = req_capsule_server_get(&req->rq_pill, &RMF_DLM_REQ);
+		if (stale == NULL || stale->lock_count > lbb->lbb_count ||
+		    req_capsule_get_size(&req->rq_pill, &RMF_DLM_REQ,
+					 RCL_SERVER) <
+		    ldlm_request_bufsize(stale->lock_count, LDLM_BL_CALLBACK))
+			rc = -EPROTO;
+	}
+
+	/* the RPC itself failed: complain and evict the client once for
+	 * the whole batch, through the first lock not cancelled meanwhile */
+	if (!req->rq_replied || (rc != 0 && rc != -EINVAL)) {
+		for (i = 0; i < lbb->lbb_count; i++) {
+			struct ldlm_lock *lock = lbb->lbb_locks[i];
+
+			if (ldlm_is_cancel(lock)) {
+				if (ldlm_handle_ast_error(lock, req, rc,
+							  "blocking") ==
+				    -ERESTART)
+					atomic_inc(&arg->restart);
+			} else if (failed == NULL) {
+				failed = lock;
+			}
+		}
+		if (failed != NULL)
+			ldlm_handle_ast_error(failed, req, rc, "blocking");
+		GOTO(out, rc);
+	}
+
+	for (i = 0; i < lbb->lbb_count; i++) {
+		struct ldlm_lock *lock = lbb->lbb_locks[i];
+		int lrc = rc;
+
+		for (j = 0; lrc == 0 && j < stale->lock_count; j++)
+			if (stale->lock_handle[j].cookie ==
+			    lock->l_remote_handle.cookie)
+				lrc = -EINVAL;
+
+		if (lrc != 0)
+			lrc = ldlm_handle_ast_error(lock, req, lrc, "blocking");
+		if (lrc == -ERESTART)
+			atomic_inc(&arg->restart);
+	}
+out:
+	/* release references taken in ldlm_bl_batch_add() */
+	for (i = 0; i < lbb->lbb_count; i++)
+		LDLM_LOCK_RELEASE(lbb->lbb_locks[i]);
+	OBD_FREE(lbb, LDLM_BL_BATCH_SIZE(lbb->lbb_max));
+
+	RETURN(0);
+}
+
+static void ldlm_bl_batch_resend(struct ptlrpc_request *req, void *data)
+{
+	struct ldlm_cb_async_args *ca = data;
+	struct ldlm_bl_batch *lbb = ca->ca_batch;
+	int i;
+
+	for (i = 0; i < lbb->lbb_count; i++)
+		ldlm_refresh_waiting_lock(lbb->lbb_locks[i],
+					  ldlm_bl_timeout(lbb->lbb_locks[i]));
+}
+
+static struct ldlm_bl_batch *ldlm_bl_batch_alloc(struct ldlm_cb_set_arg *arg,
+						 struct ldlm_lock *lock,
+						 struct ldlm_lock_desc *desc,
+						 __u32 flags)
+{
+	struct ldlm_cb_async_args *ca;
+	struct ldlm_bl_batch *lbb;
+	struct ldlm_request *body;
+	struct ptlrpc_request *req;
+	int rc;
+
+	OBD_ALLOC(lbb, LDLM_BL_BATCH_SIZE(arg->bl_batch_max));
+	if (lbb == NULL)
+		return NULL;
+
+	req = ptlrpc_request_alloc(lock->l_export->exp_imp_reverse,
+				   &RQF_LDLM_BL_CALLBACK_BATCH);
+	if (req == NULL)
+		GOTO(out_free, rc = -ENOMEM);
+
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_REQ, RCL_CLIENT,
+			     ldlm_request_bufsize(arg->bl_batch_max,
+						  LDLM_BL_CALLBACK));
+	rc = ptlrpc_request_pack(req, LUSTRE_DLM_VERSION, LDLM_BL_CALLBACK);
+	if (rc) {
+		ptlrpc_request_free(req);
+		GOTO(out_free, rc);
+	}
+
+	body = req_capsule_client_get(&req->rq_pill, &RMF_DLM_REQ);
+	body->lock_desc = *desc;
+	body->lock_flags = flags;
+
+	CLASSERT(sizeof(*ca) <= sizeof(req->rq_async_args));
+	ca = ptlrpc_req_async_args(req);
+	ca->ca_set_arg = arg;
+	ca->ca_lock = NULL;
+	ca->ca_batch = lbb;
+	req->rq_interpret_reply = ldlm_cb_batch_interpret;
+
+	lbb->lbb_exp = lock->l_export;
+	lbb->lbb_req = req;
+	lbb->lbb_flags = flags;
+	lbb->lbb_max = arg->bl_batch_max;
+	list_add_tail(&lbb->lbb_list, &arg->bl_batches);
+
+	return lbb;
+out_free:
+	OBD_FREE(lbb, LDLM_BL_BATCH_SIZE(arg->bl_batch_max));
+	return NULL;
+}
+
+static void ldlm_bl_batch_send(struct ldlm_cb_set_arg *arg,
+			       struct ldlm_bl_batch *lbb)
+{
+	struct ptlrpc_request *req = lbb->lbb_req;
+	struct ldlm_request *body;
+	int size;
+
+	list_del_init(&lbb->lbb_list);
+
+	/* every lock was destroyed or not granted yet */
+	if (lbb->lbb_count == 0) {
+		ptlrpc_req_finished(req);
+		OBD_FREE(lbb, LDLM_BL_BATCH_SIZE(lbb->lbb_max));
+		return;
+	}
+
+	body = req_capsule_client_get(&req->rq_pill, &RMF_DLM_REQ);
+	body->lock_count = lbb->lbb_count;
+
+	size = ldlm_request_bufsize(lbb->lbb_count, LDLM_BL_CALLBACK);
+	req_capsule_shrink(&req->rq_pill, &RMF_DLM_REQ, size, RCL_CLIENT);
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_REQ, RCL_SERVER, size);
+	ptlrpc_request_set_replen(req);
+
+	req->rq_send_state = LUSTRE_IMP_FULL;
+	/* Do not resend after lock callback timeout */
+	req->rq_delay_limit = ldlm_bl_timeout(lbb->lbb_locks[0]);
+	req->rq_resend_cb = ldlm_bl_batch_resend;
+	if (AT_OFF)
+		req->rq_timeout = ldlm_get_rq_timeout();
+
+	CDEBUG(D_DLMTRACE, "%s: blocking AST of %d locks to %s\n",
+	       lbb->lbb_exp->exp_obd->obd_name, lbb->lbb_count,
+	       obd_export_nid2str(lbb->lbb_exp));
+
+	ptlrpc_set_add_req(arg->set, req);
+}
+
+/**
+ * Send the next batch of blocking ASTs, once all locks of the AST work list
+ * are processed.
+ *
+ * \retval 1 if a batch was sent or dropped
+ * \retval 0 if there was no batch left
+ */
+int ldlm_bl_batch_flush(struct ldlm_cb_set_arg *arg)
+{
+	if (list_empty(&arg->bl_batches))
+		return 0;
+
+	ldlm_bl_batch_send(arg, list_entry(arg->bl_batches.next,
+					   struct ldlm_bl_batch, lbb_list));
+	return 1;
+}
+
+/* lr_pad is not initialized by ldlm_lock2desc(), don't compare it */
+static bool ldlm_bl_desc_eq(const struct ldlm_lock_desc *d1,
+			    const struct ldlm_lock_desc *d2)
+{
+	return d1->l_resource.lr_type == d2->l_resource.lr_type &&
+	       ldlm_res_eq(&d1->l_resource.lr_name, &d2->l_resource.lr_name) &&
+	       d1->l_req_mode == d2->l_req_mode &&
+	       d1->l_granted_mode == d2->l_granted_mode &&
+	       memcmp(&d1->l_policy_data, &d2->l_policy_data,
+		      sizeof(d1->l_policy_data)) == 0;
+}
+
+static bool ldlm_bl_batch_allowed(struct ldlm_lock *lock,
+				  struct ldlm_cb_set_arg *arg)
+{
+	return arg->bl_batch_max > 1 &&
+	       lock->l_resource->lr_type == LDLM_EXTENT &&
+	       !ldlm_is_cancel_on_block(lock) &&
+	       exp_connect_batch_bl_ast(lock->l_export);
+}
+
+/**
+ * Add a blocking AST of \a lock to the batch of its export, instead of
+ * sending a RPC for it alone. A full batch is sent at once, the others when
+ * the AST work list is exhausted, see ldlm_bl_batch_flush().
+ *
+ * \retval 0 if the AST is batched or not needed any more
+ * \retval -ENOMEM if the AST must be sent alone
+ */
+static int ldlm_bl_batch_add(struct ldlm_lock *lock,
+			     struct ldlm_lock_desc *desc,
+			     struct ldlm_cb_set_arg *arg)
+{
+	struct ldlm_bl_batch *lbb;
+	struct ldlm_request *body;
+	__u32 flags;
+
+	ENTRY;
+
+	flags = ldlm_flags_to_wire(lock->l_flags & LDLM_FL_AST_MASK);
+
+	list_for_each_entry(lbb, &arg->bl_batches, lbb_list) {
+		if (lbb->lbb_exp != lock->l_export)
+			continue;
+
+		body = req_capsule_client_get(&lbb->lbb_req->rq_pill,
+					      &RMF_DLM_REQ);
+		if (lbb->lbb_flags == flags &&
+		    ldlm_bl_desc_eq(&body->lock_desc, desc))
+			goto found;
+
+		/* another blocking lock, start a new batch */
+		ldlm_bl_batch_send(arg, lbb);
+		break;
+	}
+
+	lbb = ldlm_bl_batch_alloc(arg, lock, desc, flags);
+	if (lbb == NULL)
+		RETURN(-ENOMEM);
+	body = req_capsule_client_get(&lbb->lbb_req->rq_pill, &RMF_DLM_REQ);
+found:
+	lock_res_and_lock(lock);
+	if (ldlm_is_destroyed(lock)) {
+		unlock_res_and_lock(lock);
+		RETURN(0);
+	}
+
+	if (!ldlm_is_granted(lock)) {
+		/*
+		 * this blocking AST will be communicated as part of the
+		 * completion AST instead
+		 */
+		ldlm_add_blocked_lock(lock);
+		ldlm_set_waited(lock);
+		unlock_res_and_lock(lock);
+
+		LDLM_DEBUG(lock, "lock not granted, not sending blocking AST");
+		RETURN(0);
+	}
+
+	LDLM_DEBUG(lock, "server batching blocking AST");
+
+	ldlm_set_cbpending(lock);
+	ldlm_add_waiting_lock(lock, ldlm_bl_timeout(lock));
+	unlock_res_and_lock(lock);
+
+	body->lock_handle[lbb->lbb_count] = lock->l_remote_handle;
+	lbb->lbb_locks[lbb->lbb_count++] = LDLM_LOCK_GET(lock);
+
+	if (lock->l_export->exp_nid_stats &&
+	    lock->l_export->exp_nid_stats->nid_ldlm_stats)
+		lprocfs_counter_incr(lock->l_export->exp_nid_stats->nid_ldlm_stats,
+				     LDLM_BL_CALLBACK - LDLM_FIRST_OPC);
+
+	if (lbb->lbb_count == lbb->lbb_max)
+		ldlm_bl_batch_send(arg, lbb);
+
+	RETURN(0);
+}
+
 /**
  * ->l_blocking_ast() method for server-side locks. This is invoked when newly
  * enqueued server lock conflicts with given one.
@@ -893,6 +1199,10 @@ int ldlm_server_blocking_ast(struct ldlm_lock *lock,
 
 	ldlm_lock_reorder_req(lock);
 
+	if (ldlm_bl_batch_allowed(lock, arg) &&
+	    ldlm_bl_batch_add(lock, desc, arg) == 0)
+		RETURN(0);
+
 	req = ptlrpc_request_alloc_pack(lock->l_export->exp_imp_reverse,
 					&RQF_LDLM_BL_CALLBACK,
 					LUSTRE_DLM_VERSION, LDLM_BL_CALLBACK);
@@ -1554,6 +1864,70 @@ retry:
 	return rc;
 }
 
+/**
+ * Hand a granted server-local \a lock over to the client export \a exp as the
+ * server side of the client lock \a remote, and fill the enqueue reply
+ * \a dlm_rep, like an intent enqueue whose lock was replaced by the policy.
+ *
+ * This is for enqueues packed inside another RPC (e.g. MDS_BATCH_GETATTR)
+ * which don't go through ldlm_handle_enqueue0(). The single reader or writer
+ * reference of the caller is moved to the export on success.
+ */
+int ldlm_lock_export_local(struct obd_export *exp, struct ldlm_lock *lock,
+			   const struct lustre_handle *remote,
+			   struct ldlm_reply *dlm_rep)
+{
+	__u64 flags = LDLM_FL_LOCK_CHANGED;
+	ENTRY;
+
+	/* don't move a lock onto an export being cleaned up (b=5683) */
+	if (unlikely(exp->exp_disconnected))
+		RETURN(-ENOTCONN);
+
+	lock_res_and_lock(lock);
+	LASSERT(lock->l_export == NULL);
+	LASSERT(lock->l_readers + lock->l_writers == 1);
+
+	/* Zero l_readers and l_writers without triggering possible blocking
+	 * AST, the reference now belongs to the export. */
+	while (lock->l_readers > 0) {
+		lu_ref_del(&lock->l_reference, "reader", lock);
+		lu_ref_del(&lock->l_reference, "user", lock);
+		lock->l_readers--;
+	}
+	while (lock->l_writers > 0) {
+		lu_ref_del(&lock->l_reference, "writer", lock);
+		lu_ref_del(&lock->l_reference, "user", lock);
+		lock->l_writers--;
+	}
+
+	lock->l_export = class_export_lock_get(exp, lock);
+	lock->l_blocking_ast = ldlm_server_blocking_ast;
+	lock->l_completion_ast = ldlm_server_completion_ast;
+	if (ldlm_has_dom(lock))
+		lock->l_glimpse_ast = ldlm_server_glimpse_ast;
+	lock->l_remote_handle = *remote;
+	lock->l_flags &= ~LDLM_FL_LOCAL;
+
+	ldlm_lock2desc(lock, &dlm_rep->lock_desc);
+	ldlm_lock2handle(lock, &dlm_rep->lock_handle);
+
+	if (ldlm_is_ast_sent(lock)) {
+		flags |= LDLM_FL_AST_SENT;
+		if (ldlm_is_granted(lock))
+			ldlm_add_waiting_lock(lock, ldlm_bl_timeout(lock));
+	}
+	dlm_rep->lock_flags = ldlm_flags_to_wire(flags);
+	unlock_res_and_lock(lock);
+
+	cfs_hash_add(exp->exp_lock_hash, &lock->l_remote_handle,
+		     &lock->l_exp_hash);
+
+	LDLM_DEBUG(lock, "exported to client");
+	RETURN(0);
+}
+EXPORT_SYMBOL(ldlm_lock_export_local);
+
 /*
  * Clear the blocking lock, the race is possible between ldlm_handle_convert0()
  * and ldlm_work_bl_ast_lock(), so this is done under lock with check for NULL.
@@ -1849,6 +2223,54 @@ void ldlm_handle_bl_callback(struct ldlm_namespace *ns,
 	EXIT;
 }
 
+/**
+ * Handle the locks of a batched blocking AST: the unused ones are cancelled
+ * together, so that their cancels are packed in as few RPCs as possible, the
+ * others go through the blocking callback of each lock.
+ */
+static void ldlm_handle_bl_callback_list(struct ldlm_namespace *ns,
+					 struct ldlm_lock_desc *ld,
+					 struct ldlm_lock **locks, int count)
+{
+	struct list_head cancels = LIST_HEAD_INIT(cancels);
+	int ncancels = 0;
+	int i;
+
+	ENTRY;
+
+	for (i = 0; i < count; i++) {
+		struct ldlm_lock *lock = locks[i];
+
+		/* the lock disappeared, see ldlm_handle_bl_callback_batch() */
+		if (lock == NULL)
+			continue;
+
+		lock_res_and_lock(lock);
+		if (lock->l_resource->lr_type != LDLM_EXTENT ||
+		    lock->l_readers || lock->l_writers ||
+		    ldlm_is_canceling(lock)) {
+			unlock_res_and_lock(lock);
+			ldlm_handle_bl_callback(ns, ld, lock);
+			continue;
+		}
+		ldlm_set_cbpending(lock);
+		ldlm_set_canceling(lock);
+		unlock_res_and_lock(lock);
+
+		LDLM_DEBUG(lock, "client batched blocking AST, cancel it");
+		/* the reference is dropped by ldlm_cli_cancel_list() */
+		list_add_tail(&lock->l_bl_ast, &cancels);
+		ncancels++;
+	}
+
+	if (ncancels > 0) {
+		ncancels = ldlm_cli_cancel_list_local(&cancels, ncancels,
+						      LCF_BL_AST);
+		ldlm_cli_cancel_list(&cancels, ncancels, NULL, LCF_ASYNC);
+	}
+	EXIT;
+}
+
 /**
  * Callback handler for receiving incoming completion ASTs.
  *
@@ -2159,6 +2581,24 @@ int ldlm_bl_to_thread_list(struct ldlm_namespace *ns, struct ldlm_lock_desc *ld,
 	return ldlm_bl_to_thread(ns, ld, NULL, cancels, count, cancel_flags);
 }
 
+/* queue the locks of a batched blocking AST, \a locks is freed once done */
+static int ldlm_bl_to_thread_locks(struct ldlm_namespace *ns,
+				   struct ldlm_lock_desc *ld,
+				   struct ldlm_lock **locks, int count)
+{
+	struct ldlm_bl_work_item *blwi;
+
+	OBD_ALLOC(blwi, sizeof(*blwi));
+	if (blwi == NULL)
+		return -ENOMEM;
+
+	init_blwi(blwi, ns, ld, NULL, 0, NULL, LCF_ASYNC);
+	blwi->blwi_locks = locks;
+	blwi->blwi_nlocks = count;
+
+	return __ldlm_bl_to_thread(blwi, LCF_ASYNC);
+}
+
 int ldlm_bl_thread_wakeup(void)
 {
 	wake_up(&ldlm_state->ldlm_bl_pool->blp_waitq);
@@ -2224,6 +2664,105 @@ static inline void ldlm_callback_errmsg(struct ptlrpc_request *req,
 		CWARN("Send reply failed, maybe cause b=21636.\n");
 }
 
+/**
+ * Handle a blocking AST of several locks. The reply lists the locks which
+ * are already gone, so that the server doesn't wait for their cancel.
+ */
+static void ldlm_handle_bl_callback_batch(struct ptlrpc_request *req,
+					  struct ldlm_namespace *ns,
+					  struct ldlm_request *dlm_req)
+{
+	struct ldlm_request *stale;
+	struct ldlm_lock **locks;
+	struct ldlm_lock *lock;
+	int count = dlm_req->lock_count;
+	int size;
+	int rc;
+	int i;
+
+	ENTRY;
+
+	size = ldlm_request_bufsize(count, LDLM_BL_CALLBACK);
+	if (req_capsule_get_size(&req->rq_pill, &RMF_DLM_REQ,
+				 RCL_CLIENT) < size) {
+		rc = ldlm_callback_reply(req, -EPROTO);
+		ldlm_callback_errmsg(req, "Operate with short lock list", rc,
+				     NULL);
+		RETURN_EXIT;
+	}
+
+	req_capsule_extend(&req->rq_pill, &RQF_LDLM_BL_CALLBACK_BATCH);
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_REQ, RCL_SERVER, size);
+	rc = req_capsule_server_pack(&req->rq_pill);
+	if (rc) {
+		rc = ldlm_callback_reply(req, rc);
+		ldlm_callback_errmsg(req, "Pack batch reply", rc, NULL);
+		RETURN_EXIT;
+	}
+	stale = req_capsule_server_get(&req->rq_pill, &RMF_DLM_REQ);
+	stale->lock_count = 0;
+
+	/* without memory to batch, the locks are called back one by one */
+	OBD_ALLOC(locks, count * sizeof(*locks));
+
+	for (i = 0; i < count; i++) {
+		struct lustre_handle *lockh = &dlm_req->lock_handle[i];
+
+		lock = ldlm_handle2lock_long(lockh, 0);
+		if (lock != NULL) {
+			lock_res_and_lock(lock);
+			if ((ldlm_is_canceling(lock) && ldlm_is_bl_done(lock)) ||
+			    ldlm_is_failed(lock)) {
+				unlock_res_and_lock(lock);
+				LDLM_LOCK_RELEASE(lock);
+				lock = NULL;
+			} else {
+				lock->l_flags |= ldlm_flags_from_wire(
+					dlm_req->lock_flags & LDLM_FL_AST_MASK);
+				ldlm_lock_remove_from_lru(lock);
+				ldlm_set_bl_ast(lock);
+				unlock_res_and_lock(lock);
+			}
+		}
+
+		if (lock == NULL) {
+			CDEBUG(D_DLMTRACE,
+			       "callback on lock %#llx - lock disappeared\n",
+			       lockh->cookie);
+			stale->lock_handle[stale->lock_count++] = *lockh;
+		} else if (locks == NULL) {
+			LDLM_LOCK_RELEASE(lock);
+		}
+		if (locks != NULL)
+			locks[i] = lock;
+	}
+
+	rc = ldlm_callback_reply(req, 0);
+	if (req->rq_no_reply || rc)
+		ldlm_callback_errmsg(req, "Normal process", rc, NULL);
+
+	if (locks == NULL) {
+		for (i = 0; i < count; i++) {
+			lock = ldlm_handle2lock_long(&dlm_req->lock_handle[i],
+						     0);
+			if (lock == NULL)
+				continue;
+			if (ldlm_bl_to_thread_lock(ns, &dlm_req->lock_desc,
+						   lock))
+				ldlm_handle_bl_callback(ns, &dlm_req->lock_desc,
+							lock);
+		}
+		RETURN_EXIT;
+	}
+
+	if (ldlm_bl_to_thread_locks(ns, &dlm_req->lock_desc, locks, count)) {
+		ldlm_handle_bl_callback_list(ns, &dlm_req->lock_desc, locks,
+					     count);
+		OBD_FREE(locks, count * sizeof(*locks));
+	}
+	EXIT;
+}
+
 /* TODO: handle requests in a similar way as MDT: see mdt_handle_common() */
 static int ldlm_callback_handler(struct ptlrpc_request *req)
 {
@@ -2297,6 +2836,16 @@ static int ldlm_callback_handler(struct ptlrpc_request *req)
 		RETURN(0);
 	}
 
+	/*
+	 * lock_count is only set by batched blocking ASTs, which are sent to
+	 * clients with OBD_CONNECT2_BATCH_BL_AST, even for a single lock
+	 */
+	if (lustre_msg_get_opc(req->rq_reqmsg) == LDLM_BL_CALLBACK &&
+	    dlm_req->lock_count > 0) {
+		ldlm_handle_bl_callback_batch(req, ns, dlm_req);
+		RETURN(0);
+	}
+
 	/*
 	 * Force a known safe race, send a cancel to the server for a lock
 	 * which the server has already started a blocking callback on.
@@ -2767,6 +3316,12 @@ static int ldlm_bl_thread_blwi(struct ldlm_bl_pool *blp,
 						   LCF_BL_AST);
 		ldlm_cli_cancel_list(&blwi->blwi_head, count, NULL,
 				     blwi->blwi_flags);
+	} else if (blwi->blwi_locks) {
+		ldlm_handle_bl_callback_list(blwi->blwi_ns, &blwi->blwi_ld,
+					     blwi->blwi_locks,
+					     blwi->blwi_nlocks);
+		OBD_FREE(blwi->blwi_locks,
+			 blwi->blwi_nlocks * sizeof(*blwi->blwi_locks));
 	} else {
 		ldlm_handle_bl_callback(blwi->blwi_ns, &blwi->blwi_ld,
 					blwi->blwi_lock);
@@ -3373,13 +3928,13 @@ void ldlm_exit(void)
 {
 	if (ldlm_refcount)
 		CERROR("ldlm_refcount is %d in ldlm_exit!\n", ldlm_refcount);
-	kmem_cache_destroy(ldlm_resource_slab);
 	/*
-	 * ldlm_lock_put() use RCU to call ldlm_lock_free, so need call
-	 * rcu_barrier() to wait all outstanding RCU callbacks to complete,
-	 * so that ldlm_lock_free() get a chance to be called.
+	 * ldlm_lock_put() and ldlm_resource_putref() use RCU to free locks
+	 * and resources, so need call rcu_barrier() to wait all outstanding
+	 * RCU callbacks to complete before the slabs are destroyed.
 	 */
 	rcu_barrier();
+	kmem_cache_destroy(ldlm_resource_slab);
 	kmem_cache_destroy(ldlm_lock_slab);
 	kmem_cache_destroy(ldlm_interval_slab);
 	kmem_cache_destroy(ldlm_interval_tree_slab);
@@ -635,6 +635,32 @@ static ssize_t contended_locks_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(contended_locks);
 
+static ssize_t extent_hist_seconds_show(struct kobject *kobj,
+					struct attribute *attr, char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return sprintf(buf, "%llu\n", ns->ns_extent_hist_time);
+}
+
+static ssize_t extent_hist_seconds_store(struct kobject *kobj,
+					 struct attribute *attr,
+					 const char *buffer, size_t count)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+	unsigned long long tmp;
+
+	if (kstrtoull(buffer, 10, &tmp))
+		return -EINVAL;
+
+	ns->ns_extent_hist_time = tmp;
+
+	return count;
+}
+LUSTRE_RW_ATTR(extent_hist_seconds);
+
 static ssize_t max_parallel_ast_show(struct kobject *kobj,
 				     struct attribute *attr, char *buf)
 {
@@ -663,6 +689,37 @@ static ssize_t max_parallel_ast_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(max_parallel_ast);
 
+static ssize_t max_bl_ast_batch_show(struct kobject *kobj,
+				     struct attribute *attr, char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return sprintf(buf, "%u\n", ns->ns_max_bl_ast_batch);
+}
+
+static ssize_t max_bl_ast_batch_store(struct kobject *kobj,
+				      struct attribute *attr,
+				      const char *buffer, size_t count)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+	unsigned long tmp;
+	int err;
+
+	err = kstrtoul(buffer, 10, &tmp);
+	if (err != 0)
+		return -EINVAL;
+
+	if (tmp < 1 || tmp > LDLM_MAX_BL_AST_BATCH)
+		return -ERANGE;
+
+	ns->ns_max_bl_ast_batch = tmp;
+
+	return count;
+}
+LUSTRE_RW_ATTR(max_bl_ast_batch);
+
 #endif /* HAVE_SERVER_SUPPORT */
 
 /* These are for namespaces in /sys/fs/lustre/ldlm/namespaces/ */
@@ -680,7 +737,9 @@ static struct attribute *ldlm_ns_attrs[] = {
 	&lustre_attr_max_nolock_bytes.attr,
 	&lustre_attr_contention_seconds.attr,
 	&lustre_attr_contended_locks.attr,
+	&lustre_attr_extent_hist_seconds.attr,
 	&lustre_attr_max_parallel_ast.attr,
+	&lustre_attr_max_bl_ast_batch.attr,
 #endif
 	NULL,
 };
@@ -733,6 +792,12 @@ int ldlm_namespace_sysfs_register(struct ldlm_namespace *ns)
 
 	lprocfs_counter_init(ns->ns_stats, LDLM_NSS_LOCKS,
 			     LPROCFS_CNTR_AVGMINMAX, "locks", "locks");
+	lprocfs_counter_init(ns->ns_stats, LDLM_NSS_RES_LOOKUP_RCU, 0,
+			     "res_lookup_rcu", "lookups");
+	lprocfs_counter_init(ns->ns_stats, LDLM_NSS_RES_LOOKUP_LOCKED, 0,
+			     "res_lookup_locked", "lookups");
+	lprocfs_counter_init(ns->ns_stats, LDLM_NSS_RES_CREATE_RACE, 0,
+			     "res_create_race", "races");
 
 	return err;
 }
@@ -751,7 +816,7 @@ static int ldlm_namespace_debugfs_register(struct ldlm_namespace *ns)
 		ns->ns_debugfs_entry = ns_entry;
 	}
 
-	return 0;
+	return ldebugfs_register_stats(ns_entry, "stats", ns->ns_stats);
 }
 #undef MAX_STRING_SIZE
 
@@ -957,7 +1022,8 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 					 CFS_HASH_DEPTH |
 					 CFS_HASH_BIGNAME |
 					 CFS_HASH_SPIN_BKTLOCK |
-					 CFS_HASH_NO_ITEMREF);
+					 CFS_HASH_NO_ITEMREF |
+					 CFS_HASH_RCU);
 	if (ns->ns_rs_hash == NULL)
 		GOTO(out_ns, NULL);
 
@@ -984,8 +1050,10 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	ns->ns_max_nolock_size    = NS_DEFAULT_MAX_NOLOCK_BYTES;
 	ns->ns_contention_time    = NS_DEFAULT_CONTENTION_SECONDS;
 	ns->ns_contended_locks    = NS_DEFAULT_CONTENDED_LOCKS;
+	ns->ns_extent_hist_time   = NS_DEFAULT_EXTENT_HIST_SECONDS;
 
 	ns->ns_max_parallel_ast   = LDLM_DEFAULT_PARALLEL_AST_LIMIT;
+	ns->ns_max_bl_ast_batch   = LDLM_DEFAULT_BL_AST_BATCH;
 	ns->ns_nr_unused          = 0;
 	ns->ns_max_unused         = LDLM_DEFAULT_LRU_SIZE;
 	ns->ns_max_age            = ktime_set(LDLM_DEFAULT_MAX_ALIVE, 0);
@@ -1446,7 +1514,8 @@ static struct ldlm_resource *ldlm_resource_new(enum ldlm_type ldlm_type)
 /**
  * Return a reference to resource with given name, creating it if necessary.
  * Args: namespace with ns_lock unlocked
- * Locks: takes and releases NS hash-lock and res->lr_lock
+ * Locks: lockless RCU lookup first, takes and releases NS hash-lock
+ *        only on a miss
  * Returns: referenced, unlocked ldlm_resource or NULL
  */
 struct ldlm_resource *
@@ -1465,7 +1534,28 @@ ldlm_resource_get(struct ldlm_namespace *ns, struct ldlm_resource *parent,
 	LASSERT(ns->ns_rs_hash != NULL);
 	LASSERT(name->name[0] != 0);
 
-	cfs_hash_bd_get_and_lock(ns->ns_rs_hash, (void *)name, &bd, 0);
+	cfs_hash_bd_get(ns->ns_rs_hash, (void *)name, &bd);
+
+	/* Fast path: resources are RCU-freed, so the bucket can be walked
+	 * without its lock. A resource whose refcount already dropped to
+	 * zero is being unhashed by ldlm_resource_putref(), treat it as a
+	 * miss and let the locked lookup below sort it out. */
+	rcu_read_lock();
+	hnode = cfs_hash_bd_lookup_rcu(ns->ns_rs_hash, &bd, (void *)name);
+	if (hnode != NULL) {
+		res = hlist_entry(hnode, struct ldlm_resource, lr_hash);
+		if (atomic_inc_not_zero(&res->lr_refcount)) {
+			rcu_read_unlock();
+			lprocfs_counter_incr(ns->ns_stats,
+					     LDLM_NSS_RES_LOOKUP_RCU);
+			return res;
+		}
+		res = NULL;
+	}
+	rcu_read_unlock();
+
+	lprocfs_counter_incr(ns->ns_stats, LDLM_NSS_RES_LOOKUP_LOCKED);
+	cfs_hash_bd_lock(ns->ns_rs_hash, &bd, 0);
 	hnode = cfs_hash_bd_lookup_locked(ns->ns_rs_hash, &bd, (void *)name);
 	if (hnode != NULL) {
 		cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 0);
@@ -1495,6 +1585,7 @@ ldlm_resource_get(struct ldlm_namespace *ns, struct ldlm_resource *parent,
 	if (hnode != NULL) {
 		/* Someone won the race and already added the resource. */
 		cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 1);
+		lprocfs_counter_incr(ns->ns_stats, LDLM_NSS_RES_CREATE_RACE);
 		/* Clean lu_ref for failed resource. */
 		lu_ref_fini(&res->lr_reference);
 		if (res->lr_itree != NULL)
@@ -1560,6 +1651,14 @@ static void __ldlm_resource_putref_final(struct cfs_hash_bd *bd,
 		ldlm_namespace_put(nsb->nsb_namespace);
 }
 
+static void ldlm_resource_free_rcu(struct rcu_head *head)
+{
+	struct ldlm_resource *res = container_of(head, struct ldlm_resource,
+						 lr_rcu);
+
+	OBD_SLAB_FREE_PTR(res, ldlm_resource_slab);
+}
+
 /* Returns 1 if the resource was freed, 0 if it remains. */
 int ldlm_resource_putref(struct ldlm_resource *res)
 {
@@ -1579,7 +1678,11 @@ int ldlm_resource_putref(struct ldlm_resource *res)
 		if (res->lr_itree != NULL)
 			OBD_SLAB_FREE(res->lr_itree, ldlm_interval_tree_slab,
 				      sizeof(*res->lr_itree) * LCK_MODE_NUM);
-		OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
+		if (res->lr_extent_hist != NULL)
+			OBD_FREE_PTR(res->lr_extent_hist);
+		/* lockless lookups may still be looking at lr_name and
+		 * lr_refcount */
+		call_rcu(&res->lr_rcu, ldlm_resource_free_rcu);
 		return 1;
 	}
 	return 0;
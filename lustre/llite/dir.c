@@ -1290,6 +1290,175 @@ static char *ll_getname(const char __user *filename)
 
 #define ll_putname(filename) OBD_FREE(filename, NAME_MAX + 1);
 
+static int ll_batch_op_prep(struct inode *dir, struct lu_batch_op *op,
+			    struct md_batch_item *item)
+{
+	struct md_op_data *op_data;
+	size_t namelen = 0;
+	umode_t mode = 0;
+	__u32 opc = LUSTRE_OPC_ANY;
+
+	switch (op->lbo_opc) {
+	case LU_BATCH_CREATE:
+		mode = op->lbo_mode;
+		if (!IS_POSIXACL(dir) || !exp_connect_umask(ll_i2mdexp(dir)))
+			mode &= ~current_umask();
+		switch (mode & S_IFMT) {
+		case 0:
+			mode |= S_IFREG;
+			/* fallthrough */
+		case S_IFREG:
+		case S_IFIFO:
+		case S_IFSOCK:
+			opc = LUSTRE_OPC_MKNOD;
+			break;
+		case S_IFDIR:
+			opc = LUSTRE_OPC_MKDIR;
+			break;
+		default:
+			return -EINVAL;
+		}
+		/* fallthrough */
+	case LU_BATCH_UNLINK:
+		namelen = strnlen(op->lbo_name, sizeof(op->lbo_name));
+		if (namelen == 0 || namelen > NAME_MAX ||
+		    memchr(op->lbo_name, '/', namelen) != NULL)
+			return -EINVAL;
+		break;
+	case LU_BATCH_SETATTR:
+		if (!fid_is_sane(&op->lbo_fid) || op->lbo_valid == 0 ||
+		    op->lbo_valid & ~(LU_BATCH_VALID_MODE | LU_BATCH_VALID_UID |
+				      LU_BATCH_VALID_GID))
+			return -EINVAL;
+		break;
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	op_data = ll_prep_md_op_data(NULL, dir, NULL,
+				     namelen ? op->lbo_name : NULL, namelen,
+				     mode, opc, NULL);
+	if (IS_ERR(op_data))
+		return PTR_ERR(op_data);
+
+	switch (op->lbo_opc) {
+	case LU_BATCH_CREATE:
+		item->mbi_opc = REINT_CREATE;
+		item->mbi_mode = mode;
+		item->mbi_uid = from_kuid(&init_user_ns, current_fsuid());
+		item->mbi_gid = from_kgid(&init_user_ns, current_fsgid());
+		op_data->op_cap = cfs_curproc_cap_pack();
+		break;
+	case LU_BATCH_SETATTR:
+		item->mbi_opc = REINT_SETATTR;
+		op_data->op_fid1 = op->lbo_fid;
+		op_data->op_attr.ia_valid = ATTR_CTIME;
+		op_data->op_attr.ia_ctime = current_time(dir);
+		if (op->lbo_valid & LU_BATCH_VALID_MODE) {
+			op_data->op_attr.ia_valid |= ATTR_MODE;
+			op_data->op_attr.ia_mode = op->lbo_mode & S_IALLUGO;
+		}
+		if (op->lbo_valid & LU_BATCH_VALID_UID) {
+			op_data->op_attr.ia_valid |= ATTR_UID;
+			op_data->op_attr.ia_uid = make_kuid(&init_user_ns,
+							    op->lbo_uid);
+		}
+		if (op->lbo_valid & LU_BATCH_VALID_GID) {
+			op_data->op_attr.ia_valid |= ATTR_GID;
+			op_data->op_attr.ia_gid = make_kgid(&init_user_ns,
+							    op->lbo_gid);
+		}
+		break;
+	case LU_BATCH_UNLINK:
+		item->mbi_opc = REINT_UNLINK;
+		break;
+	}
+	item->mbi_op_data = op_data;
+
+	return 0;
+}
+
+/*
+ * Create, setattr or unlink up to LL_BATCH_OPS_MAX files of a directory in
+ * as few RPCs as the MDTs allow. The ioctl only fails if the operations
+ * could not be tried, the outcome of each one is in its lbo_result.
+ */
+static int ll_ioctl_batch_ops(struct file *file,
+			      struct ll_batch_ops __user *uarg)
+{
+	struct inode *dir = file_inode(file);
+	struct md_batch_item *items = NULL;
+	struct lu_batch_op *ops;
+	struct ll_batch_ops lbo;
+	size_t size;
+	int count = 0;
+	int rc = 0;
+	int i;
+	ENTRY;
+
+	if (copy_from_user(&lbo, uarg, sizeof(lbo)))
+		RETURN(-EFAULT);
+
+	if (lbo.lbo_magic != LL_BATCH_OPS_MAGIC || lbo.lbo_count == 0)
+		RETURN(-EINVAL);
+
+	if (lbo.lbo_count > LL_BATCH_OPS_MAX)
+		RETURN(-E2BIG);
+
+	size = lbo.lbo_count * sizeof(*ops);
+	OBD_ALLOC_LARGE(ops, size);
+	if (ops == NULL)
+		RETURN(-ENOMEM);
+
+	if (copy_from_user(ops, uarg->lbo_ops, size))
+		GOTO(out, rc = -EFAULT);
+
+	OBD_ALLOC_LARGE(items, lbo.lbo_count * sizeof(*items));
+	if (items == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	/* invalid operations fail by themselves, the rest is batched */
+	for (i = 0; i < lbo.lbo_count; i++) {
+		ops[i].lbo_result = ll_batch_op_prep(dir, &ops[i],
+						     &items[count]);
+		if (ops[i].lbo_result == 0)
+			count++;
+	}
+
+	if (count > 0) {
+		rc = md_batch_reint(ll_i2mdexp(dir), items, count);
+		if (rc)
+			GOTO(out_items, rc);
+	}
+
+	for (i = 0, count = 0; i < lbo.lbo_count; i++) {
+		struct md_op_data *op_data;
+
+		if (ops[i].lbo_result)
+			continue;
+
+		op_data = items[count].mbi_op_data;
+		ops[i].lbo_result = items[count].mbi_result;
+		if (ops[i].lbo_opc == LU_BATCH_CREATE &&
+		    ops[i].lbo_result == 0)
+			ops[i].lbo_fid = op_data->op_fid2;
+		count++;
+	}
+
+	if (copy_to_user(uarg->lbo_ops, ops, size))
+		rc = -EFAULT;
+
+	EXIT;
+out_items:
+	for (i = 0; i < count; i++)
+		ll_finish_md_op_data(items[i].mbi_op_data);
+	OBD_FREE_LARGE(items, lbo.lbo_count * sizeof(*items));
+out:
+	OBD_FREE_LARGE(ops, size);
+
+	return rc;
+}
+
 static long ll_dir_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	struct dentry *dentry = file_dentry(file);
@@ -1795,6 +1964,10 @@ out_rmdir:
 		RETURN(ll_fid2path(inode, (void __user *)arg));
 	case LL_IOC_GETPARENT:
 		RETURN(ll_getparent(file, (void __user *)arg));
+	case LL_IOC_STATAHEAD:
+		RETURN(ll_ioctl_statahead(file, (void __user *)arg));
+	case LL_IOC_BATCH_OPS:
+		RETURN(ll_ioctl_batch_ops(file, (void __user *)arg));
 	case LL_IOC_FID2MDTIDX: {
 		struct obd_export *exp = ll_i2mdexp(inode);
 		struct lu_fid	  fid;
@@ -1378,7 +1378,7 @@ static bool file_is_noatime(const struct file *file)
 	return false;
 }
 
-static void ll_io_init(struct cl_io *io, struct file *file, enum cl_io_type iot)
+void ll_io_init(struct cl_io *io, struct file *file, enum cl_io_type iot)
 {
 	struct inode *inode = file_inode(file);
 	struct ll_file_data *fd  = LUSTRE_FPRIVATE(file);
@@ -1409,8 +1409,7 @@ static void ll_io_init(struct cl_io *io, struct file *file, enum cl_io_type iot)
 	ll_io_set_mirror(io, file);
 }
 
-static void ll_heat_add(struct inode *inode, enum cl_io_type iot,
-			__u64 count)
+void ll_heat_add(struct inode *inode, enum cl_io_type iot, __u64 count)
 {
 	struct ll_inode_info *lli = ll_i2info(inode);
 	struct ll_sb_info *sbi = ll_i2sbi(inode);
@@ -1661,8 +1660,8 @@ static ssize_t ll_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 	 * data has been removed from the Lustre file system), at this
 	 * time, fallback to the normal read path may read the wrong
 	 * data.
-	 * TODO: for RO-PCC (readonly PCC), fall back to normal read
-	 * path: read data from data copy on OSTs.
+	 * For RO-PCC (readonly PCC), pcc_file_read_iter() falls back to
+	 * the normal read path itself, as the data on OSTs is valid.
 	 */
 	result = pcc_file_read_iter(iocb, to, &cached);
 	if (cached)
@@ -3848,6 +3847,27 @@ out_ladvise:
 		rc = ll_heat_set(inode, flags);
 		RETURN(rc);
 	}
+	case LL_IOC_PCC_ATTACH: {
+		struct lu_pcc_attach attach;
+
+		if (copy_from_user(&attach,
+				   (const struct lu_pcc_attach __user *)arg,
+				   sizeof(attach)))
+			RETURN(-EFAULT);
+
+		if (!S_ISREG(inode->i_mode))
+			RETURN(-EINVAL);
+
+		/* RW-PCC attach is done under a lease, see ll_file_set_lease */
+		if (attach.pcca_type != LU_PCC_READONLY)
+			RETURN(-EOPNOTSUPP);
+
+		if (!(file->f_mode & FMODE_READ))
+			RETURN(-EBADF);
+
+		rc = pcc_readonly_attach(file, inode, attach.pcca_id);
+		RETURN(rc);
+	}
 	case LL_IOC_PCC_DETACH: {
 		struct lu_pcc_detach *detach;
 
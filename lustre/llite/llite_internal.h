@@ -166,6 +166,13 @@ struct ll_inode_info {
 			unsigned int			lli_sa_enabled:1;
 			/* generation for statahead */
 			unsigned int			lli_sa_generation;
+			/* stats of names with a number sequence by
+			 * "lli_sa_pattern_pid" start statahead by filename
+			 * pattern when the dir is not opened for readdir. */
+			pid_t				lli_sa_pattern_pid;
+			unsigned int			lli_sa_match_count;
+			__u32				lli_sa_fname_hash;
+			__u64				lli_sa_fname_index;
 			/* rw lock protects lli_lsm_md */
 			struct rw_semaphore		lli_lsm_sem;
 			/* directory stripe information */
@@ -355,6 +362,9 @@ static inline struct pcc_inode *ll_i2pcci(struct inode *inode)
 /* default to read-ahead full files smaller than 2MB on the second read */
 #define SBI_DEFAULT_READAHEAD_WHOLE_MAX		MiB_TO_PAGES(2UL)
 
+/* read-ahead windows of at least 4MB are submitted by the async workqueue */
+#define SBI_DEFAULT_RA_ASYNC_THRESHOLD		MiB_TO_PAGES(4UL)
+
 enum ra_stat {
         RA_STAT_HIT = 0,
         RA_STAT_MISS,
@@ -369,6 +379,13 @@ enum ra_stat {
         RA_STAT_MAX_IN_FLIGHT,
         RA_STAT_WRONG_GRAB_PAGE,
 	RA_STAT_FAILED_REACH_END,
+	RA_STAT_STRIDE_HIT,
+	RA_STAT_STRIDE_MISS,
+	RA_STAT_BACKWARD_HIT,
+	RA_STAT_BACKWARD_MISS,
+	RA_STAT_BACKWARD,
+	RA_STAT_STREAM_SWITCH,
+	RA_STAT_ASYNC,
 	_NR_RA_STAT,
 };
 
@@ -377,6 +394,26 @@ struct ll_ra_info {
 	unsigned long	ra_max_pages;
 	unsigned long	ra_max_pages_per_file;
 	unsigned long	ra_max_read_ahead_whole_pages;
+	/* workqueue submitting read-ahead on behalf of readers */
+	struct workqueue_struct *ll_readahead_wq;
+	/* max # of read-ahead works queued or running at once */
+	unsigned int	ra_async_max_active;
+	/* # of read-ahead works queued or running */
+	atomic_t	ra_async_inflight;
+	/* min # of pages beyond the current read to go async */
+	unsigned long	ra_async_pages_threshold;
+};
+
+/* read-ahead handed over to ll_ra_info::ll_readahead_wq */
+struct ll_readahead_work {
+	struct work_struct	lrw_readahead_work;
+	/* file to read ahead, a reference is held */
+	struct file		*lrw_file;
+	/* first and last page index to read ahead */
+	pgoff_t			lrw_start;
+	pgoff_t			lrw_end;
+	/* lrw_end is the last page of the file */
+	bool			lrw_eof;
 };
 
 /* ra_io_arg will be filled in the beginning of ll_readahead with
@@ -466,6 +503,7 @@ enum stats_track_type {
 					 2.10, abandoned */
 #define LL_SBI_TINY_WRITE   0x2000000 /* tiny write support */
 #define LL_SBI_FILE_HEAT    0x4000000 /* file heat support */
+#define LL_SBI_SA_FNAME     0x8000000 /* statahead by filename pattern */
 #define LL_SBI_FLAGS { 	\
 	"nolck",	\
 	"checksum",	\
@@ -494,6 +532,7 @@ enum stats_track_type {
 	"pio",		\
 	"tiny_write",	\
 	"file_heat",	\
+	"statahead_fname",	\
 }
 
 /* This is embedded into llite super-blocks to keep track of connect
@@ -563,10 +602,15 @@ struct ll_sb_info {
 	unsigned int		  ll_sa_running_max;/* max concurrent
 						     * statahead instances */
 	unsigned int		  ll_sa_max;     /* max statahead RPCs */
+	unsigned int		  ll_sa_batch_max;/* max stats per batch RPC */
 	atomic_t		  ll_sa_total;   /* statahead thread started
 						  * count */
 	atomic_t		  ll_sa_wrong;   /* statahead thread stopped for
 						  * low hit ratio */
+	atomic_t		  ll_sa_fname_total; /* statahead by filename
+						      * pattern started count */
+	atomic_t		  ll_sa_list_total; /* statahead by name list
+						     * started count */
 	atomic_t		  ll_sa_running; /* running statahead thread
 						  * count */
 	atomic_t		  ll_agl_total;  /* AGL thread started count */
@@ -599,6 +643,24 @@ struct ll_sb_info {
 /*
  * per file-descriptor read-ahead data.
  */
+/*
+ * Saved state of a sequential read stream, so that a file read by several
+ * interleaved streams (e.g. several threads sharing one fd) does not lose
+ * its read-ahead window each time another stream is serviced.
+ * See ras_stream_switch().
+ */
+struct ll_ra_stream {
+	unsigned long	rst_last_readpage;
+	unsigned long	rst_consecutive_pages;
+	unsigned long	rst_consecutive_requests;
+	unsigned long	rst_window_start;
+	unsigned long	rst_window_len;
+	unsigned long	rst_next_readahead;
+};
+
+/* number of saved streams tracked per file, besides the current one */
+#define LL_RA_STREAMS	4
+
 struct ll_readahead_state {
 	spinlock_t  ras_lock;
         /*
@@ -679,6 +741,20 @@ struct ll_readahead_state {
          * stride read-ahead will be enable
          */
         unsigned long   ras_consecutive_stride_requests;
+	/*
+	 * Backward read detection. ras_request_start is the first page read
+	 * by the current request. If each request ends right where the
+	 * previous one started, ras_backward_requests is incremented and,
+	 * once it reaches 2, pages preceding the request are read ahead.
+	 */
+	unsigned long	ras_request_start;
+	unsigned long	ras_backward_requests;
+	/*
+	 * Streams interleaved with the current one, and the slot to be
+	 * replaced next when a new stream is started.
+	 */
+	struct ll_ra_stream ras_streams[LL_RA_STREAMS];
+	unsigned int	ras_stream_next;
 };
 
 extern struct kmem_cache *ll_file_data_slab;
@@ -869,6 +945,8 @@ struct ll_cl_context *ll_cl_find(struct file *file);
 extern const struct address_space_operations ll_aops;
 
 /* llite/file.c */
+void ll_io_init(struct cl_io *io, struct file *file, enum cl_io_type iot);
+void ll_heat_add(struct inode *inode, enum cl_io_type iot, __u64 count);
 extern struct file_operations ll_file_operations;
 extern struct file_operations ll_file_operations_flock;
 extern struct file_operations ll_file_operations_noflock;
@@ -1232,6 +1310,10 @@ void ll_ra_stats_inc(struct inode *inode, enum ra_stat which);
 #define LL_SA_RPC_DEF           32
 #define LL_SA_RPC_MAX           512
 
+/* stat requests packed in one MDS_BATCH_GETATTR RPC, 0 disables batching */
+#define LL_SA_BATCH_DEF		32
+#define LL_SA_BATCH_MAX		256
+
 /* XXX: If want to support more concurrent statahead instances,
  *	please consider to decentralize the RPC lists attached
  *	on related import, such as imp_{sending,delayed}_list.
@@ -1239,13 +1321,25 @@ void ll_ra_stats_inc(struct inode *inode, enum ra_stat which);
 #define LL_SA_RUNNING_MAX	256
 #define LL_SA_RUNNING_DEF	16
 
+/* sequential stats of names with a number to start statahead by filename */
+#define LL_SA_FNAME_MATCH	4
+/* statahead by filename stops after the scanner is idle for this long (s) */
+#define LL_SA_FNAME_IDLE	10
+
 #define LL_SA_CACHE_BIT         5
 #define LL_SA_CACHE_SIZE        (1 << LL_SA_CACHE_BIT)
 #define LL_SA_CACHE_MASK        (LL_SA_CACHE_SIZE - 1)
 
+enum ll_sa_mode {
+	SA_MODE_READDIR = 0,	/* "ls -l", entries in readdir order */
+	SA_MODE_FNAME,		/* names with increasing number */
+	SA_MODE_LIST,		/* names from LL_IOC_STATAHEAD */
+};
+
 /* per inode struct, for dir only */
 struct ll_statahead_info {
 	struct dentry	       *sai_dentry;
+	enum ll_sa_mode		sai_mode;
 	atomic_t		sai_refcount;   /* when access this struct, hold
 						 * refcount */
 	unsigned int            sai_max;        /* max ahead of lookup */
@@ -1284,11 +1378,30 @@ struct ll_statahead_info {
 	struct list_head	sai_cache[LL_SA_CACHE_SIZE];
 	spinlock_t		sai_cache_lock[LL_SA_CACHE_SIZE];
 	atomic_t		sai_cache_count; /* entry count in cache */
+	struct md_enqueue_info	**sai_batch;	/* stats not sent yet */
+	unsigned int		sai_batch_count;
+	unsigned int		sai_batch_max;
+	__u64			sai_batch_index;/* index of first batched
+						 * entry */
+	unsigned long		sai_access;	/* jiffies of the last access
+						 * by scanner */
+	/* SA_MODE_FNAME: name template, the number at [start, end) of
+	 * sai_fname is replaced by sai_fname_index, padded to
+	 * sai_fname_width digits */
+	char			sai_fname[NAME_MAX + 1];
+	unsigned int		sai_fname_start;
+	unsigned int		sai_fname_end;
+	unsigned int		sai_fname_width;
+	__u64			sai_fname_index;
+	/* SA_MODE_LIST: name lists not handled yet */
+	struct list_head	sai_name_lists;
 };
 
 int ll_statahead(struct inode *dir, struct dentry **dentry, bool unplug);
 void ll_authorize_statahead(struct inode *dir, void *key);
 void ll_deauthorize_statahead(struct inode *dir, void *key);
+int ll_ioctl_statahead(struct file *file,
+		       struct ll_statahead_names __user *uarg);
 
 /* glimpse.c */
 blkcnt_t dirty_cnt(struct inode *inode);
@@ -1339,16 +1452,20 @@ dentry_may_statahead(struct inode *dir, struct dentry *dentry)
 
 	lli = ll_i2info(dir);
 
-	/* statahead is not allowed for this dir, there may be three causes:
-	 * 1. dir is not opened.
-	 * 2. statahead hit ratio is too low.
-	 * 3. previous stat started statahead thread failed. */
-	if (!lli->lli_sa_enabled)
-		return false;
-
-	/* not the same process, don't statahead */
-	if (lli->lli_opendir_pid != current_pid())
+	if (lli->lli_sa_enabled) {
+		/* not the same process, don't statahead */
+		if (lli->lli_opendir_pid != current_pid())
+			return false;
+	} else if (lli->lli_opendir_key != NULL ||
+		   !(ll_i2sbi(dir)->ll_flags & LL_SBI_SA_FNAME)) {
+		/* statahead is not allowed for this dir, there may be three
+		 * causes:
+		 * 1. statahead hit ratio is too low.
+		 * 2. previous stat started statahead thread failed.
+		 * 3. dir is not opened, and statahead by filename pattern
+		 *    is disabled. */
 		return false;
+	}
 
 	/*
 	 * When stating a dentry, kernel may trigger 'revalidate' or 'lookup'
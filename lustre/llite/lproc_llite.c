@@ -466,6 +466,87 @@ ll_max_read_ahead_whole_mb_seq_write(struct file *file,
 
 LDEBUGFS_SEQ_FOPS(ll_max_read_ahead_whole_mb);
 
+static ssize_t max_read_ahead_async_active_show(struct kobject *kobj,
+						struct attribute *attr,
+						char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%u\n", sbi->ll_ra_info.ra_async_max_active);
+}
+
+static ssize_t max_read_ahead_async_active_store(struct kobject *kobj,
+						 struct attribute *attr,
+						 const char *buffer,
+						 size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	if (val < 1 || val > WQ_UNBOUND_MAX_ACTIVE) {
+		CERROR("%s: cannot set max_read_ahead_async_active=%u, valid range is [1, %d]\n",
+		       sbi->ll_fsname, val, WQ_UNBOUND_MAX_ACTIVE);
+		return -ERANGE;
+	}
+
+	spin_lock(&sbi->ll_lock);
+	sbi->ll_ra_info.ra_async_max_active = val;
+	spin_unlock(&sbi->ll_lock);
+	workqueue_set_max_active(sbi->ll_ra_info.ll_readahead_wq, val);
+
+	return count;
+}
+LUSTRE_RW_ATTR(max_read_ahead_async_active);
+
+static ssize_t read_ahead_async_threshold_mb_show(struct kobject *kobj,
+						  struct attribute *attr,
+						  char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%lu\n",
+		       PAGES_TO_MiB(sbi->ll_ra_info.ra_async_pages_threshold));
+}
+
+static ssize_t read_ahead_async_threshold_mb_store(struct kobject *kobj,
+						   struct attribute *attr,
+						   const char *buffer,
+						   size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned long pages_number;
+	unsigned long val;
+	int rc;
+
+	rc = kstrtoul(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	pages_number = MiB_TO_PAGES(val);
+	if (pages_number > sbi->ll_ra_info.ra_max_pages_per_file) {
+		CERROR("%s: cannot set read_ahead_async_threshold_mb=%lu > max_read_ahead_per_file_mb=%lu\n",
+		       sbi->ll_fsname, val,
+		       PAGES_TO_MiB(sbi->ll_ra_info.ra_max_pages_per_file));
+		return -ERANGE;
+	}
+
+	spin_lock(&sbi->ll_lock);
+	sbi->ll_ra_info.ra_async_pages_threshold = pages_number;
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(read_ahead_async_threshold_mb);
+
 static int ll_max_cached_mb_seq_show(struct seq_file *m, void *v)
 {
 	struct super_block     *sb    = m->private;
@@ -793,6 +874,41 @@ static ssize_t statahead_max_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(statahead_max);
 
+static ssize_t statahead_batch_max_show(struct kobject *kobj,
+					struct attribute *attr,
+					char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%u\n", sbi->ll_sa_batch_max);
+}
+
+static ssize_t statahead_batch_max_store(struct kobject *kobj,
+					 struct attribute *attr,
+					 const char *buffer,
+					 size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned long val;
+	int rc;
+
+	rc = kstrtoul(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val > LL_SA_BATCH_MAX) {
+		CERROR("Bad statahead_batch_max value %lu. Valid values are in the range [0, %d]\n",
+		       val, LL_SA_BATCH_MAX);
+		return -ERANGE;
+	}
+
+	sbi->ll_sa_batch_max = val;
+	return count;
+}
+LUSTRE_RW_ATTR(statahead_batch_max);
+
 static ssize_t statahead_agl_show(struct kobject *kobj,
 				  struct attribute *attr,
 				  char *buf)
@@ -826,6 +942,39 @@ static ssize_t statahead_agl_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(statahead_agl);
 
+static ssize_t statahead_fname_show(struct kobject *kobj,
+				    struct attribute *attr,
+				    char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%u\n", sbi->ll_flags & LL_SBI_SA_FNAME ? 1 : 0);
+}
+
+static ssize_t statahead_fname_store(struct kobject *kobj,
+				     struct attribute *attr,
+				     const char *buffer,
+				     size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	if (val)
+		sbi->ll_flags |= LL_SBI_SA_FNAME;
+	else
+		sbi->ll_flags &= ~LL_SBI_SA_FNAME;
+
+	return count;
+}
+LUSTRE_RW_ATTR(statahead_fname);
+
 static int ll_statahead_stats_seq_show(struct seq_file *m, void *v)
 {
 	struct super_block *sb = m->private;
@@ -833,9 +982,13 @@ static int ll_statahead_stats_seq_show(struct seq_file *m, void *v)
 
 	seq_printf(m, "statahead total: %u\n"
 		      "statahead wrong: %u\n"
+		      "statahead fname: %u\n"
+		      "statahead list: %u\n"
 		      "agl total: %u\n",
 		   atomic_read(&sbi->ll_sa_total),
 		   atomic_read(&sbi->ll_sa_wrong),
+		   atomic_read(&sbi->ll_sa_fname_total),
+		   atomic_read(&sbi->ll_sa_list_total),
 		   atomic_read(&sbi->ll_agl_total));
 	return 0;
 }
@@ -1348,6 +1501,28 @@ out_free_kernbuff:
 }
 LPROC_SEQ_FOPS(ll_pcc);
 
+static int ll_pcc_stats_seq_show(struct seq_file *m, void *v)
+{
+	struct super_block *sb = m->private;
+	struct ll_sb_info *sbi = ll_s2sbi(sb);
+
+	return pcc_super_stats_dump(&sbi->ll_pcc_super, m);
+}
+
+static ssize_t ll_pcc_stats_seq_write(struct file *file,
+				      const char __user *buffer,
+				      size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct super_block *sb = m->private;
+	struct ll_sb_info *sbi = ll_s2sbi(sb);
+
+	/* Any write clears the counters */
+	pcc_super_stats_clear(&sbi->ll_pcc_super);
+	return count;
+}
+LPROC_SEQ_FOPS(ll_pcc_stats);
+
 struct lprocfs_vars lprocfs_llite_obd_vars[] = {
 	{ .name	=	"site",
 	  .fops	=	&ll_site_stats_fops			},
@@ -1371,6 +1546,8 @@ struct lprocfs_vars lprocfs_llite_obd_vars[] = {
 	  .fops	=	&ll_nosquash_nids_fops			},
 	{ .name =	"pcc",
 	  .fops =	&ll_pcc_fops,				},
+	{ .name =	"pcc_stats",
+	  .fops =	&ll_pcc_stats_fops,			},
 	{ NULL }
 };
 
@@ -1394,7 +1571,11 @@ static struct attribute *llite_attrs[] = {
 	&lustre_attr_stats_track_gid.attr,
 	&lustre_attr_statahead_running_max.attr,
 	&lustre_attr_statahead_max.attr,
+	&lustre_attr_statahead_batch_max.attr,
 	&lustre_attr_statahead_agl.attr,
+	&lustre_attr_statahead_fname.attr,
+	&lustre_attr_max_read_ahead_async_active.attr,
+	&lustre_attr_read_ahead_async_threshold_mb.attr,
 	&lustre_attr_lazystatfs.attr,
 	&lustre_attr_max_easize.attr,
 	&lustre_attr_default_easize.attr,
@@ -1502,7 +1683,14 @@ static const char *ra_stat_string[] = {
 	[RA_STAT_EOF] = "read-ahead to EOF",
 	[RA_STAT_MAX_IN_FLIGHT] = "hit max r-a issue",
 	[RA_STAT_WRONG_GRAB_PAGE] = "wrong page from grab_cache_page",
-	[RA_STAT_FAILED_REACH_END] = "failed to reach end"
+	[RA_STAT_FAILED_REACH_END] = "failed to reach end",
+	[RA_STAT_STRIDE_HIT] = "stride hits",
+	[RA_STAT_STRIDE_MISS] = "stride misses",
+	[RA_STAT_BACKWARD_HIT] = "backward hits",
+	[RA_STAT_BACKWARD_MISS] = "backward misses",
+	[RA_STAT_BACKWARD] = "backward read-ahead",
+	[RA_STAT_STREAM_SWITCH] = "stream switch",
+	[RA_STAT_ASYNC] = "async readahead"
 };
 
 int ll_debugfs_register_super(struct super_block *sb, const char *name)
@@ -1028,6 +1028,7 @@ static int ll_atomic_open(struct inode *dir, struct dentry *dentry,
 			item.pm_projid = ll_i2info(dir)->lli_projid;
 			item.pm_name = &dentry->d_name;
 			dataset = pcc_dataset_match_get(&sbi->ll_pcc_super,
+							LU_PCC_READWRITE,
 							&item);
 			pca.pca_dataset = dataset;
 		}
@@ -107,11 +107,14 @@
 #include "pcc.h"
 #include <linux/namei.h>
 #include <linux/file.h>
+#include <linux/sort.h>
 #include <lustre_compat.h>
 #include "llite_internal.h"
 
 struct kmem_cache *pcc_inode_slab;
 
+static void pcc_evict_work(struct work_struct *work);
+
 int pcc_super_init(struct pcc_super *super)
 {
 	struct cred *cred;
@@ -125,6 +128,15 @@ int pcc_super_init(struct pcc_super *super)
 	init_rwsem(&super->pccs_rw_sem);
 	INIT_LIST_HEAD(&super->pccs_datasets);
 
+	super->pccs_attach_wq = alloc_workqueue("pcc-attach-wq", WQ_UNBOUND,
+						0);
+	if (!super->pccs_attach_wq) {
+		put_cred(super->pccs_cred);
+		return -ENOMEM;
+	}
+	INIT_DELAYED_WORK(&super->pccs_evict_work, pcc_evict_work);
+	pcc_super_stats_clear(super);
+
 	return 0;
 }
 
@@ -477,6 +489,25 @@ pcc_parse_value_pair(struct pcc_cmd *cmd, char *buffer)
 			return rc;
 		if (id > 0)
 			cmd->u.pccc_add.pccc_flags |= PCC_DATASET_ROPCC;
+	} else if (strcmp(key, "hwm") == 0) {
+		rc = kstrtoul(val, 10, &id);
+		if (rc)
+			return rc;
+		if (id > 100)
+			return -EINVAL;
+		cmd->u.pccc_add.pccc_hwm = id;
+	} else if (strcmp(key, "lwm") == 0) {
+		rc = kstrtoul(val, 10, &id);
+		if (rc)
+			return rc;
+		if (id > 100)
+			return -EINVAL;
+		cmd->u.pccc_add.pccc_lwm = id;
+	} else if (strcmp(key, "max_mb") == 0) {
+		rc = kstrtoul(val, 10, &id);
+		if (rc)
+			return rc;
+		cmd->u.pccc_add.pccc_max_mb = id;
 	} else {
 		return -EINVAL;
 	}
@@ -510,6 +541,13 @@ pcc_parse_value_pairs(struct pcc_cmd *cmd, char *buffer)
 		 */
 		if ((cmd->u.pccc_add.pccc_flags & PCC_DATASET_PCC_ALL) == 0)
 			cmd->u.pccc_add.pccc_flags |= PCC_DATASET_PCC_ALL;
+		/* Evict down to 10% below the high watermark by default */
+		if (cmd->u.pccc_add.pccc_lwm == 0 &&
+		    cmd->u.pccc_add.pccc_hwm > 10)
+			cmd->u.pccc_add.pccc_lwm =
+				cmd->u.pccc_add.pccc_hwm - 10;
+		if (cmd->u.pccc_add.pccc_lwm > cmd->u.pccc_add.pccc_hwm)
+			return -EINVAL;
 		break;
 	case PCC_DEL_DATASET:
 	case PCC_CLEAR_ALL:
@@ -657,15 +695,21 @@ pcc_cond_match(struct pcc_match_rule *rule, struct pcc_matcher *matcher)
 	return 0;
 }
 
+static inline enum pcc_dataset_flags pcc_type2flags(enum lu_pcc_type type)
+{
+	return type == LU_PCC_READONLY ? PCC_DATASET_ROPCC : PCC_DATASET_RWPCC;
+}
+
 struct pcc_dataset*
-pcc_dataset_match_get(struct pcc_super *super, struct pcc_matcher *matcher)
+pcc_dataset_match_get(struct pcc_super *super, enum lu_pcc_type type,
+		      struct pcc_matcher *matcher)
 {
 	struct pcc_dataset *dataset;
 	struct pcc_dataset *selected = NULL;
 
 	down_read(&super->pccs_rw_sem);
 	list_for_each_entry(dataset, &super->pccs_datasets, pccd_linkage) {
-		if (!(dataset->pccd_flags & PCC_DATASET_RWPCC))
+		if (!(dataset->pccd_flags & pcc_type2flags(type)))
 			continue;
 
 		if (pcc_cond_match(&dataset->pccd_rule, matcher)) {
@@ -713,6 +757,11 @@ pcc_dataset_add(struct pcc_super *super, struct pcc_cmd *cmd)
 	dataset->pccd_rwid = cmd->u.pccc_add.pccc_rwid;
 	dataset->pccd_roid = cmd->u.pccc_add.pccc_roid;
 	dataset->pccd_flags = cmd->u.pccc_add.pccc_flags;
+	dataset->pccd_hwm = cmd->u.pccc_add.pccc_hwm;
+	dataset->pccd_lwm = cmd->u.pccc_add.pccc_lwm;
+	dataset->pccd_max_bytes = cmd->u.pccc_add.pccc_max_mb << 20;
+	spin_lock_init(&dataset->pccd_lru_lock);
+	INIT_LIST_HEAD(&dataset->pccd_lru);
 	atomic_set(&dataset->pccd_refcount, 1);
 
 	rc = pcc_dataset_rule_init(&dataset->pccd_rule, cmd);
@@ -739,6 +788,9 @@ pcc_dataset_add(struct pcc_super *super, struct pcc_cmd *cmd)
 	if (found) {
 		pcc_dataset_put(dataset);
 		rc = -EEXIST;
+	} else if (dataset->pccd_hwm > 0) {
+		mod_delayed_work(super->pccs_attach_wq, &super->pccs_evict_work,
+				 0);
 	}
 
 	return rc;
@@ -762,6 +814,9 @@ pcc_dataset_get(struct pcc_super *super, enum lu_pcc_type type, __u32 id)
 		if (type == LU_PCC_READWRITE && (dataset->pccd_rwid != id ||
 		    !(dataset->pccd_flags & PCC_DATASET_RWPCC)))
 			continue;
+		if (type == LU_PCC_READONLY && (dataset->pccd_roid != id ||
+		    !(dataset->pccd_flags & PCC_DATASET_ROPCC)))
+			continue;
 		atomic_inc(&dataset->pccd_refcount);
 		selected = dataset;
 		break;
@@ -809,7 +864,11 @@ pcc_dataset_dump(struct pcc_dataset *dataset, struct seq_file *m)
 {
 	seq_printf(m, "%s:\n", dataset->pccd_pathname);
 	seq_printf(m, "  rwid: %u\n", dataset->pccd_rwid);
+	seq_printf(m, "  roid: %u\n", dataset->pccd_roid);
 	seq_printf(m, "  flags: %x\n", dataset->pccd_flags);
+	seq_printf(m, "  hwm: %u\n", dataset->pccd_hwm);
+	seq_printf(m, "  lwm: %u\n", dataset->pccd_lwm);
+	seq_printf(m, "  max_mb: %llu\n", dataset->pccd_max_bytes >> 20);
 	seq_printf(m, "  autocache: %s\n", dataset->pccd_rule.pmr_conds_str);
 }
 
@@ -841,6 +900,8 @@ static void pcc_remove_datasets(struct pcc_super *super)
 
 void pcc_super_fini(struct pcc_super *super)
 {
+	cancel_delayed_work_sync(&super->pccs_evict_work);
+	destroy_workqueue(super->pccs_attach_wq);
 	pcc_remove_datasets(super);
 	put_cred(super->pccs_cred);
 }
@@ -980,12 +1041,79 @@ static void pcc_inode_init(struct pcc_inode *pcci, struct ll_inode_info *lli)
 	pcci->pcci_layout_gen = CL_LAYOUT_GEN_NONE;
 	atomic_set(&pcci->pcci_active_ios, 0);
 	init_waitqueue_head(&pcci->pcci_waitq);
+	pcci->pcci_dataset = NULL;
+	INIT_LIST_HEAD(&pcci->pcci_lru);
+	pcci->pcci_accessed = false;
+	pcci->pcci_size = 0;
+}
+
+static inline void pcc_stats_add(struct inode *inode, enum pcc_stat_type type,
+				 __s64 count)
+{
+	atomic64_add(count, &ll_i2sbi(inode)->ll_pcc_super.pccs_stats[type]);
+}
+
+/* Move @pcci onto the LRU list of the dataset holding its cache copy */
+static void pcc_inode_dataset_set(struct pcc_inode *pcci,
+				  struct pcc_dataset *dataset)
+{
+	struct pcc_dataset *old = pcci->pcci_dataset;
+
+	pcci->pcci_accessed = true;
+	if (old == dataset)
+		return;
+
+	if (old) {
+		spin_lock(&old->pccd_lru_lock);
+		list_del_init(&pcci->pcci_lru);
+		old->pccd_lru_count--;
+		old->pccd_used -= pcci->pcci_size;
+		spin_unlock(&old->pccd_lru_lock);
+		pcc_dataset_put(old);
+	}
+
+	pcci->pcci_dataset = dataset;
+	if (dataset) {
+		atomic_inc(&dataset->pccd_refcount);
+		spin_lock(&dataset->pccd_lru_lock);
+		list_add_tail(&pcci->pcci_lru, &dataset->pccd_lru);
+		dataset->pccd_lru_count++;
+		dataset->pccd_used += pcci->pcci_size;
+		spin_unlock(&dataset->pccd_lru_lock);
+	}
+}
+
+/* Account @size bytes of the cache copy of @pcci to its dataset */
+static void pcc_inode_size_set(struct pcc_inode *pcci, __u64 size)
+{
+	struct pcc_dataset *dataset = pcci->pcci_dataset;
+
+	if (!dataset) {
+		pcci->pcci_size = size;
+		return;
+	}
+
+	spin_lock(&dataset->pccd_lru_lock);
+	dataset->pccd_used += size - pcci->pcci_size;
+	pcci->pcci_size = size;
+	spin_unlock(&dataset->pccd_lru_lock);
+}
+
+/* Check the usage of datasets with watermarks in the background soon */
+static void pcc_evict_kick(struct inode *inode, struct pcc_dataset *dataset)
+{
+	struct pcc_super *super = &ll_i2sbi(inode)->ll_pcc_super;
+
+	if (dataset && dataset->pccd_hwm > 0)
+		mod_delayed_work(super->pccs_attach_wq,
+				 &super->pccs_evict_work, 0);
 }
 
 static void pcc_inode_fini(struct pcc_inode *pcci)
 {
 	struct ll_inode_info *lli = pcci->pcci_lli;
 
+	pcc_inode_dataset_set(pcci, NULL);
 	path_put(&pcci->pcci_path);
 	pcci->pcci_type = LU_PCC_NONE;
 	OBD_SLAB_FREE_PTR(pcci, pcc_inode_slab);
@@ -1059,7 +1187,9 @@ static int pcc_layout_xattr_set(struct pcc_inode *pcci, __u32 gen)
 
 	ENTRY;
 
-	if (!(lli->lli_pcc_state & PCC_STATE_FL_OPEN_ATTACH))
+	/* RO-PCC copies are always reused at open while still valid */
+	if (!(lli->lli_pcc_state & PCC_STATE_FL_OPEN_ATTACH) &&
+	    pcci->pcci_type != LU_PCC_READONLY)
 		RETURN(0);
 
 #ifndef HAVE_VFS_SETXATTR
@@ -1127,6 +1257,10 @@ static void pcc_inode_attach_init(struct pcc_dataset *dataset,
 	atomic_set(&pcci->pcci_refcount, 1);
 	pcci->pcci_type = type;
 	pcci->pcci_attr_valid = false;
+	pcc_inode_dataset_set(pcci, dataset);
+	pcc_inode_size_set(pcci, i_size_read(dentry->d_inode));
+	pcc_stats_add(ll_info2i(pcci->pcci_lli), PCC_STAT_ATTACH, 1);
+	pcc_evict_kick(ll_info2i(pcci->pcci_lli), dataset);
 
 	if (pcc_open_attach_enabled(dataset)) {
 		struct ll_inode_info *lli = pcci->pcci_lli;
@@ -1162,8 +1296,7 @@ static int pcc_try_dataset_attach(struct inode *inode, __u32 gen,
 
 	ENTRY;
 
-	if (type == LU_PCC_READWRITE &&
-	    !(dataset->pccd_flags & PCC_DATASET_RWPCC))
+	if (!(dataset->pccd_flags & pcc_type2flags(type)))
 		RETURN(0);
 
 	OBD_ALLOC(pathname, PATH_MAX);
@@ -1220,6 +1353,8 @@ static int pcc_try_dataset_attach(struct inode *inode, __u32 gen,
 			 */
 			pcc_inode_get(pcci);
 			pcci->pcci_type = type;
+			pcc_inode_dataset_set(pcci, dataset);
+			pcc_stats_add(inode, PCC_STAT_ATTACH, 1);
 		}
 		pcc_layout_gen_set(pcci, gen);
 		*cached = true;
@@ -1244,7 +1379,8 @@ static int pcc_try_datasets_attach(struct inode *inode, __u32 gen,
 	down_read(&super->pccs_rw_sem);
 	list_for_each_entry_safe(dataset, tmp,
 				 &super->pccs_datasets, pccd_linkage) {
-		if (!pcc_open_attach_enabled(dataset))
+		if (type == LU_PCC_READWRITE &&
+		    !pcc_open_attach_enabled(dataset))
 			continue;
 		rc = pcc_try_dataset_attach(inode, gen, type, dataset, cached);
 		if (rc < 0 || (!rc && *cached))
@@ -1255,7 +1391,12 @@ static int pcc_try_datasets_attach(struct inode *inode, __u32 gen,
 	RETURN(rc);
 }
 
-static int pcc_try_open_attach(struct inode *inode, bool *cached)
+static void pcc_readonly_open_attach(struct inode *inode, struct file *file);
+static void pcc_readonly_detach(struct inode *inode, struct pcc_inode *pcci,
+				bool uncache);
+
+static int pcc_try_open_attach(struct inode *inode, struct file *file,
+			       bool *cached)
 {
 	struct pcc_super *super = &ll_i2sbi(inode)->ll_pcc_super;
 	struct cl_layout clt = {
@@ -1284,9 +1425,17 @@ static int pcc_try_open_attach(struct inode *inode, bool *cached)
 	if (rc)
 		RETURN(rc);
 
-	if (clt.cl_is_released)
+	if (clt.cl_is_released) {
 		rc = pcc_try_datasets_attach(inode, clt.cl_layout_gen,
 					     LU_PCC_READWRITE, cached);
+	} else if ((file->f_flags & O_ACCMODE) == O_RDONLY &&
+		   ll_i2info(inode)->lli_open_fd_write_count == 0) {
+		/* Reuse a still valid RO-PCC copy, or fetch a new one */
+		rc = pcc_try_datasets_attach(inode, clt.cl_layout_gen,
+					     LU_PCC_READONLY, cached);
+		if (!rc && !*cached)
+			pcc_readonly_open_attach(inode, file);
+	}
 
 	RETURN(rc);
 }
@@ -1315,12 +1464,26 @@ int pcc_file_open(struct inode *inode, struct file *file)
 		GOTO(out_unlock, rc = 0);
 
 	if (!pcci || !pcc_inode_has_layout(pcci)) {
-		rc = pcc_try_open_attach(inode, &cached);
+		rc = pcc_try_open_attach(inode, file, &cached);
+		if (!list_empty(&ll_i2sbi(inode)->ll_pcc_super.pccs_datasets))
+			pcc_stats_add(inode, cached ? PCC_STAT_HIT :
+					     PCC_STAT_MISS, 1);
 		if (rc < 0 || !cached)
 			GOTO(out_unlock, rc);
 
 		if (!pcci)
 			pcci = ll_i2pcci(inode);
+	} else {
+		pcc_stats_add(inode, PCC_STAT_HIT, 1);
+	}
+
+	/*
+	 * The RO-PCC copy can not be used once the file is written, remove
+	 * it so that it is not reused at open, and use Lustre I/O instead.
+	 */
+	if (pcci->pcci_type == LU_PCC_READONLY && file->f_mode & FMODE_WRITE) {
+		pcc_readonly_detach(inode, pcci, true);
+		GOTO(out_unlock, rc = 0);
 	}
 
 	pcc_inode_get(pcci);
@@ -1392,6 +1555,7 @@ static void pcc_io_init(struct inode *inode, bool *cached)
 	if (pcci && pcc_inode_has_layout(pcci)) {
 		LASSERT(atomic_read(&pcci->pcci_refcount) > 0);
 		atomic_inc(&pcci->pcci_active_ios);
+		pcci->pcci_accessed = true;
 		*cached = true;
 	} else {
 		*cached = false;
@@ -1471,8 +1635,20 @@ ssize_t pcc_file_read_iter(struct kiocb *iocb,
 	 */
 	result = __pcc_file_read_iter(iocb, iter);
 	iocb->ki_filp = file;
+	if (result > 0) {
+		pcc_stats_add(inode, PCC_STAT_READ_BYTES, result);
+		ll_heat_add(inode, CIT_READ, result);
+	}
 
 	pcc_io_fini(inode);
+
+	/* The Lustre copy of a RO-PCC file is valid, read it from OSTs */
+	if (result < 0 && pccf->pccf_type == LU_PCC_READONLY) {
+		CDEBUG(D_CACHE, DFID" RO-PCC read failed, fall back: rc = %zd\n",
+		       PFID(ll_inode2fid(inode)), result);
+		*cached = false;
+		result = 0;
+	}
 	RETURN(result);
 }
 
@@ -1547,6 +1723,16 @@ ssize_t pcc_file_write_iter(struct kiocb *iocb,
 	 */
 	result = __pcc_file_write_iter(iocb, iter);
 	iocb->ki_filp = file;
+	if (result > 0) {
+		struct pcc_inode *pcci = ll_i2pcci(inode);
+
+		pcc_stats_add(inode, PCC_STAT_WRITE_BYTES, result);
+		ll_heat_add(inode, CIT_WRITE, result);
+		if (iocb->ki_pos > pcci->pcci_size)
+			pcc_inode_size_set(pcci, iocb->ki_pos);
+	} else if (result == -ENOSPC || result == -EDQUOT) {
+		pcc_evict_kick(inode, ll_i2pcci(inode)->pcci_dataset);
+	}
 out:
 	pcc_io_fini(inode);
 	RETURN(result);
@@ -1572,15 +1758,33 @@ int pcc_inode_setattr(struct inode *inode, struct iattr *attr,
 	if (!*cached)
 		RETURN(0);
 
+	pcci = ll_i2pcci(inode);
+	if (pcci->pcci_type == LU_PCC_READONLY) {
+		/* Lustre attributes are authoritative, drop the stale copy
+		 * if the file data may change */
+		pcc_io_fini(inode);
+		*cached = false;
+		if (attr->ia_valid & ATTR_SIZE) {
+			pcc_inode_lock(inode);
+			pcci = ll_i2pcci(inode);
+			if (pcci && pcc_inode_has_layout(pcci) &&
+			    pcci->pcci_type == LU_PCC_READONLY)
+				pcc_readonly_detach(inode, pcci, true);
+			pcc_inode_unlock(inode);
+		}
+		RETURN(0);
+	}
+
 	attr2.ia_valid = attr->ia_valid & (ATTR_SIZE | ATTR_ATIME |
 			 ATTR_ATIME_SET | ATTR_MTIME | ATTR_MTIME_SET |
 			 ATTR_CTIME | ATTR_UID | ATTR_GID);
-	pcci = ll_i2pcci(inode);
 	pcc_dentry = pcci->pcci_path.dentry;
 	inode_lock(pcc_dentry->d_inode);
 	old_cred = override_creds(pcc_super_cred(inode->i_sb));
 	rc = pcc_dentry->d_inode->i_op->setattr(pcc_dentry, &attr2);
 	revert_creds(old_cred);
+	if (!rc && attr2.ia_valid & ATTR_SIZE)
+		pcc_inode_size_set(pcci, attr2.ia_size);
 	inode_unlock(pcc_dentry->d_inode);
 
 	pcc_io_fini(inode);
@@ -1608,6 +1812,12 @@ int pcc_inode_getattr(struct inode *inode, bool *cached)
 	if (!*cached)
 		RETURN(0);
 
+	/* RO-PCC copy has the same attributes as the Lustre file */
+	if (ll_i2pcci(inode)->pcci_type == LU_PCC_READONLY) {
+		*cached = false;
+		GOTO(out, rc = 0);
+	}
+
 	old_cred = override_creds(pcc_super_cred(inode->i_sb));
 	rc = ll_vfs_getattr(&ll_i2pcci(inode)->pcci_path, &stat);
 	revert_creds(old_cred);
@@ -1675,6 +1885,8 @@ ssize_t pcc_file_splice_read(struct file *in_file, loff_t *ppos,
 	result = file_inode(pcc_file)->i_fop->splice_read(pcc_file,
 							  ppos, pipe, count,
 							  flags);
+	if (result > 0)
+		pcc_stats_add(inode, PCC_STAT_READ_BYTES, result);
 
 	pcc_io_fini(inode);
 	RETURN(result);
@@ -1923,6 +2135,7 @@ static void pcc_layout_wait(struct pcc_inode *pcci)
 
 static void __pcc_layout_invalidate(struct pcc_inode *pcci)
 {
+	pcc_stats_add(ll_info2i(pcci->pcci_lli), PCC_STAT_DETACH, 1);
 	pcci->pcci_type = LU_PCC_NONE;
 	pcc_layout_gen_set(pcci, CL_LAYOUT_GEN_NONE);
 	pcc_layout_wait(pcci);
@@ -2370,6 +2583,272 @@ out_unlock:
 	RETURN(rc);
 }
 
+/*
+ * Copy the data of @file into @dataset and attach it as a RO-PCC copy.
+ * The caller must have set PCC_STATE_FL_ATTACHING on the inode.
+ */
+static int __pcc_readonly_attach(struct file *file, struct inode *inode,
+				 struct pcc_dataset *dataset)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+	const struct cred *old_cred;
+	struct pcc_inode *pcci;
+	struct dentry *dentry;
+	struct file *pcc_filp;
+	struct path path;
+	__u64 dv, dv2;
+	__u32 gen, gen2;
+	int rc;
+
+	ENTRY;
+
+	if (lli->lli_open_fd_write_count > 0)
+		RETURN(-ETXTBSY);
+
+	rc = ll_layout_refresh(inode, &gen);
+	if (rc)
+		RETURN(rc);
+
+	/* Flush dirty pages cached on other clients before the copy */
+	rc = ll_data_version(inode, &dv, LL_DV_RD_FLUSH);
+	if (rc)
+		RETURN(rc);
+
+	old_cred = override_creds(pcc_super_cred(inode->i_sb));
+	rc = __pcc_inode_create(dataset, &lli->lli_fid, &dentry);
+	if (rc) {
+		revert_creds(old_cred);
+		RETURN(rc);
+	}
+
+	path.mnt = dataset->pccd_path.mnt;
+	path.dentry = dentry;
+#ifdef HAVE_DENTRY_OPEN_USE_PATH
+	pcc_filp = dentry_open(&path, O_TRUNC | O_WRONLY | O_LARGEFILE,
+			       current_cred());
+#else
+	pcc_filp = dentry_open(path.dentry, path.mnt,
+			       O_TRUNC | O_WRONLY | O_LARGEFILE,
+			       current_cred());
+#endif
+	revert_creds(old_cred);
+	if (IS_ERR_OR_NULL(pcc_filp))
+		GOTO(out_dentry, rc = pcc_filp == NULL ? -EINVAL :
+						       PTR_ERR(pcc_filp));
+
+	rc = pcc_copy_data(file, pcc_filp);
+	fput(pcc_filp);
+	if (rc)
+		GOTO(out_dentry, rc);
+
+	/* The file was modified during the copy */
+	rc = ll_data_version(inode, &dv2, 0);
+	if (rc)
+		GOTO(out_dentry, rc);
+	if (dv2 != dv) {
+		CDEBUG(D_CACHE, DFID" data version changed from %llu to %llu\n",
+		       PFID(&lli->lli_fid), dv, dv2);
+		GOTO(out_dentry, rc = -ESTALE);
+	}
+
+	pcc_inode_lock(inode);
+	rc = ll_layout_refresh(inode, &gen2);
+	if (rc)
+		GOTO(out_unlock, rc);
+	if (gen2 != gen) {
+		CDEBUG(D_CACHE, DFID" layout changed from %d to %d.\n",
+		       PFID(&lli->lli_fid), gen, gen2);
+		GOTO(out_unlock, rc = -ESTALE);
+	}
+
+	pcci = ll_i2pcci(inode);
+	if (pcci && pcc_inode_has_layout(pcci))
+		GOTO(out_unlock, rc = -EEXIST);
+
+	if (!pcci) {
+		OBD_SLAB_ALLOC_PTR_GFP(pcci, pcc_inode_slab, GFP_NOFS);
+		if (pcci == NULL)
+			GOTO(out_unlock, rc = -ENOMEM);
+
+		pcc_inode_init(pcci, lli);
+		pcc_inode_attach_init(dataset, pcci, dentry, LU_PCC_READONLY);
+	} else {
+		/* Files opened on the invalidated copy still hold @pcci */
+		path_put(&pcci->pcci_path);
+		pcci->pcci_path.mnt = mntget(dataset->pccd_path.mnt);
+		pcci->pcci_path.dentry = dentry;
+		pcc_inode_get(pcci);
+		pcci->pcci_type = LU_PCC_READONLY;
+		pcci->pcci_attr_valid = false;
+		pcc_inode_dataset_set(pcci, dataset);
+		pcc_inode_size_set(pcci, i_size_read(dentry->d_inode));
+		pcc_stats_add(inode, PCC_STAT_ATTACH, 1);
+		pcc_evict_kick(inode, dataset);
+	}
+
+	old_cred = override_creds(pcc_super_cred(inode->i_sb));
+	/* Not fatal, the copy is just not reused after the inode is freed */
+	if (pcc_layout_xattr_set(pcci, gen))
+		CDEBUG(D_CACHE, DFID" failed to save layout gen %u\n",
+		       PFID(&lli->lli_fid), gen);
+	revert_creds(old_cred);
+	pcc_layout_gen_set(pcci, gen);
+	CDEBUG(D_CACHE, DFID" attached into RO-PCC %s, layout gen %u\n",
+	       PFID(&lli->lli_fid), dataset->pccd_pathname, gen);
+out_unlock:
+	pcc_inode_unlock(inode);
+out_dentry:
+	if (rc) {
+		old_cred = override_creds(pcc_super_cred(inode->i_sb));
+		(void) pcc_inode_remove(inode, dentry);
+		revert_creds(old_cred);
+		dput(dentry);
+	}
+	RETURN(rc);
+}
+
+int pcc_readonly_attach(struct file *file, struct inode *inode, __u32 roid)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct pcc_dataset *dataset;
+	int rc;
+
+	ENTRY;
+
+	dataset = pcc_dataset_get(&ll_i2sbi(inode)->ll_pcc_super,
+				  LU_PCC_READONLY, roid);
+	if (dataset == NULL)
+		RETURN(-ENOENT);
+
+	rc = pcc_attach_allowed_check(inode);
+	if (rc)
+		GOTO(out_dataset_put, rc);
+
+	rc = __pcc_readonly_attach(file, inode, dataset);
+
+	pcc_inode_lock(inode);
+	lli->lli_pcc_state &= ~PCC_STATE_FL_ATTACHING;
+	pcc_inode_unlock(inode);
+out_dataset_put:
+	pcc_dataset_put(dataset);
+	RETURN(rc);
+}
+
+struct pcc_attach_work {
+	struct work_struct	 paw_work;
+	/* Lustre file to fetch into RO-PCC */
+	struct path		 paw_path;
+	/* creds of the process which opened the file */
+	const struct cred	*paw_cred;
+	struct pcc_dataset	*paw_dataset;
+};
+
+static void pcc_readonly_attach_work(struct work_struct *wq)
+{
+	struct pcc_attach_work *work;
+	struct inode *inode;
+	const struct cred *old_cred;
+	struct file *file;
+	int rc;
+
+	ENTRY;
+
+	work = container_of(wq, struct pcc_attach_work, paw_work);
+	inode = work->paw_path.dentry->d_inode;
+
+	old_cred = override_creds(work->paw_cred);
+#ifdef HAVE_DENTRY_OPEN_USE_PATH
+	file = dentry_open(&work->paw_path, O_RDONLY | O_LARGEFILE,
+			   work->paw_cred);
+#else
+	file = dentry_open(work->paw_path.dentry, work->paw_path.mnt,
+			   O_RDONLY | O_LARGEFILE, work->paw_cred);
+#endif
+	if (IS_ERR_OR_NULL(file)) {
+		rc = file == NULL ? -EINVAL : PTR_ERR(file);
+	} else {
+		rc = __pcc_readonly_attach(file, inode, work->paw_dataset);
+		fput(file);
+	}
+	revert_creds(old_cred);
+
+	pcc_inode_lock(inode);
+	ll_i2info(inode)->lli_pcc_state &= ~PCC_STATE_FL_ATTACHING;
+	pcc_inode_unlock(inode);
+
+	CDEBUG(D_CACHE, DFID" RO-PCC open attach: rc = %d\n",
+	       PFID(ll_inode2fid(inode)), rc);
+	pcc_dataset_put(work->paw_dataset);
+	put_cred(work->paw_cred);
+	path_put(&work->paw_path);
+	OBD_FREE_PTR(work);
+	EXIT;
+}
+
+/*
+ * Fetch a file matching the rule of a RO-PCC dataset into the cache in the
+ * background at its first read-only open, later opens then read from the
+ * cached copy. Must be called with pcc_inode_lock held.
+ */
+static void pcc_readonly_open_attach(struct inode *inode, struct file *file)
+{
+	struct pcc_super *super = &ll_i2sbi(inode)->ll_pcc_super;
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct pcc_attach_work *work;
+	struct pcc_dataset *dataset;
+	struct pcc_matcher item;
+
+	ENTRY;
+
+	/* another open already queued the fetch, or an attach is running */
+	if (lli->lli_pcc_state & PCC_STATE_FL_ATTACHING)
+		RETURN_EXIT;
+
+	item.pm_uid = from_kuid(&init_user_ns, current_uid());
+	item.pm_gid = from_kgid(&init_user_ns, current_gid());
+	item.pm_projid = lli->lli_projid;
+	item.pm_name = &file_dentry(file)->d_name;
+	dataset = pcc_dataset_match_get(super, LU_PCC_READONLY, &item);
+	if (dataset == NULL)
+		RETURN_EXIT;
+
+	OBD_ALLOC_PTR(work);
+	if (work == NULL) {
+		pcc_dataset_put(dataset);
+		RETURN_EXIT;
+	}
+
+	/* cleared by pcc_readonly_attach_work() once the fetch is done */
+	lli->lli_pcc_state |= PCC_STATE_FL_ATTACHING;
+	work->paw_path = file->f_path;
+	path_get(&work->paw_path);
+	work->paw_cred = get_current_cred();
+	work->paw_dataset = dataset;
+	INIT_WORK(&work->paw_work, pcc_readonly_attach_work);
+	queue_work(super->pccs_attach_wq, &work->paw_work);
+	EXIT;
+}
+
+/* Must be called with pcc_inode_lock held */
+static void pcc_readonly_detach(struct inode *inode, struct pcc_inode *pcci,
+				bool uncache)
+{
+	LASSERT(pcci->pcci_type == LU_PCC_READONLY);
+
+	if (uncache) {
+		const struct cred *old_cred;
+
+		old_cred = override_creds(pcc_super_cred(inode->i_sb));
+		(void) pcc_inode_remove(inode, pcci->pcci_path.dentry);
+		revert_creds(old_cred);
+	}
+
+	__pcc_layout_invalidate(pcci);
+	CDEBUG(D_CACHE, DFID" detached from RO-PCC\n",
+	       PFID(ll_inode2fid(inode)));
+	pcc_inode_put(pcci);
+}
+
 static int pcc_hsm_remove(struct inode *inode)
 {
 	struct hsm_user_request *hur;
@@ -2435,6 +2914,9 @@ int pcc_ioctl_detach(struct inode *inode, __u32 opt)
 
 		__pcc_layout_invalidate(pcci);
 		pcc_inode_put(pcci);
+	} else if (pcci->pcci_type == LU_PCC_READONLY) {
+		pcc_readonly_detach(inode, pcci,
+				    opt == PCC_DETACH_OPT_UNCACHE);
 	}
 
 out_unlock:
@@ -2508,3 +2990,276 @@ out_unlock:
 	OBD_FREE(buf, buf_len);
 	RETURN(rc);
 }
+
+struct pcc_evict_candidate {
+	struct inode	*pec_inode;
+	__u64		 pec_heat;
+	__u64		 pec_size;
+};
+
+static int pcc_evict_candidate_cmp(const void *a, const void *b)
+{
+	const struct pcc_evict_candidate *pa = a;
+	const struct pcc_evict_candidate *pb = b;
+
+	if (pa->pec_heat < pb->pec_heat)
+		return -1;
+	return pa->pec_heat > pb->pec_heat;
+}
+
+/* I/O heat of the file, 0 if file heat is disabled */
+static __u64 pcc_inode_heat(struct inode *inode)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	__u64 now = ktime_get_real_seconds();
+	__u64 heat;
+
+	if (!ll_sbi_has_file_heat(sbi))
+		return 0;
+
+	spin_lock(&lli->lli_heat_lock);
+	heat = obd_heat_get(&lli->lli_heat_instances[OBD_HEAT_READBYTE], now,
+			    sbi->ll_heat_decay_weight,
+			    sbi->ll_heat_period_second) +
+	       obd_heat_get(&lli->lli_heat_instances[OBD_HEAT_WRITEBYTE], now,
+			    sbi->ll_heat_decay_weight,
+			    sbi->ll_heat_period_second);
+	spin_unlock(&lli->lli_heat_lock);
+
+	return heat;
+}
+
+/*
+ * Pick up to @max cold files of @dataset for eviction. Files accessed since
+ * the last scan get a second chance and are moved to the tail of the LRU.
+ * Returns the number of candidates, each holds an inode reference.
+ */
+static int pcc_dataset_evict_scan(struct pcc_dataset *dataset,
+				  struct pcc_evict_candidate *cands, int max)
+{
+	struct pcc_inode *pcci;
+	struct inode *inode;
+	unsigned int budget;
+	int nr = 0;
+
+	spin_lock(&dataset->pccd_lru_lock);
+	budget = dataset->pccd_lru_count * 2;
+	while (nr < max && budget-- > 0 && !list_empty(&dataset->pccd_lru)) {
+		pcci = list_first_entry(&dataset->pccd_lru, struct pcc_inode,
+					pcci_lru);
+		list_move_tail(&pcci->pcci_lru, &dataset->pccd_lru);
+
+		if (!pcc_inode_has_layout(pcci))
+			continue;
+
+		if (pcci->pcci_accessed) {
+			pcci->pcci_accessed = false;
+			continue;
+		}
+
+		inode = igrab(ll_info2i(pcci->pcci_lli));
+		if (inode == NULL)
+			continue;
+
+		cands[nr].pec_inode = inode;
+		cands[nr].pec_size = pcci->pcci_size;
+		nr++;
+	}
+	spin_unlock(&dataset->pccd_lru_lock);
+
+	return nr;
+}
+
+static int pcc_inode_evict(struct inode *inode)
+{
+	struct pcc_inode *pcci;
+	int rc;
+
+	ENTRY;
+
+	pcc_inode_lock(inode);
+	pcci = ll_i2pcci(inode);
+	if (!pcci || !pcc_inode_has_layout(pcci) ||
+	    ll_i2info(inode)->lli_pcc_state & PCC_STATE_FL_ATTACHING) {
+		pcc_inode_unlock(inode);
+		RETURN(-EAGAIN);
+	}
+	pcc_inode_unlock(inode);
+
+	/* Restore the data into Lustre if needed and remove the PCC copy */
+	rc = pcc_ioctl_detach(inode, PCC_DETACH_OPT_UNCACHE);
+	if (!rc)
+		pcc_stats_add(inode, PCC_STAT_EVICT, 1);
+	CDEBUG(D_CACHE, DFID" evicted from PCC: rc = %d\n",
+	       PFID(ll_inode2fid(inode)), rc);
+	RETURN(rc);
+}
+
+/* Get the cache usage and capacity of @dataset in bytes */
+static int pcc_dataset_usage(struct pcc_dataset *dataset, __u64 *used,
+			     __u64 *capacity)
+{
+	struct kstatfs statfs;
+	int rc;
+
+	if (dataset->pccd_max_bytes > 0) {
+		spin_lock(&dataset->pccd_lru_lock);
+		*used = dataset->pccd_used;
+		spin_unlock(&dataset->pccd_lru_lock);
+		*capacity = dataset->pccd_max_bytes;
+		return 0;
+	}
+
+	rc = vfs_statfs(&dataset->pccd_path, &statfs);
+	if (rc)
+		return rc;
+
+	*capacity = statfs.f_blocks * statfs.f_bsize;
+	*used = (statfs.f_blocks - statfs.f_bfree) * statfs.f_bsize;
+	return 0;
+}
+
+static void pcc_dataset_evict(struct pcc_dataset *dataset)
+{
+	struct pcc_evict_candidate *cands;
+	__u64 used, capacity, target;
+	int evicted;
+	int nr, i;
+
+	ENTRY;
+
+	if (pcc_dataset_usage(dataset, &used, &capacity))
+		RETURN_EXIT;
+
+	if (used * 100 <= capacity * dataset->pccd_hwm)
+		RETURN_EXIT;
+
+	target = div_u64(capacity * dataset->pccd_lwm, 100);
+	CDEBUG(D_CACHE, "%s: used %llu > %u%% of %llu, evict to %llu\n",
+	       dataset->pccd_pathname, used, dataset->pccd_hwm, capacity,
+	       target);
+
+	OBD_ALLOC(cands, sizeof(*cands) * PCC_EVICT_BATCH);
+	if (cands == NULL)
+		RETURN_EXIT;
+
+	while (used > target) {
+		nr = pcc_dataset_evict_scan(dataset, cands, PCC_EVICT_BATCH);
+		if (nr == 0)
+			break;
+
+		/* Detach the coldest files of the batch first */
+		for (i = 0; i < nr; i++)
+			cands[i].pec_heat = pcc_inode_heat(cands[i].pec_inode);
+		sort(cands, nr, sizeof(*cands), pcc_evict_candidate_cmp, NULL);
+
+		evicted = 0;
+		for (i = 0; i < nr; i++) {
+			if (used > target &&
+			    pcc_inode_evict(cands[i].pec_inode) == 0) {
+				used -= min(used, cands[i].pec_size);
+				evicted++;
+			}
+			iput(cands[i].pec_inode);
+		}
+		/* Retry in the next run if none of the batch could go */
+		if (evicted == 0)
+			break;
+	}
+
+	OBD_FREE(cands, sizeof(*cands) * PCC_EVICT_BATCH);
+	EXIT;
+}
+
+static void pcc_evict_work(struct work_struct *work)
+{
+	struct pcc_super *super = container_of(to_delayed_work(work),
+					       struct pcc_super,
+					       pccs_evict_work);
+	struct pcc_dataset **datasets;
+	struct pcc_dataset *dataset;
+	int count = 0;
+	int i = 0;
+
+	ENTRY;
+
+	/* Do not block dataset add/del while detaching files */
+	down_read(&super->pccs_rw_sem);
+	list_for_each_entry(dataset, &super->pccs_datasets, pccd_linkage) {
+		if (dataset->pccd_hwm > 0)
+			count++;
+	}
+	if (count == 0) {
+		up_read(&super->pccs_rw_sem);
+		RETURN_EXIT;
+	}
+
+	OBD_ALLOC(datasets, sizeof(*datasets) * count);
+	if (datasets == NULL) {
+		up_read(&super->pccs_rw_sem);
+		GOTO(out_requeue, 0);
+	}
+
+	list_for_each_entry(dataset, &super->pccs_datasets, pccd_linkage) {
+		if (dataset->pccd_hwm == 0)
+			continue;
+		atomic_inc(&dataset->pccd_refcount);
+		datasets[i++] = dataset;
+	}
+	up_read(&super->pccs_rw_sem);
+
+	for (i = 0; i < count; i++) {
+		pcc_dataset_evict(datasets[i]);
+		pcc_dataset_put(datasets[i]);
+	}
+	OBD_FREE(datasets, sizeof(*datasets) * count);
+
+out_requeue:
+	queue_delayed_work(super->pccs_attach_wq, &super->pccs_evict_work,
+			   cfs_time_seconds(PCC_EVICT_INTERVAL));
+	EXIT;
+}
+
+static const char * const pcc_stat_names[] = {
+	[PCC_STAT_ATTACH]	= "attach",
+	[PCC_STAT_DETACH]	= "detach",
+	[PCC_STAT_EVICT]	= "evict",
+	[PCC_STAT_HIT]		= "hit",
+	[PCC_STAT_MISS]		= "miss",
+	[PCC_STAT_READ_BYTES]	= "read_bytes",
+	[PCC_STAT_WRITE_BYTES]	= "write_bytes",
+};
+
+int pcc_super_stats_dump(struct pcc_super *super, struct seq_file *m)
+{
+	struct pcc_dataset *dataset;
+	__u64 used, capacity;
+	int i;
+
+	for (i = 0; i < PCC_STAT_NR; i++)
+		seq_printf(m, "%s: %lld\n", pcc_stat_names[i],
+			   (long long)atomic64_read(&super->pccs_stats[i]));
+
+	down_read(&super->pccs_rw_sem);
+	list_for_each_entry(dataset, &super->pccs_datasets, pccd_linkage) {
+		seq_printf(m, "%s:\n", dataset->pccd_pathname);
+		seq_printf(m, "  cached_files: %u\n", dataset->pccd_lru_count);
+		seq_printf(m, "  cached_mb: %llu\n", dataset->pccd_used >> 20);
+		if (pcc_dataset_usage(dataset, &used, &capacity) == 0) {
+			seq_printf(m, "  used_mb: %llu\n", used >> 20);
+			seq_printf(m, "  capacity_mb: %llu\n", capacity >> 20);
+		}
+	}
+	up_read(&super->pccs_rw_sem);
+
+	return 0;
+}
+
+void pcc_super_stats_clear(struct pcc_super *super)
+{
+	int i;
+
+	for (i = 0; i < PCC_STAT_NR; i++)
+		atomic64_set(&super->pccs_stats[i], 0);
+}
@@ -42,6 +42,11 @@ extern struct kmem_cache *pcc_inode_slab;
 
 #define LPROCFS_WR_PCC_MAX_CMD 4096
 
+/* Interval of checking the cache usage of datasets with watermarks */
+#define PCC_EVICT_INTERVAL	10
+/* Max # of cached files detached in a batch by the eviction work */
+#define PCC_EVICT_BATCH		16
+
 /* User/Group/Project ID */
 struct pcc_match_id {
 	__u32			pmi_id;
@@ -111,6 +116,30 @@ struct pcc_dataset {
 	struct path		pccd_path;	 /* Root path */
 	struct list_head	pccd_linkage;  /* Linked to pccs_datasets */
 	atomic_t		pccd_refcount; /* Reference count */
+	/* Eviction starts above pccd_hwm percent of the capacity, and stops
+	 * below pccd_lwm percent, disabled if pccd_hwm is 0 */
+	__u32			pccd_hwm;
+	__u32			pccd_lwm;
+	/* Capacity of the dataset, 0 means the whole cache file system */
+	__u64			pccd_max_bytes;
+	/* Protect pccd_lru, pccd_lru_count and pccd_used */
+	spinlock_t		pccd_lru_lock;
+	/* pcc_inodes attached from this dataset, least recently used first */
+	struct list_head	pccd_lru;
+	unsigned int		pccd_lru_count;
+	/* Bytes of the cache copies on pccd_lru */
+	__u64			pccd_used;
+};
+
+enum pcc_stat_type {
+	PCC_STAT_ATTACH = 0,
+	PCC_STAT_DETACH,
+	PCC_STAT_EVICT,
+	PCC_STAT_HIT,
+	PCC_STAT_MISS,
+	PCC_STAT_READ_BYTES,
+	PCC_STAT_WRITE_BYTES,
+	PCC_STAT_NR
 };
 
 struct pcc_super {
@@ -120,6 +149,11 @@ struct pcc_super {
 	struct list_head	 pccs_datasets;
 	/* creds of process who forced instantiation of super block */
 	const struct cred	*pccs_cred;
+	/* Workqueue copying files into RO-PCC on their first open */
+	struct workqueue_struct	*pccs_attach_wq;
+	/* Work detaching cold files from datasets above high watermark */
+	struct delayed_work	 pccs_evict_work;
+	atomic64_t		 pccs_stats[PCC_STAT_NR];
 };
 
 struct pcc_inode {
@@ -144,6 +178,14 @@ struct pcc_inode {
 	atomic_t		 pcci_active_ios;
 	/* Waitq - wait for PCC I/O completion. */
 	wait_queue_head_t	 pcci_waitq;
+	/* Dataset holding the cache copy */
+	struct pcc_dataset	*pcci_dataset;
+	/* Linked to pcci_dataset->pccd_lru */
+	struct list_head	 pcci_lru;
+	/* Accessed since last scanned by the eviction work */
+	bool			 pcci_accessed;
+	/* Bytes accounted to pcci_dataset for the cache copy */
+	__u64			 pcci_size;
 };
 
 struct pcc_file {
@@ -166,6 +208,9 @@ struct pcc_cmd {
 		struct pcc_cmd_add {
 			__u32			 pccc_rwid;
 			__u32			 pccc_roid;
+			__u32			 pccc_hwm;
+			__u32			 pccc_lwm;
+			__u64			 pccc_max_mb;
 			struct list_head	 pccc_conds;
 			char			*pccc_conds_str;
 			enum pcc_dataset_flags	 pccc_flags;
@@ -181,11 +226,14 @@ void pcc_super_fini(struct pcc_super *super);
 int pcc_cmd_handle(char *buffer, unsigned long count,
 		   struct pcc_super *super);
 int pcc_super_dump(struct pcc_super *super, struct seq_file *m);
+int pcc_super_stats_dump(struct pcc_super *super, struct seq_file *m);
+void pcc_super_stats_clear(struct pcc_super *super);
 int pcc_readwrite_attach(struct file *file, struct inode *inode,
 			 __u32 arch_id);
 int pcc_readwrite_attach_fini(struct file *file, struct inode *inode,
 			      __u32 gen, bool lease_broken, int rc,
 			      bool attached);
+int pcc_readonly_attach(struct file *file, struct inode *inode, __u32 roid);
 int pcc_ioctl_detach(struct inode *inode, __u32 opt);
 int pcc_ioctl_state(struct file *file, struct inode *inode,
 		    struct lu_pcc_state *state);
@@ -214,6 +262,7 @@ int pcc_inode_create(struct super_block *sb, struct pcc_dataset *dataset,
 int pcc_inode_create_fini(struct pcc_dataset *dataset, struct inode *inode,
 			   struct dentry *pcc_dentry);
 struct pcc_dataset *pcc_dataset_match_get(struct pcc_super *super,
+					  enum lu_pcc_type type,
 					  struct pcc_matcher *matcher);
 void pcc_dataset_put(struct pcc_dataset *dataset);
 void pcc_inode_free(struct inode *inode);
@@ -249,6 +249,11 @@ static inline int stride_io_mode(struct ll_readahead_state *ras)
         return ras->ras_consecutive_stride_requests > 1;
 }
 
+static inline bool backward_io_mode(struct ll_readahead_state *ras)
+{
+	return ras->ras_backward_requests > 1;
+}
+
 /* The function calculates how much pages will be read in
  * [off, off + length], in such stride IO area,
  * stride_offset = st_off, stride_lengh = st_len,
@@ -425,15 +430,162 @@ ll_read_ahead_pages(const struct lu_env *env, struct cl_io *io,
 	return count;
 }
 
+static void ll_readahead_work_free(struct ll_readahead_work *work)
+{
+	fput(work->lrw_file);
+	OBD_FREE_PTR(work);
+}
+
+static void ll_readahead_handle_work(struct work_struct *wq);
+
+/**
+ * Queue read-ahead of pages [\a start, \a end] of \a file to the per-sbi
+ * read-ahead workqueue, so that the reader does not wait for pages it has
+ * not asked for yet.
+ *
+ * \retval 0		work queued
+ * \retval -EBUSY	too many works in flight, read ahead synchronously
+ * \retval -ENOMEM	no memory for the work
+ */
+static int ll_readahead_kickoff(struct file *file, pgoff_t start, pgoff_t end,
+				bool eof)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(file_inode(file));
+	struct ll_ra_info *ra = &sbi->ll_ra_info;
+	struct ll_readahead_work *lrw;
+	ENTRY;
+
+	if (atomic_inc_return(&ra->ra_async_inflight) >
+	    ra->ra_async_max_active) {
+		atomic_dec(&ra->ra_async_inflight);
+		RETURN(-EBUSY);
+	}
+
+	OBD_ALLOC_PTR(lrw);
+	if (lrw == NULL) {
+		atomic_dec(&ra->ra_async_inflight);
+		RETURN(-ENOMEM);
+	}
+
+	lrw->lrw_file = get_file(file);
+	lrw->lrw_start = start;
+	lrw->lrw_end = end;
+	lrw->lrw_eof = eof;
+	INIT_WORK(&lrw->lrw_readahead_work, ll_readahead_handle_work);
+	queue_work(ra->ll_readahead_wq, &lrw->lrw_readahead_work);
+
+	CDEBUG(D_READA, DFID": async read-ahead %lu-%lu queued\n",
+	       PFID(ll_inode2fid(file_inode(file))), start, end);
+	RETURN(0);
+}
+
+static void ll_readahead_handle_work(struct work_struct *wq)
+{
+	struct ll_readahead_work *work;
+	struct ll_file_data *fd;
+	struct inode *inode;
+	struct ll_sb_info *sbi;
+	struct ra_io_arg *ria;
+	struct cl_2queue *queue;
+	struct vvp_io *vio;
+	struct lu_env *env;
+	struct cl_io *io;
+	pgoff_t ra_end = 0;
+	unsigned long len;
+	__u16 refcheck;
+	int rc;
+	ENTRY;
+
+	work = container_of(wq, struct ll_readahead_work, lrw_readahead_work);
+	fd = LUSTRE_FPRIVATE(work->lrw_file);
+	inode = file_inode(work->lrw_file);
+	sbi = ll_i2sbi(inode);
+
+	env = cl_env_get(&refcheck);
+	if (IS_ERR(env))
+		GOTO(out_free_work, rc = PTR_ERR(env));
+
+	io = vvp_env_thread_io(env);
+	ll_io_init(io, work->lrw_file, CIT_READ);
+
+	len = work->lrw_end - work->lrw_start + 1;
+	rc = cl_io_rw_init(env, io, CIT_READ,
+			   (loff_t)work->lrw_start << PAGE_SHIFT,
+			   (size_t)len << PAGE_SHIFT);
+	if (rc)
+		GOTO(out_io_fini, rc);
+
+	vio = vvp_env_io(env);
+	vio->vui_fd = fd;
+	vio->vui_io_subtype = IO_NORMAL;
+	/* the pages are only read under DLM locks cached by the reader,
+	 * see osc_io_read_ahead(), so no lock is enqueued here */
+	io->ci_state = CIS_LOCKED;
+	io->ci_async_readahead = 1;
+	rc = cl_io_start(env, io);
+	if (rc)
+		GOTO(out_io_end, rc);
+
+	ria = &ll_env_info(env)->lti_ria;
+	memset(ria, 0, sizeof(*ria));
+	ria->ria_start = work->lrw_start;
+	ria->ria_end = work->lrw_end;
+	ria->ria_eof = work->lrw_eof;
+	ria->ria_reserved = ll_ra_count_get(sbi, ria, len, 0);
+	if (ria->ria_reserved < len)
+		ll_ra_stats_inc_sbi(sbi, RA_STAT_MAX_IN_FLIGHT);
+	if (ria->ria_reserved == 0)
+		GOTO(out_io_end, rc = 0);
+
+	queue = &io->ci_queue;
+	cl_2queue_init(queue);
+
+	rc = ll_read_ahead_pages(env, io, &queue->c2_qin, &fd->fd_ras, ria,
+				 &ra_end);
+	if (ria->ria_reserved != 0)
+		ll_ra_count_put(sbi, ria->ria_reserved);
+
+	if (queue->c2_qin.pl_nr > 0) {
+		int count = queue->c2_qin.pl_nr;
+
+		rc = cl_io_submit_rw(env, io, CRT_READ, queue);
+		if (rc == 0)
+			task_io_account_read(PAGE_SIZE * count);
+	}
+
+	/* read-ahead pages which could not be sent are dropped, a later
+	 * read of them starts afresh */
+	cl_page_list_discard(env, io, &queue->c2_qin);
+	cl_page_list_disown(env, io, &queue->c2_qin);
+
+	cl_2queue_fini(env, queue);
+
+	CDEBUG(D_READA, DFID": async read-ahead %lu-%lu done, ra_end %lu: rc = %d\n",
+	       PFID(ll_inode2fid(inode)), work->lrw_start, work->lrw_end,
+	       ra_end, rc);
+out_io_end:
+	cl_io_end(env, io);
+out_io_fini:
+	cl_io_fini(env, io);
+	cl_env_put(env, &refcheck);
+out_free_work:
+	if (ra_end > 0)
+		ll_ra_stats_inc_sbi(sbi, RA_STAT_ASYNC);
+	atomic_dec(&sbi->ll_ra_info.ra_async_inflight);
+	ll_readahead_work_free(work);
+	EXIT;
+}
+
 static int ll_readahead(const struct lu_env *env, struct cl_io *io,
 			struct cl_page_list *queue,
-			struct ll_readahead_state *ras, bool hit)
+			struct ll_readahead_state *ras, bool hit,
+			struct file *file)
 {
 	struct vvp_io *vio = vvp_env_io(env);
 	struct ll_thread_info *lti = ll_env_info(env);
 	struct cl_attr *attr = vvp_env_thread_attr(env);
 	unsigned long len, mlen = 0;
-	pgoff_t ra_end = 0, start = 0, end = 0;
+	pgoff_t ra_end = 0, start = 0, end = 0, async_end = 0;
 	struct inode *inode;
 	struct ra_io_arg *ria = &lti->lti_ria;
 	struct cl_object *clob;
@@ -531,6 +683,30 @@ static int ll_readahead(const struct lu_env *env, struct cl_io *io,
 		ria->ria_end_min = ria->ria_start + mlen;
 	}
 
+	/* Large non-stride windows are split: the part covering the current
+	 * read is read ahead here, the rest is handed to the async worker so
+	 * that the reader only waits for the pages it needs now. */
+	if (file != NULL && ria->ria_length == 0 &&
+	    len >= ll_i2sbi(inode)->ll_ra_info.ra_async_pages_threshold) {
+		pgoff_t async_start = mlen > 0 ? ria->ria_end_min + 1 :
+						 ria->ria_start;
+
+		if (async_start <= ria->ria_end &&
+		    ll_readahead_kickoff(file, async_start, ria->ria_end,
+					 ria->ria_eof) == 0) {
+			async_end = ria->ria_end;
+			if (mlen == 0) {
+				spin_lock(&ras->ras_lock);
+				ras->ras_next_readahead = async_end + 1;
+				spin_unlock(&ras->ras_lock);
+				RETURN(0);
+			}
+			ria->ria_end = end = ria->ria_end_min;
+			ria->ria_eof = false;
+			len = ria_page_count(ria);
+		}
+	}
+
 	ria->ria_reserved = ll_ra_count_get(ll_i2sbi(inode), ria, len, mlen);
 	if (ria->ria_reserved < len)
 		ll_ra_stats_inc(inode, RA_STAT_MAX_IN_FLIGHT);
@@ -553,11 +729,11 @@ static int ll_readahead(const struct lu_env *env, struct cl_io *io,
 
 	if (ra_end != end)
 		ll_ra_stats_inc(inode, RA_STAT_FAILED_REACH_END);
-	if (ra_end > 0) {
+	if (ra_end > 0 || async_end > 0) {
 		/* update the ras so that the next read-ahead tries from
-		 * where we left off. */
+		 * where we left off, skipping what the async worker reads. */
 		spin_lock(&ras->ras_lock);
-		ras->ras_next_readahead = ra_end + 1;
+		ras->ras_next_readahead = max(ra_end, async_end) + 1;
 		spin_unlock(&ras->ras_lock);
 		RAS_CDEBUG(ras);
 	}
@@ -600,6 +776,113 @@ void ll_readahead_init(struct inode *inode, struct ll_readahead_state *ras)
 	ras->ras_rpc_size = PTLRPC_MAX_BRW_PAGES;
 	ras_reset(inode, ras, 0);
 	ras->ras_requests = 0;
+	ras->ras_request_start = 0;
+	ras->ras_backward_requests = 0;
+	memset(ras->ras_streams, 0, sizeof(ras->ras_streams));
+	ras->ras_stream_next = 0;
+}
+
+/* called with the ras_lock held */
+static void ras_stream_save(struct ll_readahead_state *ras,
+			    struct ll_ra_stream *rst)
+{
+	rst->rst_last_readpage = ras->ras_last_readpage;
+	rst->rst_consecutive_pages = ras->ras_consecutive_pages;
+	rst->rst_consecutive_requests = ras->ras_consecutive_requests;
+	rst->rst_window_start = ras->ras_window_start;
+	rst->rst_window_len = ras->ras_window_len;
+	rst->rst_next_readahead = ras->ras_next_readahead;
+}
+
+/* called with the ras_lock held */
+static void ras_stream_restore(struct ll_readahead_state *ras,
+			       const struct ll_ra_stream *rst)
+{
+	ras->ras_last_readpage = rst->rst_last_readpage;
+	ras->ras_consecutive_pages = rst->rst_consecutive_pages;
+	ras->ras_consecutive_requests = rst->rst_consecutive_requests;
+	ras->ras_window_start = rst->rst_window_start;
+	ras->ras_window_len = rst->rst_window_len;
+	ras->ras_next_readahead = rst->rst_next_readahead;
+}
+
+/*
+ * The read at \a index is not contiguous with the current stream. Check
+ * whether it continues one of the streams saved in ras_streams, and if so
+ * swap it with the current stream, so that interleaved sequential streams
+ * keep their own read-ahead window. Otherwise the current stream is saved,
+ * if it had a read-ahead window, before it gets reset by the caller.
+ *
+ * Return true if the current stream was switched.
+ */
+static bool ras_stream_switch(struct ll_readahead_state *ras,
+			      unsigned long index)
+{
+	struct ll_ra_stream cur;
+	struct ll_ra_stream *rst;
+	int i;
+
+	ras_stream_save(ras, &cur);
+	for (i = 0; i < LL_RA_STREAMS; i++) {
+		rst = &ras->ras_streams[i];
+		if (rst->rst_consecutive_pages == 0 ||
+		    !index_in_window(index, rst->rst_last_readpage, 8, 8))
+			continue;
+
+		ras_stream_restore(ras, rst);
+		*rst = cur;
+		RAS_CDEBUG(ras);
+		return true;
+	}
+
+	if (cur.rst_window_len > 0) {
+		ras->ras_streams[ras->ras_stream_next] = cur;
+		ras->ras_stream_next = (ras->ras_stream_next + 1) %
+				       LL_RA_STREAMS;
+	}
+	return false;
+}
+
+/*
+ * Called for the first page of each read request. If the request ends
+ * right where the previous one started for the second time in a row, the
+ * file is being read backward: set up a read-ahead window covering the
+ * pages preceding \a index, growing it by one request size per backward
+ * request up to ra_max_pages_per_file.
+ *
+ * Return true if the backward read-ahead window was set up.
+ */
+static bool ras_backward_detect(struct ll_readahead_state *ras,
+				struct ll_ra_info *ra, unsigned long index)
+{
+	unsigned long prev_start = ras->ras_request_start;
+	unsigned long prev_len;
+	unsigned long len;
+
+	if (index >= prev_start || ras->ras_last_readpage < prev_start)
+		goto out_reset;
+
+	prev_len = ras->ras_last_readpage - prev_start + 1;
+	if (index + prev_len != prev_start)
+		goto out_reset;
+
+	if (++ras->ras_backward_requests < 2)
+		return false;
+
+	len = min(prev_len * ras->ras_backward_requests,
+		  ra->ra_max_pages_per_file);
+	ras_stride_reset(ras);
+	ras->ras_window_start = index > len ? index - len : 0;
+	ras->ras_window_len = index - ras->ras_window_start;
+	ras->ras_next_readahead = ras->ras_window_start;
+	ras->ras_last_readpage = index;
+	ras->ras_consecutive_pages = 1;
+	RAS_CDEBUG(ras);
+	return true;
+
+out_reset:
+	ras->ras_backward_requests = 0;
+	return false;
 }
 
 /*
@@ -736,15 +1019,28 @@ static void ras_update(struct ll_sb_info *sbi, struct inode *inode,
 		CDEBUG(D_READA, DFID " pages at %lu miss.\n",
 		       PFID(ll_inode2fid(inode)), index);
         ll_ra_stats_inc_sbi(sbi, hit ? RA_STAT_HIT : RA_STAT_MISS);
+	if (stride_io_mode(ras))
+		ll_ra_stats_inc_sbi(sbi, hit ? RA_STAT_STRIDE_HIT :
+					       RA_STAT_STRIDE_MISS);
+	else if (backward_io_mode(ras))
+		ll_ra_stats_inc_sbi(sbi, hit ? RA_STAT_BACKWARD_HIT :
+					       RA_STAT_BACKWARD_MISS);
 
         /* reset the read-ahead window in two cases.  First when the app seeks
          * or reads to some other part of the file.  Secondly if we get a
          * read-ahead miss that we think we've previously issued.  This can
          * be a symptom of there being so many read-ahead pages that the VM is
-         * reclaiming it before we get to it. */
+         * reclaiming it before we get to it.
+	 * A seek that continues another sequential stream reading the same
+	 * file just switches to that stream. */
         if (!index_in_window(index, ras->ras_last_readpage, 8, 8)) {
-                zero = 1;
-                ll_ra_stats_inc_sbi(sbi, RA_STAT_DISTANT_READPAGE);
+		if (!stride_io_mode(ras) && !backward_io_mode(ras) &&
+		    ras_stream_switch(ras, index)) {
+			ll_ra_stats_inc_sbi(sbi, RA_STAT_STREAM_SWITCH);
+		} else {
+			zero = 1;
+			ll_ra_stats_inc_sbi(sbi, RA_STAT_DISTANT_READPAGE);
+		}
         } else if (!hit && ras->ras_window_len &&
                    index < ras->ras_next_readahead &&
                    index_in_window(index, ras->ras_window_start, 0,
@@ -777,6 +1073,23 @@ static void ras_update(struct ll_sb_info *sbi, struct inode *inode,
                         GOTO(out_unlock, 0);
                 }
         }
+
+	if (ras->ras_request_index == 0) {
+		if (ras_backward_detect(ras, ra, index)) {
+			ll_ra_stats_inc_sbi(sbi, RA_STAT_BACKWARD);
+			ras->ras_request_start = index;
+			GOTO(out_unlock, 0);
+		}
+		ras->ras_request_start = index;
+	} else if (backward_io_mode(ras) &&
+		   index == ras->ras_last_readpage + 1) {
+		/* the rest of a backward request was covered by the window
+		 * set up on its first page, don't grow it forward */
+		ras->ras_consecutive_pages++;
+		ras->ras_last_readpage = index;
+		GOTO(out_unlock, 0);
+	}
+
 	if (zero) {
 		/* check whether it is in stride I/O mode*/
 		if (!index_in_stride_window(ras, index)) {
@@ -1125,7 +1438,7 @@ int ll_io_read_page(const struct lu_env *env, struct cl_io *io,
 		int rc2;
 
 		rc2 = ll_readahead(env, io, &queue->c2_qin, ras,
-				   uptodate);
+				   uptodate, file);
 		CDEBUG(D_READA, DFID "%d pages read ahead at %lu\n",
 		       PFID(ll_inode2fid(inode)), rc2, vvp_index(vpg));
 	}
@@ -174,13 +174,32 @@ static int ll_releasepage(struct page *vmpage, RELEASEPAGE_ARG_TYPE gfp_mask)
 
 #define MAX_DIRECTIO_SIZE 2*1024*1024*1024UL
 
+/**
+ * Pages of one direct IO segment. Segments are submitted back to back and
+ * their transfer completes against a common cl_sync_io anchor, so a large
+ * direct IO keeps several segments in flight instead of waiting for each of
+ * them in turn. See ll_direct_IO().
+ */
+struct ll_dio_pages {
+	struct list_head	  ldp_linkage;
+	/** transient cl_pages of this segment */
+	struct cl_2queue	  ldp_queue;
+	/** pinned user pages */
+	struct page		**ldp_pages;
+	/** size of ldp_pages array */
+	int			  ldp_count;
+};
+
+/* max number of direct IO segments in flight for one system call */
+#define LL_DIO_PIPELINE_DEPTH	8
+
 static ssize_t
 ll_direct_IO_seg(const struct lu_env *env, struct cl_io *io, int rw,
 		 struct inode *inode, size_t size, loff_t file_offset,
-		 struct page **pages, int page_count)
+		 struct page **pages, int page_count,
+		 struct cl_2queue *queue, struct cl_sync_io *anchor)
 {
 	struct cl_page *clp;
-	struct cl_2queue *queue;
 	struct cl_object *obj = io->ci_obj;
 	int i;
 	ssize_t rc = 0;
@@ -190,7 +209,6 @@ ll_direct_IO_seg(const struct lu_env *env, struct cl_io *io, int rw,
 	int io_pages = 0;
 
 	ENTRY;
-	queue = &io->ci_queue;
 	cl_2queue_init(queue);
 	for (i = 0; i < page_count; i++) {
 		LASSERT(!(file_offset & (page_size - 1)));
@@ -264,16 +282,32 @@ ll_direct_IO_seg(const struct lu_env *env, struct cl_io *io, int rw,
 	}
 
 	if (rc == 0 && io_pages) {
-		rc = cl_io_submit_sync(env, io,
-				       rw == READ ? CRT_READ : CRT_WRITE,
-				       queue, 0);
+		cl_page_list_for_each(clp, &queue->c2_qin) {
+			LASSERT(clp->cp_sync_io == NULL);
+			clp->cp_sync_io = anchor;
+		}
+		/* the caller holds a reference on the anchor, so it can't
+		 * complete while the pages are being accounted */
+		atomic_add(queue->c2_qin.pl_nr, &anchor->csi_sync_nr);
+		rc = cl_io_submit_rw(env, io,
+				     rw == READ ? CRT_READ : CRT_WRITE, queue);
+		if (rc == 0) {
+			/* pages which were not sent are accounted as
+			 * completed, like cl_io_submit_sync() does */
+			cl_page_list_for_each(clp, &queue->c2_qin) {
+				clp->cp_sync_io = NULL;
+				cl_sync_io_note(env, anchor, 1);
+			}
+		} else {
+			LASSERT(list_empty(&queue->c2_qout.pl_pages));
+			cl_page_list_for_each(clp, &queue->c2_qin)
+				clp->cp_sync_io = NULL;
+			atomic_sub(queue->c2_qin.pl_nr, &anchor->csi_sync_nr);
+		}
 	}
 	if (rc == 0)
 		rc = orig_size;
 
-	cl_2queue_discard(env, io, queue);
-	cl_2queue_disown(env, io, queue);
-	cl_2queue_fini(env, queue);
 	RETURN(rc);
 }
 
@@ -298,6 +332,77 @@ static void ll_free_user_pages(struct page **pages, int npages, int do_dirty)
 #endif
 }
 
+/* release the transient pages and the user pages of \a ldp */
+static void ll_dio_pages_fini(const struct lu_env *env, struct cl_io *io,
+			      struct ll_dio_pages *ldp, int rw)
+{
+	struct cl_2queue *queue = &ldp->ldp_queue;
+
+	cl_page_list_assume(env, io, &queue->c2_qout);
+	cl_2queue_discard(env, io, queue);
+	cl_2queue_disown(env, io, queue);
+	cl_2queue_fini(env, queue);
+	ll_free_user_pages(ldp->ldp_pages, ldp->ldp_count, rw == READ);
+	list_del(&ldp->ldp_linkage);
+	OBD_FREE_PTR(ldp);
+}
+
+/**
+ * Submit a direct IO segment of \a size bytes at \a file_offset, backed by
+ * user pages \a pages. The segment is added to \a segs, and its pages are
+ * released by ll_direct_IO_wait(). On failure nothing is left in flight and
+ * the segment is released immediately.
+ */
+static ssize_t ll_direct_IO_submit(const struct lu_env *env, struct cl_io *io,
+				   int rw, struct inode *inode, size_t size,
+				   loff_t file_offset, struct page **pages,
+				   int page_count, int max_pages,
+				   struct cl_sync_io *anchor,
+				   struct list_head *segs)
+{
+	struct ll_dio_pages *ldp;
+	ssize_t rc;
+
+	OBD_ALLOC_PTR(ldp);
+	if (ldp == NULL) {
+		ll_free_user_pages(pages, max_pages, 0);
+		return -ENOMEM;
+	}
+	ldp->ldp_pages = pages;
+	ldp->ldp_count = max_pages;
+	list_add_tail(&ldp->ldp_linkage, segs);
+
+	rc = ll_direct_IO_seg(env, io, rw, inode, size, file_offset, pages,
+			      page_count, &ldp->ldp_queue, anchor);
+	if (rc <= 0)
+		ll_dio_pages_fini(env, io, ldp, rw);
+
+	return rc;
+}
+
+/**
+ * Wait for all direct IO segments submitted against \a anchor, and release
+ * them. The caller's reference on \a anchor is dropped; the anchor is
+ * re-armed for the next batch of segments.
+ */
+static int ll_direct_IO_wait(const struct lu_env *env, struct cl_io *io,
+			     int rw, struct cl_sync_io *anchor,
+			     struct list_head *segs)
+{
+	struct ll_dio_pages *ldp;
+	struct ll_dio_pages *tmp;
+	int rc;
+
+	cl_sync_io_note(env, anchor, 0);
+	rc = cl_sync_io_wait(env, anchor, 0);
+
+	list_for_each_entry_safe(ldp, tmp, segs, ldp_linkage)
+		ll_dio_pages_fini(env, io, ldp, rw);
+
+	cl_sync_io_init(anchor, 1, &cl_sync_io_end);
+	return rc;
+}
+
 #ifdef KMALLOC_MAX_SIZE
 #define MAX_MALLOC KMALLOC_MAX_SIZE
 #else
@@ -338,7 +443,12 @@ ll_direct_IO(
 	struct inode *inode = file->f_mapping->host;
 	ssize_t count = iov_iter_count(iter);
 	ssize_t tot_bytes = 0, result = 0;
+	ssize_t pending = 0;
 	size_t size = MAX_DIO_SIZE;
+	struct cl_sync_io anchor;
+	struct list_head segs = LIST_HEAD_INIT(segs);
+	int nsegs = 0;
+	int rc;
 
 	/* Check EOF by ourselves */
 	if (iov_iter_rw(iter) == READ && file_offset >= i_size_read(inode))
@@ -373,6 +483,7 @@ ll_direct_IO(
 	if (iov_iter_rw(iter) == READ)
 		inode_lock(inode);
 
+	cl_sync_io_init(&anchor, 1, &cl_sync_io_end);
 	while (iov_iter_count(iter)) {
 		struct page **pages;
 		size_t offs;
@@ -390,12 +501,10 @@ ll_direct_IO(
 		if (likely(result > 0)) {
 			int n = DIV_ROUND_UP(result + offs, PAGE_SIZE);
 
-			result = ll_direct_IO_seg(env, io, iov_iter_rw(iter),
-						  inode, result, file_offset,
-						  pages, n);
-			ll_free_user_pages(pages, n,
-					   iov_iter_rw(iter) == READ);
-
+			result = ll_direct_IO_submit(env, io, iov_iter_rw(iter),
+						     inode, result,
+						     file_offset, pages, n, n,
+						     &anchor, &segs);
 		}
 		if (unlikely(result <= 0)) {
 			/* If we can't allocate a large enough buffer
@@ -417,10 +526,28 @@ ll_direct_IO(
 		}
 
 		iov_iter_advance(iter, result);
-		tot_bytes += result;
+		pending += result;
 		file_offset += result;
+
+		if (++nsegs >= LL_DIO_PIPELINE_DEPTH) {
+			rc = ll_direct_IO_wait(env, io, iov_iter_rw(iter),
+					       &anchor, &segs);
+			if (rc < 0) {
+				pending = 0;
+				GOTO(out, result = rc);
+			}
+			tot_bytes += pending;
+			pending = 0;
+			nsegs = 0;
+		}
 	}
 out:
+	rc = ll_direct_IO_wait(env, io, iov_iter_rw(iter), &anchor, &segs);
+	if (rc < 0 && pending > 0)
+		result = rc;
+	else
+		tot_bytes += pending;
+
 	if (iov_iter_rw(iter) == READ)
 		inode_unlock(inode);
 
@@ -476,8 +603,13 @@ ll_direct_IO(int rw, struct kiocb *iocb, const struct iovec *iov,
 	struct inode *inode = file->f_mapping->host;
 	ssize_t count = iov_length(iov, nr_segs);
 	ssize_t tot_bytes = 0, result = 0;
+	ssize_t pending = 0;
 	unsigned long seg = 0;
 	size_t size = MAX_DIO_SIZE;
+	struct cl_sync_io anchor;
+	struct list_head segs = LIST_HEAD_INIT(segs);
+	int nsegs = 0;
+	int rc;
 	ENTRY;
 
         /* FIXME: io smaller than PAGE_SIZE is broken on ia64 ??? */
@@ -506,6 +638,7 @@ ll_direct_IO(int rw, struct kiocb *iocb, const struct iovec *iov,
 	io = lcc->lcc_io;
 	LASSERT(io != NULL);
 
+	cl_sync_io_init(&anchor, 1, &cl_sync_io_end);
         for (seg = 0; seg < nr_segs; seg++) {
 		size_t iov_left = iov[seg].iov_len;
                 unsigned long user_addr = (unsigned long)iov[seg].iov_base;
@@ -528,10 +661,11 @@ ll_direct_IO(int rw, struct kiocb *iocb, const struct iovec *iov,
                         if (likely(page_count > 0)) {
                                 if (unlikely(page_count <  max_pages))
 					bytes = page_count << PAGE_SHIFT;
-				result = ll_direct_IO_seg(env, io, rw, inode,
-							  bytes, file_offset,
-							  pages, page_count);
-                                ll_free_user_pages(pages, max_pages, rw==READ);
+				result = ll_direct_IO_submit(env, io, rw, inode,
+							     bytes, file_offset,
+							     pages, page_count,
+							     max_pages,
+							     &anchor, &segs);
                         } else if (page_count == 0) {
                                 GOTO(out, result = -EFAULT);
                         } else {
@@ -557,13 +691,31 @@ ll_direct_IO(int rw, struct kiocb *iocb, const struct iovec *iov,
                                 GOTO(out, result);
                         }
 
-                        tot_bytes += result;
+			pending += result;
                         file_offset += result;
                         iov_left -= result;
                         user_addr += result;
+
+			if (++nsegs >= LL_DIO_PIPELINE_DEPTH) {
+				rc = ll_direct_IO_wait(env, io, rw, &anchor,
+						       &segs);
+				if (rc < 0) {
+					pending = 0;
+					GOTO(out, result = rc);
+				}
+				tot_bytes += pending;
+				pending = 0;
+				nsegs = 0;
+			}
                 }
         }
 out:
+	rc = ll_direct_IO_wait(env, io, rw, &anchor, &segs);
+	if (rc < 0 && pending > 0)
+		result = rc;
+	else
+		tot_bytes += pending;
+
         if (tot_bytes > 0) {
 		struct vvp_io *vio = vvp_env_io(env);
 
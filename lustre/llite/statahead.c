@@ -30,6 +30,7 @@
  * Lustre is a trademark of Sun Microsystems, Inc.
  */
 
+#include <linux/ctype.h>
 #include <linux/fs.h>
 #include <linux/sched.h>
 #include <linux/kthread.h>
@@ -82,6 +83,17 @@ struct sa_entry {
 	struct lu_fid		se_fid;
 };
 
+/* names handed over by LL_IOC_STATAHEAD, queued in sai_name_lists */
+struct sa_name_list {
+	struct list_head	snl_list;
+	/* bytes used by names */
+	__u32			snl_size;
+	/* NUL terminated names, one after another */
+	char			snl_names[0];
+};
+
+#define SNL_ALLOC_SIZE(size)	offsetof(struct sa_name_list, snl_names[size])
+
 static unsigned int sai_generation = 0;
 static DEFINE_SPINLOCK(sai_generation_lock);
 
@@ -155,6 +167,22 @@ static inline int agl_list_empty(struct ll_statahead_info *sai)
 	return list_empty(&sai->sai_agls);
 }
 
+/*
+ * statahead by filename pattern isn't bound to an opened dir handle, it stops
+ * once the scanner hasn't accessed it for a while, or upon umount.
+ */
+static inline bool sa_expired(struct ll_statahead_info *sai)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(sai->sai_dentry->d_inode);
+
+	if (sai->sai_mode != SA_MODE_FNAME)
+		return false;
+
+	return sbi->ll_umounting ||
+	       time_after(jiffies, sai->sai_access +
+				   cfs_time_seconds(LL_SA_FNAME_IDLE));
+}
+
 /**
  * (1) hit ratio less than 80%
  * or
@@ -470,6 +498,8 @@ static struct ll_statahead_info *ll_sai_alloc(struct dentry *dentry)
 	INIT_LIST_HEAD(&sai->sai_interim_entries);
 	INIT_LIST_HEAD(&sai->sai_entries);
 	INIT_LIST_HEAD(&sai->sai_agls);
+	INIT_LIST_HEAD(&sai->sai_name_lists);
+	sai->sai_access = jiffies;
 
 	for (i = 0; i < LL_SA_CACHE_SIZE; i++) {
 		INIT_LIST_HEAD(&sai->sai_cache[i]);
@@ -489,7 +519,13 @@ static struct ll_statahead_info *ll_sai_alloc(struct dentry *dentry)
 /* free sai */
 static inline void ll_sai_free(struct ll_statahead_info *sai)
 {
+	struct sa_name_list *snl, *tmp;
+
 	LASSERT(sai->sai_dentry != NULL);
+	list_for_each_entry_safe(snl, tmp, &sai->sai_name_lists, snl_list) {
+		list_del(&snl->snl_list);
+		OBD_FREE_LARGE(snl, SNL_ALLOC_SIZE(snl->snl_size));
+	}
 	dput(sai->sai_dentry);
 	OBD_FREE_PTR(sai);
 }
@@ -775,6 +811,41 @@ static int ll_statahead_interpret(struct ptlrpc_request *req,
 	RETURN(rc);
 }
 
+/*
+ * send async stat RPC for @minfo, or queue it to be sent in one batch RPC
+ * with the following entries by sa_batch_flush().
+ */
+static int sa_getattr(struct inode *dir, struct md_enqueue_info *minfo)
+{
+	struct ll_statahead_info *sai = ll_i2info(dir)->lli_sai;
+
+	if (sai->sai_batch_max == 0)
+		return md_intent_getattr_async(ll_i2mdexp(dir), minfo);
+
+	if (sai->sai_batch_count == 0)
+		sai->sai_batch_index = sai->sai_index;
+	sai->sai_batch[sai->sai_batch_count++] = minfo;
+	return 0;
+}
+
+/* send queued stat requests, their results come by ll_statahead_interpret() */
+static void sa_batch_flush(struct inode *dir, struct ll_statahead_info *sai)
+{
+	unsigned int count = sai->sai_batch_count;
+	unsigned int i;
+	int rc;
+
+	if (count == 0)
+		return;
+
+	sai->sai_batch_count = 0;
+	rc = md_intent_getattr_batch(ll_i2mdexp(dir), sai->sai_batch, count);
+	if (rc < 0) {
+		for (i = 0; i < count; i++)
+			sai->sai_batch[i]->mi_cb(NULL, sai->sai_batch[i], rc);
+	}
+}
+
 /* async stat for file not found in dcache */
 static int sa_lookup(struct inode *dir, struct sa_entry *entry)
 {
@@ -786,7 +857,7 @@ static int sa_lookup(struct inode *dir, struct sa_entry *entry)
 	if (IS_ERR(minfo))
 		RETURN(PTR_ERR(minfo));
 
-	rc = md_intent_getattr_async(ll_i2mdexp(dir), minfo);
+	rc = sa_getattr(dir, minfo);
 	if (rc < 0)
 		sa_fini_data(minfo);
 
@@ -830,7 +901,7 @@ static int sa_revalidate(struct inode *dir, struct sa_entry *entry,
 		RETURN(1);
 	}
 
-	rc = md_intent_getattr_async(ll_i2mdexp(dir), minfo);
+	rc = sa_getattr(dir, minfo);
 	if (rc < 0) {
 		entry->se_inode = NULL;
 		iput(inode);
@@ -979,47 +1050,105 @@ static void ll_start_agl(struct dentry *parent, struct ll_statahead_info *sai)
 }
 
 /* statahead thread main function */
-static int ll_statahead_thread(void *arg)
+/*
+ * wait for spare statahead window, and then stat @name ahead, the stat request
+ * may be queued to be sent in a batch.
+ */
+static void sa_statahead_next(struct dentry *parent,
+			      struct ll_statahead_info *sai,
+			      const char *name, int namelen,
+			      const struct lu_fid *fid)
 {
-	struct dentry *parent = (struct dentry *)arg;
 	struct inode *dir = parent->d_inode;
 	struct ll_inode_info *lli = ll_i2info(dir);
-	struct ll_sb_info *sbi = ll_i2sbi(dir);
-	struct ll_statahead_info *sai;
-	struct ptlrpc_thread *sa_thread;
-	struct ptlrpc_thread *agl_thread;
+	struct ptlrpc_thread *sa_thread = &sai->sai_thread;
+	struct l_wait_info lwi = { 0 };
+
+	if (sai->sai_mode == SA_MODE_FNAME)
+		lwi = LWI_TIMEOUT(cfs_time_seconds(1), NULL, NULL);
+
+	/* entries in the batch can't complete meanwhile */
+	if (sa_sent_full(sai))
+		sa_batch_flush(dir, sai);
+
+	/* wait for spare statahead window */
+	do {
+		l_wait_event(sa_thread->t_ctl_waitq,
+			     !sa_sent_full(sai) ||
+			     sa_has_callback(sai) ||
+			     !agl_list_empty(sai) ||
+			     !thread_is_running(sa_thread),
+			     &lwi);
+
+		sa_handle_callback(sai);
+
+		spin_lock(&lli->lli_agl_lock);
+		while (sa_sent_full(sai) &&
+		       !agl_list_empty(sai)) {
+			struct ll_inode_info *clli;
+
+			clli = agl_first_entry(sai);
+			list_del_init(&clli->lli_agl_list);
+			spin_unlock(&lli->lli_agl_lock);
+
+			ll_agl_trigger(&clli->lli_vfs_inode, sai);
+			cond_resched();
+			spin_lock(&lli->lli_agl_lock);
+		}
+		spin_unlock(&lli->lli_agl_lock);
+
+		if (sa_expired(sai)) {
+			spin_lock(&lli->lli_sa_lock);
+			thread_set_flags(sa_thread, SVC_STOPPING);
+			spin_unlock(&lli->lli_sa_lock);
+		}
+	} while (sa_sent_full(sai) &&
+		 thread_is_running(sa_thread));
+
+	sa_statahead(parent, name, namelen, fid);
+
+	/* don't keep the scanner waiting for a batched entry */
+	if (sai->sai_batch_count == sai->sai_batch_max ||
+	    (sai->sai_batch_count > 0 &&
+	     sai->sai_index_wait >= sai->sai_batch_index))
+		sa_batch_flush(dir, sai);
+}
+
+/* hit ratio is too low, statahead thread should quit */
+static int sa_low_hit_stop(struct ll_statahead_info *sai)
+{
+	struct ll_inode_info *lli = ll_i2info(sai->sai_dentry->d_inode);
+
+	atomic_inc(&ll_i2sbi(sai->sai_dentry->d_inode)->ll_sa_wrong);
+	CDEBUG(D_READA, "Statahead for dir "DFID" hit "
+	       "ratio too low: hit/miss %llu/%llu"
+	       ", sent/replied %llu/%llu, stopping "
+	       "statahead thread: pid %d\n",
+	       PFID(&lli->lli_fid), sai->sai_hit,
+	       sai->sai_miss, sai->sai_sent,
+	       sai->sai_replied, current_pid());
+
+	return -EFAULT;
+}
+
+/* stat ahead entries in readdir order, for "ls -l" */
+static int ll_statahead_by_readdir(struct dentry *parent,
+				   struct ll_statahead_info *sai)
+{
+	struct inode *dir = parent->d_inode;
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct ptlrpc_thread *sa_thread = &sai->sai_thread;
 	int first = 0;
 	struct md_op_data *op_data;
 	struct ll_dir_chain chain;
-	struct l_wait_info lwi = { 0 };
 	struct page *page = NULL;
 	__u64 pos = 0;
 	int rc = 0;
 	ENTRY;
 
-	sai = ll_sai_get(dir);
-	sa_thread = &sai->sai_thread;
-	agl_thread = &sai->sai_agl_thread;
-	sa_thread->t_pid = current_pid();
-	CDEBUG(D_READA, "statahead thread starting: sai %p, parent %.*s\n",
-	       sai, parent->d_name.len, parent->d_name.name);
-
 	OBD_ALLOC_PTR(op_data);
-	if (IS_ERR(op_data))
-		GOTO(out, rc = PTR_ERR(op_data));
-
-	if (sbi->ll_flags & LL_SBI_AGL_ENABLED)
-		ll_start_agl(parent, sai);
-
-	atomic_inc(&sbi->ll_sa_total);
-	spin_lock(&lli->lli_sa_lock);
-	if (thread_is_init(sa_thread))
-		/* If someone else has changed the thread state
-		 * (e.g. already changed to SVC_STOPPING), we can't just
-		 * blindly overwrite that setting. */
-		thread_set_flags(sa_thread, SVC_RUNNING);
-	spin_unlock(&lli->lli_sa_lock);
-	wake_up(&sa_thread->t_ctl_waitq);
+	if (op_data == NULL)
+		RETURN(-ENOMEM);
 
 	ll_dir_chain_init(&chain);
 	while (pos != MDS_DIR_END_OFF && thread_is_running(sa_thread)) {
@@ -1033,6 +1162,7 @@ static int ll_statahead_thread(void *arg)
 			break;
 		}
 
+		sa_batch_flush(dir, sai);
 		sai->sai_in_readpage = 1;
 		page = ll_get_dir_page(dir, op_data, pos, &chain);
 		ll_unlock_md_op_lsm(op_data);
@@ -1098,37 +1228,7 @@ static int ll_statahead_thread(void *arg)
 				continue;
 
 			fid_le_to_cpu(&fid, &ent->lde_fid);
-
-			/* wait for spare statahead window */
-			do {
-				l_wait_event(sa_thread->t_ctl_waitq,
-					     !sa_sent_full(sai) ||
-					     sa_has_callback(sai) ||
-					     !agl_list_empty(sai) ||
-					     !thread_is_running(sa_thread),
-					     &lwi);
-
-				sa_handle_callback(sai);
-
-				spin_lock(&lli->lli_agl_lock);
-				while (sa_sent_full(sai) &&
-				       !agl_list_empty(sai)) {
-					struct ll_inode_info *clli;
-
-					clli = agl_first_entry(sai);
-					list_del_init(&clli->lli_agl_list);
-					spin_unlock(&lli->lli_agl_lock);
-
-					ll_agl_trigger(&clli->lli_vfs_inode,
-							sai);
-					cond_resched();
-					spin_lock(&lli->lli_agl_lock);
-				}
-				spin_unlock(&lli->lli_agl_lock);
-			} while (sa_sent_full(sai) &&
-				 thread_is_running(sa_thread));
-
-			sa_statahead(parent, name, namelen, &fid);
+			sa_statahead_next(parent, sai, name, namelen, &fid);
 		}
 
 		pos = le64_to_cpu(dp->ldp_hash_end);
@@ -1136,41 +1236,186 @@ static int ll_statahead_thread(void *arg)
 				le32_to_cpu(dp->ldp_flags) & LDF_COLLIDE);
 
 		if (sa_low_hit(sai)) {
-			rc = -EFAULT;
-			atomic_inc(&sbi->ll_sa_wrong);
-			CDEBUG(D_READA, "Statahead for dir "DFID" hit "
-			       "ratio too low: hit/miss %llu/%llu"
-			       ", sent/replied %llu/%llu, stopping "
-			       "statahead thread: pid %d\n",
-			       PFID(&lli->lli_fid), sai->sai_hit,
-			       sai->sai_miss, sai->sai_sent,
-			       sai->sai_replied, current_pid());
+			rc = sa_low_hit_stop(sai);
 			break;
 		}
 	}
 	ll_dir_chain_fini(&chain);
 	ll_finish_md_op_data(op_data);
 
+	RETURN(rc);
+}
+
+/* stat ahead names following the one which started statahead by pattern */
+static int ll_statahead_by_fname(struct dentry *parent,
+				 struct ll_statahead_info *sai)
+{
+	struct ptlrpc_thread *sa_thread = &sai->sai_thread;
+	struct lu_fid fid;
+	char name[NAME_MAX + 1];
+	int namelen;
+	ENTRY;
+
+	/* FID is unknown, the name is looked up on MDT */
+	fid_zero(&fid);
+	while (thread_is_running(sa_thread) && !sa_low_hit(sai)) {
+		namelen = snprintf(name, sizeof(name), "%.*s%0*llu%s",
+				   (int)sai->sai_fname_start, sai->sai_fname,
+				   (int)sai->sai_fname_width,
+				   (unsigned long long)sai->sai_fname_index,
+				   sai->sai_fname + sai->sai_fname_end);
+		if (namelen > NAME_MAX)
+			break;
+
+		sai->sai_fname_index++;
+		sa_statahead_next(parent, sai, name, namelen, &fid);
+	}
+
+	if (sa_low_hit(sai))
+		RETURN(sa_low_hit_stop(sai));
+
+	RETURN(0);
+}
+
+/* stat ahead names from LL_IOC_STATAHEAD, and wait for more until dir close */
+static int ll_statahead_by_list(struct dentry *parent,
+				struct ll_statahead_info *sai)
+{
+	struct inode *dir = parent->d_inode;
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct ptlrpc_thread *sa_thread = &sai->sai_thread;
+	struct l_wait_info lwi = { 0 };
+	struct sa_name_list *snl;
+	struct lu_fid fid;
+	char *name;
+	int namelen;
+	ENTRY;
+
+	fid_zero(&fid);
+	while (thread_is_running(sa_thread)) {
+		snl = NULL;
+		spin_lock(&lli->lli_sa_lock);
+		if (!list_empty(&sai->sai_name_lists)) {
+			snl = list_entry(sai->sai_name_lists.next,
+					 struct sa_name_list, snl_list);
+			list_del_init(&snl->snl_list);
+		}
+		spin_unlock(&lli->lli_sa_lock);
+
+		if (snl == NULL) {
+			sa_batch_flush(dir, sai);
+			l_wait_event(sa_thread->t_ctl_waitq,
+				     !list_empty(&sai->sai_name_lists) ||
+				     sa_has_callback(sai) ||
+				     !thread_is_running(sa_thread),
+				     &lwi);
+			sa_handle_callback(sai);
+			continue;
+		}
+
+		for (name = snl->snl_names;
+		     name < snl->snl_names + snl->snl_size &&
+		     thread_is_running(sa_thread) && !sa_low_hit(sai);
+		     name += namelen + 1) {
+			namelen = strlen(name);
+			sa_statahead_next(parent, sai, name, namelen, &fid);
+		}
+		OBD_FREE_LARGE(snl, SNL_ALLOC_SIZE(snl->snl_size));
+
+		if (sa_low_hit(sai))
+			RETURN(sa_low_hit_stop(sai));
+	}
+
+	RETURN(0);
+}
+
+static int ll_statahead_thread(void *arg)
+{
+	struct dentry *parent = (struct dentry *)arg;
+	struct inode *dir = parent->d_inode;
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	struct ll_statahead_info *sai;
+	struct ptlrpc_thread *sa_thread;
+	struct ptlrpc_thread *agl_thread;
+	struct l_wait_info lwi = { 0 };
+	int rc = 0;
+	ENTRY;
+
+	sai = ll_sai_get(dir);
+	sa_thread = &sai->sai_thread;
+	agl_thread = &sai->sai_agl_thread;
+	sa_thread->t_pid = current_pid();
+	CDEBUG(D_READA, "statahead thread starting: sai %p, parent %.*s\n",
+	       sai, parent->d_name.len, parent->d_name.name);
+
+	if (sbi->ll_flags & LL_SBI_AGL_ENABLED)
+		ll_start_agl(parent, sai);
+
+	/* batching is used only if the MDT supports it, but this is decided
+	 * by MDC for each batch, see mdc_intent_getattr_batch() */
+	sai->sai_batch_max = sbi->ll_sa_batch_max;
+	if (sai->sai_batch_max > 0) {
+		OBD_ALLOC(sai->sai_batch,
+			  sai->sai_batch_max * sizeof(*sai->sai_batch));
+		if (sai->sai_batch == NULL)
+			sai->sai_batch_max = 0;
+	}
+
+	atomic_inc(&sbi->ll_sa_total);
+	spin_lock(&lli->lli_sa_lock);
+	if (thread_is_init(sa_thread))
+		/* If someone else has changed the thread state
+		 * (e.g. already changed to SVC_STOPPING), we can't just
+		 * blindly overwrite that setting. */
+		thread_set_flags(sa_thread, SVC_RUNNING);
+	spin_unlock(&lli->lli_sa_lock);
+	wake_up(&sa_thread->t_ctl_waitq);
+
+	switch (sai->sai_mode) {
+	case SA_MODE_READDIR:
+		rc = ll_statahead_by_readdir(parent, sai);
+		break;
+	case SA_MODE_FNAME:
+		rc = ll_statahead_by_fname(parent, sai);
+		break;
+	case SA_MODE_LIST:
+		rc = ll_statahead_by_list(parent, sai);
+		break;
+	}
+	sa_batch_flush(dir, sai);
+
 	if (rc < 0) {
 		spin_lock(&lli->lli_sa_lock);
 		thread_set_flags(sa_thread, SVC_STOPPING);
-		lli->lli_sa_enabled = 0;
+		if (sai->sai_mode != SA_MODE_FNAME)
+			lli->lli_sa_enabled = 0;
 		spin_unlock(&lli->lli_sa_lock);
 	}
 
 	/* statahead is finished, but statahead entries need to be cached, wait
-	 * for file release to stop me. */
+	 * for file release (or idle timeout if not bound to an opened dir) to
+	 * stop me. */
 	while (thread_is_running(sa_thread)) {
+		struct l_wait_info lwi_idle = { 0 };
+
+		if (sai->sai_mode == SA_MODE_FNAME)
+			lwi_idle = LWI_TIMEOUT(cfs_time_seconds(1), NULL, NULL);
 		l_wait_event(sa_thread->t_ctl_waitq,
 			     sa_has_callback(sai) ||
 			     !thread_is_running(sa_thread),
-			     &lwi);
+			     &lwi_idle);
 
 		sa_handle_callback(sai);
-	}
 
+		if (sa_expired(sai)) {
+			spin_lock(&lli->lli_sa_lock);
+			thread_set_flags(sa_thread, SVC_STOPPING);
+			spin_unlock(&lli->lli_sa_lock);
+		}
+	}
 	EXIT;
-out:
+
 	if (sai->sai_agl_valid) {
 		spin_lock(&lli->lli_agl_lock);
 		thread_set_flags(agl_thread, SVC_STOPPING);
@@ -1200,6 +1445,11 @@ out:
 	/* release resources held by statahead RPCs */
 	sa_handle_callback(sai);
 
+	if (sai->sai_batch != NULL)
+		OBD_FREE(sai->sai_batch,
+			 sai->sai_batch_max * sizeof(*sai->sai_batch));
+	sai->sai_batch = NULL;
+
 	spin_lock(&lli->lli_sa_lock);
 	thread_set_flags(sa_thread, SVC_STOPPED);
 	spin_unlock(&lli->lli_sa_lock);
@@ -1426,6 +1676,7 @@ static int revalidate_statahead_dentry(struct inode *dir,
 	int rc = 0;
 	ENTRY;
 
+	sai->sai_access = jiffies;
 	if ((*dentryp)->d_name.name[0] == '.') {
 		if (sai->sai_ls_all ||
 		    sai->sai_miss_hidden >= sai->sai_skip_hidden) {
@@ -1546,6 +1797,179 @@ out:
 	RETURN(rc);
 }
 
+/**
+ * install @sai for @dir and start its statahead thread
+ *
+ * \param[in] dir	parent directory
+ * \param[in] sai	sai to start, the caller's refcount is dropped on
+ *			success, and the caller should free it on failure
+ * \param[in] key	opened dir handle for SA_MODE_LIST
+ * \retval		0 on success
+ * \retval		negative number upon error
+ */
+static int sa_start_thread(struct inode *dir, struct ll_statahead_info *sai,
+			   void *key)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct dentry *parent = sai->sai_dentry;
+	struct ptlrpc_thread *thread = &sai->sai_thread;
+	struct l_wait_info lwi = { 0 };
+	struct task_struct *task;
+	bool allowed = false;
+	int rc;
+
+	/* if current lli_opendir_key was deauthorized, or dir re-opened by
+	 * another process, don't start statahead, otherwise the newly spawned
+	 * statahead thread won't be notified to quit. */
+	spin_lock(&lli->lli_sa_lock);
+	switch (sai->sai_mode) {
+	case SA_MODE_READDIR:
+		allowed = lli->lli_opendir_key != NULL &&
+			  lli->lli_opendir_pid == current->pid;
+		break;
+	case SA_MODE_FNAME:
+		allowed = lli->lli_opendir_key == NULL &&
+			  lli->lli_sa_pattern_pid == current->pid;
+		break;
+	case SA_MODE_LIST:
+		allowed = lli->lli_opendir_key == key;
+		break;
+	}
+	if (unlikely(lli->lli_sai != NULL || !allowed)) {
+		spin_unlock(&lli->lli_sa_lock);
+		return -EPERM;
+	}
+	if (sai->sai_mode == SA_MODE_LIST) {
+		/* the caller of LL_IOC_STATAHEAD is the scanner */
+		lli->lli_opendir_pid = current->pid;
+		lli->lli_sa_enabled = 1;
+	}
+	lli->lli_sai = sai;
+	spin_unlock(&lli->lli_sa_lock);
+
+	CDEBUG(D_READA, "start statahead thread: [pid %d] [parent %.*s] "
+	       "[mode %d]\n", current_pid(), parent->d_name.len,
+	       parent->d_name.name, sai->sai_mode);
+
+	task = kthread_run(ll_statahead_thread, parent, "ll_sa_%u",
+			   current->pid);
+	if (IS_ERR(task)) {
+		spin_lock(&lli->lli_sa_lock);
+		lli->lli_sai = NULL;
+		spin_unlock(&lli->lli_sa_lock);
+		rc = PTR_ERR(task);
+		CERROR("can't start ll_sa thread, rc: %d\n", rc);
+		return rc;
+	}
+
+	l_wait_event(thread->t_ctl_waitq,
+		     thread_is_running(thread) || thread_is_stopped(thread),
+		     &lwi);
+	ll_sai_put(sai);
+
+	return 0;
+}
+
+/**
+ * start statahead by filename pattern
+ *
+ * Tools which stat files by name in numeric order, e.g. "file.0001",
+ * "file.0002"... don't open the dir, so readdir statahead can't help them.
+ * If the current process stats LL_SA_FNAME_MATCH names in a row which differ
+ * only in the last number, which increases by one each time, start statahead
+ * for the names following @dentry.
+ *
+ * \param[in] dir	parent directory
+ * \param[in] dentry	dentry being stat'ed
+ * \retval		-EAGAIN if statahead started, or it's not a sequence,
+ *			either way the caller should stat @dentry itself
+ * \retval		negative number upon error
+ */
+static int start_statahead_fname(struct inode *dir, struct dentry *dentry)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	struct ll_statahead_info *sai = NULL;
+	const char *name = dentry->d_name.name;
+	unsigned int len = dentry->d_name.len;
+	unsigned int start;
+	unsigned int end;
+	unsigned int i;
+	__u64 index = 0;
+	__u32 hash = 0;
+	bool matched;
+	int rc;
+	ENTRY;
+
+	/* find the last number in name, and hash the rest */
+	for (end = len; end > 0 && !isdigit(name[end - 1]); end--)
+		;
+	for (start = end; start > 0 && isdigit(name[start - 1]); start--)
+		;
+	for (i = start; i < end; i++)
+		index = index * 10 + name[i] - '0';
+	for (i = 0; i < len; i++)
+		if (i < start || i >= end)
+			hash = hash * 31 + name[i];
+
+	spin_lock(&lli->lli_sa_lock);
+	if (start < end && end - start < 19 &&
+	    lli->lli_sa_pattern_pid == current->pid &&
+	    lli->lli_sa_fname_hash == hash &&
+	    lli->lli_sa_fname_index + 1 == index) {
+		lli->lli_sa_match_count++;
+	} else {
+		lli->lli_sa_pattern_pid = current->pid;
+		lli->lli_sa_match_count = 0;
+	}
+	lli->lli_sa_fname_hash = hash;
+	lli->lli_sa_fname_index = index;
+	matched = lli->lli_sa_match_count >= LL_SA_FNAME_MATCH &&
+		  lli->lli_sai == NULL && lli->lli_opendir_key == NULL;
+	if (matched)
+		lli->lli_sa_match_count = 0;
+	spin_unlock(&lli->lli_sa_lock);
+
+	if (!matched)
+		RETURN(-EAGAIN);
+
+	if (unlikely(atomic_inc_return(&sbi->ll_sa_running) >
+				       sbi->ll_sa_running_max)) {
+		CDEBUG(D_READA,
+		       "Too many concurrent statahead instances, "
+		       "avoid new statahead instance temporarily.\n");
+		GOTO(out, rc = -EMFILE);
+	}
+
+	sai = ll_sai_alloc(dentry->d_parent);
+	if (sai == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	sai->sai_mode = SA_MODE_FNAME;
+	sai->sai_ls_all = 1;
+	memcpy(sai->sai_fname, name, len);
+	sai->sai_fname[len] = '\0';
+	sai->sai_fname_start = start;
+	sai->sai_fname_end = end;
+	/* keep leading zeros, "file.0099" is followed by "file.0100" */
+	sai->sai_fname_width = name[start] == '0' ? end - start : 0;
+	sai->sai_fname_index = index + 1;
+
+	rc = sa_start_thread(dir, sai, NULL);
+	if (rc)
+		GOTO(out, rc);
+
+	atomic_inc(&sbi->ll_sa_fname_total);
+	RETURN(-EAGAIN);
+
+out:
+	if (sai != NULL)
+		ll_sai_free(sai);
+	atomic_dec(&sbi->ll_sa_running);
+
+	RETURN(rc);
+}
+
 /**
  * start statahead thread
  *
@@ -1563,9 +1987,6 @@ static int start_statahead_thread(struct inode *dir, struct dentry *dentry)
 	struct ll_inode_info *lli = ll_i2info(dir);
 	struct ll_statahead_info *sai = NULL;
 	struct dentry *parent = dentry->d_parent;
-	struct ptlrpc_thread *thread;
-	struct l_wait_info lwi = { 0 };
-	struct task_struct *task;
 	struct ll_sb_info *sbi = ll_i2sbi(parent->d_inode);
 	int first = LS_FIRST_DE;
 	int rc = 0;
@@ -1591,38 +2012,9 @@ static int start_statahead_thread(struct inode *dir, struct dentry *dentry)
 
 	sai->sai_ls_all = (first == LS_FIRST_DOT_DE);
 
-	/* if current lli_opendir_key was deauthorized, or dir re-opened by
-	 * another process, don't start statahead, otherwise the newly spawned
-	 * statahead thread won't be notified to quit. */
-	spin_lock(&lli->lli_sa_lock);
-	if (unlikely(lli->lli_sai != NULL ||
-		     lli->lli_opendir_key == NULL ||
-		     lli->lli_opendir_pid != current->pid)) {
-		spin_unlock(&lli->lli_sa_lock);
-		GOTO(out, rc = -EPERM);
-	}
-	lli->lli_sai = sai;
-	spin_unlock(&lli->lli_sa_lock);
-
-	CDEBUG(D_READA, "start statahead thread: [pid %d] [parent %.*s]\n",
-	       current_pid(), parent->d_name.len, parent->d_name.name);
-
-	task = kthread_run(ll_statahead_thread, parent, "ll_sa_%u",
-			   lli->lli_opendir_pid);
-	thread = &sai->sai_thread;
-	if (IS_ERR(task)) {
-		spin_lock(&lli->lli_sa_lock);
-		lli->lli_sai = NULL;
-		spin_unlock(&lli->lli_sa_lock);
-		rc = PTR_ERR(task);
-		CERROR("can't start ll_sa thread, rc: %d\n", rc);
+	rc = sa_start_thread(dir, sai, NULL);
+	if (rc)
 		GOTO(out, rc);
-	}
-
-	l_wait_event(thread->t_ctl_waitq,
-		     thread_is_running(thread) || thread_is_stopped(thread),
-		     &lwi);
-	ll_sai_put(sai);
 
 	/*
 	 * We don't stat-ahead for the first dirent since we are already in
@@ -1646,10 +2038,125 @@ out:
 	RETURN(rc);
 }
 
+/**
+ * stat ahead names given by LL_IOC_STATAHEAD on an opened dir, in the order
+ * they will be stat'ed by the caller. The names are appended to the running
+ * statahead by name list, or start one if statahead is not running yet.
+ *
+ * \param[in] file	opened dir
+ * \param[in] uarg	names from userspace
+ * \retval		0 on success
+ * \retval		-EBUSY if another statahead is running for the dir
+ * \retval		negative number upon other errors
+ */
+int ll_ioctl_statahead(struct file *file,
+		       struct ll_statahead_names __user *uarg)
+{
+	struct inode *dir = file_inode(file);
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	struct ll_file_data *fd = LUSTRE_FPRIVATE(file);
+	struct ll_statahead_names lsn;
+	struct ll_statahead_info *sai = NULL;
+	struct sa_name_list *snl;
+	char *name;
+	__u32 count = 0;
+	int rc = 0;
+	ENTRY;
+
+	if (sbi->ll_sa_max == 0)
+		RETURN(-EOPNOTSUPP);
+
+	if (copy_from_user(&lsn, uarg, sizeof(lsn)))
+		RETURN(-EFAULT);
+
+	if (lsn.lsn_magic != LL_STATAHEAD_MAGIC || lsn.lsn_count == 0 ||
+	    lsn.lsn_size == 0)
+		RETURN(-EINVAL);
+
+	if (lsn.lsn_size > LL_STATAHEAD_SIZE_MAX)
+		RETURN(-EFBIG);
+
+	OBD_ALLOC_LARGE(snl, SNL_ALLOC_SIZE(lsn.lsn_size));
+	if (snl == NULL)
+		RETURN(-ENOMEM);
+
+	INIT_LIST_HEAD(&snl->snl_list);
+	snl->snl_size = lsn.lsn_size;
+	if (copy_from_user(snl->snl_names, uarg->lsn_names, lsn.lsn_size))
+		GOTO(out, rc = -EFAULT);
+
+	if (snl->snl_names[lsn.lsn_size - 1] != '\0')
+		GOTO(out, rc = -EINVAL);
+
+	for (name = snl->snl_names; name < snl->snl_names + lsn.lsn_size;
+	     name += strlen(name) + 1) {
+		if (name[0] == '\0' || strlen(name) > NAME_MAX ||
+		    strchr(name, '/') != NULL)
+			GOTO(out, rc = -EINVAL);
+		count++;
+	}
+	if (count != lsn.lsn_count)
+		GOTO(out, rc = -EINVAL);
+
+	spin_lock(&lli->lli_sa_lock);
+	sai = lli->lli_sai;
+	if (sai != NULL) {
+		if (sai->sai_mode == SA_MODE_LIST &&
+		    lli->lli_opendir_key == fd &&
+		    thread_is_running(&sai->sai_thread)) {
+			list_add_tail(&snl->snl_list, &sai->sai_name_lists);
+			snl = NULL;
+			wake_up(&sai->sai_thread.t_ctl_waitq);
+		} else {
+			rc = -EBUSY;
+		}
+		spin_unlock(&lli->lli_sa_lock);
+		GOTO(out, rc);
+	}
+	spin_unlock(&lli->lli_sa_lock);
+
+	if (unlikely(atomic_inc_return(&sbi->ll_sa_running) >
+				       sbi->ll_sa_running_max)) {
+		atomic_dec(&sbi->ll_sa_running);
+		GOTO(out, rc = -EMFILE);
+	}
+
+	sai = ll_sai_alloc(file_dentry(file));
+	if (sai == NULL) {
+		atomic_dec(&sbi->ll_sa_running);
+		GOTO(out, rc = -ENOMEM);
+	}
+
+	sai->sai_mode = SA_MODE_LIST;
+	sai->sai_ls_all = 1;
+	list_add_tail(&snl->snl_list, &sai->sai_name_lists);
+	snl = NULL;
+
+	rc = sa_start_thread(dir, sai, fd);
+	if (rc) {
+		/* the dir is not opened by @file for statahead */
+		if (rc == -EPERM)
+			rc = -EBUSY;
+		ll_sai_free(sai);
+		atomic_dec(&sbi->ll_sa_running);
+		GOTO(out, rc);
+	}
+
+	atomic_inc(&sbi->ll_sa_list_total);
+	EXIT;
+out:
+	if (snl != NULL)
+		OBD_FREE_LARGE(snl, SNL_ALLOC_SIZE(snl->snl_size));
+
+	return rc;
+}
+
 /**
  * statahead entry function, this is called when client getattr on a file, it
- * will start statahead thread if this is the first dir entry, else revalidate
- * dentry from statahead cache.
+ * will start statahead thread if this is the first dir entry, or the name
+ * continues a number sequence if dir is not opened, else revalidate dentry
+ * from statahead cache.
  *
  * \param[in]  dir	parent directory
  * \param[out] dentryp	dentry to getattr
@@ -1663,17 +2170,29 @@ out:
  */
 int ll_statahead(struct inode *dir, struct dentry **dentryp, bool unplug)
 {
+	struct ll_inode_info *lli = ll_i2info(dir);
 	struct ll_statahead_info *sai;
 
 	sai = ll_sai_get(dir);
 	if (sai != NULL) {
 		int rc;
 
-		rc = revalidate_statahead_dentry(dir, sai, dentryp, unplug);
+		/* only the process which started statahead by filename
+		 * pattern is the scanner */
+		if (sai->sai_mode == SA_MODE_FNAME &&
+		    lli->lli_sa_pattern_pid != current_pid())
+			rc = -EAGAIN;
+		else
+			rc = revalidate_statahead_dentry(dir, sai, dentryp,
+							 unplug);
 		CDEBUG(D_READA, "revalidate statahead %.*s: %d.\n",
 			(*dentryp)->d_name.len, (*dentryp)->d_name.name, rc);
 		ll_sai_put(sai);
 		return rc;
 	}
+
+	if (!lli->lli_sa_enabled)
+		return start_statahead_fname(dir, *dentryp);
+
 	return start_statahead_thread(dir, *dentryp);
 }
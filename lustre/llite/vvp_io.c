@@ -783,6 +783,10 @@ static int vvp_io_read_start(const struct lu_env *env,
 	if (!can_populate_pages(env, io, inode))
 		RETURN(0);
 
+	/* pages are read ahead by the caller, see ll_readahead_handle_work() */
+	if (io->ci_async_readahead)
+		RETURN(0);
+
 	/* Unless this is reading a sparse file, otherwise the lock has already
 	 * been acquired so vvp_prep_size() is an empty op. */
 	result = vvp_prep_size(env, obj, io, pos, cnt, &exceed);
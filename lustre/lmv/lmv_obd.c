@@ -3381,7 +3381,8 @@ int lmv_intent_getattr_async(struct obd_export *exp,
 	int rc;
 	ENTRY;
 
-	if (!fid_is_sane(&op_data->op_fid2))
+	/* FID is unknown for names not from readdir, see SA_MODE_FNAME */
+	if (!fid_is_zero(&op_data->op_fid2) && !fid_is_sane(&op_data->op_fid2))
 		RETURN(-EINVAL);
 
 	tgt = lmv_find_target(lmv, &op_data->op_fid1);
@@ -3401,6 +3402,246 @@ int lmv_intent_getattr_async(struct obd_export *exp,
 	RETURN(rc);
 }
 
+int lmv_intent_getattr_batch(struct obd_export *exp,
+			     struct md_enqueue_info **minfo, int count)
+{
+	struct lmv_obd *lmv = &exp->exp_obd->u.lmv;
+	struct lmv_tgt_desc *tgt = NULL;
+	struct lmv_tgt_desc *cur;
+	int first = 0;
+	int i;
+	ENTRY;
+
+	/* entries of one directory are mostly on the same MDT, so forward
+	 * each run of entries going to the same MDT as one batch */
+	for (i = 0; i < count; i++) {
+		struct md_op_data *op_data = &minfo[i]->mi_data;
+
+		if (!fid_is_zero(&op_data->op_fid2) &&
+		    !fid_is_sane(&op_data->op_fid2))
+			cur = ERR_PTR(-EINVAL);
+		else
+			cur = lmv_find_target(lmv, &op_data->op_fid1);
+
+		if (tgt != NULL && cur != tgt) {
+			md_intent_getattr_batch(tgt->ltd_exp, minfo + first,
+						i - first);
+			tgt = NULL;
+		}
+
+		if (IS_ERR(cur)) {
+			minfo[i]->mi_cb(NULL, minfo[i], PTR_ERR(cur));
+			continue;
+		}
+
+		if (tgt == NULL) {
+			tgt = cur;
+			first = i;
+		}
+	}
+
+	if (tgt != NULL)
+		md_intent_getattr_batch(tgt->ltd_exp, minfo + first,
+					count - first);
+	RETURN(0);
+}
+
+/* a single reint of lmv_batch_reint(), used when it can't be batched */
+static int lmv_batch_reint_one(struct obd_export *exp,
+			       struct md_batch_item *item)
+{
+	struct md_op_data *op_data = item->mbi_op_data;
+	struct ptlrpc_request *req = NULL;
+	int rc;
+
+	switch (item->mbi_opc) {
+	case REINT_CREATE:
+		rc = lmv_create(exp, op_data, NULL, 0, item->mbi_mode,
+				item->mbi_uid, item->mbi_gid, op_data->op_cap,
+				0, &req);
+		break;
+	case REINT_SETATTR:
+		rc = lmv_setattr(exp, op_data, NULL, 0, &req);
+		break;
+	case REINT_UNLINK:
+		rc = lmv_unlink(exp, op_data, &req);
+		break;
+	default:
+		rc = -EOPNOTSUPP;
+		break;
+	}
+	ptlrpc_req_finished(req);
+
+	return rc;
+}
+
+/*
+ * Find the MDT \a item can be sent to as part of a batch, or NULL if it has
+ * to go through the regular path, e.g. because it involves several MDTs.
+ */
+static struct lmv_tgt_desc *lmv_batch_reint_tgt(struct obd_export *exp,
+						struct md_batch_item *item)
+{
+	struct lmv_obd *lmv = &exp->exp_obd->u.lmv;
+	struct md_op_data *op_data = item->mbi_op_data;
+	struct lmv_tgt_desc *parent_tgt;
+	struct lmv_tgt_desc *tgt;
+	int rc;
+
+	switch (item->mbi_opc) {
+	case REINT_CREATE:
+		if (lmv_dir_bad_hash(op_data->op_mea1) ||
+		    lmv_dir_migrating(op_data->op_mea1))
+			return NULL;
+
+		tgt = lmv_locate_tgt(lmv, op_data);
+		if (IS_ERR(tgt))
+			return NULL;
+
+		rc = lmv_fid_alloc(NULL, exp, &op_data->op_fid2, op_data);
+		if (rc)
+			return NULL;
+
+		if (exp_connect_flags(exp) & OBD_CONNECT_DIR_STRIPE) {
+			tgt = lmv_find_target(lmv, &op_data->op_fid2);
+			if (IS_ERR(tgt))
+				return NULL;
+			op_data->op_mds = tgt->ltd_index;
+		}
+		op_data->op_flags |= MF_MDC_CANCEL_FID1;
+		return tgt;
+	case REINT_SETATTR:
+		tgt = lmv_find_target(lmv, &op_data->op_fid1);
+		if (IS_ERR(tgt))
+			return NULL;
+		op_data->op_flags |= MF_MDC_CANCEL_FID1;
+		return tgt;
+	case REINT_UNLINK:
+		op_data->op_fsuid = from_kuid(&init_user_ns, current_fsuid());
+		op_data->op_fsgid = from_kgid(&init_user_ns, current_fsgid());
+		op_data->op_cap = cfs_curproc_cap_pack();
+
+		parent_tgt = lmv_locate_tgt(lmv, op_data);
+		if (IS_ERR(parent_tgt))
+			return NULL;
+
+		tgt = parent_tgt;
+		if (!fid_is_zero(&op_data->op_fid2))
+			tgt = lmv_find_target(lmv, &op_data->op_fid2);
+		if (tgt != parent_tgt)
+			return NULL;
+
+		op_data->op_flags |= MF_MDC_CANCEL_FID1 | MF_MDC_CANCEL_FID3;
+		rc = lmv_early_cancel(exp, NULL, op_data, tgt->ltd_index,
+				      LCK_EX, MDS_INODELOCK_ELC,
+				      MF_MDC_CANCEL_FID3);
+		if (rc)
+			return NULL;
+		return tgt;
+	default:
+		return NULL;
+	}
+}
+
+/* fid of the file \a item creates, changes or removes, if known */
+static const struct lu_fid *lmv_batch_item_fid(struct md_batch_item *item)
+{
+	struct md_op_data *op_data = item->mbi_op_data;
+	const struct lu_fid *fid;
+
+	fid = item->mbi_opc == REINT_SETATTR ? &op_data->op_fid1 :
+					       &op_data->op_fid2;
+
+	return fid_is_zero(fid) ? NULL : fid;
+}
+
+/*
+ * Check whether \a a and \a b lock the same file or the same name in a
+ * directory, the MDT would then keep the locks of the first one until the
+ * batch reply is sent, and block the second one on them.
+ */
+static bool lmv_batch_items_conflict(struct md_batch_item *a,
+				     struct md_batch_item *b)
+{
+	struct md_op_data *opa = a->mbi_op_data;
+	struct md_op_data *opb = b->mbi_op_data;
+	const struct lu_fid *fida = lmv_batch_item_fid(a);
+	const struct lu_fid *fidb = lmv_batch_item_fid(b);
+
+	if (fida != NULL && fidb != NULL && lu_fid_eq(fida, fidb))
+		return true;
+
+	if ((a->mbi_opc == REINT_SETATTR && b->mbi_opc == REINT_SETATTR) ||
+	    !lu_fid_eq(&opa->op_fid1, &opb->op_fid1))
+		return false;
+
+	/* a setattr of the directory the other one creates or unlinks in */
+	if (a->mbi_opc == REINT_SETATTR || b->mbi_opc == REINT_SETATTR)
+		return true;
+
+	return opa->op_namelen == opb->op_namelen &&
+	       memcmp(opa->op_name, opb->op_name, opa->op_namelen) == 0;
+}
+
+static int lmv_batch_reint(struct obd_export *exp, struct md_batch_item *items,
+			   int count)
+{
+	struct lmv_tgt_desc **tgts;
+	struct lmv_tgt_desc *tgt;
+	int first;
+	int i;
+	int j;
+	ENTRY;
+
+	OBD_ALLOC(tgts, count * sizeof(*tgts));
+	if (tgts == NULL) {
+		for (i = 0; i < count; i++)
+			items[i].mbi_result = lmv_batch_reint_one(exp,
+								  &items[i]);
+		RETURN(0);
+	}
+
+	for (i = 0; i < count; i++)
+		tgts[i] = lmv_batch_reint_tgt(exp, &items[i]);
+
+	/* forward each run of items going to the same MDT as one batch, and
+	 * not touching a file or name twice */
+	for (first = 0; first < count; first = i) {
+		tgt = tgts[first];
+		if (tgt == NULL) {
+			items[first].mbi_result =
+				lmv_batch_reint_one(exp, &items[first]);
+			i = first + 1;
+			continue;
+		}
+
+		for (i = first + 1; i < count && tgts[i] == tgt; i++) {
+			for (j = first; j < i; j++)
+				if (lmv_batch_items_conflict(&items[j],
+							     &items[i]))
+					break;
+			if (j < i)
+				break;
+		}
+		md_batch_reint(tgt->ltd_exp, items + first, i - first);
+	}
+
+	/* the name was found on another MDT or stripe in the meantime, the
+	 * regular path knows how to chase it */
+	for (i = 0; i < count; i++) {
+		if (tgts[i] == NULL || items[i].mbi_opc != REINT_UNLINK)
+			continue;
+		if (items[i].mbi_result == -EREMOTE ||
+		    (items[i].mbi_result == -ENOENT &&
+		     lmv_dir_retry_check_update(items[i].mbi_op_data)))
+			items[i].mbi_result = lmv_batch_reint_one(exp,
+								  &items[i]);
+	}
+
+	OBD_FREE(tgts, count * sizeof(*tgts));
+	RETURN(0);
+}
+
 int lmv_revalidate_lock(struct obd_export *exp, struct lookup_intent *it,
                         struct lu_fid *fid, __u64 *bits)
 {
@@ -3583,6 +3824,8 @@ struct md_ops lmv_md_ops = {
         .m_set_open_replay_data = lmv_set_open_replay_data,
         .m_clear_open_replay_data = lmv_clear_open_replay_data,
         .m_intent_getattr_async = lmv_intent_getattr_async,
+	.m_intent_getattr_batch = lmv_intent_getattr_batch,
+	.m_batch_reint		= lmv_batch_reint,
 	.m_revalidate_lock      = lmv_revalidate_lock,
 	.m_get_fid_from_lsm	= lmv_get_fid_from_lsm,
 	.m_unpackmd		= lmv_unpackmd,
@@ -1839,7 +1839,7 @@ static struct lu_device *lod_device_free(const struct lu_env *env,
 	ENTRY;
 
 	if (atomic_read(&lu->ld_ref) > 0 &&
-	    !cfs_hash_is_empty(lu->ld_site->ls_obj_hash)) {
+	    atomic_read(&lu->ld_site->ls_obj_hash.nelems)) {
 		LIBCFS_DEBUG_MSG_DATA_DECL(msgdata, D_ERROR, NULL);
 		lu_site_print(env, lu->ld_site, &msgdata, lu_cdebug_printer);
 	}
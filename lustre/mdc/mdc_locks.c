@@ -52,6 +52,17 @@ struct mdc_getattr_args {
 	struct md_enqueue_info		*ga_minfo;
 };
 
+struct mdc_batch_entry {
+	struct ptlrpc_request		*mbe_req;
+	struct md_enqueue_info		*mbe_minfo;
+};
+
+struct mdc_batch_getattr_args {
+	struct obd_export		*bga_exp;
+	struct mdc_batch_entry		*bga_entries;
+	int				 bga_count;
+};
+
 int it_open_error(int phase, struct lookup_intent *it)
 {
 	if (it_disposition(it, DISP_OPEN_LEASE)) {
@@ -1318,27 +1329,18 @@ int mdc_intent_lock(struct obd_export *exp, struct md_op_data *op_data,
         RETURN(rc);
 }
 
-static int mdc_intent_getattr_async_interpret(const struct lu_env *env,
-					      struct ptlrpc_request *req,
-					      void *args, int rc)
+/* complete an intent getattr enqueue, \a rc is the RPC status */
+static void mdc_intent_getattr_finish(struct obd_export *exp,
+				      struct ptlrpc_request *req,
+				      struct md_enqueue_info *minfo, int rc)
 {
-	struct mdc_getattr_args  *ga = args;
-	struct obd_export *exp = ga->ga_exp;
-	struct md_enqueue_info *minfo = ga->ga_minfo;
 	struct ldlm_enqueue_info *einfo = &minfo->mi_einfo;
-	struct lookup_intent *it;
-	struct lustre_handle *lockh;
-	struct obd_device *obddev;
+	struct lookup_intent *it = &minfo->mi_it;
+	struct lustre_handle *lockh = &minfo->mi_lockh;
 	struct ldlm_reply *lockrep;
 	__u64 flags = LDLM_FL_HAS_INTENT;
 	ENTRY;
 
-        it    = &minfo->mi_it;
-        lockh = &minfo->mi_lockh;
-
-        obddev = class_exp2obd(exp);
-
-	obd_put_request_slot(&obddev->u.cli);
         if (OBD_FAIL_CHECK(OBD_FAIL_MDC_GETATTR_ENQUEUE))
                 rc = -ETIMEDOUT;
 
@@ -1365,17 +1367,31 @@ static int mdc_intent_getattr_async_interpret(const struct lu_env *env,
 
 out:
         minfo->mi_cb(req, minfo, rc);
-        return 0;
 }
 
-int mdc_intent_getattr_async(struct obd_export *exp,
-			     struct md_enqueue_info *minfo)
+static int mdc_intent_getattr_async_interpret(const struct lu_env *env,
+					      struct ptlrpc_request *req,
+					      void *args, int rc)
+{
+	struct mdc_getattr_args *ga = args;
+	struct obd_device *obddev = class_exp2obd(ga->ga_exp);
+
+	obd_put_request_slot(&obddev->u.cli);
+	mdc_intent_getattr_finish(ga->ga_exp, req, ga->ga_minfo, rc);
+	return 0;
+}
+
+/*
+ * Pack the intent getattr enqueue for \a minfo and create its client lock,
+ * the request is returned in \a reqp but not sent.
+ */
+static int mdc_intent_getattr_prep(struct obd_export *exp,
+				   struct md_enqueue_info *minfo,
+				   struct ptlrpc_request **reqp)
 {
 	struct md_op_data       *op_data = &minfo->mi_data;
 	struct lookup_intent    *it = &minfo->mi_it;
 	struct ptlrpc_request   *req;
-	struct mdc_getattr_args *ga;
-	struct obd_device       *obddev = class_exp2obd(exp);
 	struct ldlm_res_id       res_id;
 	union ldlm_policy_data policy = {
 				.l_inodebits = { MDS_INODELOCK_LOOKUP |
@@ -1396,12 +1412,6 @@ int mdc_intent_getattr_async(struct obd_export *exp,
 	if (IS_ERR(req))
 		RETURN(PTR_ERR(req));
 
-	rc = obd_get_request_slot(&obddev->u.cli);
-	if (rc != 0) {
-		ptlrpc_req_finished(req);
-		RETURN(rc);
-	}
-
 	/* With Data-on-MDT the glimpse callback is needed too.
 	 * It is set here in advance but not in mdc_finish_enqueue()
 	 * to avoid possible races. It is safe to have glimpse handler
@@ -1412,11 +1422,33 @@ int mdc_intent_getattr_async(struct obd_export *exp,
 	rc = ldlm_cli_enqueue(exp, &req, &minfo->mi_einfo, &res_id, &policy,
 			      &flags, NULL, 0, LVB_T_NONE, &minfo->mi_lockh, 1);
 	if (rc < 0) {
-		obd_put_request_slot(&obddev->u.cli);
 		ptlrpc_req_finished(req);
 		RETURN(rc);
 	}
 
+	*reqp = req;
+	RETURN(0);
+}
+
+int mdc_intent_getattr_async(struct obd_export *exp,
+			     struct md_enqueue_info *minfo)
+{
+	struct ptlrpc_request   *req;
+	struct mdc_getattr_args *ga;
+	struct obd_device       *obddev = class_exp2obd(exp);
+	int			 rc;
+	ENTRY;
+
+	rc = obd_get_request_slot(&obddev->u.cli);
+	if (rc != 0)
+		RETURN(rc);
+
+	rc = mdc_intent_getattr_prep(exp, minfo, &req);
+	if (rc < 0) {
+		obd_put_request_slot(&obddev->u.cli);
+		RETURN(rc);
+	}
+
 	CLASSERT(sizeof(*ga) <= sizeof(req->rq_async_args));
 	ga = ptlrpc_req_async_args(req);
 	ga->ga_exp = exp;
@@ -1427,3 +1459,255 @@ int mdc_intent_getattr_async(struct obd_export *exp,
 
 	RETURN(0);
 }
+
+/* interpret of a batched entry the MDT had no room for, sent on its own */
+static int mdc_batch_entry_interpret(const struct lu_env *env,
+				     struct ptlrpc_request *req,
+				     void *args, int rc)
+{
+	struct mdc_getattr_args *ga = args;
+
+	mdc_intent_getattr_finish(ga->ga_exp, req, ga->ga_minfo, rc);
+	return 0;
+}
+
+static void mdc_batch_entry_resend(struct obd_export *exp,
+				   struct mdc_batch_entry *mbe)
+{
+	struct mdc_getattr_args *ga;
+
+	ga = ptlrpc_req_async_args(mbe->mbe_req);
+	ga->ga_exp = exp;
+	ga->ga_minfo = mbe->mbe_minfo;
+
+	mbe->mbe_req->rq_interpret_reply = mdc_batch_entry_interpret;
+	ptlrpcd_add_req(mbe->mbe_req);
+}
+
+static int mdc_batch_getattr_interpret(const struct lu_env *env,
+				       struct ptlrpc_request *req,
+				       void *args, int rc)
+{
+	struct mdc_batch_getattr_args *bga = args;
+	struct obd_export *exp = bga->bga_exp;
+	struct obd_device *obddev = class_exp2obd(exp);
+	struct mdt_batch_header *mbh = NULL;
+	char *buf = NULL;
+	__u32 buflen = 0;
+	__u32 replied = 0;
+	int i;
+	ENTRY;
+
+	obd_put_request_slot(&obddev->u.cli);
+
+	if (rc == 0) {
+		mbh = req_capsule_server_get(&req->rq_pill, &RMF_BATCH_HEADER);
+		buf = req_capsule_server_get(&req->rq_pill, &RMF_BATCH_BUF);
+		if (mbh == NULL || buf == NULL)
+			rc = -EPROTO;
+		else
+			buflen = req_capsule_get_size(&req->rq_pill,
+						      &RMF_BATCH_BUF,
+						      RCL_SERVER);
+	}
+
+	if (rc == 0) {
+		replied = min_t(__u32, mbh->mbh_count, bga->bga_count);
+		CDEBUG(D_INFO, "%s: batch getattr %u/%d replied\n",
+		       obddev->obd_name, replied, bga->bga_count);
+	}
+
+	for (i = 0; i < bga->bga_count; i++) {
+		struct mdc_batch_entry *mbe = &bga->bga_entries[i];
+		struct lustre_msg *msg = (struct lustre_msg *)buf;
+		int len;
+		int rc2 = rc;
+
+		if (rc == 0 && i >= replied) {
+			/* the MDT ran out of reply space, send the rest of
+			 * entries as regular intent getattr enqueues */
+			mdc_batch_entry_resend(exp, mbe);
+			continue;
+		}
+
+		if (rc == 0) {
+			/* the MDT refuses batches from clients of the other
+			 * endianness, so sub-replies are always native here */
+			len = 0;
+			if (buflen >= sizeof(*msg) &&
+			    msg->lm_magic == LUSTRE_MSG_MAGIC_V2 &&
+			    msg->lm_bufcount < buflen / sizeof(__u32) &&
+			    lustre_msg_hdr_size(msg->lm_magic,
+						msg->lm_bufcount) <= buflen)
+				len = lustre_packed_msg_size(msg);
+			if (len == 0 || len > buflen) {
+				/* treat the rest as broken too */
+				rc = rc2 = -EPROTO;
+			} else {
+				rc2 = ptlrpc_req_set_subreply(mbe->mbe_req,
+							      msg, len);
+				len = cfs_size_round(len);
+				buf += min_t(__u32, len, buflen);
+				buflen -= min_t(__u32, len, buflen);
+			}
+		}
+
+		mdc_intent_getattr_finish(exp, mbe->mbe_req, mbe->mbe_minfo,
+					  rc2);
+		ptlrpc_req_finished(mbe->mbe_req);
+	}
+
+	OBD_FREE(bga->bga_entries, bga->bga_count * sizeof(*bga->bga_entries));
+	RETURN(0);
+}
+
+/* send entries [0, count) of \a entries in one MDS_BATCH_GETATTR RPC */
+static int mdc_batch_getattr_send(struct obd_export *exp,
+				  struct mdc_batch_entry *entries, int count,
+				  __u32 reqsize, __u32 repsize)
+{
+	struct obd_device *obddev = class_exp2obd(exp);
+	struct mdc_batch_getattr_args *bga;
+	struct mdt_batch_header *mbh;
+	struct ptlrpc_request *req;
+	char *buf;
+	int rc;
+	int i;
+	ENTRY;
+
+	req = ptlrpc_request_alloc(class_exp2cliimp(exp),
+				   &RQF_MDS_BATCH_GETATTR);
+	if (req == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	req_capsule_set_size(&req->rq_pill, &RMF_BATCH_BUF, RCL_CLIENT,
+			     reqsize);
+	rc = ptlrpc_request_pack(req, LUSTRE_MDS_VERSION, MDS_BATCH_GETATTR);
+	if (rc) {
+		ptlrpc_request_free(req);
+		GOTO(out, rc);
+	}
+
+	mbh = req_capsule_client_get(&req->rq_pill, &RMF_BATCH_HEADER);
+	mbh->mbh_count = count;
+	mbh->mbh_flags = 0;
+	mbh->mbh_reply_size = repsize;
+
+	buf = req_capsule_client_get(&req->rq_pill, &RMF_BATCH_BUF);
+	for (i = 0; i < count; i++) {
+		struct ptlrpc_request *sub = entries[i].mbe_req;
+
+		memcpy(buf, sub->rq_reqmsg, sub->rq_reqlen);
+		buf += cfs_size_round(sub->rq_reqlen);
+	}
+
+	req_capsule_set_size(&req->rq_pill, &RMF_BATCH_BUF, RCL_SERVER,
+			     repsize);
+	ptlrpc_request_set_replen(req);
+	/* the locks are granted as a side effect of the RPC, a resend could
+	 * grant them twice, let the callers retry individually instead */
+	req->rq_no_resend = 1;
+
+	rc = obd_get_request_slot(&obddev->u.cli);
+	if (rc != 0) {
+		ptlrpc_req_finished(req);
+		GOTO(out, rc);
+	}
+
+	CLASSERT(sizeof(*bga) <= sizeof(req->rq_async_args));
+	bga = ptlrpc_req_async_args(req);
+	bga->bga_exp = exp;
+	bga->bga_count = count;
+	OBD_ALLOC(bga->bga_entries, count * sizeof(*entries));
+	if (bga->bga_entries == NULL) {
+		obd_put_request_slot(&obddev->u.cli);
+		ptlrpc_req_finished(req);
+		GOTO(out, rc = -ENOMEM);
+	}
+	memcpy(bga->bga_entries, entries, count * sizeof(*entries));
+
+	req->rq_interpret_reply = mdc_batch_getattr_interpret;
+	ptlrpcd_add_req(req);
+
+	RETURN(0);
+out:
+	/* complete the entries as failed enqueues */
+	for (i = 0; i < count; i++) {
+		mdc_intent_getattr_finish(exp, entries[i].mbe_req,
+					  entries[i].mbe_minfo, rc);
+		ptlrpc_req_finished(entries[i].mbe_req);
+	}
+	RETURN(rc);
+}
+
+/**
+ * Send intent getattr enqueues for \a count entries of \a minfo in as few
+ * MDS_BATCH_GETATTR RPCs as their request and reply sizes allow. Each entry
+ * is completed through its mi_cb() exactly once, whatever the outcome.
+ */
+int mdc_intent_getattr_batch(struct obd_export *exp,
+			     struct md_enqueue_info **minfo, int count)
+{
+	struct mdc_batch_entry *entries;
+	__u32 reqsize = 0;
+	__u32 repsize = 0;
+	__u32 maxreq;
+	__u32 maxrep;
+	int first = 0;
+	int n = 0;
+	int rc;
+	int i;
+	ENTRY;
+
+	if (!exp_connect_batch_getattr(exp) || count == 1)
+		GOTO(fallback, rc = 0);
+
+	OBD_ALLOC(entries, count * sizeof(*entries));
+	if (entries == NULL)
+		GOTO(fallback, rc = -ENOMEM);
+
+	/* leave room for the batch RPC's own buffers */
+	maxreq = MDS_REG_MAXREQSIZE - 1024;
+	maxrep = MDS_REG_MAXREPSIZE - 1024;
+
+	for (i = 0; i < count; i++) {
+		struct mdc_batch_entry *mbe = &entries[n];
+		__u32 reqlen;
+		__u32 replen;
+
+		rc = mdc_intent_getattr_prep(exp, minfo[i], &mbe->mbe_req);
+		if (rc < 0) {
+			minfo[i]->mi_cb(NULL, minfo[i], rc);
+			continue;
+		}
+		mbe->mbe_minfo = minfo[i];
+
+		reqlen = cfs_size_round(mbe->mbe_req->rq_reqlen);
+		replen = cfs_size_round(mbe->mbe_req->rq_replen);
+		if (n > first &&
+		    (reqsize + reqlen > maxreq || repsize + replen > maxrep)) {
+			mdc_batch_getattr_send(exp, entries + first, n - first,
+					       reqsize, repsize);
+			first = n;
+			reqsize = 0;
+			repsize = 0;
+		}
+		reqsize += reqlen;
+		repsize += replen;
+		n++;
+	}
+	if (n > first)
+		mdc_batch_getattr_send(exp, entries + first, n - first,
+				       reqsize, repsize);
+
+	OBD_FREE(entries, count * sizeof(*entries));
+	RETURN(0);
+
+fallback:
+	for (i = 0; i < count; i++) {
+		rc = mdc_intent_getattr_async(exp, minfo[i]);
+		if (rc < 0)
+			minfo[i]->mi_cb(NULL, minfo[i], rc);
+	}
+	RETURN(0);
+}
@@ -104,30 +104,31 @@ int mdc_resource_get_unused(struct obd_export *exp, const struct lu_fid *fid,
 	return mdc_resource_get_unused_res(exp, &res_id, cancels, mode, bits);
 }
 
-int mdc_setattr(struct obd_export *exp, struct md_op_data *op_data,
-		void *ea, size_t ealen, struct ptlrpc_request **request)
+static int mdc_setattr_prep(struct obd_export *exp, struct md_op_data *op_data,
+			    void *ea, size_t ealen,
+			    struct ptlrpc_request **request)
 {
 	struct list_head cancels = LIST_HEAD_INIT(cancels);
-        struct ptlrpc_request *req;
-        int count = 0, rc;
-        __u64 bits;
-        ENTRY;
+	struct ptlrpc_request *req;
+	int count = 0, rc;
+	__u64 bits;
+	ENTRY;
 
-        LASSERT(op_data != NULL);
+	LASSERT(op_data != NULL);
 
-        bits = MDS_INODELOCK_UPDATE;
-        if (op_data->op_attr.ia_valid & (ATTR_MODE|ATTR_UID|ATTR_GID))
-                bits |= MDS_INODELOCK_LOOKUP;
+	bits = MDS_INODELOCK_UPDATE;
+	if (op_data->op_attr.ia_valid & (ATTR_MODE|ATTR_UID|ATTR_GID))
+		bits |= MDS_INODELOCK_LOOKUP;
 	if ((op_data->op_flags & MF_MDC_CANCEL_FID1) &&
 	    (fid_is_sane(&op_data->op_fid1)))
 		count = mdc_resource_get_unused(exp, &op_data->op_fid1,
 						&cancels, LCK_EX, bits);
-        req = ptlrpc_request_alloc(class_exp2cliimp(exp),
-                                   &RQF_MDS_REINT_SETATTR);
-        if (req == NULL) {
-                ldlm_lock_list_put(&cancels, l_bl_ast, count);
-                RETURN(-ENOMEM);
-        }
+	req = ptlrpc_request_alloc(class_exp2cliimp(exp),
+				   &RQF_MDS_REINT_SETATTR);
+	if (req == NULL) {
+		ldlm_lock_list_put(&cancels, l_bl_ast, count);
+		RETURN(-ENOMEM);
+	}
 
 	req_capsule_set_size(&req->rq_pill, &RMF_MDT_EPOCH, RCL_CLIENT, 0);
 	req_capsule_set_size(&req->rq_pill, &RMF_EADATA, RCL_CLIENT, ealen);
@@ -139,7 +140,7 @@ int mdc_setattr(struct obd_export *exp, struct md_op_data *op_data,
 		RETURN(rc);
 	}
 
-        if (op_data->op_attr.ia_valid & (ATTR_MTIME | ATTR_CTIME))
+	if (op_data->op_attr.ia_valid & (ATTR_MTIME | ATTR_CTIME))
 		CDEBUG(D_INODE, "setting mtime %lld, ctime %lld\n",
 		       (s64)op_data->op_attr.ia_mtime.tv_sec,
 		       (s64)op_data->op_attr.ia_ctime.tv_sec);
@@ -147,61 +148,60 @@ int mdc_setattr(struct obd_export *exp, struct md_op_data *op_data,
 
 	req_capsule_set_size(&req->rq_pill, &RMF_ACL, RCL_SERVER, 0);
 
-        ptlrpc_request_set_replen(req);
+	ptlrpc_request_set_replen(req);
+
+	*request = req;
+	RETURN(0);
+}
+
+int mdc_setattr(struct obd_export *exp, struct md_op_data *op_data,
+		void *ea, size_t ealen, struct ptlrpc_request **request)
+{
+	struct ptlrpc_request *req;
+	int rc;
+	ENTRY;
+
+	rc = mdc_setattr_prep(exp, op_data, ea, ealen, &req);
+	if (rc)
+		RETURN(rc);
 
 	rc = mdc_reint(req, LUSTRE_IMP_FULL);
 	if (rc == -ERESTARTSYS)
-                rc = 0;
+		rc = 0;
 
-        *request = req;
+	*request = req;
 
 	RETURN(rc);
 }
 
-int mdc_create(struct obd_export *exp, struct md_op_data *op_data,
-		const void *data, size_t datalen,
-		umode_t mode, uid_t uid, gid_t gid,
-		cfs_cap_t cap_effective, __u64 rdev,
-		struct ptlrpc_request **request)
+static int mdc_create_prep(struct obd_export *exp, struct md_op_data *op_data,
+			   const void *data, size_t datalen,
+			   umode_t mode, uid_t uid, gid_t gid,
+			   cfs_cap_t cap_effective, __u64 rdev,
+			   struct ptlrpc_request **request)
 {
-        struct ptlrpc_request *req;
-        int level, rc;
-        int count, resends = 0;
-        struct obd_import *import = exp->exp_obd->u.cli.cl_import;
-        int generation = import->imp_generation;
+	struct ptlrpc_request *req;
+	int count = 0, rc;
 	struct list_head cancels = LIST_HEAD_INIT(cancels);
-        ENTRY;
-
-	/* For case if upper layer did not alloc fid, do it now. */
-	if (!fid_is_sane(&op_data->op_fid2)) {
-		/*
-		 * mdc_fid_alloc() may return errno 1 in case of switch to new
-		 * sequence, handle this.
-		 */
-		rc = mdc_fid_alloc(NULL, exp, &op_data->op_fid2, op_data);
-		if (rc < 0)
-			RETURN(rc);
-	}
+	ENTRY;
 
-rebuild:
-        count = 0;
-        if ((op_data->op_flags & MF_MDC_CANCEL_FID1) &&
-            (fid_is_sane(&op_data->op_fid1)))
-                count = mdc_resource_get_unused(exp, &op_data->op_fid1,
-                                                &cancels, LCK_EX,
-                                                MDS_INODELOCK_UPDATE);
+	if ((op_data->op_flags & MF_MDC_CANCEL_FID1) &&
+	    (fid_is_sane(&op_data->op_fid1)))
+		count = mdc_resource_get_unused(exp, &op_data->op_fid1,
+						&cancels, LCK_EX,
+						MDS_INODELOCK_UPDATE);
 
-        req = ptlrpc_request_alloc(class_exp2cliimp(exp),
+	req = ptlrpc_request_alloc(class_exp2cliimp(exp),
 				   &RQF_MDS_REINT_CREATE_ACL);
-        if (req == NULL) {
-                ldlm_lock_list_put(&cancels, l_bl_ast, count);
-                RETURN(-ENOMEM);
-        }
+	if (req == NULL) {
+		ldlm_lock_list_put(&cancels, l_bl_ast, count);
+		RETURN(-ENOMEM);
+	}
 
-        req_capsule_set_size(&req->rq_pill, &RMF_NAME, RCL_CLIENT,
-                             op_data->op_namelen + 1);
-        req_capsule_set_size(&req->rq_pill, &RMF_EADATA, RCL_CLIENT,
-                             data && datalen ? datalen : 0);
+	req_capsule_set_size(&req->rq_pill, &RMF_NAME, RCL_CLIENT,
+			     op_data->op_namelen + 1);
+	req_capsule_set_size(&req->rq_pill, &RMF_EADATA, RCL_CLIENT,
+			     data && datalen ? datalen : 0);
 
 	req_capsule_set_size(&req->rq_pill, &RMF_FILE_SECCTX_NAME,
 			     RCL_CLIENT, op_data->op_file_secctx_name != NULL ?
@@ -226,14 +226,48 @@ rebuild:
 		RETURN(rc);
 	}
 
-        /*
-         * mdc_create_pack() fills msg->bufs[1] with name and msg->bufs[2] with
-         * tgt, for symlinks or lov MD data.
-         */
-        mdc_create_pack(req, op_data, data, datalen, mode, uid,
-                        gid, cap_effective, rdev);
+	/*
+	 * mdc_create_pack() fills msg->bufs[1] with name and msg->bufs[2] with
+	 * tgt, for symlinks or lov MD data.
+	 */
+	mdc_create_pack(req, op_data, data, datalen, mode, uid,
+			gid, cap_effective, rdev);
 
-        ptlrpc_request_set_replen(req);
+	ptlrpc_request_set_replen(req);
+
+	*request = req;
+	RETURN(0);
+}
+
+int mdc_create(struct obd_export *exp, struct md_op_data *op_data,
+		const void *data, size_t datalen,
+		umode_t mode, uid_t uid, gid_t gid,
+		cfs_cap_t cap_effective, __u64 rdev,
+		struct ptlrpc_request **request)
+{
+        struct ptlrpc_request *req;
+        int level, rc;
+        int resends = 0;
+        struct obd_import *import = exp->exp_obd->u.cli.cl_import;
+        int generation = import->imp_generation;
+        ENTRY;
+
+	/* For case if upper layer did not alloc fid, do it now. */
+	if (!fid_is_sane(&op_data->op_fid2)) {
+		/*
+		 * mdc_fid_alloc() may return errno 1 in case of switch to new
+		 * sequence, handle this.
+		 */
+		rc = mdc_fid_alloc(NULL, exp, &op_data->op_fid2, op_data);
+		if (rc < 0)
+			RETURN(rc);
+	}
+
+rebuild:
+	rc = mdc_create_prep(exp, op_data, data, datalen, mode, uid, gid,
+			     cap_effective, rdev, &req);
+	if (rc)
+		RETURN(rc);
 
 	/* ask ptlrpc not to resend on EINPROGRESS since we have our own retry
 	 * logic here */
@@ -276,16 +310,14 @@ rebuild:
         RETURN(rc);
 }
 
-int mdc_unlink(struct obd_export *exp, struct md_op_data *op_data,
-               struct ptlrpc_request **request)
+static int mdc_unlink_prep(struct obd_export *exp, struct md_op_data *op_data,
+			   struct ptlrpc_request **request)
 {
 	struct list_head cancels = LIST_HEAD_INIT(cancels);
-        struct obd_device *obd = class_exp2obd(exp);
-        struct ptlrpc_request *req = *request;
-        int count = 0, rc;
-        ENTRY;
-
-        LASSERT(req == NULL);
+	struct obd_device *obd = class_exp2obd(exp);
+	struct ptlrpc_request *req;
+	int count = 0, rc;
+	ENTRY;
 
 	if ((op_data->op_flags & MF_MDC_CANCEL_FID1) &&
 	    (fid_is_sane(&op_data->op_fid1)))
@@ -298,15 +330,15 @@ int mdc_unlink(struct obd_export *exp, struct md_op_data *op_data,
 		count += mdc_resource_get_unused(exp, &op_data->op_fid3,
 						 &cancels, LCK_EX,
 						 MDS_INODELOCK_ELC);
-        req = ptlrpc_request_alloc(class_exp2cliimp(exp),
-                                   &RQF_MDS_REINT_UNLINK);
-        if (req == NULL) {
-                ldlm_lock_list_put(&cancels, l_bl_ast, count);
-                RETURN(-ENOMEM);
-        }
+	req = ptlrpc_request_alloc(class_exp2cliimp(exp),
+				   &RQF_MDS_REINT_UNLINK);
+	if (req == NULL) {
+		ldlm_lock_list_put(&cancels, l_bl_ast, count);
+		RETURN(-ENOMEM);
+	}
 
-        req_capsule_set_size(&req->rq_pill, &RMF_NAME, RCL_CLIENT,
-                             op_data->op_namelen + 1);
+	req_capsule_set_size(&req->rq_pill, &RMF_NAME, RCL_CLIENT,
+			     op_data->op_namelen + 1);
 
 	/* get SELinux policy info if any */
 	rc = sptlrpc_get_sepol(req);
@@ -330,6 +362,23 @@ int mdc_unlink(struct obd_export *exp, struct md_op_data *op_data,
 			     obd->u.cli.cl_default_mds_easize);
 	ptlrpc_request_set_replen(req);
 
+	*request = req;
+	RETURN(0);
+}
+
+int mdc_unlink(struct obd_export *exp, struct md_op_data *op_data,
+               struct ptlrpc_request **request)
+{
+        struct ptlrpc_request *req = *request;
+        int rc;
+        ENTRY;
+
+        LASSERT(req == NULL);
+
+	rc = mdc_unlink_prep(exp, op_data, &req);
+	if (rc)
+		RETURN(rc);
+
         *request = req;
 
 	rc = mdc_reint(req, LUSTRE_IMP_FULL);
@@ -528,3 +577,264 @@ int mdc_file_resync(struct obd_export *exp, struct md_op_data *op_data)
 	ptlrpc_req_finished(req);
 	RETURN(rc);
 }
+
+/* a single reint of md_batch_reint(), used when it can't be batched */
+static int mdc_batch_reint_one(struct obd_export *exp,
+			       struct md_batch_item *item)
+{
+	struct md_op_data *op_data = item->mbi_op_data;
+	struct ptlrpc_request *req = NULL;
+	int rc;
+
+	switch (item->mbi_opc) {
+	case REINT_CREATE:
+		rc = mdc_create(exp, op_data, NULL, 0, item->mbi_mode,
+				item->mbi_uid, item->mbi_gid, op_data->op_cap,
+				0, &req);
+		break;
+	case REINT_SETATTR:
+		rc = mdc_setattr(exp, op_data, NULL, 0, &req);
+		break;
+	case REINT_UNLINK:
+		rc = mdc_unlink(exp, op_data, &req);
+		break;
+	default:
+		rc = -EOPNOTSUPP;
+		break;
+	}
+	ptlrpc_req_finished(req);
+
+	return rc;
+}
+
+static int mdc_batch_reint_prep(struct obd_export *exp,
+				struct md_batch_item *item,
+				struct ptlrpc_request **reqp)
+{
+	struct md_op_data *op_data = item->mbi_op_data;
+	int rc;
+
+	switch (item->mbi_opc) {
+	case REINT_CREATE:
+		if (!fid_is_sane(&op_data->op_fid2)) {
+			rc = mdc_fid_alloc(NULL, exp, &op_data->op_fid2,
+					   op_data);
+			if (rc < 0)
+				return rc;
+		}
+		return mdc_create_prep(exp, op_data, NULL, 0, item->mbi_mode,
+				       item->mbi_uid, item->mbi_gid,
+				       op_data->op_cap, 0, reqp);
+	case REINT_SETATTR:
+		return mdc_setattr_prep(exp, op_data, NULL, 0, reqp);
+	case REINT_UNLINK:
+		return mdc_unlink_prep(exp, op_data, reqp);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+struct mdc_batch_reint_entry {
+	struct ptlrpc_request	*mre_req;
+	struct md_batch_item	*mre_item;
+};
+
+/* complete \a mre with the status \a rc of its sub-reply */
+static void mdc_batch_reint_done(struct obd_export *exp,
+				 struct mdc_batch_reint_entry *mre, int rc)
+{
+	ptlrpc_req_finished(mre->mre_req);
+	mre->mre_req = NULL;
+
+	/* sub-requests are not retried by ptlrpc, do it with a new RPC */
+	if (rc == -EINPROGRESS)
+		rc = mdc_batch_reint_one(exp, mre->mre_item);
+	mre->mre_item->mbi_result = rc;
+}
+
+/*
+ * Send the sub-requests of \a entries in one MDS_BATCH_REINT RPC. The MDT
+ * may handle only the first ones, the rest is flagged as resent, in case the
+ * MDT executed one without room to reply, and is left to the caller.
+ *
+ * \retval number of entries completed, or negative errno if none was
+ */
+static int mdc_batch_reint_send(struct obd_export *exp,
+				struct mdc_batch_reint_entry *entries,
+				int count, __u32 reqsize)
+{
+	struct mdt_batch_header *mbh;
+	struct ptlrpc_request *req;
+	__u32 repsize;
+	__u32 replied;
+	__u32 buflen;
+	__u64 *xids;
+	char *buf;
+	int rc;
+	int i;
+	ENTRY;
+
+	req = ptlrpc_request_alloc(class_exp2cliimp(exp),
+				   &RQF_MDS_BATCH_REINT);
+	if (req == NULL)
+		RETURN(-ENOMEM);
+
+	req_capsule_set_size(&req->rq_pill, &RMF_BATCH_XID, RCL_CLIENT,
+			     count * sizeof(*xids));
+	req_capsule_set_size(&req->rq_pill, &RMF_BATCH_BUF, RCL_CLIENT,
+			     reqsize);
+	rc = ptlrpc_request_pack(req, LUSTRE_MDS_VERSION, MDS_BATCH_REINT);
+	if (rc) {
+		ptlrpc_request_free(req);
+		RETURN(rc);
+	}
+
+	repsize = count *
+		  cfs_size_round(lustre_msg_size(LUSTRE_MSG_MAGIC_V2, 1, NULL));
+	mbh = req_capsule_client_get(&req->rq_pill, &RMF_BATCH_HEADER);
+	mbh->mbh_count = count;
+	mbh->mbh_flags = 0;
+	mbh->mbh_reply_size = repsize;
+
+	xids = req_capsule_client_get(&req->rq_pill, &RMF_BATCH_XID);
+	buf = req_capsule_client_get(&req->rq_pill, &RMF_BATCH_BUF);
+	for (i = 0; i < count; i++) {
+		struct ptlrpc_request *sub = entries[i].mre_req;
+
+		xids[i] = sub->rq_xid;
+		memcpy(buf, sub->rq_reqmsg, sub->rq_reqlen);
+		buf += cfs_size_round(sub->rq_reqlen);
+		lustre_msg_add_flags(sub->rq_reqmsg, MSG_RESENT);
+	}
+
+	req_capsule_set_size(&req->rq_pill, &RMF_BATCH_BUF, RCL_SERVER,
+			     repsize);
+	ptlrpc_request_set_replen(req);
+
+	mdc_get_mod_rpc_slot(req, NULL);
+	rc = ptlrpc_queue_wait(req);
+	mdc_put_mod_rpc_slot(req, NULL);
+	if (rc)
+		GOTO(out, rc);
+
+	mbh = req_capsule_server_get(&req->rq_pill, &RMF_BATCH_HEADER);
+	buf = req_capsule_server_get(&req->rq_pill, &RMF_BATCH_BUF);
+	if (mbh == NULL || buf == NULL)
+		GOTO(out, rc = -EPROTO);
+	buflen = req_capsule_get_size(&req->rq_pill, &RMF_BATCH_BUF,
+				      RCL_SERVER);
+
+	replied = min_t(__u32, mbh->mbh_count, count);
+	CDEBUG(D_INFO, "%s: batch reint %u/%d replied\n",
+	       exp->exp_obd->obd_name, replied, count);
+
+	for (i = 0; i < replied; i++) {
+		struct lustre_msg *msg = (struct lustre_msg *)buf;
+		int len = 0;
+
+		/* the MDT refuses batches from clients of the other
+		 * endianness, so sub-replies are always native here */
+		if (buflen >= sizeof(*msg) &&
+		    msg->lm_magic == LUSTRE_MSG_MAGIC_V2 &&
+		    msg->lm_bufcount < buflen / sizeof(__u32) &&
+		    lustre_msg_hdr_size(msg->lm_magic,
+					msg->lm_bufcount) <= buflen)
+			len = lustre_packed_msg_size(msg);
+		if (len == 0 || len > buflen)
+			break;
+
+		rc = ptlrpc_req_set_subreply(entries[i].mre_req, msg, len);
+		mdc_batch_reint_done(exp, &entries[i], rc);
+
+		len = cfs_size_round(len);
+		buf += min_t(__u32, len, buflen);
+		buflen -= min_t(__u32, len, buflen);
+	}
+	rc = i;
+out:
+	ptlrpc_req_finished(req);
+	RETURN(rc);
+}
+
+/**
+ * Execute \a count creates, setattrs or unlinks of \a items, all on this
+ * MDT, in as few MDS_BATCH_REINT RPCs as their size and the MDT allow. Each
+ * sub-request is a complete MDS_REINT, which is kept for replay on its own.
+ */
+int mdc_batch_reint(struct obd_export *exp, struct md_batch_item *items,
+		    int count)
+{
+	struct mdc_batch_reint_entry *entries;
+	__u32 maxreq;
+	int done = 0;
+	int last;
+	int n = 0;
+	int rc;
+	int i;
+	ENTRY;
+
+	/* sub-requests need their own reply data slot on the MDT */
+	if (!exp_connect_batch_reint(exp) ||
+	    !(exp_connect_flags(exp) & OBD_CONNECT_MULTIMODRPCS) || count == 1)
+		GOTO(fallback, rc = 0);
+
+	OBD_ALLOC(entries, count * sizeof(*entries));
+	if (entries == NULL)
+		GOTO(fallback, rc = -ENOMEM);
+
+	for (i = 0; i < count; i++) {
+		rc = mdc_batch_reint_prep(exp, &items[i], &entries[n].mre_req);
+		if (rc < 0) {
+			items[i].mbi_result = rc;
+			continue;
+		}
+		entries[n++].mre_item = &items[i];
+	}
+
+	/* leave room for the batch RPC's own buffers */
+	maxreq = MDS_REG_MAXREQSIZE - 1024;
+
+	while (done < n) {
+		__u32 reqsize = 0;
+		int nr = 0;
+
+		while (done + nr < n) {
+			__u32 reqlen;
+
+			reqlen = cfs_size_round(
+					entries[done + nr].mre_req->rq_reqlen) +
+				 sizeof(__u64);
+			if (nr > 0 && reqsize + reqlen > maxreq)
+				break;
+			reqsize += reqlen;
+			nr++;
+		}
+
+		rc = mdc_batch_reint_send(exp, entries + done, nr,
+					  reqsize - nr * sizeof(__u64));
+		if (rc > 0) {
+			done += rc;
+			continue;
+		}
+
+		/* the MDT handled none, make progress with a regular RPC, or
+		 * only use regular RPCs if the batch RPC itself failed */
+		last = rc < 0 ? n : done + 1;
+		for (i = done; i < last; i++) {
+			struct md_batch_item *item = entries[i].mre_item;
+
+			ptlrpc_req_finished(entries[i].mre_req);
+			item->mbi_result = rc == -EINTR ? rc :
+					   mdc_batch_reint_one(exp, item);
+		}
+		done = last;
+	}
+
+	OBD_FREE(entries, count * sizeof(*entries));
+	RETURN(0);
+
+fallback:
+	for (i = 0; i < count; i++)
+		items[i].mbi_result = mdc_batch_reint_one(exp, &items[i]);
+	RETURN(0);
+}
@@ -2881,6 +2881,8 @@ static struct md_ops mdc_md_ops = {
         .m_set_open_replay_data = mdc_set_open_replay_data,
         .m_clear_open_replay_data = mdc_clear_open_replay_data,
         .m_intent_getattr_async = mdc_intent_getattr_async,
+	.m_intent_getattr_batch = mdc_intent_getattr_batch,
+	.m_batch_reint		= mdc_batch_reint,
         .m_revalidate_lock      = mdc_revalidate_lock
 };
 
@@ -3825,6 +3825,432 @@ out_shrink:
         return rc;
 }
 
+/*
+ * Handle one LDLM_INTENT_GETATTR enqueue packed in MDS_BATCH_GETATTR, the
+ * same way as mdt_intent_getattr() does, except that the child lock is
+ * exported to the client directly because there is no server lock created
+ * by ldlm_handle_enqueue0() to replace.
+ *
+ * \retval enqueue status to be returned in the sub-reply
+ */
+static int mdt_batch_getattr_one(struct mdt_thread_info *info)
+{
+	struct req_capsule *pill = info->mti_pill;
+	struct mdt_lock_handle *lhc = &info->mti_lh[MDT_LH_RMT];
+	struct ldlm_request *dlm_req;
+	struct ldlm_intent *intent;
+	struct ldlm_reply *ldlm_rep;
+	struct ldlm_lock *lock;
+	struct mdt_body *reqbody;
+	struct mdt_body *repbody;
+	__u64 child_bits;
+	int rc, rc2;
+	ENTRY;
+
+	dlm_req = req_capsule_client_get(pill, &RMF_DLM_REQ);
+	intent = req_capsule_client_get(pill, &RMF_LDLM_INTENT);
+	if (dlm_req == NULL || intent == NULL)
+		RETURN(-EPROTO);
+
+	rc = mdt_unpack_req_pack_rep(info, HAS_REPLY);
+	if (rc < 0) {
+		/* return the error in a reply of the regular format */
+		if (pill->rc_repmsg == NULL && req_capsule_server_pack(pill))
+			RETURN(rc);
+		GOTO(out_status, rc);
+	}
+
+	reqbody = req_capsule_client_get(pill, &RMF_MDT_BODY);
+	repbody = req_capsule_server_get(pill, &RMF_MDT_BODY);
+	ldlm_rep = req_capsule_server_get(pill, &RMF_DLM_REP);
+	if (reqbody == NULL || repbody == NULL || ldlm_rep == NULL)
+		GOTO(out_status, rc = -EPROTO);
+
+	info->mti_cross_ref = !!(reqbody->mbo_valid & OBD_MD_FLCROSSREF);
+	repbody->mbo_eadatasize = 0;
+	repbody->mbo_aclsize = 0;
+
+	switch (intent->opc) {
+	case IT_LOOKUP:
+		child_bits = MDS_INODELOCK_LOOKUP | MDS_INODELOCK_PERM;
+		break;
+	case IT_GETATTR:
+		child_bits = MDS_INODELOCK_LOOKUP | MDS_INODELOCK_UPDATE |
+			     MDS_INODELOCK_PERM;
+		break;
+	default:
+		CERROR("%s: unsupported batched intent %#llx\n",
+		       mdt_obd_name(info->mti_mdt), intent->opc);
+		GOTO(out_shrink, rc = -EINVAL);
+	}
+
+	rc = mdt_init_ucred_intent_getattr(info, reqbody);
+	if (rc)
+		GOTO(out_shrink, rc);
+
+	mdt_set_disposition(info, ldlm_rep, DISP_IT_EXECD);
+
+	rc = mdt_getattr_name_lock(info, lhc, child_bits, ldlm_rep);
+	ldlm_rep->lock_policy_res2 = clear_serious(rc);
+
+	if (mdt_get_disposition(ldlm_rep, DISP_LOOKUP_NEG))
+		ldlm_rep->lock_policy_res2 = 0;
+	if (!mdt_get_disposition(ldlm_rep, DISP_LOOKUP_POS) ||
+	    ldlm_rep->lock_policy_res2) {
+		lhc->mlh_reg_lh.cookie = 0ull;
+		GOTO(out_ucred, rc = ELDLM_LOCK_ABORTED);
+	}
+
+	lock = ldlm_handle2lock(&lhc->mlh_reg_lh);
+	LASSERT(lock != NULL);
+	rc = ldlm_lock_export_local(info->mti_exp, lock,
+				    &dlm_req->lock_handle[0], ldlm_rep);
+	LDLM_LOCK_PUT(lock);
+	if (rc)
+		ldlm_lock_decref(&lhc->mlh_reg_lh, lhc->mlh_reg_mode);
+	lhc->mlh_reg_lh.cookie = 0;
+	EXIT;
+out_ucred:
+	mdt_exit_ucred(info);
+out_shrink:
+	mdt_client_compatibility(info);
+	rc2 = mdt_fix_reply(info);
+	if (rc == 0)
+		rc = rc2;
+	ldlm_rep->lock_policy_res2 =
+		ptlrpc_status_hton(ldlm_rep->lock_policy_res2);
+out_status:
+	lustre_msg_set_status(pill->rc_repmsg, ptlrpc_status_hton(rc));
+	return rc;
+}
+
+/* drop the lock of a sub-reply which is not going to reach the client */
+static void mdt_batch_getattr_cancel(struct req_capsule *pill)
+{
+	struct ldlm_reply *ldlm_rep;
+	struct ldlm_lock *lock;
+
+	ldlm_rep = req_capsule_server_get(pill, &RMF_DLM_REP);
+	if (ldlm_rep == NULL || !lustre_handle_is_used(&ldlm_rep->lock_handle))
+		return;
+
+	lock = ldlm_handle2lock(&ldlm_rep->lock_handle);
+	if (lock != NULL) {
+		ldlm_lock_cancel(lock);
+		LDLM_LOCK_PUT(lock);
+	}
+}
+
+/*
+ * MDS_BATCH_GETATTR handler, used by statahead to stat many entries of a
+ * directory in one RPC.
+ *
+ * RMF_BATCH_BUF carries complete LDLM_INTENT_GETATTR enqueue messages, each
+ * one is handled as a regular intent getattr and its reply is packed into
+ * the reply RMF_BATCH_BUF in the same order. Processing stops at the first
+ * reply which doesn't fit, the client sends the rest individually.
+ */
+static int mdt_batch_getattr(struct tgt_session_info *tsi)
+{
+	struct ptlrpc_request *req = tgt_ses_req(tsi);
+	struct mdt_thread_info *info = tsi2mdt_info(tsi);
+	struct req_capsule *pill = tsi->tsi_pill;
+	struct req_capsule *subpill = &info->mti_sub_pill;
+	struct mdt_batch_header *mbh;
+	struct mdt_batch_header *repmbh;
+	char *reqbuf;
+	char *repbuf;
+	__u32 reqlen;
+	__u32 replen;
+	__u32 used = 0;
+	__u32 i;
+	int rc;
+	ENTRY;
+
+	/* sub-requests would need swabbing too, not worth it */
+	if (ptlrpc_req_need_swab(req))
+		GOTO(out, rc = err_serious(-EOPNOTSUPP));
+
+	mbh = req_capsule_client_get(pill, &RMF_BATCH_HEADER);
+	reqbuf = req_capsule_client_get(pill, &RMF_BATCH_BUF);
+	if (mbh == NULL || reqbuf == NULL)
+		GOTO(out, rc = err_serious(-EPROTO));
+	reqlen = req_capsule_get_size(pill, &RMF_BATCH_BUF, RCL_CLIENT);
+
+	replen = min_t(__u32, mbh->mbh_reply_size, MDS_REG_MAXREPSIZE);
+	req_capsule_set_size(pill, &RMF_BATCH_BUF, RCL_SERVER, replen);
+	rc = req_capsule_server_pack(pill);
+	if (rc)
+		GOTO(out, rc = err_serious(rc));
+
+	repmbh = req_capsule_server_get(pill, &RMF_BATCH_HEADER);
+	repbuf = req_capsule_server_get(pill, &RMF_BATCH_BUF);
+
+	for (i = 0; i < mbh->mbh_count; i++) {
+		struct lustre_msg *msg = (struct lustre_msg *)reqbuf;
+		__u32 msglen;
+		int status;
+
+		/* a swabbed sub-request from a non-swabbed client is bogus */
+		if (__lustre_unpack_msg(msg, reqlen) != 0 ||
+		    lustre_msg_get_opc(msg) != LDLM_ENQUEUE)
+			break;
+
+		msglen = cfs_size_round(lustre_packed_msg_size(msg));
+
+		/* every sub-request starts with a clean thread info */
+		mdt_thread_info_fini(info);
+		mdt_thread_info_init(req, info);
+		req_capsule_subreq_init(subpill, &RQF_LDLM_INTENT_GETATTR, req,
+					msg);
+		info->mti_pill = subpill;
+
+		status = mdt_batch_getattr_one(info);
+		if (status < 0 && subpill->rc_repmsg != NULL)
+			mdt_batch_getattr_cancel(subpill);
+		if (subpill->rc_repmsg == NULL ||
+		    used + cfs_size_round(subpill->rc_replen) > replen) {
+			if (subpill->rc_repmsg != NULL)
+				mdt_batch_getattr_cancel(subpill);
+			req_capsule_subreq_fini(subpill);
+			break;
+		}
+
+		CDEBUG(D_INFO, "%s: batched getattr %u: rc = %d\n",
+		       mdt_obd_name(info->mti_mdt), i, status);
+
+		memcpy(repbuf + used, subpill->rc_repmsg, subpill->rc_replen);
+		used += cfs_size_round(subpill->rc_replen);
+		req_capsule_subreq_fini(subpill);
+
+		reqbuf += msglen;
+		reqlen -= min(msglen, reqlen);
+	}
+
+	info->mti_pill = pill;
+	repmbh->mbh_count = i;
+	repmbh->mbh_flags = 0;
+	repmbh->mbh_reply_size = used;
+	req_capsule_shrink(pill, &RMF_BATCH_BUF, used, RCL_SERVER);
+	rc = 0;
+	EXIT;
+out:
+	mdt_thread_info_fini(info);
+	return rc;
+}
+
+/*
+ * Check whether sub-request \a opc of a batch would need a lock conflicting
+ * with one kept by the batch reply of \a req, it would wait for the batch
+ * reply to be sent then. The locks are guessed from \a rec and the name, as
+ * the strongest ones the reint may take.
+ */
+static bool mdt_batch_reint_conflict(struct mdt_thread_info *info,
+				     struct ptlrpc_request *req, __u32 opc,
+				     const struct mdt_rec_reint *rec)
+{
+	struct ptlrpc_reply_state *rs = req->rq_reply_state;
+	struct ldlm_res_id *res_id = &info->mti_res_id;
+	struct lu_fid *child_fid = &info->mti_tmp_fid1;
+	struct mdt_lock_handle lh;
+	struct mdt_object *parent;
+	int rc;
+
+	if (rs->rs_nlocks == 0)
+		return false;
+
+	if (opc == REINT_SETATTR) {
+		fid_build_reg_res_name(&rec->rr_fid1, res_id);
+		return ptlrpc_rs_lock_conflict(rs, res_id, LCK_PW,
+					       MDS_INODELOCK_FULL);
+	}
+
+	/* the whole directory, then the part of it holding the name */
+	fid_build_reg_res_name(&rec->rr_fid1, res_id);
+	if (ptlrpc_rs_lock_conflict(rs, res_id, LCK_PW, MDS_INODELOCK_UPDATE))
+		return true;
+	if (mdt_name_unpack(info->mti_pill, &RMF_NAME, &info->mti_name, 0))
+		return false;
+	mdt_lock_pdo_init(&lh, LCK_PW, &info->mti_name);
+	fid_build_pdo_res_name(&rec->rr_fid1, lh.mlh_pdo_hash, res_id);
+	if (ptlrpc_rs_lock_conflict(rs, res_id, LCK_PW, MDS_INODELOCK_UPDATE))
+		return true;
+	if (opc != REINT_UNLINK)
+		return false;
+
+	/* and the file removed, clients don't always know it */
+	*child_fid = rec->rr_fid2;
+	if (!fid_is_sane(child_fid)) {
+		parent = mdt_object_find(info->mti_env, info->mti_mdt,
+					 &rec->rr_fid1);
+		if (IS_ERR(parent))
+			return false;
+		rc = -ENOENT;
+		if (mdt_object_exists(parent) && !mdt_object_remote(parent))
+			rc = mdo_lookup(info->mti_env, mdt_object_child(parent),
+					&info->mti_name, child_fid,
+					&info->mti_spec);
+		mdt_object_put(info->mti_env, parent);
+		if (rc != 0)
+			return false;
+	}
+	fid_build_reg_res_name(child_fid, res_id);
+
+	return ptlrpc_rs_lock_conflict(rs, res_id, LCK_EX, MDS_INODELOCK_FULL);
+}
+
+/*
+ * MDS_BATCH_REINT handler, used to create, setattr or unlink many files in
+ * one RPC, e.g. by untar or rsync through llapi_batch_ops().
+ *
+ * RMF_BATCH_BUF carries complete MDS_REINT messages, and RMF_BATCH_XID the
+ * xid each of them was given by the client. Each one is handled as a regular
+ * MDS_REINT with its own transno and last_rcvd slot, so it can be resent and
+ * replayed on its own, and only its status is packed into the reply. The
+ * locks left by the sub-requests are kept by the batch reply, processing
+ * stops when they could overflow it, when a sub-request would need a lock
+ * conflicting with them or when a status doesn't fit, the client sends the
+ * rest in another batch.
+ */
+static int mdt_batch_reint(struct tgt_session_info *tsi)
+{
+	static const struct req_format *batch_fmts[REINT_MAX] = {
+		[REINT_SETATTR]  = &RQF_MDS_REINT_SETATTR,
+		[REINT_CREATE]   = &RQF_MDS_REINT_CREATE,
+		[REINT_UNLINK]   = &RQF_MDS_REINT_UNLINK,
+	};
+	struct ptlrpc_request *req = tgt_ses_req(tsi);
+	struct mdt_thread_info *info = tsi2mdt_info(tsi);
+	struct req_capsule *pill = tsi->tsi_pill;
+	struct mdt_batch_header *mbh;
+	struct mdt_batch_header *repmbh;
+	__u64 *xids;
+	char *reqbuf;
+	char *repbuf;
+	__u32 reqlen;
+	__u32 replen;
+	__u32 sublen;
+	__u32 used = 0;
+	__u32 i;
+	int rc;
+	ENTRY;
+
+	/* sub-requests would need swabbing too, not worth it */
+	if (ptlrpc_req_need_swab(req))
+		GOTO(out, rc = err_serious(-EOPNOTSUPP));
+
+	mbh = req_capsule_client_get(pill, &RMF_BATCH_HEADER);
+	xids = req_capsule_client_get(pill, &RMF_BATCH_XID);
+	reqbuf = req_capsule_client_get(pill, &RMF_BATCH_BUF);
+	if (mbh == NULL || xids == NULL || reqbuf == NULL ||
+	    mbh->mbh_count > req_capsule_get_size(pill, &RMF_BATCH_XID,
+						  RCL_CLIENT) / sizeof(*xids))
+		GOTO(out, rc = err_serious(-EPROTO));
+	reqlen = req_capsule_get_size(pill, &RMF_BATCH_BUF, RCL_CLIENT);
+
+	replen = min_t(__u32, mbh->mbh_reply_size, MDS_REG_MAXREPSIZE);
+	req_capsule_set_size(pill, &RMF_BATCH_BUF, RCL_SERVER, replen);
+	rc = req_capsule_server_pack(pill);
+	if (rc)
+		GOTO(out, rc = err_serious(rc));
+
+	repmbh = req_capsule_server_get(pill, &RMF_BATCH_HEADER);
+	repbuf = req_capsule_server_get(pill, &RMF_BATCH_BUF);
+	sublen = cfs_size_round(lustre_msg_size(LUSTRE_MSG_MAGIC_V2, 1, NULL));
+
+	for (i = 0; i < mbh->mbh_count; i++) {
+		struct lustre_msg *msg = (struct lustre_msg *)reqbuf;
+		struct ptlrpc_request *sub;
+		struct mdt_rec_reint *rec;
+		__u32 msglen;
+		__u32 opc;
+		int len;
+
+		/* a sub-request keeps up to two locks (parent and child) */
+		if (req->rq_reply_state->rs_nlocks > RS_MAX_LOCKS - 2 ||
+		    used + sublen > replen)
+			break;
+
+		/* a swabbed sub-request from a non-swabbed client is bogus */
+		if (__lustre_unpack_msg(msg, reqlen) != 0 ||
+		    lustre_msg_get_opc(msg) != MDS_REINT)
+			break;
+
+		msglen = cfs_size_round(lustre_packed_msg_size(msg));
+		if (lustre_msg_get_flags(req->rq_reqmsg) & MSG_RESENT)
+			lustre_msg_add_flags(msg, MSG_RESENT);
+
+		sub = ptlrpc_server_subreq_alloc(req, msg, min(msglen, reqlen),
+						 xids[i]);
+		if (IS_ERR(sub))
+			break;
+
+		/* every sub-request starts with a clean thread info and its
+		 * own transaction */
+		mdt_thread_info_fini(info);
+		mdt_thread_info_init(sub, info);
+		tsi->tsi_pill = &sub->rq_pill;
+		tgt_txn_reset(tsi->tsi_env);
+
+		req_capsule_set(&sub->rq_pill, &RQF_MDS_REINT);
+		rec = req_capsule_client_get(&sub->rq_pill, &RMF_REC_REINT);
+		opc = rec != NULL ? rec->rr_opcode : REINT_MAX;
+		if (opc < REINT_MAX && batch_fmts[opc] != NULL) {
+			req_capsule_extend(&sub->rq_pill, batch_fmts[opc]);
+			/* leave it and the rest unprocessed, the client sends
+			 * them again once the locks are released */
+			if (mdt_batch_reint_conflict(info, req, opc, rec)) {
+				CDEBUG(D_INFO, "%s: batched reint %u opc %u xid "
+				       "%llu conflicts with a saved lock\n",
+				       mdt_obd_name(info->mti_mdt), i, opc,
+				       xids[i]);
+				mdt_thread_info_fini(info);
+				tsi->tsi_pill = pill;
+				ptlrpc_server_subreq_free(req, sub);
+				break;
+			}
+			rc = mdt_reint_internal(info, NULL, opc);
+		} else {
+			rc = -EOPNOTSUPP;
+		}
+		sub->rq_status = clear_serious(rc);
+		if (sub->rq_repmsg != NULL)
+			target_committed_to_req(sub);
+
+		CDEBUG(D_INFO, "%s: batched reint %u opc %u xid %llu: rc = %d\n",
+		       mdt_obd_name(info->mti_mdt), i, opc, xids[i],
+		       sub->rq_status);
+
+		len = ptlrpc_server_subreq_reply(sub, repbuf + used,
+						 replen - used);
+		/* locks of uncommitted sub-requests are kept until the
+		 * batch reply is committed too */
+		if (sub->rq_transno > req->rq_transno)
+			req->rq_transno = sub->rq_transno;
+		mdt_thread_info_fini(info);
+		tsi->tsi_pill = pill;
+		ptlrpc_server_subreq_free(req, sub);
+		/* the client resends it, the result is reconstructed then */
+		if (len < 0)
+			break;
+
+		used += len;
+		reqbuf += msglen;
+		reqlen -= min(msglen, reqlen);
+	}
+
+	tgt_txn_reset(tsi->tsi_env);
+	repmbh->mbh_count = i;
+	repmbh->mbh_flags = 0;
+	repmbh->mbh_reply_size = used;
+	req_capsule_shrink(pill, &RMF_BATCH_BUF, used, RCL_SERVER);
+	rc = 0;
+	EXIT;
+out:
+	mdt_thread_info_fini(info);
+	return rc;
+}
+
 static int mdt_intent_layout(enum ldlm_intent_flags it_opc,
 			     struct mdt_thread_info *info,
 			     struct ldlm_lock **lockp,
@@ -4941,6 +5367,9 @@ TGT_MDT_HDL(HAS_BODY | HAS_REPLY, MDS_HSM_REQUEST,
 TGT_MDT_HDL(HAS_KEY | HAS_BODY | HAS_REPLY | IS_MUTABLE,
 	    MDS_SWAP_LAYOUTS,
 	    mdt_swap_layouts),
+TGT_MDT_HDL(0,				MDS_BATCH_GETATTR,
+							mdt_batch_getattr),
+TGT_MDT_HDL(IS_MUTABLE,		MDS_BATCH_REINT,	mdt_batch_reint),
 };
 
 static struct tgt_handler mdt_io_ops[] = {
@@ -5510,6 +5939,14 @@ static int mdt_object_init(const struct lu_env *env, struct lu_object *o,
         RETURN(rc);
 }
 
+static void mdt_object_free_rcu(struct rcu_head *head)
+{
+	struct mdt_object *mo = container_of(head, struct mdt_object,
+					     mot_header.loh_rcu);
+
+	OBD_SLAB_FREE_PTR(mo, mdt_object_kmem);
+}
+
 static void mdt_object_free(const struct lu_env *env, struct lu_object *o)
 {
         struct mdt_object *mo = mdt_obj(o);
@@ -5525,7 +5962,7 @@ static void mdt_object_free(const struct lu_env *env, struct lu_object *o)
 
 	lu_object_fini(o);
 	lu_object_header_fini(h);
-	OBD_SLAB_FREE_PTR(mo, mdt_object_kmem);
+	call_rcu(&h->loh_rcu, mdt_object_free_rcu);
 
 	EXIT;
 }
@@ -466,6 +466,9 @@ struct mdt_thread_info {
          * They should be initialized explicitly by the user themselves.
          */
 
+	/* capsule of the current sub-request of MDS_BATCH_GETATTR */
+	struct req_capsule		mti_sub_pill;
+
 	/* XXX: If something is in a union, make sure they do not conflict */
 	struct lu_fid			mti_tmp_fid1;
 	struct lu_fid			mti_tmp_fid2;
@@ -45,8 +45,9 @@
 #include <lustre_nodemap.h>
 
 /* we do nothing because we do not have refcount now */
-static void mdt_mfd_get(void *mfdp)
+static bool mdt_mfd_get(void *mfdp)
 {
+	return true;
 }
 
 static struct portals_handle_ops mfd_open_handle_ops = {
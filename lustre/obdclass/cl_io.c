@@ -1004,6 +1004,7 @@ void cl_page_list_assume(const struct lu_env *env,
 	cl_page_list_for_each(page, plist)
 		cl_page_assume(env, io, page);
 }
+EXPORT_SYMBOL(cl_page_list_assume);
 
 /**
  * Discards all pages in a queue.
@@ -488,6 +488,8 @@ int cl_site_init(struct cl_site *s, struct cl_device *d)
                 cache_stats_init(&s->cs_pages, "pages");
                 for (i = 0; i < ARRAY_SIZE(s->cs_pages_state); ++i)
 			atomic_set(&s->cs_pages_state[0], 0);
+		for (i = 0; i < ARRAY_SIZE(s->cs_page_pool); ++i)
+			atomic_set(&s->cs_page_pool[i], 0);
 		cl_env_percpu_refill();
 	}
 	return result;
@@ -521,11 +523,13 @@ int cl_site_stats_print(const struct cl_site *site, struct seq_file *m)
 		[CPS_PAGEIN]	= "r",
 		[CPS_FREEING]	= "f"
 	};
+	static const char *ppool[CPP_NR] = CPP_NAMES;
 	size_t i;
 
 /*
        lookup    hit  total   busy create
 pages: ...... ...... ...... ...... ...... [...... ...... ...... ......]
+ pool: [hit: ...... miss: ...... free: ......]
 locks: ...... ...... ...... ...... ...... [...... ...... ...... ...... ......]
   env: ...... ...... ...... ...... ......
  */
@@ -536,6 +540,11 @@ locks: ...... ...... ...... ...... ...... [...... ...... ...... ...... ......]
 		seq_printf(m, "%s: %u ", pstate[i],
 			   atomic_read(&site->cs_pages_state[i]));
 	seq_printf(m, "]\n");
+	seq_printf(m, "%5.5s: [", "pool");
+	for (i = 0; i < ARRAY_SIZE(site->cs_page_pool); ++i)
+		seq_printf(m, "%s: %u ", ppool[i],
+			   atomic_read(&site->cs_page_pool[i]));
+	seq_printf(m, "]\n");
 	cache_stats_print(&cl_env_stats, m, 0);
 	seq_printf(m, "\n");
 	return 0;
@@ -1085,6 +1094,7 @@ void cl_global_fini(void)
 {
 	cl_env_percpu_fini();
 	lu_context_key_degister(&cl_key);
+	cl_page_kmem_fini();
 	lu_kmem_fini(cl_object_caches);
 	OBD_FREE(cl_envs, sizeof(*cl_envs) * num_possible_cpus());
 }
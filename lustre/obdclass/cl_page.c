@@ -47,6 +47,21 @@
 
 static void cl_page_delete0(const struct lu_env *env, struct cl_page *pg);
 
+/**
+ * Slab pools for cl_page buffers (cl_page + all layer slices).
+ *
+ * The buffer size only depends on the layers stacked over the object, so
+ * in practice only a handful of distinct sizes are ever seen. Each size
+ * gets its own kmem_cache, which keeps recently freed buffers cached per
+ * CPU and avoids going through the generic allocator for every page. The
+ * arrays are only appended to under cl_page_kmem_mutex and are never
+ * shrunk until module unload, so readers can scan them locklessly.
+ */
+#define CL_PAGE_KMEM_NR		16
+static struct kmem_cache *cl_page_kmem_array[CL_PAGE_KMEM_NR];
+static unsigned short cl_page_kmem_size_array[CL_PAGE_KMEM_NR];
+static DEFINE_MUTEX(cl_page_kmem_mutex);
+
 #ifdef LIBCFS_DEBUG
 # define PASSERT(env, page, expr)                                       \
   do {                                                                    \
@@ -142,6 +157,105 @@ cl_page_at_trusted(const struct cl_page *page,
 	RETURN(NULL);
 }
 
+/**
+ * Returns index of the slab pool for \a bufsize sized cl_page buffers,
+ * creating the pool on first use. Returns -1 if no pool is available, in
+ * which case the caller should fall back to the generic allocator.
+ */
+static int cl_page_kmem_index(unsigned short bufsize)
+{
+	char name[32];
+	int i;
+
+	for (i = 0; i < CL_PAGE_KMEM_NR; i++) {
+		if (cl_page_kmem_size_array[i] == bufsize) {
+			/* pairs with smp_wmb() below */
+			smp_rmb();
+			return i;
+		}
+		if (cl_page_kmem_size_array[i] == 0)
+			break;
+	}
+
+	mutex_lock(&cl_page_kmem_mutex);
+	for (i = 0; i < CL_PAGE_KMEM_NR; i++) {
+		if (cl_page_kmem_size_array[i] == bufsize)
+			break;
+		if (cl_page_kmem_size_array[i] != 0)
+			continue;
+
+		snprintf(name, sizeof(name), "cl_page_kmem-%u", bufsize);
+		cl_page_kmem_array[i] = kmem_cache_create(name, bufsize, 0,
+							  0, NULL);
+		if (cl_page_kmem_array[i] == NULL) {
+			i = CL_PAGE_KMEM_NR;
+			break;
+		}
+		/* publish the cache before its size */
+		smp_wmb();
+		cl_page_kmem_size_array[i] = bufsize;
+		break;
+	}
+	mutex_unlock(&cl_page_kmem_mutex);
+
+	return i < CL_PAGE_KMEM_NR ? i : -1;
+}
+
+/**
+ * Releases all cl_page slab pools. Called at module unload, when no
+ * cl_page can exist any more.
+ */
+void cl_page_kmem_fini(void)
+{
+	int i;
+
+	for (i = 0; i < CL_PAGE_KMEM_NR; i++) {
+		if (cl_page_kmem_array[i] == NULL)
+			break;
+		kmem_cache_destroy(cl_page_kmem_array[i]);
+		cl_page_kmem_array[i] = NULL;
+		cl_page_kmem_size_array[i] = 0;
+	}
+}
+
+static struct cl_page *cl_page_buf_alloc(struct cl_object *o)
+{
+	struct cl_site *site = cl_object_site(o);
+	unsigned short bufsize = cl_object_header(o)->coh_page_bufsize;
+	struct cl_page *page;
+	int index;
+
+	index = cl_page_kmem_index(bufsize);
+	if (likely(index >= 0)) {
+		OBD_SLAB_ALLOC_GFP(page, cl_page_kmem_array[index], bufsize,
+				   GFP_NOFS);
+		if (page != NULL)
+			atomic_inc(&site->cs_page_pool[CPP_hit]);
+	} else {
+		OBD_ALLOC_GFP(page, bufsize, GFP_NOFS);
+		if (page != NULL)
+			atomic_inc(&site->cs_page_pool[CPP_miss]);
+	}
+	if (page != NULL)
+		page->cp_kmem_index = index;
+
+	return page;
+}
+
+static void cl_page_buf_free(struct cl_object *o, struct cl_page *page,
+			     unsigned short bufsize)
+{
+	int index = page->cp_kmem_index;
+
+	if (likely(index >= 0)) {
+		LASSERT(cl_page_kmem_size_array[index] == bufsize);
+		OBD_SLAB_FREE(page, cl_page_kmem_array[index], bufsize);
+		atomic_inc(&cl_object_site(o)->cs_page_pool[CPP_free]);
+	} else {
+		OBD_FREE(page, bufsize);
+	}
+}
+
 static void cl_page_free(const struct lu_env *env, struct cl_page *page,
 			 struct pagevec *pvec)
 {
@@ -165,9 +279,9 @@ static void cl_page_free(const struct lu_env *env, struct cl_page *page,
 	cs_page_dec(obj, CS_total);
 	cs_pagestate_dec(obj, page->cp_state);
 	lu_object_ref_del_at(&obj->co_lu, &page->cp_obj_ref, "cl_page", page);
-	cl_object_put(env, obj);
 	lu_ref_fini(&page->cp_reference);
-	OBD_FREE(page, pagesize);
+	cl_page_buf_free(obj, page, pagesize);
+	cl_object_put(env, obj);
 	EXIT;
 }
 
@@ -190,8 +304,7 @@ struct cl_page *cl_page_alloc(const struct lu_env *env,
 	struct lu_object_header *head;
 
 	ENTRY;
-	OBD_ALLOC_GFP(page, cl_object_header(o)->coh_page_bufsize,
-			GFP_NOFS);
+	page = cl_page_buf_alloc(o);
 	if (page != NULL) {
 		int result = 0;
 		atomic_set(&page->cp_ref, 1);
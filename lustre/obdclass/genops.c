@@ -1015,9 +1015,11 @@ static void class_export_destroy(struct obd_export *exp)
         EXIT;
 }
 
-static void export_handle_addref(void *export)
+static bool export_handle_addref(void *export)
 {
-        class_export_get(export);
+	struct obd_export *exp = export;
+
+	return atomic_inc_not_zero(&exp->exp_refcount);
 }
 
 static struct portals_handle_ops export_handle_ops = {
@@ -788,6 +788,10 @@ static const char *obd_connect_names[] = {
 	"pcc",			/* 0x1000 */
 	"plain_layout",		/* 0x2000 */
 	"async_discard",	/* 0x4000 */
+	"batch_getattr",	/* 0x8000 */
+	"multi_obj_brw",	/* 0x10000 */
+	"batch_reint",		/* 0x20000 */
+	"batch_bl_ast",		/* 0x40000 */
 	NULL
 };
 
@@ -1651,6 +1655,8 @@ static const char * const mps_stats[] = {
 	[LPROC_MD_SETXATTR]		= "setxattr",
 	[LPROC_MD_GETXATTR]		= "getxattr",
 	[LPROC_MD_INTENT_GETATTR_ASYNC]	= "intent_getattr_async",
+	[LPROC_MD_INTENT_GETATTR_BATCH]	= "intent_getattr_batch",
+	[LPROC_MD_BATCH_REINT]		= "batch_reint",
 	[LPROC_MD_REVALIDATE_LOCK]	= "revalidate_lock",
 };
 
@@ -42,6 +42,7 @@
 
 #include <linux/module.h>
 #include <linux/list.h>
+#include <linux/delay.h>
 #ifdef HAVE_PROCESSOR_H
 #include <linux/processor.h>
 #else
@@ -49,7 +50,6 @@
 #endif
 
 #include <libcfs/libcfs.h>
-#include <libcfs/libcfs_hash.h> /* hash_long() */
 #include <libcfs/linux/linux-mem.h>
 #include <obd_class.h>
 #include <obd_support.h>
@@ -60,12 +60,19 @@
 
 struct lu_site_bkt_data {
 	/**
-	 * LRU list, updated on each access to object. Protected by
-	 * bucket lock of lu_site::ls_obj_hash.
+	 * Protects lsb_lru, the LU_OBJECT_UNHASHED bit and the transitions
+	 * of lu_object_header::loh_ref from and to 0 for the objects of
+	 * this bucket.
+	 */
+	spinlock_t			lsb_lock;
+	/**
+	 * LRU list of the objects of this bucket. Objects are added when
+	 * they are inserted into lu_site::ls_obj_hash and stay on the list
+	 * until they are taken out of the cache. Lookup only sets
+	 * LU_OBJECT_ACCESSED, the list is reordered lazily by
+	 * lu_site_purge_objects().
 	 *
-	 * "Cold" end of LRU is lu_site::ls_lru.next. Accessed object are
-	 * moved to the lu_site::ls_lru.prev (this is due to the non-existence
-	 * of list_for_each_entry_safe_reverse()).
+	 * "Cold" end of LRU is lsb_lru.next.
 	 */
 	struct list_head		lsb_lru;
 	/**
@@ -95,7 +102,7 @@ enum {
 #define LU_SITE_BITS_MAX    24
 #define LU_SITE_BITS_MAX_CL 19
 /**
- * total 256 buckets, we don't want too many buckets because:
+ * at least 256 LRU buckets, we don't want too many buckets because:
  * - consume too much memory
  * - avoid unbalanced LRU list
  */
@@ -113,18 +120,51 @@ MODULE_PARM_DESC(lu_cache_nr, "Maximum number of objects in lu_object cache");
 static void lu_object_free(const struct lu_env *env, struct lu_object *o);
 static __u32 ls_stats_read(struct lprocfs_stats *stats, int idx);
 
+static u32 lu_obj_hop_hash(const void *data, u32 len, u32 seed)
+{
+	const struct lu_fid *fid = data;
+
+	seed = cfs_hash_32(seed ^ fid->f_oid, 32);
+	seed ^= cfs_hash_64(fid->f_seq, 32);
+	return seed;
+}
+
+static const struct rhashtable_params obj_hash_params = {
+	.key_len	= sizeof(struct lu_fid),
+	.key_offset	= offsetof(struct lu_object_header, loh_fid),
+	.head_offset	= offsetof(struct lu_object_header, loh_hash),
+	.hashfn		= lu_obj_hop_hash,
+	.min_size	= 1 << LU_SITE_BITS_MIN,
+	.automatic_shrinking = true,
+};
+
+static inline struct lu_site_bkt_data *
+lu_site_bkt_from_fid(struct lu_site *site, const struct lu_fid *fid)
+{
+	u32 hash = lu_obj_hop_hash(fid, sizeof(*fid), site->ls_bkt_seed);
+
+	return &site->ls_bkts[hash & (site->ls_bkt_cnt - 1)];
+}
+
 wait_queue_head_t *
 lu_site_wq_from_fid(struct lu_site *site, struct lu_fid *fid)
 {
-	struct cfs_hash_bd bd;
-	struct lu_site_bkt_data *bkt;
-
-	cfs_hash_bd_get(site->ls_obj_hash, fid, &bd);
-	bkt = cfs_hash_bd_extra_get(site->ls_obj_hash, &bd);
-	return &bkt->lsb_marche_funebre;
+	return &lu_site_bkt_from_fid(site, fid)->lsb_marche_funebre;
 }
 EXPORT_SYMBOL(lu_site_wq_from_fid);
 
+/**
+ * Take \a h out of the hash table and the LRU, called under the bucket lock
+ * after LU_OBJECT_UNHASHED was set.
+ */
+static void lu_object_unhash_locked(struct lu_site *site,
+				    struct lu_object_header *h)
+{
+	rhashtable_remove_fast(&site->ls_obj_hash, &h->loh_hash,
+			       obj_hash_params);
+	list_del_init(&h->loh_lru);
+}
+
 /**
  * Decrease reference counter on object. If last reference is freed, return
  * object to the cache, unless lu_object_is_dying(o) holds. In the latter
@@ -136,7 +176,6 @@ void lu_object_put(const struct lu_env *env, struct lu_object *o)
 	struct lu_object_header *top = o->lo_header;
 	struct lu_site *site = o->lo_dev->ld_site;
 	struct lu_object *orig = o;
-	struct cfs_hash_bd bd;
 	const struct lu_fid *fid = lu_object_fid(o);
 	bool is_dying;
 
@@ -146,8 +185,6 @@ void lu_object_put(const struct lu_env *env, struct lu_object *o)
 	 * so we should not remove it from the site.
 	 */
 	if (fid_is_zero(fid)) {
-		LASSERT(top->loh_hash.next == NULL
-			&& top->loh_hash.pprev == NULL);
 		LASSERT(list_empty(&top->loh_lru));
 		if (!atomic_dec_and_test(&top->loh_ref))
 			return;
@@ -159,11 +196,12 @@ void lu_object_put(const struct lu_env *env, struct lu_object *o)
 		return;
 	}
 
-	cfs_hash_bd_get(site->ls_obj_hash, &top->loh_fid, &bd);
-	bkt = cfs_hash_bd_extra_get(site->ls_obj_hash, &bd);
+	bkt = lu_site_bkt_from_fid(site, &top->loh_fid);
 
 	is_dying = lu_object_is_dying(top);
-	if (!cfs_hash_bd_dec_and_lock(site->ls_obj_hash, &bd, &top->loh_ref)) {
+	/* only the last reference needs the bucket lock */
+	if (atomic_add_unless(&top->loh_ref, -1, 1)) {
+still_active:
 		/* at this point the object reference is dropped and lock is
 		 * not taken, so lu_object should not be touched because it
 		 * can be freed by concurrent thread. Use local variable for
@@ -179,6 +217,12 @@ void lu_object_put(const struct lu_env *env, struct lu_object *o)
 		return;
 	}
 
+	spin_lock(&bkt->lsb_lock);
+	if (!atomic_dec_and_test(&top->loh_ref)) {
+		spin_unlock(&bkt->lsb_lock);
+		goto still_active;
+	}
+
 	/*
 	 * When last reference is released, iterate over object
 	 * layers, and notify them that object is no longer busy.
@@ -194,12 +238,13 @@ void lu_object_put(const struct lu_env *env, struct lu_object *o)
 	 */
 	if (!lu_object_is_dying(top) &&
 	    (lu_object_exists(orig) || lu_object_is_cl(orig))) {
-		LASSERT(list_empty(&top->loh_lru));
-		list_add_tail(&top->loh_lru, &bkt->lsb_lru);
+		/* the object is already on the bucket LRU, it just becomes
+		 * reclaimable */
+		LASSERT(!list_empty(&top->loh_lru));
 		percpu_counter_inc(&site->ls_lru_len_counter);
-		CDEBUG(D_INODE, "Add %p/%p to site lru. hash: %p, bkt: %p\n",
-		       orig, top, site->ls_obj_hash, bkt);
-		cfs_hash_bd_unlock(site->ls_obj_hash, &bd, 1);
+		spin_unlock(&bkt->lsb_lock);
+		CDEBUG(D_INODE, "Add %p/%p to site lru. bkt: %p\n",
+		       orig, top, bkt);
 		return;
 	}
 
@@ -207,16 +252,18 @@ void lu_object_put(const struct lu_env *env, struct lu_object *o)
 	 * If object is dying (will not be cached) then remove it
 	 * from hash table and LRU.
 	 *
-	 * This is done with hash table and LRU lists locked. As the only
-	 * way to acquire first reference to previously unreferenced
-	 * object is through hash-table lookup (lu_object_find()),
-	 * or LRU scanning (lu_site_purge()), that are done under hash-table
-	 * and LRU lock, no race with concurrent object lookup is possible
-	 * and we can safely destroy object below.
+	 * This is done with the bucket locked. As the only way to acquire
+	 * first reference to previously unreferenced object is through
+	 * hash-table lookup (lu_object_find()), or LRU scanning
+	 * (lu_site_purge()), that check LU_OBJECT_UNHASHED under the bucket
+	 * lock, no race with concurrent object lookup is possible and we can
+	 * safely destroy object below. Lockless lookups which have already
+	 * found the object in the hash table only look at the header, which
+	 * is freed after a RCU grace period.
 	 */
 	if (!test_and_set_bit(LU_OBJECT_UNHASHED, &top->loh_flags))
-		cfs_hash_bd_del_locked(site->ls_obj_hash, &bd, &top->loh_hash);
-	cfs_hash_bd_unlock(site->ls_obj_hash, &bd, 1);
+		lu_object_unhash_locked(site, top);
+	spin_unlock(&bkt->lsb_lock);
 	/*
 	 * Object was already removed from hash and lru above, can
 	 * kill it.
@@ -242,26 +289,23 @@ EXPORT_SYMBOL(lu_object_put_nocache);
  */
 void lu_object_unhash(const struct lu_env *env, struct lu_object *o)
 {
-	struct lu_object_header *top;
+	struct lu_object_header *top = o->lo_header;
+	struct lu_site *site = o->lo_dev->ld_site;
+	struct lu_site_bkt_data *bkt;
 
-	top = o->lo_header;
 	set_bit(LU_OBJECT_HEARD_BANSHEE, &top->loh_flags);
-	if (!test_and_set_bit(LU_OBJECT_UNHASHED, &top->loh_flags)) {
-		struct lu_site *site = o->lo_dev->ld_site;
-		struct cfs_hash *obj_hash = site->ls_obj_hash;
-		struct cfs_hash_bd bd;
-
-		cfs_hash_bd_get_and_lock(obj_hash, &top->loh_fid, &bd, 1);
-		if (!list_empty(&top->loh_lru)) {
-			struct lu_site_bkt_data *bkt;
+	if (test_bit(LU_OBJECT_UNHASHED, &top->loh_flags))
+		return;
 
-			list_del_init(&top->loh_lru);
-			bkt = cfs_hash_bd_extra_get(obj_hash, &bd);
+	bkt = lu_site_bkt_from_fid(site, &top->loh_fid);
+	spin_lock(&bkt->lsb_lock);
+	if (!test_and_set_bit(LU_OBJECT_UNHASHED, &top->loh_flags)) {
+		lu_object_unhash_locked(site, top);
+		/* unreferenced objects are in ls_lru_len_counter */
+		if (atomic_read(&top->loh_ref) == 0)
 			percpu_counter_dec(&site->ls_lru_len_counter);
-		}
-		cfs_hash_bd_del_locked(obj_hash, &bd, &top->loh_hash);
-		cfs_hash_bd_unlock(obj_hash, &bd, 1);
 	}
+	spin_unlock(&bkt->lsb_lock);
 }
 EXPORT_SYMBOL(lu_object_unhash);
 
@@ -388,34 +432,38 @@ static void lu_object_free(const struct lu_env *env, struct lu_object *o)
  * Free \a nr objects from the cold end of the site LRU list.
  * if canblock is 0, then don't block awaiting for another
  * instance of lu_site_purge() to complete
+ *
+ * The LRU lists also hold referenced objects and objects accessed since
+ * the last scan, they are moved to the hot end of the list instead (the
+ * latter only when not purging the whole site).
  */
 int lu_site_purge_objects(const struct lu_env *env, struct lu_site *s,
 			  int nr, int canblock)
 {
-        struct lu_object_header *h;
-        struct lu_object_header *temp;
-        struct lu_site_bkt_data *bkt;
-	struct cfs_hash_bd            bd;
-	struct cfs_hash_bd            bd2;
+	struct lu_object_header *h;
+	struct lu_object_header *temp;
+	struct lu_site_bkt_data *bkt;
 	struct list_head	 dispose;
-	int                      did_sth;
+	struct list_head	 rotate;
+	int			 did_sth;
 	unsigned int		 start = 0;
-        int                      count;
-        int                      bnr;
-	unsigned int             i;
+	int			 count;
+	int			 bnr;
+	unsigned int		 i;
 
 	if (OBD_FAIL_CHECK(OBD_FAIL_OBD_NO_LRU))
 		RETURN(0);
 
 	INIT_LIST_HEAD(&dispose);
-        /*
-         * Under LRU list lock, scan LRU list and move unreferenced objects to
-         * the dispose list, removing them from LRU and hash table.
-         */
+	INIT_LIST_HEAD(&rotate);
+	/*
+	 * Under LRU list lock, scan LRU list and move unreferenced objects to
+	 * the dispose list, removing them from LRU and hash table.
+	 */
 	if (nr != ~0)
 		start = s->ls_purge_start;
-	bnr = (nr == ~0) ? -1 : nr / (int)CFS_HASH_NBKT(s->ls_obj_hash) + 1;
- again:
+	bnr = (nr == ~0) ? -1 : nr / (int)s->ls_bkt_cnt + 1;
+again:
 	/*
 	 * It doesn't make any sense to make purge threads parallel, that can
 	 * only bring troubles to us. See LU-5331.
@@ -425,35 +473,36 @@ int lu_site_purge_objects(const struct lu_env *env, struct lu_site *s,
 	else if (mutex_trylock(&s->ls_purge_mutex) == 0)
 		goto out;
 
-        did_sth = 0;
-        cfs_hash_for_each_bucket(s->ls_obj_hash, &bd, i) {
-                if (i < start)
-                        continue;
-                count = bnr;
-                cfs_hash_bd_lock(s->ls_obj_hash, &bd, 1);
-                bkt = cfs_hash_bd_extra_get(s->ls_obj_hash, &bd);
+	did_sth = 0;
+	for (i = start; i < s->ls_bkt_cnt; i++) {
+		count = bnr;
+		bkt = &s->ls_bkts[i];
+		spin_lock(&bkt->lsb_lock);
 
 		list_for_each_entry_safe(h, temp, &bkt->lsb_lru, loh_lru) {
-			LASSERT(atomic_read(&h->loh_ref) == 0);
-
-                        cfs_hash_bd_get(s->ls_obj_hash, &h->loh_fid, &bd2);
-                        LASSERT(bd.bd_bucket == bd2.bd_bucket);
+			if (atomic_read(&h->loh_ref) > 0 ||
+			    (nr != ~0 &&
+			     test_and_clear_bit(LU_OBJECT_ACCESSED,
+						&h->loh_flags))) {
+				list_move_tail(&h->loh_lru, &rotate);
+				continue;
+			}
 
-                        cfs_hash_bd_del_locked(s->ls_obj_hash,
-                                               &bd2, &h->loh_hash);
-			list_move(&h->loh_lru, &dispose);
+			set_bit(LU_OBJECT_UNHASHED, &h->loh_flags);
+			lu_object_unhash_locked(s, h);
+			list_add(&h->loh_lru, &dispose);
 			percpu_counter_dec(&s->ls_lru_len_counter);
-                        if (did_sth == 0)
-                                did_sth = 1;
+			if (did_sth == 0)
+				did_sth = 1;
 
-                        if (nr != ~0 && --nr == 0)
-                                break;
-
-                        if (count > 0 && --count == 0)
-                                break;
+			if (nr != ~0 && --nr == 0)
+				break;
 
+			if (count > 0 && --count == 0)
+				break;
 		}
-		cfs_hash_bd_unlock(s->ls_obj_hash, &bd, 1);
+		list_splice_tail_init(&rotate, &bkt->lsb_lru);
+		spin_unlock(&bkt->lsb_lock);
 		cond_resched();
 		/*
 		 * Free everything on the dispose list. This is safe against
@@ -467,20 +516,20 @@ int lu_site_purge_objects(const struct lu_env *env, struct lu_site *s,
 			lprocfs_counter_incr(s->ls_stats, LU_SS_LRU_PURGED);
 		}
 
-                if (nr == 0)
-                        break;
-        }
+		if (nr == 0)
+			break;
+	}
 	mutex_unlock(&s->ls_purge_mutex);
 
-        if (nr != 0 && did_sth && start != 0) {
-                start = 0; /* restart from the first bucket */
-                goto again;
-        }
-        /* race on s->ls_purge_start, but nobody cares */
-        s->ls_purge_start = i % CFS_HASH_NBKT(s->ls_obj_hash);
+	if (nr != 0 && did_sth && start != 0) {
+		start = 0; /* restart from the first bucket */
+		goto again;
+	}
+	/* race on s->ls_purge_start, but nobody cares */
+	s->ls_purge_start = i % s->ls_bkt_cnt;
 
 out:
-        return nr;
+	return nr;
 }
 EXPORT_SYMBOL(lu_site_purge_objects);
 
@@ -574,9 +623,9 @@ void lu_object_header_print(const struct lu_env *env, void *cookie,
 	(*printer)(env, cookie, "header@%p[%#lx, %d, "DFID"%s%s%s]",
 		   hdr, hdr->loh_flags, atomic_read(&hdr->loh_ref),
 		   PFID(&hdr->loh_fid),
-		   hlist_unhashed(&hdr->loh_hash) ? "" : " hash",
-		   list_empty((struct list_head *)&hdr->loh_lru) ? \
-		   "" : " lru",
+		   list_empty(&hdr->loh_lru) ? "" : " hash",
+		   list_empty(&hdr->loh_lru) ||
+		   atomic_read(&hdr->loh_ref) > 0 ? "" : " lru",
 		   hdr->loh_attr & LOHA_EXISTS ? " exist" : "");
 }
 EXPORT_SYMBOL(lu_object_header_print);
@@ -628,39 +677,129 @@ int lu_object_invariant(const struct lu_object *o)
         return 1;
 }
 
+/**
+ * Take a reference on \a h found in the hash table under rcu_read_lock().
+ *
+ * \retval false if the object is being taken out of the cache
+ */
+static bool lu_object_get_cached(struct lu_site *s,
+				 struct lu_site_bkt_data *bkt,
+				 struct lu_object_header *h)
+{
+	bool found = true;
+
+	if (!atomic_inc_not_zero(&h->loh_ref)) {
+		/* unreferenced objects can be purged concurrently */
+		spin_lock(&bkt->lsb_lock);
+		if (test_bit(LU_OBJECT_UNHASHED, &h->loh_flags))
+			found = false;
+		else if (atomic_inc_return(&h->loh_ref) == 1)
+			percpu_counter_dec(&s->ls_lru_len_counter);
+		spin_unlock(&bkt->lsb_lock);
+	}
+
+	/* lazy LRU: just mark the object, lu_site_purge_objects() will
+	 * move it to the hot end of the list */
+	if (found && !test_bit(LU_OBJECT_ACCESSED, &h->loh_flags))
+		set_bit(LU_OBJECT_ACCESSED, &h->loh_flags);
+
+	return found;
+}
+
 static struct lu_object *htable_lookup(struct lu_site *s,
-				       struct cfs_hash_bd *bd,
-				       const struct lu_fid *f,
-				       __u64 *version)
+				       struct lu_site_bkt_data *bkt,
+				       const struct lu_fid *f)
 {
-	struct lu_site_bkt_data	*bkt;
 	struct lu_object_header	*h;
-	struct hlist_node *hnode;
-	__u64 ver = cfs_hash_bd_version_get(bd);
 
-	if (*version == ver)
-		return ERR_PTR(-ENOENT);
-
-	*version = ver;
-	bkt = cfs_hash_bd_extra_get(s->ls_obj_hash, bd);
-	/* cfs_hash_bd_peek_locked is a somehow "internal" function
-	 * of cfs_hash, it doesn't add refcount on object. */
-	hnode = cfs_hash_bd_peek_locked(s->ls_obj_hash, bd, (void *)f);
-	if (!hnode) {
+	rcu_read_lock();
+	h = rhashtable_lookup(&s->ls_obj_hash, f, obj_hash_params);
+	if (h == NULL || !lu_object_get_cached(s, bkt, h)) {
+		rcu_read_unlock();
 		lprocfs_counter_incr(s->ls_stats, LU_SS_CACHE_MISS);
 		return ERR_PTR(-ENOENT);
 	}
+	rcu_read_unlock();
 
-	h = container_of0(hnode, struct lu_object_header, loh_hash);
-	cfs_hash_get(s->ls_obj_hash, hnode);
 	lprocfs_counter_incr(s->ls_stats, LU_SS_CACHE_HIT);
-	if (!list_empty(&h->loh_lru)) {
-		list_del_init(&h->loh_lru);
-		percpu_counter_dec(&s->ls_lru_len_counter);
+	return lu_object_top(h);
+}
+
+/**
+ * Insert the newly allocated object \a o into the hash table, unless an
+ * object with the same fid is already cached.
+ *
+ * \retval NULL	\a o was inserted
+ * \retval object	cached object with a reference held
+ * \retval ERR_PTR	on error
+ */
+static struct lu_object *htable_insert(struct lu_site *s,
+				       struct lu_site_bkt_data *bkt,
+				       struct lu_object *o)
+{
+	struct lu_object_header	*new = o->lo_header;
+	struct lu_object_header	*h;
+
+try_again:
+	rcu_read_lock();
+	spin_lock(&bkt->lsb_lock);
+	h = rhashtable_lookup_get_insert_fast(&s->ls_obj_hash, &new->loh_hash,
+					      obj_hash_params);
+	if (h == NULL)
+		list_add_tail(&new->loh_lru, &bkt->lsb_lru);
+	spin_unlock(&bkt->lsb_lock);
+
+	if (IS_ERR_OR_NULL(h)) {
+		rcu_read_unlock();
+		/* the table is being resized, or is short of memory */
+		if (PTR_ERR(h) == -EBUSY || PTR_ERR(h) == -ENOMEM) {
+			msleep(20);
+			goto try_again;
+		}
+		return ERR_CAST(h);
 	}
+
+	if (!lu_object_get_cached(s, bkt, h)) {
+		/* cached object is being freed, it is out of the table */
+		rcu_read_unlock();
+		goto try_again;
+	}
+	rcu_read_unlock();
+
 	return lu_object_top(h);
 }
 
+/**
+ * Get a reference on the slice of device \a dev of object \a h, found by a
+ * walk of lu_site::ls_obj_hash under rcu_read_lock().
+ *
+ * \retval NULL if the object is dying or has no such slice
+ */
+struct lu_object *lu_object_get_first(struct lu_object_header *h,
+				      struct lu_device *dev)
+{
+	struct lu_site *s = dev->ld_site;
+	struct lu_site_bkt_data *bkt;
+	struct lu_object *ret = NULL;
+
+	if (IS_ERR_OR_NULL(h) || lu_object_is_dying(h))
+		return NULL;
+
+	/* the layers of an object still in the cache are stable under the
+	 * bucket lock, even if it is unreferenced */
+	bkt = lu_site_bkt_from_fid(s, &h->loh_fid);
+	spin_lock(&bkt->lsb_lock);
+	if (!test_bit(LU_OBJECT_UNHASHED, &h->loh_flags)) {
+		ret = lu_object_locate(h, dev->ld_type);
+		if (ret != NULL && atomic_inc_return(&h->loh_ref) == 1)
+			percpu_counter_dec(&s->ls_lru_len_counter);
+	}
+	spin_unlock(&bkt->lsb_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL(lu_object_get_first);
+
 /**
  * Search cache for an object with the fid \a f. If such object is found,
  * return it. Otherwise, create new object, insert it into cache and return
@@ -689,7 +828,7 @@ static void lu_object_limit(const struct lu_env *env,
 	if (lu_cache_nr == LU_CACHE_NR_UNLIMITED)
 		return;
 
-	size = cfs_hash_size_get(dev->ld_site->ls_obj_hash);
+	size = atomic_read(&dev->ld_site->ls_obj_hash.nelems);
 	nr = (__u64)lu_cache_nr;
 	if (size <= nr)
 		return;
@@ -713,21 +852,18 @@ struct lu_object *lu_object_find_at(const struct lu_env *env,
 	struct lu_object *o;
 	struct lu_object *shadow;
 	struct lu_site *s;
-	struct cfs_hash *hs;
-	struct cfs_hash_bd bd;
-	__u64 version = 0;
+	struct lu_site_bkt_data *bkt;
 
 	/*
 	 * This uses standard index maintenance protocol:
 	 *
-	 *     - search index under lock, and return object if found;
-	 *     - otherwise, unlock index, allocate new object;
-	 *     - lock index and search again;
-	 *     - if nothing is found (usual case), insert newly created
-	 *       object into index;
+	 *     - search index under RCU, and return object if found;
+	 *     - otherwise, allocate new object;
+	 *     - lock bucket, search again and insert newly created object
+	 *       into index if nothing is found (usual case);
 	 *     - otherwise (race: other thread inserted object), free
 	 *       object just allocated.
-	 *     - unlock index;
+	 *     - unlock bucket;
 	 *     - return object.
 	 *
 	 * For "LOC_F_NEW" case, we are sure the object is new established.
@@ -736,13 +872,9 @@ struct lu_object *lu_object_find_at(const struct lu_env *env,
 	 *
 	 */
 	s  = dev->ld_site;
-	hs = s->ls_obj_hash;
-	cfs_hash_bd_get(hs, f, &bd);
+	bkt = lu_site_bkt_from_fid(s, f);
 	if (!(conf && conf->loc_flags & LOC_F_NEW)) {
-		cfs_hash_bd_lock(hs, &bd, 1);
-		o = htable_lookup(s, &bd, f, &version);
-		cfs_hash_bd_unlock(hs, &bd, 1);
-
+		o = htable_lookup(s, bkt, f);
 		if (!IS_ERR(o) || PTR_ERR(o) != -ENOENT)
 			return o;
 	}
@@ -756,23 +888,15 @@ struct lu_object *lu_object_find_at(const struct lu_env *env,
 
 	LASSERT(lu_fid_eq(lu_object_fid(o), f));
 
-	cfs_hash_bd_lock(hs, &bd, 1);
-
-	if (conf && conf->loc_flags & LOC_F_NEW)
-		shadow = ERR_PTR(-ENOENT);
-	else
-		shadow = htable_lookup(s, &bd, f, &version);
-	if (likely(PTR_ERR(shadow) == -ENOENT)) {
-		cfs_hash_bd_add_locked(hs, &bd, &o->lo_header->loh_hash);
-		cfs_hash_bd_unlock(hs, &bd, 1);
-
+	shadow = htable_insert(s, bkt, o);
+	if (likely(shadow == NULL)) {
 		lu_object_limit(env, dev);
 
 		return o;
 	}
 
-	lprocfs_counter_incr(s->ls_stats, LU_SS_CACHE_RACE);
-	cfs_hash_bd_unlock(hs, &bd, 1);
+	if (!IS_ERR(shadow))
+		lprocfs_counter_incr(s->ls_stats, LU_SS_CACHE_RACE);
 	lu_object_free(env, o);
 	return shadow;
 }
@@ -839,14 +963,18 @@ struct lu_site_print_arg {
         lu_printer_t     lsp_printer;
 };
 
-static int
-lu_site_obj_print(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-		  struct hlist_node *hnode, void *data)
+static void lu_site_obj_print(struct lu_site *s, struct lu_object_header *h,
+			      struct lu_site_print_arg *arg)
 {
-	struct lu_site_print_arg *arg = (struct lu_site_print_arg *)data;
-	struct lu_object_header  *h;
+	struct lu_site_bkt_data *bkt = lu_site_bkt_from_fid(s, &h->loh_fid);
+
+	/* objects out of the table may be freed concurrently */
+	spin_lock(&bkt->lsb_lock);
+	if (test_bit(LU_OBJECT_UNHASHED, &h->loh_flags)) {
+		spin_unlock(&bkt->lsb_lock);
+		return;
+	}
 
-	h = hlist_entry(hnode, struct lu_object_header, loh_hash);
 	if (!list_empty(&h->loh_layers)) {
 		const struct lu_object *o;
 
@@ -857,7 +985,7 @@ lu_site_obj_print(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 		lu_object_header_print(arg->lsp_env, arg->lsp_cookie,
 				       arg->lsp_printer, h);
 	}
-	return 0;
+	spin_unlock(&bkt->lsb_lock);
 }
 
 /**
@@ -866,13 +994,24 @@ lu_site_obj_print(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 void lu_site_print(const struct lu_env *env, struct lu_site *s, void *cookie,
                    lu_printer_t printer)
 {
-        struct lu_site_print_arg arg = {
-                .lsp_env     = (struct lu_env *)env,
-                .lsp_cookie  = cookie,
-                .lsp_printer = printer,
-        };
+	struct lu_site_print_arg arg = {
+		.lsp_env     = (struct lu_env *)env,
+		.lsp_cookie  = cookie,
+		.lsp_printer = printer,
+	};
+	struct rhashtable_iter iter;
+	struct lu_object_header *h;
 
-        cfs_hash_for_each(s->ls_obj_hash, lu_site_obj_print, &arg);
+	rhashtable_walk_enter(&s->ls_obj_hash, &iter);
+	rhashtable_walk_start(&iter);
+	while ((h = rhashtable_walk_next(&iter)) != NULL) {
+		/* -EAGAIN: the table was resized, go on with the new one */
+		if (IS_ERR(h))
+			continue;
+		lu_site_obj_print(s, h, &arg);
+	}
+	rhashtable_walk_stop(&iter);
+	rhashtable_walk_exit(&iter);
 }
 EXPORT_SYMBOL(lu_site_print);
 
@@ -934,68 +1073,6 @@ static unsigned long lu_htable_order(struct lu_device *top)
 	return clamp_t(typeof(bits), bits, LU_SITE_BITS_MIN, bits_max);
 }
 
-static unsigned lu_obj_hop_hash(struct cfs_hash *hs,
-				const void *key, unsigned mask)
-{
-	struct lu_fid  *fid = (struct lu_fid *)key;
-	__u32           hash;
-
-	hash = fid_flatten32(fid);
-	hash += (hash >> 4) + (hash << 12); /* mixing oid and seq */
-	hash = hash_long(hash, hs->hs_bkt_bits);
-
-	/* give me another random factor */
-	hash -= hash_long((unsigned long)hs, fid_oid(fid) % 11 + 3);
-
-	hash <<= hs->hs_cur_bits - hs->hs_bkt_bits;
-	hash |= (fid_seq(fid) + fid_oid(fid)) & (CFS_HASH_NBKT(hs) - 1);
-
-	return hash & mask;
-}
-
-static void *lu_obj_hop_object(struct hlist_node *hnode)
-{
-	return hlist_entry(hnode, struct lu_object_header, loh_hash);
-}
-
-static void *lu_obj_hop_key(struct hlist_node *hnode)
-{
-	struct lu_object_header *h;
-
-	h = hlist_entry(hnode, struct lu_object_header, loh_hash);
-	return &h->loh_fid;
-}
-
-static int lu_obj_hop_keycmp(const void *key, struct hlist_node *hnode)
-{
-	struct lu_object_header *h;
-
-	h = hlist_entry(hnode, struct lu_object_header, loh_hash);
-	return lu_fid_eq(&h->loh_fid, (struct lu_fid *)key);
-}
-
-static void lu_obj_hop_get(struct cfs_hash *hs, struct hlist_node *hnode)
-{
-	struct lu_object_header *h;
-
-	h = hlist_entry(hnode, struct lu_object_header, loh_hash);
-	atomic_inc(&h->loh_ref);
-}
-
-static void lu_obj_hop_put_locked(struct cfs_hash *hs, struct hlist_node *hnode)
-{
-        LBUG(); /* we should never called it */
-}
-
-static struct cfs_hash_ops lu_site_hash_ops = {
-        .hs_hash        = lu_obj_hop_hash,
-        .hs_key         = lu_obj_hop_key,
-        .hs_keycmp      = lu_obj_hop_keycmp,
-        .hs_object      = lu_obj_hop_object,
-        .hs_get         = lu_obj_hop_get,
-        .hs_put_locked  = lu_obj_hop_put_locked,
-};
-
 void lu_dev_add_linkage(struct lu_site *s, struct lu_device *d)
 {
 	spin_lock(&s->ls_ld_lock);
@@ -1018,10 +1095,8 @@ EXPORT_SYMBOL(lu_dev_del_linkage);
   */
 int lu_site_init(struct lu_site *s, struct lu_device *top)
 {
+	struct rhashtable_params params = obj_hash_params;
 	struct lu_site_bkt_data *bkt;
-	struct cfs_hash_bd bd;
-	char name[16];
-	unsigned long bits;
 	unsigned int i;
 	int rc;
 	ENTRY;
@@ -1037,39 +1112,44 @@ int lu_site_init(struct lu_site *s, struct lu_device *top)
 	if (rc)
 		return -ENOMEM;
 
-	snprintf(name, sizeof(name), "lu_site_%s", top->ld_type->ldt_name);
-	for (bits = lu_htable_order(top);
-	     bits >= LU_SITE_BITS_MIN; bits--) {
-		s->ls_obj_hash = cfs_hash_create(name, bits, bits,
-						 bits - LU_SITE_BKT_BITS,
-						 sizeof(*bkt), 0, 0,
-						 &lu_site_hash_ops,
-						 CFS_HASH_SPIN_BKTLOCK |
-						 CFS_HASH_NO_ITEMREF |
-						 CFS_HASH_DEPTH |
-						 CFS_HASH_ASSERT_EMPTY |
-						 CFS_HASH_COUNTER);
-		if (s->ls_obj_hash != NULL)
-			break;
+	/* the table grows and shrinks with the number of cached objects,
+	 * start with the size expected for the cache as far as the hint,
+	 * which is only 16 bits wide, allows */
+	params.nelem_hint = min_t(unsigned long, USHRT_MAX,
+				  (1UL << lu_htable_order(top)) / 4 * 3);
+	get_random_bytes(&s->ls_bkt_seed, sizeof(s->ls_bkt_seed));
+	rc = rhashtable_init(&s->ls_obj_hash, &params);
+	if (rc) {
+		CERROR("failed to create lu_site hash: rc = %d\n", rc);
+		percpu_counter_destroy(&s->ls_lru_len_counter);
+		return rc;
 	}
 
-	if (s->ls_obj_hash == NULL) {
-		CERROR("failed to create lu_site hash with bits: %lu\n", bits);
+	s->ls_bkt_cnt = max_t(unsigned int, 1 << LU_SITE_BKT_BITS,
+			      2 * num_possible_cpus());
+	s->ls_bkt_cnt = roundup_pow_of_two(s->ls_bkt_cnt);
+	OBD_ALLOC_LARGE(s->ls_bkts, s->ls_bkt_cnt * sizeof(*bkt));
+	if (s->ls_bkts == NULL) {
+		rhashtable_destroy(&s->ls_obj_hash);
+		percpu_counter_destroy(&s->ls_lru_len_counter);
 		return -ENOMEM;
 	}
 
-	cfs_hash_for_each_bucket(s->ls_obj_hash, &bd, i) {
-		bkt = cfs_hash_bd_extra_get(s->ls_obj_hash, &bd);
+	for (i = 0; i < s->ls_bkt_cnt; i++) {
+		bkt = &s->ls_bkts[i];
+		spin_lock_init(&bkt->lsb_lock);
 		INIT_LIST_HEAD(&bkt->lsb_lru);
 		init_waitqueue_head(&bkt->lsb_marche_funebre);
 	}
 
         s->ls_stats = lprocfs_alloc_stats(LU_SS_LAST_STAT, 0);
-        if (s->ls_stats == NULL) {
-                cfs_hash_putref(s->ls_obj_hash);
-                s->ls_obj_hash = NULL;
-                return -ENOMEM;
-        }
+	if (s->ls_stats == NULL) {
+		OBD_FREE_LARGE(s->ls_bkts, s->ls_bkt_cnt * sizeof(*bkt));
+		s->ls_bkts = NULL;
+		rhashtable_destroy(&s->ls_obj_hash);
+		percpu_counter_destroy(&s->ls_lru_len_counter);
+		return -ENOMEM;
+	}
 
         lprocfs_counter_init(s->ls_stats, LU_SS_CREATED,
                              0, "created", "created");
@@ -1110,10 +1190,12 @@ void lu_site_fini(struct lu_site *s)
 
 	percpu_counter_destroy(&s->ls_lru_len_counter);
 
-        if (s->ls_obj_hash != NULL) {
-                cfs_hash_putref(s->ls_obj_hash);
-                s->ls_obj_hash = NULL;
-        }
+	if (s->ls_bkts != NULL) {
+		rhashtable_destroy(&s->ls_obj_hash);
+		OBD_FREE_LARGE(s->ls_bkts,
+			       s->ls_bkt_cnt * sizeof(*s->ls_bkts));
+		s->ls_bkts = NULL;
+	}
 
         if (s->ls_top_dev != NULL) {
                 s->ls_top_dev->ld_site = NULL;
@@ -1269,7 +1351,6 @@ int lu_object_header_init(struct lu_object_header *h)
 {
         memset(h, 0, sizeof *h);
 	atomic_set(&h->loh_ref, 1);
-	INIT_HLIST_NODE(&h->loh_hash);
 	INIT_LIST_HEAD(&h->loh_lru);
 	INIT_LIST_HEAD(&h->loh_layers);
         lu_ref_init(&h->loh_reference);
@@ -1284,11 +1365,29 @@ void lu_object_header_fini(struct lu_object_header *h)
 {
 	LASSERT(list_empty(&h->loh_layers));
 	LASSERT(list_empty(&h->loh_lru));
-	LASSERT(hlist_unhashed(&h->loh_hash));
         lu_ref_fini(&h->loh_reference);
 }
 EXPORT_SYMBOL(lu_object_header_fini);
 
+static void lu_object_header_free_rcu(struct rcu_head *head)
+{
+	struct lu_object_header *h;
+
+	h = container_of(head, struct lu_object_header, loh_rcu);
+	OBD_FREE_PTR(h);
+}
+
+/**
+ * Finalize and free a compound object header allocated on its own, after
+ * a RCU grace period.
+ */
+void lu_object_header_free(struct lu_object_header *h)
+{
+	lu_object_header_fini(h);
+	call_rcu(&h->loh_rcu, lu_object_header_free_rcu);
+}
+EXPORT_SYMBOL(lu_object_header_free);
+
 /**
  * Given a compound object, find its slice, corresponding to the device type
  * \a dtype.
@@ -1983,13 +2082,15 @@ typedef struct lu_site_stats{
         unsigned        lss_max_search;
         unsigned        lss_total;
         unsigned        lss_busy;
+	unsigned	lss_buckets;
 } lu_site_stats_t;
 
 static void lu_site_stats_get(const struct lu_site *s,
                               lu_site_stats_t *stats, int populated)
 {
-	struct cfs_hash *hs = s->ls_obj_hash;
-	struct cfs_hash_bd bd;
+	struct rhashtable *ht = (struct rhashtable *)&s->ls_obj_hash;
+	struct bucket_table *tbl;
+	unsigned int cnt = atomic_read(&ht->nelems);
 	unsigned int i;
 	/*
 	 * percpu_counter_sum_positive() won't accept a const pointer
@@ -1997,26 +2098,24 @@ static void lu_site_stats_get(const struct lu_site *s,
 	 */
 	struct lu_site *s2 = (struct lu_site *)s;
 
-	stats->lss_busy += cfs_hash_size_get(hs) -
+	stats->lss_busy += cnt -
 		percpu_counter_sum_positive(&s2->ls_lru_len_counter);
-        cfs_hash_for_each_bucket(hs, &bd, i) {
-		struct hlist_head *hhead;
-
-                cfs_hash_bd_lock(hs, &bd, 1);
-                stats->lss_total += cfs_hash_bd_count_get(&bd);
-                stats->lss_max_search = max((int)stats->lss_max_search,
-                                            cfs_hash_bd_depmax_get(&bd));
-                if (!populated) {
-                        cfs_hash_bd_unlock(hs, &bd, 1);
-                        continue;
-                }
+	stats->lss_total += cnt;
 
-                cfs_hash_bd_for_each_hlist(hs, &bd, hhead) {
-			if (!hlist_empty(hhead))
-                                stats->lss_populated++;
-                }
-                cfs_hash_bd_unlock(hs, &bd, 1);
-        }
+	rcu_read_lock();
+	tbl = rht_dereference_rcu(ht->tbl, ht);
+	stats->lss_buckets = tbl->size;
+	for (i = 0; populated && i < tbl->size; i++) {
+		struct rhash_head *pos;
+		unsigned int depth = 0;
+
+		rht_for_each_rcu(pos, tbl, i)
+			depth++;
+		if (depth > 0)
+			stats->lss_populated++;
+		stats->lss_max_search = max(stats->lss_max_search, depth);
+	}
+	rcu_read_unlock();
 }
 
 
@@ -2034,7 +2133,7 @@ static void lu_site_stats_get(const struct lu_site *s,
  * Using a per cpu counter is a compromise solution to concurrent access:
  * lu_object_put() can update the counter without locking the site and
  * lu_cache_shrink_count can sum the counters without locking each
- * ls_obj_hash bucket.
+ * lu_site bucket.
  */
 static unsigned long lu_cache_shrink_count(struct shrinker *sk,
 					   struct shrink_control *sc)
@@ -2283,7 +2382,7 @@ int lu_site_stats_seq_print(const struct lu_site *s, struct seq_file *m)
 		   stats.lss_busy,
 		   stats.lss_total,
 		   stats.lss_populated,
-		   CFS_HASH_NHLIST(s->ls_obj_hash),
+		   stats.lss_buckets,
 		   stats.lss_max_search,
 		   ls_stats_read(s->ls_stats, LU_SS_CREATED),
 		   ls_stats_read(s->ls_stats, LU_SS_CACHE_HIT),
@@ -2324,6 +2423,9 @@ EXPORT_SYMBOL(lu_kmem_init);
  */
 void lu_kmem_fini(struct lu_kmem_descr *caches)
 {
+	/* lu_object_header memory is freed by RCU callbacks */
+	rcu_barrier();
+
         for (; caches->ckd_cache != NULL; ++caches) {
                 if (*caches->ckd_cache != NULL) {
 			kmem_cache_destroy(*caches->ckd_cache);
@@ -2342,27 +2444,27 @@ void lu_object_assign_fid(const struct lu_env *env, struct lu_object *o,
 {
 	struct lu_site		*s = o->lo_dev->ld_site;
 	struct lu_fid		*old = &o->lo_header->loh_fid;
-	struct cfs_hash		*hs;
-	struct cfs_hash_bd	 bd;
+	struct lu_site_bkt_data	*bkt;
+	int			 rc;
 
 	LASSERT(fid_is_zero(old));
 
-	/* supposed to be unique */
-	hs = s->ls_obj_hash;
-	cfs_hash_bd_get_and_lock(hs, (void *)fid, &bd, 1);
-#ifdef CONFIG_LUSTRE_DEBUG_EXPENSIVE_CHECK
-	{
-		__u64 version = 0;
-		struct lu_object *shadow;
-
-		shadow = htable_lookup(s, &bd, fid, &version);
-		/* supposed to be unique */
-		LASSERT(IS_ERR(shadow) && PTR_ERR(shadow) == -ENOENT);
-	}
-#endif
 	*old = *fid;
-	cfs_hash_bd_add_locked(hs, &bd, &o->lo_header->loh_hash);
-	cfs_hash_bd_unlock(hs, &bd, 1);
+	bkt = lu_site_bkt_from_fid(s, fid);
+try_again:
+	spin_lock(&bkt->lsb_lock);
+	rc = rhashtable_lookup_insert_fast(&s->ls_obj_hash,
+					   &o->lo_header->loh_hash,
+					   obj_hash_params);
+	if (rc == 0)
+		list_add_tail(&o->lo_header->loh_lru, &bkt->lsb_lru);
+	spin_unlock(&bkt->lsb_lock);
+	if (rc == -EBUSY || rc == -ENOMEM) {
+		msleep(20);
+		goto try_again;
+	}
+	/* supposed to be unique */
+	LASSERTF(rc == 0, DFID": rc = %d\n", PFID(fid), rc);
 }
 EXPORT_SYMBOL(lu_object_assign_fid);
 
@@ -87,12 +87,11 @@ void class_handle_hash(struct portals_handle *h,
 	spin_unlock(&handle_base_lock);
 
 	h->h_ops = ops;
-	spin_lock_init(&h->h_lock);
 
 	bucket = &handle_hash[h->h_cookie & HANDLE_HASH_MASK];
 	spin_lock(&bucket->lock);
 	list_add_rcu(&h->h_link, &bucket->head);
-	h->h_in = 1;
+	WRITE_ONCE(h->h_in, 1);
 	spin_unlock(&bucket->lock);
 
 	CDEBUG(D_INFO, "added object %p with handle %#llx to hash\n",
@@ -112,13 +111,9 @@ static void class_handle_unhash_nolock(struct portals_handle *h)
 	CDEBUG(D_INFO, "removing object %p with handle %#llx from hash\n",
 	       h, h->h_cookie);
 
-	spin_lock(&h->h_lock);
-	if (h->h_in == 0) {
-		spin_unlock(&h->h_lock);
+	if (h->h_in == 0)
 		return;
-	}
-	h->h_in = 0;
-	spin_unlock(&h->h_lock);
+	WRITE_ONCE(h->h_in, 0);
 	list_del_rcu(&h->h_link);
 }
 
@@ -142,7 +137,7 @@ void class_handle_hash_back(struct portals_handle *h)
 
 	spin_lock(&bucket->lock);
 	list_add_rcu(&h->h_link, &bucket->head);
-	h->h_in = 1;
+	WRITE_ONCE(h->h_in, 1);
 	spin_unlock(&bucket->lock);
 
 	EXIT;
@@ -170,12 +165,12 @@ void *class_handle2object(__u64 cookie, const void *owner)
 		if (h->h_cookie != cookie || h->h_owner != owner)
 			continue;
 
-		spin_lock(&h->h_lock);
-		if (likely(h->h_in != 0)) {
-			h->h_ops->hop_addref(h);
+		/* No handle lock: an unhashed handle is skipped, and
+		 * hop_addref() refuses objects whose last reference is
+		 * already gone, so a freed object is never returned. */
+		if (likely(READ_ONCE(h->h_in) != 0) &&
+		    h->h_ops->hop_addref(h))
 			retval = h;
-		}
-		spin_unlock(&h->h_lock);
 		break;
 	}
 	rcu_read_unlock();
@@ -507,6 +507,14 @@ static int echo_object_init(const struct lu_env *env, struct lu_object *obj,
 	RETURN(0);
 }
 
+static void echo_object_free_rcu(struct rcu_head *head)
+{
+	struct echo_object *eco = container_of(head, struct echo_object,
+					       eo_hdr.coh_lu.loh_rcu);
+
+	OBD_SLAB_FREE_PTR(eco, echo_object_kmem);
+}
+
 static void echo_object_free(const struct lu_env *env, struct lu_object *obj)
 {
         struct echo_object *eco    = cl2echo_obj(lu2cl(obj));
@@ -525,7 +533,7 @@ static void echo_object_free(const struct lu_env *env, struct lu_object *obj)
 	if (eco->eo_oinfo != NULL)
 		OBD_FREE_PTR(eco->eo_oinfo);
 
-	OBD_SLAB_FREE_PTR(eco, echo_object_kmem);
+	call_rcu(&eco->eo_hdr.coh_lu.loh_rcu, echo_object_free_rcu);
 	EXIT;
 }
 
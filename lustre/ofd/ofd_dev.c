@@ -250,7 +250,7 @@ static void ofd_stack_fini(const struct lu_env *env, struct ofd_device *m,
 	}
 
 	lu_site_purge(env, top->ld_site, ~0);
-	if (!cfs_hash_is_empty(top->ld_site->ls_obj_hash)) {
+	if (atomic_read(&top->ld_site->ls_obj_hash.nelems)) {
 		LIBCFS_DEBUG_MSG_DATA_DECL(msgdata, D_OTHER, NULL);
 		lu_site_print(env, top->ld_site, &msgdata, lu_cdebug_printer);
 	}
@@ -449,17 +449,25 @@ static int ofd_object_init(const struct lu_env *env, struct lu_object *o,
 	RETURN(rc);
 }
 
+static void ofd_object_free_rcu(struct rcu_head *head)
+{
+	struct ofd_object *of = container_of(head, struct ofd_object,
+					     ofo_header.loh_rcu);
+
+	OBD_SLAB_FREE_PTR(of, ofd_object_kmem);
+}
+
 /**
  * Implementation of lu_object_operations::loo_object_free.
  *
- * Finish OFD object lifecycle and free its memory.
+ * Finish OFD object lifecycle and free its memory after a RCU grace
+ * period, lockless lookups may still look at the object header.
  *
  * \param[in] env	execution environment
  * \param[in] o		LU object of OFD object
  */
 static void ofd_object_free(const struct lu_env *env, struct lu_object *o)
 {
-	struct ofd_object	*of = ofd_obj(o);
 	struct lu_object_header	*h;
 
 	ENTRY;
@@ -470,7 +478,7 @@ static void ofd_object_free(const struct lu_env *env, struct lu_object *o)
 
 	lu_object_fini(o);
 	lu_object_header_fini(h);
-	OBD_SLAB_FREE_PTR(of, ofd_object_kmem);
+	call_rcu(&h->loh_rcu, ofd_object_free_rcu);
 	EXIT;
 }
 
@@ -2402,23 +2410,19 @@ static int ofd_rw_hpreq_lock_match(struct ptlrpc_request *req,
 	enum ldlm_mode  mode;
 	struct ldlm_extent ext;
 	__u32 opc = lustre_msg_get_opc(req->rq_reqmsg);
+	int objcount;
+	int i;
 
 	ENTRY;
 
 	ioo = req_capsule_client_get(&req->rq_pill, &RMF_OBD_IOOBJ);
 	LASSERT(ioo != NULL);
+	objcount = req_capsule_get_size(&req->rq_pill, &RMF_OBD_IOOBJ,
+					RCL_CLIENT) / sizeof(*ioo);
 
 	rnb = req_capsule_client_get(&req->rq_pill, &RMF_NIOBUF_REMOTE);
 	LASSERT(rnb != NULL);
 
-	ext.start = rnb->rnb_offset;
-	rnb += ioo->ioo_bufcnt - 1;
-	ext.end = rnb->rnb_offset + rnb->rnb_len - 1;
-
-	LASSERT(lock->l_resource != NULL);
-	if (!ostid_res_name_eq(&ioo->ioo_oid, &lock->l_resource->lr_name))
-		RETURN(0);
-
 	/* a bulk write can only hold a reference on a PW extent lock
 	 * or GROUP lock.
 	 */
@@ -2431,7 +2435,21 @@ static int ofd_rw_hpreq_lock_match(struct ptlrpc_request *req,
 	if (!(lock->l_granted_mode & mode))
 		RETURN(0);
 
-	RETURN(ldlm_extent_overlap(&lock->l_policy_data.l_extent, &ext));
+	LASSERT(lock->l_resource != NULL);
+	/* a multi-object write may cover locks of any of its objects */
+	for (i = 0; i < objcount; rnb += ioo[i].ioo_bufcnt, i++) {
+		if (!ostid_res_name_eq(&ioo[i].ioo_oid,
+				       &lock->l_resource->lr_name))
+			continue;
+
+		ext.start = rnb[0].rnb_offset;
+		ext.end = rnb[ioo[i].ioo_bufcnt - 1].rnb_offset +
+			  rnb[ioo[i].ioo_bufcnt - 1].rnb_len - 1;
+		RETURN(ldlm_extent_overlap(&lock->l_policy_data.l_extent,
+					   &ext));
+	}
+
+	RETURN(0);
 }
 
 /**
@@ -2453,6 +2471,8 @@ static int ofd_rw_hpreq_check(struct ptlrpc_request *req)
 	struct obd_ioobj	*ioo;
 	struct niobuf_remote	*rnb;
 	int opc;
+	int objcount;
+	int i;
 	struct ldlm_prolong_args pa = { 0 };
 
 	ENTRY;
@@ -2490,6 +2510,18 @@ static int ofd_rw_hpreq_check(struct ptlrpc_request *req)
 
 	ofd_prolong_extent_locks(tsi, &pa);
 
+	/* the other objects of a multi-object write, see tgt_brw_write() */
+	objcount = req_capsule_get_size(&req->rq_pill, &RMF_OBD_IOOBJ,
+					RCL_CLIENT) / sizeof(*ioo);
+	for (i = 1; i < objcount; i++) {
+		rnb++;
+		pa.lpa_extent.start = rnb->rnb_offset;
+		rnb += ioo[i].ioo_bufcnt - 1;
+		pa.lpa_extent.end = rnb->rnb_offset + rnb->rnb_len - 1;
+		ost_fid_build_resid(&ioo[i].ioo_oid.oi_fid, &pa.lpa_resid);
+		ldlm_resource_prolong(&pa);
+	}
+
 	CDEBUG(D_DLMTRACE, "%s: refreshed %u locks timeout for req %p.\n",
 	       tgt_name(tsi->tsi_tgt), pa.lpa_blocks_cnt, req);
 
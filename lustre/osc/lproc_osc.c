@@ -480,6 +480,40 @@ static ssize_t resend_count_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(resend_count);
 
+static ssize_t max_objs_per_rpc_show(struct kobject *kobj,
+				     struct attribute *attr,
+				     char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+
+	return sprintf(buf, "%u\n", obd->u.cli.cl_max_objs_per_rpc);
+}
+
+/* more than one object per write RPC needs OBD_CONNECT2_MULTI_OBJ_BRW */
+static ssize_t max_objs_per_rpc_store(struct kobject *kobj,
+				      struct attribute *attr,
+				      const char *buffer,
+				      size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	if (val == 0 || val > PTLRPC_MAX_BRW_PAGES)
+		return -ERANGE;
+
+	obd->u.cli.cl_max_objs_per_rpc = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(max_objs_per_rpc);
+
 static ssize_t checksum_dump_show(struct kobject *kobj,
 				  struct attribute *attr,
 				  char *buf)
@@ -956,6 +990,7 @@ static struct attribute *osc_attrs[] = {
 	&lustre_attr_max_dirty_mb.attr,
 	&lustre_attr_max_rpcs_in_flight.attr,
 	&lustre_attr_short_io_bytes.attr,
+	&lustre_attr_max_objs_per_rpc.attr,
 	&lustre_attr_resend_count.attr,
 	&lustre_attr_ost_conn_uuid.attr,
 	&lustre_attr_conn_uuid.attr,
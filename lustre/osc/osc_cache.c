@@ -2008,38 +2008,31 @@ static int try_to_add_extent_for_io(struct client_obd *cli,
  * 6. Above steps exit if there is no space in this RPC.
  */
 static unsigned int get_write_extents(struct osc_object *obj,
-				      struct list_head *rpclist)
+				      struct extent_rpc_data *data)
 {
 	struct client_obd *cli = osc_cli(obj);
 	struct osc_extent *ext;
-	struct extent_rpc_data data = {
-		.erd_rpc_list	= rpclist,
-		.erd_page_count	= 0,
-		.erd_max_pages	= cli->cl_max_pages_per_rpc,
-		.erd_max_chunks	= osc_max_write_chunks(cli),
-		.erd_max_extents = 256,
-	};
 
 	LASSERT(osc_object_is_locked(obj));
 	while (!list_empty(&obj->oo_hp_exts)) {
 		ext = list_entry(obj->oo_hp_exts.next, struct osc_extent,
 				 oe_link);
 		LASSERT(ext->oe_state == OES_CACHE);
-		if (!try_to_add_extent_for_io(cli, ext, &data))
-			return data.erd_page_count;
-		EASSERT(ext->oe_nr_pages <= data.erd_max_pages, ext);
+		if (!try_to_add_extent_for_io(cli, ext, data))
+			return data->erd_page_count;
+		EASSERT(ext->oe_nr_pages <= data->erd_max_pages, ext);
 	}
-	if (data.erd_page_count == data.erd_max_pages)
-		return data.erd_page_count;
+	if (data->erd_page_count == data->erd_max_pages)
+		return data->erd_page_count;
 
 	while (!list_empty(&obj->oo_urgent_exts)) {
 		ext = list_entry(obj->oo_urgent_exts.next,
 				 struct osc_extent, oe_link);
-		if (!try_to_add_extent_for_io(cli, ext, &data))
-			return data.erd_page_count;
+		if (!try_to_add_extent_for_io(cli, ext, data))
+			return data->erd_page_count;
 	}
-	if (data.erd_page_count == data.erd_max_pages)
-		return data.erd_page_count;
+	if (data->erd_page_count == data->erd_max_pages)
+		return data->erd_page_count;
 
 	/* One key difference between full extents and other extents: full
 	 * extents can usually only be added if the rpclist was empty, so if we
@@ -2049,11 +2042,11 @@ static unsigned int get_write_extents(struct osc_object *obj,
 	while (!list_empty(&obj->oo_full_exts)) {
 		ext = list_entry(obj->oo_full_exts.next,
 				 struct osc_extent, oe_link);
-		if (!try_to_add_extent_for_io(cli, ext, &data))
+		if (!try_to_add_extent_for_io(cli, ext, data))
 			break;
 	}
-	if (data.erd_page_count == data.erd_max_pages)
-		return data.erd_page_count;
+	if (data->erd_page_count == data->erd_max_pages)
+		return data->erd_page_count;
 
 	ext = first_extent(obj);
 	while (ext != NULL) {
@@ -2064,12 +2057,106 @@ static unsigned int get_write_extents(struct osc_object *obj,
 			continue;
 		}
 
-		if (!try_to_add_extent_for_io(cli, ext, &data))
-			return data.erd_page_count;
+		if (!try_to_add_extent_for_io(cli, ext, data))
+			return data->erd_page_count;
 
 		ext = next_extent(ext);
 	}
-	return data.erd_page_count;
+	return data->erd_page_count;
+}
+
+/* Take the extents added to \a rpclist after \a last out of the cache of
+ * \a osc, \a last is NULL if they are the first ones of the RPC. */
+static void osc_rpc_extents_start(struct osc_object *osc,
+				  struct list_head *rpclist,
+				  struct osc_extent *last,
+				  unsigned int page_count)
+__must_hold(osc)
+{
+	struct osc_extent *ext;
+
+	LASSERT(osc_object_is_locked(osc));
+
+	osc_update_pending(osc, OBD_BRW_WRITE, -page_count);
+
+	ext = list_prepare_entry(last, rpclist, oe_link);
+	list_for_each_entry_continue(ext, rpclist, oe_link) {
+		LASSERT(ext->oe_obj == osc);
+		LASSERT(ext->oe_state == OES_CACHE ||
+			ext->oe_state == OES_LOCK_DONE);
+		if (ext->oe_state == OES_CACHE)
+			osc_extent_state_set(ext, OES_LOCKING);
+		else
+			osc_extent_state_set(ext, OES_RPC);
+	}
+}
+
+/**
+ * Fill the rest of a write RPC with the dirty extents of other objects of
+ * this OST, see osc.*.max_objs_per_rpc. Each object gets its own obd_ioobj
+ * in the RPC, this saves an RPC per object when writing many small files.
+ *
+ * No object lock is held here, the objects are taken from the list of
+ * objects with pending writes like osc_check_rpcs() does.
+ */
+static void osc_gather_write_extents(const struct lu_env *env,
+				     struct client_obd *cli,
+				     struct osc_object *osc,
+				     struct extent_rpc_data *data)
+{
+	struct osc_extent *first;
+	struct osc_extent *last;
+	struct osc_object *obj;
+	unsigned int page_count;
+	unsigned int nr_objs = 1;
+	unsigned int tries;
+
+	first = list_entry(data->erd_rpc_list->next, struct osc_extent,
+			   oe_link);
+	if (cli->cl_max_objs_per_rpc <= 1 || first->oe_srvlock ||
+	    cli->cl_import == NULL ||
+	    !imp_connect_multi_obj_brw(cli->cl_import))
+		return;
+
+	for (tries = 0; tries < 2 * cli->cl_max_objs_per_rpc &&
+	     nr_objs < cli->cl_max_objs_per_rpc &&
+	     data->erd_page_count < data->erd_max_pages &&
+	     data->erd_max_extents > 0; tries++) {
+		spin_lock(&cli->cl_loi_list_lock);
+		if (list_empty(&cli->cl_loi_write_list)) {
+			spin_unlock(&cli->cl_loi_list_lock);
+			break;
+		}
+		obj = list_entry(cli->cl_loi_write_list.next,
+				 struct osc_object, oo_write_item);
+		/* rotated to the tail, osc_list_maint() puts it back */
+		list_del_init(&obj->oo_write_item);
+		cl_object_get(osc2cl(obj));
+		spin_unlock(&cli->cl_loi_list_lock);
+
+		if (obj != osc) {
+			last = list_entry(data->erd_rpc_list->prev,
+					  struct osc_extent, oe_link);
+			page_count = data->erd_page_count;
+
+			osc_object_lock(obj);
+			if (get_write_extents(obj, data) > page_count) {
+				osc_rpc_extents_start(obj, data->erd_rpc_list,
+						      last, data->erd_page_count -
+						      page_count);
+				nr_objs++;
+			}
+			osc_object_unlock(obj);
+		}
+
+		osc_list_maint(cli, obj);
+		cl_object_put(env, osc2cl(obj));
+	}
+
+	if (nr_objs > 1)
+		CDEBUG(D_CACHE, "%s: %u objects %u pages in one write RPC\n",
+		       cli->cl_import->imp_obd->obd_name, nr_objs,
+		       data->erd_page_count);
 }
 
 static int
@@ -2081,6 +2168,13 @@ __must_hold(osc)
 	struct osc_extent *ext;
 	struct osc_extent *tmp;
 	struct osc_extent *first = NULL;
+	struct extent_rpc_data data = {
+		.erd_rpc_list	= &rpclist,
+		.erd_page_count	= 0,
+		.erd_max_pages	= cli->cl_max_pages_per_rpc,
+		.erd_max_chunks	= osc_max_write_chunks(cli),
+		.erd_max_extents = 256,
+	};
 	unsigned int page_count = 0;
 	int srvlock = 0;
 	int rc = 0;
@@ -2088,27 +2182,21 @@ __must_hold(osc)
 
 	LASSERT(osc_object_is_locked(osc));
 
-	page_count = get_write_extents(osc, &rpclist);
+	page_count = get_write_extents(osc, &data);
 	LASSERT(equi(page_count == 0, list_empty(&rpclist)));
 
 	if (list_empty(&rpclist))
 		RETURN(0);
 
-	osc_update_pending(osc, OBD_BRW_WRITE, -page_count);
-
-	list_for_each_entry(ext, &rpclist, oe_link) {
-		LASSERT(ext->oe_state == OES_CACHE ||
-			ext->oe_state == OES_LOCK_DONE);
-		if (ext->oe_state == OES_CACHE)
-			osc_extent_state_set(ext, OES_LOCKING);
-		else
-			osc_extent_state_set(ext, OES_RPC);
-	}
+	osc_rpc_extents_start(osc, &rpclist, NULL, page_count);
 
 	/* we're going to grab page lock, so release object lock because
 	 * lock order is page lock -> object lock. */
 	osc_object_unlock(osc);
 
+	osc_gather_write_extents(env, cli, osc, &data);
+	page_count = data.erd_page_count;
+
 	list_for_each_entry_safe(ext, tmp, &rpclist, oe_link) {
 		if (ext->oe_state == OES_LOCKING) {
 			rc = osc_extent_make_ready(env, ext);
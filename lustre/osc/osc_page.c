@@ -285,6 +285,7 @@ int osc_page_init(const struct lu_env *env, struct cl_object *obj,
 	opg->ops_to   = PAGE_SIZE;
 
 	INIT_LIST_HEAD(&opg->ops_lru);
+	opg->ops_lru_cpt = -1;
 
 	result = osc_prep_async_page(osc, opg, page->cp_vmpage,
 				     cl_offset(obj, index));
@@ -442,12 +443,79 @@ int lru_queue_work(const struct lu_env *env, void *data)
 	RETURN(0);
 }
 
+/**
+ * Move pages staged on the per-CPT list \a lru to the tail of cl_lru_list.
+ * Called with lru->clp_lock held.
+ */
+static void __osc_lru_merge(struct client_obd *cli, struct cl_lru_pcpt *lru)
+{
+	struct osc_page *opg;
+
+	if (lru->clp_count == 0)
+		return;
+
+	spin_lock(&cli->cl_lru_list_lock);
+	list_for_each_entry(opg, &lru->clp_list, ops_lru)
+		opg->ops_lru_cpt = -1;
+	list_splice_tail_init(&lru->clp_list, &cli->cl_lru_list);
+	spin_unlock(&cli->cl_lru_list_lock);
+	lru->clp_count = 0;
+}
+
+/**
+ * Drain all per-CPT staging lists into cl_lru_list, so that the shrinker
+ * sees every LRU page in aging order.
+ */
+static void osc_lru_merge_all(struct client_obd *cli)
+{
+	struct cl_lru_pcpt *lru;
+	int i;
+
+	cfs_percpt_for_each(lru, i, cli->cl_lru_pcpt) {
+		if (lru->clp_count == 0)
+			continue;
+
+		spin_lock(&lru->clp_lock);
+		__osc_lru_merge(cli, lru);
+		spin_unlock(&lru->clp_lock);
+	}
+}
+
+/**
+ * Lock the LRU list \a opg is linked on, which is either one of the per-CPT
+ * staging lists or cl_lru_list. Returns the lock taken.
+ */
+static spinlock_t *osc_lru_lock_page(struct client_obd *cli,
+				     struct osc_page *opg)
+{
+	spinlock_t *lock;
+	int cpt;
+
+	while (1) {
+		cpt = READ_ONCE(opg->ops_lru_cpt);
+		if (cpt < 0)
+			lock = &cli->cl_lru_list_lock;
+		else
+			lock = &cli->cl_lru_pcpt[cpt]->clp_lock;
+
+		spin_lock(lock);
+		/* page may have been merged to cl_lru_list meanwhile */
+		if (likely(opg->ops_lru_cpt == cpt))
+			return lock;
+		spin_unlock(lock);
+	}
+}
+
 void osc_lru_add_batch(struct client_obd *cli, struct list_head *plist)
 {
 	struct list_head lru = LIST_HEAD_INIT(lru);
 	struct osc_async_page *oap;
+	struct cl_lru_pcpt *pcpt;
+	time64_t now;
 	long npages = 0;
+	int cpt;
 
+	cpt = cfs_cpt_current(cfs_cpt_tab, 1);
 	list_for_each_entry(oap, plist, oap_pending_item) {
 		struct osc_page *opg = oap2osc_page(oap);
 
@@ -457,15 +525,26 @@ void osc_lru_add_batch(struct client_obd *cli, struct list_head *plist)
 		++npages;
 		LASSERT(list_empty(&opg->ops_lru));
 		list_add(&opg->ops_lru, &lru);
+		opg->ops_lru_cpt = cpt;
 	}
 
 	if (npages > 0) {
-		spin_lock(&cli->cl_lru_list_lock);
-		list_splice_tail(&lru, &cli->cl_lru_list);
+		/* queue on the local staging list, and only touch the shared
+		 * cl_lru_list once enough pages have been collected */
+		pcpt = cli->cl_lru_pcpt[cpt];
+		spin_lock(&pcpt->clp_lock);
+		list_splice_tail(&lru, &pcpt->clp_list);
+		pcpt->clp_count += npages;
+		if (pcpt->clp_count >= lru_shrink_min(cli))
+			__osc_lru_merge(cli, pcpt);
+		spin_unlock(&pcpt->clp_lock);
+
 		atomic_long_sub(npages, &cli->cl_lru_busy);
 		atomic_long_add(npages, &cli->cl_lru_in_list);
-		cli->cl_lru_last_used = ktime_get_real_seconds();
-		spin_unlock(&cli->cl_lru_list_lock);
+		/* avoid dirtying the shared cacheline if nothing changed */
+		now = ktime_get_real_seconds();
+		if (cli->cl_lru_last_used != now)
+			cli->cl_lru_last_used = now;
 
 		if (waitqueue_active(&osc_lru_waitq))
 			(void)ptlrpcd_queue_work(cli->cl_lru_work);
@@ -476,6 +555,10 @@ static void __osc_lru_del(struct client_obd *cli, struct osc_page *opg)
 {
 	LASSERT(atomic_long_read(&cli->cl_lru_in_list) > 0);
 	list_del_init(&opg->ops_lru);
+	if (opg->ops_lru_cpt >= 0) {
+		cli->cl_lru_pcpt[opg->ops_lru_cpt]->clp_count--;
+		opg->ops_lru_cpt = -1;
+	}
 	atomic_long_dec(&cli->cl_lru_in_list);
 }
 
@@ -485,15 +568,17 @@ static void __osc_lru_del(struct client_obd *cli, struct osc_page *opg)
  */
 static void osc_lru_del(struct client_obd *cli, struct osc_page *opg)
 {
+	spinlock_t *lock;
+
 	if (opg->ops_in_lru) {
-		spin_lock(&cli->cl_lru_list_lock);
+		lock = osc_lru_lock_page(cli, opg);
 		if (!list_empty(&opg->ops_lru)) {
 			__osc_lru_del(cli, opg);
 		} else {
 			LASSERT(atomic_long_read(&cli->cl_lru_busy) > 0);
 			atomic_long_dec(&cli->cl_lru_busy);
 		}
-		spin_unlock(&cli->cl_lru_list_lock);
+		spin_unlock(lock);
 
 		atomic_long_inc(cli->cl_lru_left);
 		/* this is a great place to release more LRU pages if
@@ -517,14 +602,16 @@ static void osc_lru_use(struct client_obd *cli, struct osc_page *opg)
 	/* If page is being transferred for the first time,
 	 * ops_lru should be empty */
 	if (opg->ops_in_lru) {
+		spinlock_t *lock;
+
 		if (list_empty(&opg->ops_lru))
 			return;
-		spin_lock(&cli->cl_lru_list_lock);
+		lock = osc_lru_lock_page(cli, opg);
 		if (!list_empty(&opg->ops_lru)) {
 			__osc_lru_del(cli, opg);
 			atomic_long_inc(&cli->cl_lru_busy);
 		}
-		spin_unlock(&cli->cl_lru_list_lock);
+		spin_unlock(lock);
 	}
 }
 
@@ -608,6 +695,10 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 	pvec = (struct cl_page **)osc_env_info(env)->oti_pvec;
 	io = osc_env_thread_io(env);
 
+	/* age staged pages together with the rest of the LRU, and drain them
+	 * in bulk rather than page by page */
+	osc_lru_merge_all(cli);
+
 	spin_lock(&cli->cl_lru_list_lock);
 	if (force)
 		cli->cl_lru_reclaim++;
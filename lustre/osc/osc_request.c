@@ -1292,14 +1292,42 @@ static int osc_checksum_bulk_rw(const char *obd_name,
 	RETURN(rc);
 }
 
+/* number of niobufs needed for pages [start, end) of a page array */
+static u32 osc_brw_niocount(struct brw_page **pga, u32 start, u32 end)
+{
+	u32 niocount = 1;
+	u32 i;
+
+	for (i = start + 1; i < end; i++)
+		if (!can_merge_pages(pga[i - 1], pga[i]))
+			niocount++;
+
+	return niocount;
+}
+
+/* number of pages of object \a idx of the RPC */
+static inline u32 osc_brw_obj_pages(struct osc_brw_obj *objs, u32 obj_count,
+				    u32 page_count, u32 idx)
+{
+	return obj_count > 1 ? objs[idx].obo_page_count : page_count;
+}
+
+/**
+ * Pack a BRW request for the pages \a pga. If \a obj_count is more than 1,
+ * this is a write of several objects: the pages of each object follow each
+ * other in \a pga and \a objs describes them, \a oa is used for the first
+ * object and the grant and checksum of the whole RPC.
+ */
 static int
 osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
 		     u32 page_count, struct brw_page **pga,
+		     struct osc_brw_obj *objs, u32 obj_count,
 		     struct ptlrpc_request **reqp, int resend)
 {
         struct ptlrpc_request   *req;
         struct ptlrpc_bulk_desc *desc;
         struct ost_body         *body;
+	struct ost_body		*bodies = NULL;
         struct obd_ioobj        *ioobj;
         struct niobuf_remote    *niobuf;
 	int niocount, i, requested_nob, opc, rc, short_io_size = 0;
@@ -1308,6 +1336,10 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
         struct brw_page *pg_prev;
 	void *short_io_buf;
 	const char *obd_name = cli->cl_import->imp_obd->obd_name;
+	u32 nr_objs = max_t(u32, obj_count, 1);
+	u32 obj_start;
+	u32 obj_end;
+	u32 j;
 
         ENTRY;
         if (OBD_FAIL_CHECK(OBD_FAIL_OSC_BRW_PREP_REQ))
@@ -1327,16 +1359,23 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
         if (req == NULL)
                 RETURN(-ENOMEM);
 
-        for (niocount = i = 1; i < page_count; i++) {
-                if (!can_merge_pages(pga[i - 1], pga[i]))
-                        niocount++;
-        }
+	LASSERT(ergo(nr_objs > 1, opc == OST_WRITE));
+	/* pages of different objects never share a niobuf */
+	for (niocount = 0, obj_start = j = 0; j < nr_objs; j++) {
+		obj_end = obj_start + osc_brw_obj_pages(objs, obj_count,
+							page_count, j);
+		niocount += osc_brw_niocount(pga, obj_start, obj_end);
+		obj_start = obj_end;
+	}
+	LASSERT(obj_start == page_count);
 
         pill = &req->rq_pill;
         req_capsule_set_size(pill, &RMF_OBD_IOOBJ, RCL_CLIENT,
-                             sizeof(*ioobj));
+			     nr_objs * sizeof(*ioobj));
         req_capsule_set_size(pill, &RMF_NIOBUF_REMOTE, RCL_CLIENT,
                              niocount * sizeof(*niobuf));
+	req_capsule_set_size(pill, &RMF_OST_BODIES, RCL_CLIENT,
+			     (nr_objs - 1) * sizeof(*body));
 
 	for (i = 0; i < page_count; i++)
 		short_io_size += pga[i]->count;
@@ -1398,17 +1437,37 @@ no_bulk:
 	body->oa.o_uid = oa->o_uid;
 	body->oa.o_gid = oa->o_gid;
 
-	obdo_to_ioobj(oa, ioobj);
-	ioobj->ioo_bufcnt = niocount;
-	/* The high bits of ioo_max_brw tells server _maximum_ number of bulks
-	 * that might be send for this request.  The actual number is decided
-	 * when the RPC is finally sent in ptlrpc_register_bulk(). It sends
-	 * "max - 1" for old client compatibility sending "0", and also so the
-	 * the actual maximum is a power-of-two number, not one less. LU-1431 */
-	if (desc != NULL)
-		ioobj_max_brw_set(ioobj, desc->bd_md_max_brw);
-	else /* short io */
-		ioobj_max_brw_set(ioobj, 0);
+	if (nr_objs > 1) {
+		bodies = req_capsule_client_get(pill, &RMF_OST_BODIES);
+		LASSERT(bodies != NULL);
+	}
+
+	for (obj_start = j = 0; j < nr_objs; j++, ioobj++) {
+		struct obdo *obj_oa = j == 0 ? oa : &objs[j].obo_oa;
+
+		obj_end = obj_start + osc_brw_obj_pages(objs, obj_count,
+							page_count, j);
+		if (j > 0) {
+			lustre_set_wire_obdo(&req->rq_import->imp_connect_data,
+					     &bodies[j - 1].oa, obj_oa);
+			bodies[j - 1].oa.o_uid = obj_oa->o_uid;
+			bodies[j - 1].oa.o_gid = obj_oa->o_gid;
+		}
+
+		obdo_to_ioobj(obj_oa, ioobj);
+		ioobj->ioo_bufcnt = osc_brw_niocount(pga, obj_start, obj_end);
+		/* The high bits of ioo_max_brw tells server _maximum_ number
+		 * of bulks that might be send for this request.  The actual
+		 * number is decided when the RPC is finally sent in
+		 * ptlrpc_register_bulk(). It sends "max - 1" for old client
+		 * compatibility sending "0", and also so the the actual
+		 * maximum is a power-of-two number, not one less. LU-1431 */
+		if (desc != NULL)
+			ioobj_max_brw_set(ioobj, desc->bd_md_max_brw);
+		else /* short io */
+			ioobj_max_brw_set(ioobj, 0);
+		obj_start = obj_end;
+	}
 
 	if (short_io_size != 0) {
 		if ((body->oa.o_valid & OBD_MD_FLFLAGS) == 0) {
@@ -1427,20 +1486,30 @@ no_bulk:
 
 	LASSERT(page_count > 0);
 	pg_prev = pga[0];
-        for (requested_nob = i = 0; i < page_count; i++, niobuf++) {
+	obj_start = 0;
+	obj_end = osc_brw_obj_pages(objs, obj_count, page_count, 0);
+	for (requested_nob = i = j = 0; i < page_count; i++, niobuf++) {
                 struct brw_page *pg = pga[i];
 		int poff = pg->off & ~PAGE_MASK;
 
+		if (i == obj_end) {
+			/* first page of the next object */
+			obj_start = obj_end;
+			obj_end += osc_brw_obj_pages(objs, obj_count,
+						     page_count, ++j);
+		}
+
                 LASSERT(pg->count > 0);
                 /* make sure there is no gap in the middle of page array */
-		LASSERTF(page_count == 1 ||
-			 (ergo(i == 0, poff + pg->count == PAGE_SIZE) &&
-			  ergo(i > 0 && i < page_count - 1,
+		LASSERTF(obj_end - obj_start == 1 ||
+			 (ergo(i == obj_start,
+			       poff + pg->count == PAGE_SIZE) &&
+			  ergo(i > obj_start && i < obj_end - 1,
 			       poff == 0 && pg->count == PAGE_SIZE)   &&
-			  ergo(i == page_count - 1, poff == 0)),
+			  ergo(i == obj_end - 1, poff == 0)),
 			 "i: %d/%d pg: %p off: %llu, count: %u\n",
 			 i, page_count, pg, pg->off, pg->count);
-                LASSERTF(i == 0 || pg->off > pg_prev->off,
+		LASSERTF(i == obj_start || pg->off > pg_prev->off,
 			 "i %d p_c %u pg %p [pri %lu ind %lu] off %llu"
 			 " prev_pg %p [pri %lu ind %lu] off %llu\n",
                          i, page_count,
@@ -1463,7 +1532,7 @@ no_bulk:
 		}
 		requested_nob += pg->count;
 
-                if (i > 0 && can_merge_pages(pg_prev, pg)) {
+		if (i > obj_start && can_merge_pages(pg_prev, pg)) {
                         niobuf--;
 			niobuf->rnb_len += pg->count;
 		} else {
@@ -1486,6 +1555,17 @@ no_bulk:
                         body->oa.o_flags = 0;
                 }
                 body->oa.o_flags |= OBD_FL_RECOV_RESEND;
+
+		/* grant of the other objects was consumed on the first try */
+		for (j = 1; j < nr_objs; j++) {
+			struct obdo *obj_oa = &bodies[j - 1].oa;
+
+			if ((obj_oa->o_valid & OBD_MD_FLFLAGS) == 0) {
+				obj_oa->o_valid |= OBD_MD_FLFLAGS;
+				obj_oa->o_flags = 0;
+			}
+			obj_oa->o_flags |= OBD_FL_RECOV_RESEND;
+		}
         }
 
         if (osc_should_shrink_grant(cli))
@@ -1557,6 +1637,8 @@ no_bulk:
 	aa->aa_resends = 0;
 	aa->aa_ppga = pga;
 	aa->aa_cli = cli;
+	aa->aa_objs = objs;
+	aa->aa_obj_count = obj_count;
 	INIT_LIST_HEAD(&aa->aa_oaps);
 
 	*reqp = req;
@@ -1935,7 +2017,8 @@ static int osc_brw_redo_request(struct ptlrpc_request *request,
 	rc = osc_brw_prep_request(lustre_msg_get_opc(request->rq_reqmsg) ==
 				OST_WRITE ? OBD_BRW_WRITE : OBD_BRW_READ,
 				  aa->aa_cli, aa->aa_oa, aa->aa_page_count,
-				  aa->aa_ppga, &new_req, 1);
+				  aa->aa_ppga, aa->aa_objs, aa->aa_obj_count,
+				  &new_req, 1);
         if (rc)
                 RETURN(rc);
 
@@ -2029,6 +2112,62 @@ static void osc_release_ppga(struct brw_page **ppga, size_t count)
         OBD_FREE(ppga, sizeof(*ppga) * count);
 }
 
+/* update the attributes of the object of \a last_pg after a BRW, \a oa
+ * is the one returned by the OST for it if any */
+static void osc_brw_attr_update(const struct lu_env *env,
+				struct ptlrpc_request *req, struct obdo *oa,
+				struct brw_page *last_pg)
+{
+	struct cl_attr *attr = &osc_env_info(env)->oti_attr;
+	unsigned long valid = 0;
+	struct cl_object *obj;
+	struct osc_async_page *last;
+
+	last = brw_page2oap(last_pg);
+	obj = osc2cl(last->oap_obj);
+
+	cl_object_attr_lock(obj);
+	if (oa != NULL && oa->o_valid & OBD_MD_FLBLOCKS) {
+		attr->cat_blocks = oa->o_blocks;
+		valid |= CAT_BLOCKS;
+	}
+	if (oa != NULL && oa->o_valid & OBD_MD_FLMTIME) {
+		attr->cat_mtime = oa->o_mtime;
+		valid |= CAT_MTIME;
+	}
+	if (oa != NULL && oa->o_valid & OBD_MD_FLATIME) {
+		attr->cat_atime = oa->o_atime;
+		valid |= CAT_ATIME;
+	}
+	if (oa != NULL && oa->o_valid & OBD_MD_FLCTIME) {
+		attr->cat_ctime = oa->o_ctime;
+		valid |= CAT_CTIME;
+	}
+
+	if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE) {
+		struct lov_oinfo *loi = cl2osc(obj)->oo_oinfo;
+		loff_t last_off = last->oap_count + last->oap_obj_off +
+			last->oap_page_off;
+
+		/* Change file size if this is an out of quota or
+		 * direct IO write and it extends the file size */
+		if (loi->loi_lvb.lvb_size < last_off) {
+			attr->cat_size = last_off;
+			valid |= CAT_SIZE;
+		}
+		/* Extend KMS if it's not a lockless write */
+		if (loi->loi_kms < last_off &&
+		    oap2osc_page(last)->ops_srvlock == 0) {
+			attr->cat_kms = last_off;
+			valid |= CAT_KMS;
+		}
+	}
+
+	if (valid != 0)
+		cl_object_attr_update(env, obj, attr, valid);
+	cl_object_attr_unlock(obj);
+}
+
 static int brw_interpret(const struct lu_env *env,
 			 struct ptlrpc_request *req, void *args, int rc)
 {
@@ -2070,57 +2209,21 @@ static int brw_interpret(const struct lu_env *env,
 	}
 
 	if (rc == 0) {
-		struct obdo *oa = aa->aa_oa;
-		struct cl_attr *attr = &osc_env_info(env)->oti_attr;
-		unsigned long valid = 0;
-		struct cl_object *obj;
-		struct osc_async_page *last;
-
-		last = brw_page2oap(aa->aa_ppga[aa->aa_page_count - 1]);
-		obj = osc2cl(last->oap_obj);
-
-		cl_object_attr_lock(obj);
-		if (oa->o_valid & OBD_MD_FLBLOCKS) {
-			attr->cat_blocks = oa->o_blocks;
-			valid |= CAT_BLOCKS;
-		}
-		if (oa->o_valid & OBD_MD_FLMTIME) {
-			attr->cat_mtime = oa->o_mtime;
-			valid |= CAT_MTIME;
+		u32 nr_objs = max_t(u32, aa->aa_obj_count, 1);
+		u32 end = 0;
+		u32 j;
+
+		/* the reply only has the attributes of the first object */
+		for (j = 0; j < nr_objs; j++) {
+			end += osc_brw_obj_pages(aa->aa_objs, aa->aa_obj_count,
+						 aa->aa_page_count, j);
+			osc_brw_attr_update(env, req, j == 0 ? aa->aa_oa : NULL,
+					    aa->aa_ppga[end - 1]);
 		}
-		if (oa->o_valid & OBD_MD_FLATIME) {
-			attr->cat_atime = oa->o_atime;
-			valid |= CAT_ATIME;
-		}
-		if (oa->o_valid & OBD_MD_FLCTIME) {
-			attr->cat_ctime = oa->o_ctime;
-			valid |= CAT_CTIME;
-		}
-
-		if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE) {
-			struct lov_oinfo *loi = cl2osc(obj)->oo_oinfo;
-			loff_t last_off = last->oap_count + last->oap_obj_off +
-				last->oap_page_off;
-
-			/* Change file size if this is an out of quota or
-			 * direct IO write and it extends the file size */
-			if (loi->loi_lvb.lvb_size < last_off) {
-				attr->cat_size = last_off;
-				valid |= CAT_SIZE;
-			}
-			/* Extend KMS if it's not a lockless write */
-			if (loi->loi_kms < last_off &&
-			    oap2osc_page(last)->ops_srvlock == 0) {
-				attr->cat_kms = last_off;
-				valid |= CAT_KMS;
-			}
-		}
-
-		if (valid != 0)
-			cl_object_attr_update(env, obj, attr, valid);
-		cl_object_attr_unlock(obj);
 	}
 	OBD_SLAB_FREE_PTR(aa->aa_oa, osc_obdo_kmem);
+	if (aa->aa_objs != NULL)
+		OBD_FREE(aa->aa_objs, sizeof(*aa->aa_objs) * aa->aa_obj_count);
 
 	if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE && rc == 0)
 		osc_inc_unstable_pages(req);
@@ -2173,10 +2276,98 @@ static void brw_commit(struct ptlrpc_request *req)
 	}
 }
 
+/* compare two objects by the FID the OST sees, see tgt_io_data_unpack() */
+static int osc_object_fid_cmp(struct osc_object *obj1, struct osc_object *obj2)
+{
+	struct lu_fid fid1;
+	struct lu_fid fid2;
+
+	/* the OST index only changes the sequence of IDIF FIDs, which are
+	 * all lower than the normal ones, so it does not change the order */
+	ostid_to_fid(&fid1, &obj1->oo_oinfo->loi_oi, 0);
+	ostid_to_fid(&fid2, &obj2->oo_oinfo->loi_oi, 0);
+
+	return lu_fid_cmp(&fid1, &fid2);
+}
+
+/*
+ * Group the extents of a multi-object write by object in FID order, the
+ * OST requires it to prepare the objects in a stable order. The order of
+ * the extents of each object is kept. Returns the number of objects.
+ */
+static u32 osc_sort_rpc_extents(struct list_head *ext_list)
+{
+	struct list_head sorted = LIST_HEAD_INIT(sorted);
+	struct osc_extent *ext;
+	struct osc_extent *tmp;
+	struct osc_extent *pos;
+	u32 nr_objs = 0;
+
+	list_for_each_entry_safe(ext, tmp, ext_list, oe_link) {
+		struct list_head *at = &sorted;
+		bool found = false;
+
+		list_for_each_entry(pos, &sorted, oe_link) {
+			if (pos->oe_obj == ext->oe_obj) {
+				found = true;
+				continue;
+			}
+			if (found ||
+			    osc_object_fid_cmp(pos->oe_obj, ext->oe_obj) > 0) {
+				at = &pos->oe_link;
+				break;
+			}
+		}
+		if (!found)
+			nr_objs++;
+		list_move_tail(&ext->oe_link, at);
+	}
+	list_splice_init(&sorted, ext_list);
+
+	return nr_objs;
+}
+
+/*
+ * Set the attributes of the objects after the first one of a multi-object
+ * write, either in \a objs or in the \a bodies of the request.
+ */
+static void osc_brw_objs_attr_set(const struct lu_env *env,
+				  struct list_head *ext_list,
+				  struct osc_brw_obj *objs,
+				  struct ost_body *bodies, u64 flags)
+{
+	struct cl_req_attr attr;
+	struct osc_object *obj = NULL;
+	struct osc_extent *ext;
+	struct osc_async_page *oap;
+	int j = -1;
+
+	list_for_each_entry(ext, ext_list, oe_link) {
+		if (ext->oe_obj == obj)
+			continue;
+		obj = ext->oe_obj;
+		if (++j == 0)
+			continue;
+
+		oap = list_first_entry(&ext->oe_pages, struct osc_async_page,
+				       oap_pending_item);
+		memset(&attr, 0, sizeof(attr));
+		attr.cra_type = CRT_WRITE;
+		attr.cra_flags = flags;
+		attr.cra_page = oap2cl_page(oap);
+		attr.cra_oa = bodies != NULL ? &bodies[j - 1].oa :
+					       &objs[j].obo_oa;
+		cl_req_attr_set(env, osc2cl(obj), &attr);
+	}
+}
+
 /**
  * Build an RPC by the list of extent @ext_list. The caller must ensure
  * that the total pages in this list are NOT over max pages per RPC.
  * Extents in the list must be in OES_RPC state.
+ *
+ * The extents of a write may belong to several objects, each of them then
+ * gets its own obd_ioobj in the RPC, see osc_gather_write_extents().
  */
 int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		  struct list_head *ext_list, int cmd)
@@ -2188,7 +2379,10 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	struct obdo			*oa = NULL;
 	struct osc_async_page		*oap;
 	struct osc_object		*obj = NULL;
+	struct osc_object		*prev = NULL;
+	struct osc_brw_obj		*objs = NULL;
 	struct cl_req_attr		*crattr = NULL;
+	loff_t				rpc_offset = OBD_OBJECT_EOF;
 	loff_t				starting_offset = OBD_OBJECT_EOF;
 	loff_t				ending_offset = 0;
 	int				mpflag = 0;
@@ -2198,8 +2392,10 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	bool				interrupted = false;
 	bool				ndelay = false;
 	int				i;
+	int				j;
 	int				grant = 0;
 	int				rc;
+	u32				nr_objs = 1;
 	__u32				layout_version = 0;
 	struct list_head		rpc_list = LIST_HEAD_INIT(rpc_list);
 	struct ost_body			*body;
@@ -2215,12 +2411,42 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		layout_version = MAX(layout_version, ext->oe_layout_version);
 		if (obj == NULL)
 			obj = ext->oe_obj;
+		else if (ext->oe_obj != obj)
+			nr_objs = 2;
 	}
 
 	soft_sync = osc_over_unstable_soft_limit(cli);
 	if (mem_tight)
 		mpflag = cfs_memory_pressure_get_and_set();
 
+	if (nr_objs > 1) {
+		LASSERT(cmd == OBD_BRW_WRITE);
+		nr_objs = osc_sort_rpc_extents(ext_list);
+		obj = list_first_entry(ext_list, struct osc_extent,
+				       oe_link)->oe_obj;
+
+		OBD_ALLOC(objs, sizeof(*objs) * nr_objs);
+		if (objs == NULL)
+			GOTO(out, rc = -ENOMEM);
+
+		/* grant and layout version of each object */
+		j = -1;
+		list_for_each_entry(ext, ext_list, oe_link) {
+			if (ext->oe_obj != prev) {
+				prev = ext->oe_obj;
+				j++;
+			}
+			objs[j].obo_page_count += ext->oe_nr_pages;
+			objs[j].obo_oa.o_grant_used += ext->oe_grants;
+			objs[j].obo_oa.o_layout_version =
+				MAX(objs[j].obo_oa.o_layout_version,
+				    ext->oe_layout_version);
+		}
+		grant = objs[0].obo_oa.o_grant_used;
+		layout_version = objs[0].obo_oa.o_layout_version;
+		prev = NULL;
+	}
+
 	OBD_ALLOC(pga, sizeof(*pga) * page_count);
 	if (pga == NULL)
 		GOTO(out, rc = -ENOMEM);
@@ -2231,6 +2457,15 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 
 	i = 0;
 	list_for_each_entry(ext, ext_list, oe_link) {
+		if (ext->oe_obj != prev) {
+			/* pages of each object are checked on their own */
+			prev = ext->oe_obj;
+			if (rpc_offset == OBD_OBJECT_EOF ||
+			    rpc_offset > starting_offset)
+				rpc_offset = starting_offset;
+			starting_offset = OBD_OBJECT_EOF;
+			ending_offset = 0;
+		}
 		list_for_each_entry(oap, &ext->oe_pages, oap_pending_item) {
 			if (mem_tight)
 				oap->oap_brw_flags |= OBD_BRW_MEMALLOC;
@@ -2258,6 +2493,8 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		if (ext->oe_ndelay)
 			ndelay = true;
 	}
+	if (rpc_offset == OBD_OBJECT_EOF || rpc_offset > starting_offset)
+		rpc_offset = starting_offset;
 
 	/* first page in the list */
 	oap = list_entry(rpc_list.next, typeof(*oap), oap_rpc_item);
@@ -2281,8 +2518,22 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		}
 	}
 
-	sort_brw_pages(pga, page_count);
-	rc = osc_brw_prep_request(cmd, cli, oa, page_count, pga, &req, 0);
+	if (objs != NULL) {
+		osc_brw_objs_attr_set(env, ext_list, objs, NULL, ~0ULL);
+		for (j = 1; j < nr_objs; j++)
+			if (objs[j].obo_oa.o_layout_version > 0)
+				objs[j].obo_oa.o_valid |= OBD_MD_LAYOUT_VERSION;
+
+		/* the pages of each object are sorted on their own */
+		for (i = j = 0; j < nr_objs; j++) {
+			sort_brw_pages(pga + i, objs[j].obo_page_count);
+			i += objs[j].obo_page_count;
+		}
+	} else {
+		sort_brw_pages(pga, page_count);
+	}
+	rc = osc_brw_prep_request(cmd, cli, oa, page_count, pga, objs,
+				  objs != NULL ? nr_objs : 0, &req, 0);
 	if (rc != 0) {
 		CERROR("prep_req failed: %d\n", rc);
 		GOTO(out, rc);
@@ -2311,6 +2562,12 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	crattr->cra_flags = OBD_MD_FLMTIME | OBD_MD_FLCTIME | OBD_MD_FLATIME;
 	cl_req_attr_set(env, osc2cl(obj), crattr);
 	lustre_msg_set_jobid(req->rq_reqmsg, crattr->cra_jobid);
+	if (objs != NULL)
+		osc_brw_objs_attr_set(env, ext_list, objs,
+				      req_capsule_client_get(&req->rq_pill,
+							     &RMF_OST_BODIES),
+				      OBD_MD_FLMTIME | OBD_MD_FLCTIME |
+				      OBD_MD_FLATIME);
 
 	CLASSERT(sizeof(*aa) <= sizeof(req->rq_async_args));
 	aa = ptlrpc_req_async_args(req);
@@ -2320,7 +2577,7 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	list_splice_init(ext_list, &aa->aa_exts);
 
 	spin_lock(&cli->cl_loi_list_lock);
-	starting_offset >>= PAGE_SHIFT;
+	starting_offset = rpc_offset >> PAGE_SHIFT;
 	if (cmd == OBD_BRW_READ) {
 		cli->cl_r_in_flight++;
 		lprocfs_oh_tally_log2(&cli->cl_read_page_hist, page_count);
@@ -2354,6 +2611,8 @@ out:
 
 		if (oa)
 			OBD_SLAB_FREE_PTR(oa, osc_obdo_kmem);
+		if (objs)
+			OBD_FREE(objs, sizeof(*objs) * nr_objs);
 		if (pga)
 			OBD_FREE(pga, sizeof(*pga) * page_count);
 		/* this should happen rarely and is pretty bad, it makes the
@@ -1576,10 +1576,8 @@ static void osd_object_free(const struct lu_env *env, struct lu_object *l)
 	if (obj->oo_hl_head != NULL)
 		ldiskfs_htree_lock_head_free(obj->oo_hl_head);
 	OBD_FREE_PTR(obj);
-	if (unlikely(h)) {
-		lu_object_header_fini(h);
-		OBD_FREE_PTR(h);
-	}
+	if (unlikely(h))
+		lu_object_header_free(h);
 }
 
 /*
@@ -7887,7 +7885,7 @@ static struct lu_device *osd_device_free(const struct lu_env *env,
 	/* XXX: make osd top device in order to release reference */
 	d->ld_site->ls_top_dev = d;
 	lu_site_purge(env, d->ld_site, -1);
-	if (!cfs_hash_is_empty(d->ld_site->ls_obj_hash)) {
+	if (atomic_read(&d->ld_site->ls_obj_hash.nelems)) {
 		LIBCFS_DEBUG_MSG_DATA_DECL(msgdata, D_ERROR, NULL);
 		lu_site_print(env, d->ld_site, &msgdata, lu_cdebug_printer);
 	}
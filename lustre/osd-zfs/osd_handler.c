@@ -97,7 +97,7 @@ static void arc_prune_func(int64_t bytes, void *private)
 	struct lu_env      env;
 	int rc;
 
-	LASSERT(site->ls_obj_hash);
+	LASSERT(site->ls_bkts != NULL);
 
 	rc = lu_env_init(&env, LCT_SHRINKER);
 	if (rc) {
@@ -1342,7 +1342,7 @@ static struct lu_device *osd_device_free(const struct lu_env *env,
 	/* XXX: make osd top device in order to release reference */
 	d->ld_site->ls_top_dev = d;
 	lu_site_purge(env, d->ld_site, -1);
-	if (!cfs_hash_is_empty(d->ld_site->ls_obj_hash)) {
+	if (atomic_read(&d->ld_site->ls_obj_hash.nelems)) {
 		LIBCFS_DEBUG_MSG_DATA_DECL(msgdata, D_ERROR, NULL);
 		lu_site_print(env, d->ld_site, &msgdata, lu_cdebug_printer);
 	}
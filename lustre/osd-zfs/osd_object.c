@@ -697,10 +697,8 @@ static void osd_object_free(const struct lu_env *env, struct lu_object *l)
 
 	dt_object_fini(&obj->oo_dt);
 	OBD_SLAB_FREE_PTR(obj, osd_object_kmem);
-	if (unlikely(h)) {
-		lu_object_header_fini(h);
-		OBD_FREE_PTR(h);
-	}
+	if (unlikely(h))
+		lu_object_header_free(h);
 }
 
 static int
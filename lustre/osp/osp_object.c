@@ -2272,13 +2272,22 @@ static int osp_object_init(const struct lu_env *env, struct lu_object *o,
 	RETURN(rc);
 }
 
+static void osp_object_free_rcu(struct rcu_head *head)
+{
+	struct osp_object *obj = container_of(head, struct osp_object,
+					      opo_header.loh_rcu);
+
+	OBD_SLAB_FREE_PTR(obj, osp_object_kmem);
+}
+
 /**
  * Implement OSP layer lu_object_operations::loo_object_free() interface.
  *
  * Finalize the object.
  *
  * If the OSP object has attributes cache, then destroy the cache.
- * Free the object finally.
+ * Free the object finally, after a RCU grace period if it is the top
+ * object and owns the object header.
  *
  * \param[in] env	pointer to the thread context
  * \param[in] o		pointer to the OSP layer lu_object
@@ -2302,7 +2311,10 @@ static void osp_object_free(const struct lu_env *env, struct lu_object *o)
 
 		OBD_FREE(oxe, oxe->oxe_buflen);
 	}
-	OBD_SLAB_FREE_PTR(obj, osp_object_kmem);
+	if (h == &obj->opo_header)
+		call_rcu(&obj->opo_header.loh_rcu, osp_object_free_rcu);
+	else
+		OBD_SLAB_FREE_PTR(obj, osp_object_kmem);
 }
 
 /**
@@ -1374,6 +1374,75 @@ __u64 ptlrpc_known_replied_xid(struct obd_import *imp)
 	return req->rq_xid - 1;
 }
 
+/**
+ * Save the transno of a replied \a req and decide whether it has to be kept
+ * for replay, and update the import's view of the committed transactions.
+ */
+static void ptlrpc_req_commit_status(struct ptlrpc_request *req)
+{
+	struct obd_import *imp = req->rq_import;
+	u64 committed;
+
+	/*
+	 * Store transno in reqmsg for replay.
+	 */
+	if (!(lustre_msg_get_flags(req->rq_reqmsg) & MSG_REPLAY)) {
+		req->rq_transno = lustre_msg_get_transno(req->rq_repmsg);
+		lustre_msg_set_transno(req->rq_reqmsg, req->rq_transno);
+	}
+
+	if (imp->imp_replayable) {
+		spin_lock(&imp->imp_lock);
+		/*
+		 * No point in adding already-committed requests to the replay
+		 * list, we will just remove them immediately. b=9829
+		 */
+		if (req->rq_transno != 0 &&
+		    (req->rq_transno >
+		     lustre_msg_get_last_committed(req->rq_repmsg) ||
+		     req->rq_replay)) {
+			/** version recovery */
+			ptlrpc_save_versions(req);
+			ptlrpc_retain_replayable_request(req, imp);
+		} else if (req->rq_commit_cb &&
+			   list_empty(&req->rq_replay_list)) {
+			/*
+			 * NB: don't call rq_commit_cb if it's already on
+			 * rq_replay_list, ptlrpc_free_committed() will call
+			 * it later, see LU-3618 for details
+			 */
+			spin_unlock(&imp->imp_lock);
+			req->rq_commit_cb(req);
+			spin_lock(&imp->imp_lock);
+		}
+
+		/*
+		 * Replay-enabled imports return commit-status information.
+		 */
+		committed = lustre_msg_get_last_committed(req->rq_repmsg);
+		if (likely(committed > imp->imp_peer_committed_transno))
+			imp->imp_peer_committed_transno = committed;
+
+		ptlrpc_free_committed(imp);
+
+		if (!list_empty(&imp->imp_replay_list)) {
+			struct ptlrpc_request *last;
+
+			last = list_entry(imp->imp_replay_list.prev,
+					  struct ptlrpc_request,
+					  rq_replay_list);
+			/*
+			 * Requests with rq_replay stay on the list even if no
+			 * commit is expected.
+			 */
+			if (last->rq_transno > imp->imp_peer_committed_transno)
+				ptlrpc_pinger_commit_expected(imp);
+		}
+
+		spin_unlock(&imp->imp_lock);
+	}
+}
+
 /**
  * Callback function called when client receives RPC reply for \a req.
  * Returns 0 on success or error code.
@@ -1386,7 +1455,6 @@ static int after_reply(struct ptlrpc_request *req)
 	struct obd_import *imp = req->rq_import;
 	struct obd_device *obd = req->rq_import->imp_obd;
 	ktime_t work_start;
-	u64 committed;
 	s64 timediff;
 	int rc;
 
@@ -1516,64 +1584,7 @@ static int after_reply(struct ptlrpc_request *req)
 		ldlm_cli_update_pool(req);
 	}
 
-	/*
-	 * Store transno in reqmsg for replay.
-	 */
-	if (!(lustre_msg_get_flags(req->rq_reqmsg) & MSG_REPLAY)) {
-		req->rq_transno = lustre_msg_get_transno(req->rq_repmsg);
-		lustre_msg_set_transno(req->rq_reqmsg, req->rq_transno);
-	}
-
-	if (imp->imp_replayable) {
-		spin_lock(&imp->imp_lock);
-		/*
-		 * No point in adding already-committed requests to the replay
-		 * list, we will just remove them immediately. b=9829
-		 */
-		if (req->rq_transno != 0 &&
-		    (req->rq_transno >
-		     lustre_msg_get_last_committed(req->rq_repmsg) ||
-		     req->rq_replay)) {
-			/** version recovery */
-			ptlrpc_save_versions(req);
-			ptlrpc_retain_replayable_request(req, imp);
-		} else if (req->rq_commit_cb &&
-			   list_empty(&req->rq_replay_list)) {
-			/*
-			 * NB: don't call rq_commit_cb if it's already on
-			 * rq_replay_list, ptlrpc_free_committed() will call
-			 * it later, see LU-3618 for details
-			 */
-			spin_unlock(&imp->imp_lock);
-			req->rq_commit_cb(req);
-			spin_lock(&imp->imp_lock);
-		}
-
-		/*
-		 * Replay-enabled imports return commit-status information.
-		 */
-		committed = lustre_msg_get_last_committed(req->rq_repmsg);
-		if (likely(committed > imp->imp_peer_committed_transno))
-			imp->imp_peer_committed_transno = committed;
-
-		ptlrpc_free_committed(imp);
-
-		if (!list_empty(&imp->imp_replay_list)) {
-			struct ptlrpc_request *last;
-
-			last = list_entry(imp->imp_replay_list.prev,
-					  struct ptlrpc_request,
-					  rq_replay_list);
-			/*
-			 * Requests with rq_replay stay on the list even if no
-			 * commit is expected.
-			 */
-			if (last->rq_transno > imp->imp_peer_committed_transno)
-				ptlrpc_pinger_commit_expected(imp);
-		}
-
-		spin_unlock(&imp->imp_lock);
-	}
+	ptlrpc_req_commit_status(req);
 
 	RETURN(rc);
 }
@@ -2671,6 +2682,59 @@ __u64 ptlrpc_req_xid(struct ptlrpc_request *request)
 }
 EXPORT_SYMBOL(ptlrpc_req_xid);
 
+/**
+ * Install reply message \a msg of \a len bytes into \a req, which was packed
+ * but never sent on its own because it was carried inside another RPC (e.g.
+ * MDS_BATCH_GETATTR). On success \a req can be interpreted as if it had been
+ * replied by the server directly, and a modifying request is kept for replay
+ * like any other, in which case it is sent alone.
+ *
+ * \retval status of the reply or negative errno if it can't be unpacked
+ */
+int ptlrpc_req_set_subreply(struct ptlrpc_request *req, struct lustre_msg *msg,
+			    int len)
+{
+	struct obd_import *imp = req->rq_import;
+	int rc;
+
+	ENTRY;
+	LASSERT(req->rq_repbuf == NULL);
+
+	/* the reply of a replay can be much larger than the sub-reply */
+	rc = sptlrpc_cli_alloc_repbuf(req, max_t(int, len, req->rq_replen));
+	if (rc)
+		RETURN(rc);
+
+	memcpy(req->rq_repbuf, msg, len);
+	req->rq_repdata = req->rq_repbuf;
+	req->rq_repdata_len = len;
+	req->rq_repmsg = req->rq_repbuf;
+	req->rq_replen = len;
+	req->rq_nob_received = len;
+
+	rc = ptlrpc_unpack_rep_msg(req, len);
+	if (rc == 0)
+		rc = lustre_unpack_rep_ptlrpc_body(req, MSG_PTLRPC_BODY_OFF);
+	if (rc) {
+		DEBUG_REQ(D_ERROR, req, "unpack sub-reply failed: rc = %d", rc);
+		req->rq_repmsg = NULL;
+		RETURN(-EPROTO);
+	}
+
+	spin_lock(&imp->imp_lock);
+	list_del_init(&req->rq_unreplied_list);
+	spin_unlock(&imp->imp_lock);
+
+	spin_lock(&req->rq_lock);
+	req->rq_replied = 1;
+	spin_unlock(&req->rq_lock);
+
+	req->rq_status = ptlrpc_status_ntoh(lustre_msg_get_status(req->rq_repmsg));
+	ptlrpc_req_commit_status(req);
+	RETURN(req->rq_status);
+}
+EXPORT_SYMBOL(ptlrpc_req_set_subreply);
+
 /**
  * Disengage the client's reply buffer from the network
  * NB does _NOT_ unregister any client-side bulk.
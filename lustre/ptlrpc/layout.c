@@ -337,6 +337,19 @@ static const struct req_msg_field *mdt_swap_layouts[] = {
 	&RMF_DLM_REQ
 };
 
+static const struct req_msg_field *mdt_batch_getattr[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_BATCH_HEADER,
+	&RMF_BATCH_BUF
+};
+
+static const struct req_msg_field *mdt_batch_reint_client[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_BATCH_HEADER,
+	&RMF_BATCH_XID,
+	&RMF_BATCH_BUF
+};
+
 static const struct req_msg_field *obd_connect_client[] = {
 	&RMF_PTLRPC_BODY,
 	&RMF_TGTUUID,
@@ -396,6 +409,12 @@ static const struct req_msg_field *ldlm_cp_callback_client[] = {
         &RMF_DLM_LVB
 };
 
+/* handles of the locks the client doesn't have any more */
+static const struct req_msg_field *ldlm_bl_callback_batch_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_DLM_REQ
+};
+
 static const struct req_msg_field *ldlm_gl_callback_desc_client[] = {
 	&RMF_PTLRPC_BODY,
 	&RMF_DLM_REQ,
@@ -623,7 +642,8 @@ static const struct req_msg_field *ost_brw_client[] = {
 	&RMF_OBD_IOOBJ,
 	&RMF_NIOBUF_REMOTE,
 	&RMF_CAPA1,
-	&RMF_SHORT_IO
+	&RMF_SHORT_IO,
+	&RMF_OST_BODIES
 };
 
 static const struct req_msg_field *ost_brw_read_server[] = {
@@ -784,6 +804,8 @@ static struct req_format *req_formats[] = {
 	&RQF_MDS_HSM_ACTION,
 	&RQF_MDS_HSM_REQUEST,
 	&RQF_MDS_SWAP_LAYOUTS,
+	&RQF_MDS_BATCH_GETATTR,
+	&RQF_MDS_BATCH_REINT,
 	&RQF_OUT_UPDATE,
 	&RQF_OST_CONNECT,
 	&RQF_OST_DISCONNECT,
@@ -811,6 +833,7 @@ static struct req_format *req_formats[] = {
 	&RQF_LDLM_CALLBACK,
 	&RQF_LDLM_CP_CALLBACK,
 	&RQF_LDLM_BL_CALLBACK,
+	&RQF_LDLM_BL_CALLBACK_BATCH,
 	&RQF_LDLM_GL_CALLBACK,
 	&RQF_LDLM_GL_CALLBACK_DESC,
 	&RQF_LDLM_INTENT,
@@ -1135,6 +1158,13 @@ struct req_msg_field RMF_OST_BODY =
 		    dump_ost_body);
 EXPORT_SYMBOL(RMF_OST_BODY);
 
+/* ost_body of the objects after the first one of a multi-object OST_WRITE */
+struct req_msg_field RMF_OST_BODIES =
+	DEFINE_MSGF("ost_bodies", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct ost_body), lustre_swab_ost_body,
+		    dump_ost_body);
+EXPORT_SYMBOL(RMF_OST_BODIES);
+
 struct req_msg_field RMF_OBD_IOOBJ =
         DEFINE_MSGF("obd_ioobj", RMF_F_STRUCT_ARRAY,
                     sizeof(struct obd_ioobj), lustre_swab_obd_ioobj, dump_ioo);
@@ -1243,6 +1273,21 @@ struct req_msg_field RMF_SWAP_LAYOUTS =
 		    lustre_swab_swap_layouts, NULL);
 EXPORT_SYMBOL(RMF_SWAP_LAYOUTS);
 
+struct req_msg_field RMF_BATCH_HEADER =
+	DEFINE_MSGF("batch_header", 0, sizeof(struct mdt_batch_header),
+		    lustre_swab_mdt_batch_header, NULL);
+EXPORT_SYMBOL(RMF_BATCH_HEADER);
+
+/* packed lustre_msg's, never swabbed as a whole, see mdt_batch_getattr() */
+struct req_msg_field RMF_BATCH_BUF =
+	DEFINE_MSGF("batch_buf", 0, -1, NULL, NULL);
+EXPORT_SYMBOL(RMF_BATCH_BUF);
+
+/* xids of the messages in RMF_BATCH_BUF, never swabbed either */
+struct req_msg_field RMF_BATCH_XID =
+	DEFINE_MSGF("batch_xid", RMF_F_STRUCT_ARRAY, sizeof(__u64), NULL, NULL);
+EXPORT_SYMBOL(RMF_BATCH_XID);
+
 struct req_msg_field RMF_LFSCK_REQUEST =
 	DEFINE_MSGF("lfsck_request", 0, sizeof(struct lfsck_request),
 		    lustre_swab_lfsck_request, NULL);
@@ -1527,6 +1572,11 @@ struct req_format RQF_LDLM_BL_CALLBACK =
         DEFINE_REQ_FMT0("LDLM_BL_CALLBACK", ldlm_enqueue_client, empty);
 EXPORT_SYMBOL(RQF_LDLM_BL_CALLBACK);
 
+struct req_format RQF_LDLM_BL_CALLBACK_BATCH =
+	DEFINE_REQ_FMT0("LDLM_BL_CALLBACK_BATCH", ldlm_enqueue_client,
+			ldlm_bl_callback_batch_server);
+EXPORT_SYMBOL(RQF_LDLM_BL_CALLBACK_BATCH);
+
 struct req_format RQF_LDLM_GL_CALLBACK =
         DEFINE_REQ_FMT0("LDLM_GL_CALLBACK", ldlm_enqueue_client,
                         ldlm_gl_callback_server);
@@ -1622,6 +1672,16 @@ struct req_format RQF_MDS_SWAP_LAYOUTS =
 			mdt_swap_layouts, empty);
 EXPORT_SYMBOL(RQF_MDS_SWAP_LAYOUTS);
 
+struct req_format RQF_MDS_BATCH_GETATTR =
+	DEFINE_REQ_FMT0("MDS_BATCH_GETATTR",
+			mdt_batch_getattr, mdt_batch_getattr);
+EXPORT_SYMBOL(RQF_MDS_BATCH_GETATTR);
+
+struct req_format RQF_MDS_BATCH_REINT =
+	DEFINE_REQ_FMT0("MDS_BATCH_REINT",
+			mdt_batch_reint_client, mdt_batch_getattr);
+EXPORT_SYMBOL(RQF_MDS_BATCH_REINT);
+
 struct req_format RQF_LLOG_ORIGIN_HANDLE_CREATE =
         DEFINE_REQ_FMT0("LLOG_ORIGIN_HANDLE_CREATE",
                         llog_origin_handle_create_client, llogd_body_only);
@@ -1836,6 +1896,40 @@ void req_capsule_fini(struct req_capsule *pill)
 }
 EXPORT_SYMBOL(req_capsule_fini);
 
+/**
+ * Initialize a server pill over a request message \a reqmsg packed inside
+ * the buffer of another request \a req (e.g. MDS_BATCH_GETATTR).
+ *
+ * The reply is packed into a separately allocated message which the caller
+ * copies out from \a rc_repmsg / \a rc_replen before req_capsule_subreq_fini().
+ * Sub-requests are never swabbed, so \a req must not need swabbing either.
+ */
+void req_capsule_subreq_init(struct req_capsule *pill,
+			     const struct req_format *fmt,
+			     struct ptlrpc_request *req,
+			     struct lustre_msg *reqmsg)
+{
+	LASSERT(reqmsg != NULL);
+
+	memset(pill, 0, sizeof(*pill));
+	pill->rc_req = req;
+	pill->rc_loc = RCL_SERVER;
+	pill->rc_reqmsg = reqmsg;
+	req_capsule_init_area(pill);
+	req_capsule_set(pill, fmt);
+}
+EXPORT_SYMBOL(req_capsule_subreq_init);
+
+void req_capsule_subreq_fini(struct req_capsule *pill)
+{
+	if (pill->rc_repmsg != NULL)
+		OBD_FREE_LARGE(pill->rc_repmsg, pill->rc_repbuf_len);
+	pill->rc_repmsg = NULL;
+	pill->rc_replen = 0;
+	pill->rc_repbuf_len = 0;
+}
+EXPORT_SYMBOL(req_capsule_subreq_fini);
+
 static int __req_format_is_sane(const struct req_format *fmt)
 {
 	return fmt->rf_idx < ARRAY_SIZE(req_formats) &&
@@ -1847,6 +1941,9 @@ static struct lustre_msg *__req_msg(const struct req_capsule *pill,
 {
         struct ptlrpc_request *req;
 
+	if (pill->rc_reqmsg != NULL)
+		return loc == RCL_CLIENT ? pill->rc_reqmsg : pill->rc_repmsg;
+
         req = pill->rc_req;
         return loc == RCL_CLIENT ? req->rq_reqmsg : req->rq_repmsg;
 }
@@ -1900,6 +1997,30 @@ size_t req_capsule_filled_sizes(struct req_capsule *pill,
 }
 EXPORT_SYMBOL(req_capsule_filled_sizes);
 
+/* reply of a sub-request has no reply state, just a plain message buffer */
+static int req_capsule_subreq_pack(struct req_capsule *pill, int count)
+{
+	struct lustre_msg *msg;
+	__u32 len;
+
+	LASSERT(pill->rc_repmsg == NULL);
+
+	len = lustre_msg_size_v2(count, pill->rc_area[RCL_SERVER]);
+	OBD_ALLOC_LARGE(msg, len);
+	if (msg == NULL)
+		return -ENOMEM;
+
+	lustre_init_msg_v2(msg, count, pill->rc_area[RCL_SERVER], NULL);
+	lustre_msg_add_version(msg, PTLRPC_MSG_VERSION);
+	lustre_msg_set_type(msg, PTL_RPC_MSG_REPLY);
+	lustre_msg_set_opc(msg, lustre_msg_get_opc(pill->rc_reqmsg));
+
+	pill->rc_repmsg = msg;
+	pill->rc_replen = len;
+	pill->rc_repbuf_len = len;
+	return 0;
+}
+
 /**
  * Capsule equivalent of lustre_pack_request() and lustre_pack_reply().
  *
@@ -1918,8 +2039,11 @@ int req_capsule_server_pack(struct req_capsule *pill)
         LASSERT(fmt != NULL);
 
         count = req_capsule_filled_sizes(pill, RCL_SERVER);
-        rc = lustre_pack_reply(pill->rc_req, count,
-                               pill->rc_area[RCL_SERVER], NULL);
+	if (pill->rc_reqmsg != NULL)
+		rc = req_capsule_subreq_pack(pill, count);
+	else
+		rc = lustre_pack_reply(pill->rc_req, count,
+				       pill->rc_area[RCL_SERVER], NULL);
         if (rc != 0) {
                 DEBUG_REQ(D_ERROR, pill->rc_req,
                        "Cannot pack %d fields in format `%s': ",
@@ -2479,7 +2603,10 @@ void req_capsule_shrink(struct req_capsule *pill,
 	LASSERTF(newlen <= len, "%s:%s, oldlen=%u, newlen=%u\n",
                                 fmt->rf_name, field->rmf_name, len, newlen);
 
-        if (loc == RCL_CLIENT)
+	if (pill->rc_reqmsg != NULL) {
+		LASSERT(loc == RCL_SERVER);
+		pill->rc_replen = lustre_shrink_msg(msg, offset, newlen, 1);
+	} else if (loc == RCL_CLIENT)
                 pill->rc_req->rq_reqlen = lustre_shrink_msg(msg, offset, newlen,
                                                             1);
         else
@@ -2488,12 +2615,59 @@ void req_capsule_shrink(struct req_capsule *pill,
 }
 EXPORT_SYMBOL(req_capsule_shrink);
 
+/* copy all buffers but \a offset from \a src into the repacked \a dst */
+static void req_capsule_grow_copy(struct lustre_msg *dst,
+				  struct lustre_msg *src, __u32 offset)
+{
+	char *from, *to;
+	__u32 len;
+
+	/* Now we need only buffers, copy first chunk */
+	to = lustre_msg_buf(dst, 0, 0);
+	from = lustre_msg_buf(src, 0, 0);
+	len = (char *)lustre_msg_buf(src, offset, 0) - from;
+	memcpy(to, from, len);
+	/* check if we have tail and copy it too */
+	if (src->lm_bufcount > offset + 1) {
+		to = lustre_msg_buf(dst, offset + 1, 0);
+		from = lustre_msg_buf(src, offset + 1, 0);
+		offset = src->lm_bufcount - 1;
+		len = (char *)lustre_msg_buf(src, offset, 0) +
+		      cfs_size_round(src->lm_buflens[offset]) - from;
+		memcpy(to, from, len);
+	}
+}
+
+static int req_capsule_subreq_grow(struct req_capsule *pill,
+				   const struct req_msg_field *field,
+				   __u32 offset, __u32 newlen)
+{
+	struct lustre_msg *msg = pill->rc_repmsg;
+	__u32 replen = pill->rc_replen;
+	__u32 buflen = pill->rc_repbuf_len;
+	int rc;
+
+	pill->rc_repmsg = NULL;
+	req_capsule_set_size(pill, field, RCL_SERVER, newlen);
+	rc = req_capsule_server_pack(pill);
+	if (rc) {
+		/* put old reply back, the caller will decide what to do */
+		pill->rc_repmsg = msg;
+		pill->rc_replen = replen;
+		pill->rc_repbuf_len = buflen;
+		return rc;
+	}
+
+	req_capsule_grow_copy(pill->rc_repmsg, msg, offset);
+	OBD_FREE_LARGE(msg, buflen);
+	return 0;
+}
+
 int req_capsule_server_grow(struct req_capsule *pill,
 			    const struct req_msg_field *field,
 			    __u32 newlen)
 {
         struct ptlrpc_reply_state *rs = pill->rc_req->rq_reply_state, *nrs;
-        char *from, *to;
 	int rc;
 	__u32 offset, len;
 
@@ -2504,6 +2678,9 @@ int req_capsule_server_grow(struct req_capsule *pill,
 
         len = req_capsule_get_size(pill, field, RCL_SERVER);
         offset = __req_capsule_offset(pill, field, RCL_SERVER);
+	if (pill->rc_reqmsg != NULL)
+		return req_capsule_subreq_grow(pill, field, offset, newlen);
+
 	if ((__u32)pill->rc_req->rq_repbuf_len >=
             lustre_packed_msg_size(pill->rc_req->rq_repmsg) - len + newlen)
                 CERROR("Inplace repack might be done\n");
@@ -2517,20 +2694,7 @@ int req_capsule_server_grow(struct req_capsule *pill,
                 return rc;
         }
         nrs = pill->rc_req->rq_reply_state;
-        /* Now we need only buffers, copy first chunk */
-        to = lustre_msg_buf(nrs->rs_msg, 0, 0);
-        from = lustre_msg_buf(rs->rs_msg, 0, 0);
-        len = (char *)lustre_msg_buf(rs->rs_msg, offset, 0) - from;
-        memcpy(to, from, len);
-        /* check if we have tail and copy it too */
-        if (rs->rs_msg->lm_bufcount > offset + 1) {
-                to = lustre_msg_buf(nrs->rs_msg, offset + 1, 0);
-                from = lustre_msg_buf(rs->rs_msg, offset + 1, 0);
-                offset = rs->rs_msg->lm_bufcount - 1;
-                len = (char *)lustre_msg_buf(rs->rs_msg, offset, 0) +
-                      cfs_size_round(rs->rs_msg->lm_buflens[offset]) - from;
-                memcpy(to, from, len);
-        }
+	req_capsule_grow_copy(nrs->rs_msg, rs->rs_msg, offset);
         /* drop old reply if everything is fine */
         if (rs->rs_difficult) {
                 /* copy rs data */
@@ -95,6 +95,8 @@ static struct ll_rpc_opcode {
 	{ MDS_HSM_CT_REGISTER, "mds_hsm_ct_register" },
 	{ MDS_HSM_CT_UNREGISTER, "mds_hsm_ct_unregister" },
 	{ MDS_SWAP_LAYOUTS,	"mds_swap_layouts" },
+	{ MDS_BATCH_GETATTR,	"mds_batch_getattr" },
+	{ MDS_BATCH_REINT,	"mds_batch_reint" },
         { LDLM_ENQUEUE,     "ldlm_enqueue" },
         { LDLM_CONVERT,     "ldlm_convert" },
         { LDLM_CANCEL,      "ldlm_cancel" },
@@ -233,6 +235,12 @@ ptlrpc_ldebugfs_register(struct dentry *root, char *dir, char *name,
                              svc_counter_config, "req_timeout", "sec");
         lprocfs_counter_init(svc_stats, PTLRPC_REQBUF_AVAIL_CNTR,
                              svc_counter_config, "reqbuf_avail", "bufs");
+	lprocfs_counter_init(svc_stats, PTLRPC_REQSTOLEN_CNTR,
+			     svc_counter_config, "req_stolen", "reqs");
+	lprocfs_counter_init(svc_stats, PTLRPC_RSCACHE_HIT_CNTR,
+			     svc_counter_config, "rs_cache_hit", "reps");
+	lprocfs_counter_init(svc_stats, PTLRPC_RSCACHE_MISS_CNTR,
+			     svc_counter_config, "rs_cache_miss", "reps");
         for (i = 0; i < EXTRA_LAST_OPC; i++) {
                 char *units;
 
@@ -1119,6 +1127,40 @@ static int ptlrpc_lprocfs_timeouts_seq_show(struct seq_file *m, void *n)
 
 LDEBUGFS_SEQ_FOPS_RO(ptlrpc_lprocfs_timeouts);
 
+/* per-partition queue depth and work stealing, not strictly consistent */
+static int ptlrpc_lprocfs_cpt_queues_seq_show(struct seq_file *m, void *n)
+{
+	struct ptlrpc_service		*svc = m->private;
+	struct ptlrpc_service_part	*svcpt;
+	int				i;
+
+	seq_printf(m, "%-4s %8s %8s %10s %10s %12s\n", "cpt", "threads",
+		   "active", "queued", "hp_queued", "stolen");
+
+	ptlrpc_service_for_each_part(svcpt, i, svc) {
+		unsigned long hp_queued = 0;
+		unsigned long queued;
+		int active;
+		__u64 stolen;
+
+		spin_lock(&svcpt->scp_req_lock);
+		queued = svcpt->scp_nrs_reg.nrs_req_queued;
+		if (svcpt->scp_nrs_hp != NULL)
+			hp_queued = svcpt->scp_nrs_hp->nrs_req_queued;
+		active = svcpt->scp_nreqs_active;
+		stolen = svcpt->scp_nreqs_stolen;
+		spin_unlock(&svcpt->scp_req_lock);
+
+		seq_printf(m, "%-4d %8d %8d %10lu %10lu %12llu\n",
+			   svcpt->scp_cpt, svcpt->scp_nthrs_running, active,
+			   queued, hp_queued, stolen);
+	}
+
+	return 0;
+}
+
+LDEBUGFS_SEQ_FOPS_RO(ptlrpc_lprocfs_cpt_queues);
+
 static ssize_t high_priority_ratio_show(struct kobject *kobj,
 					struct attribute *attr,
 					char *buf)
@@ -1151,11 +1193,89 @@ static ssize_t high_priority_ratio_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(high_priority_ratio);
 
+static ssize_t steal_threshold_show(struct kobject *kobj,
+				    struct attribute *attr,
+				    char *buf)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+
+	return sprintf(buf, "%d\n", svc->srv_steal_threshold);
+}
+
+/* 0 disables stealing requests between CPT partitions */
+static ssize_t steal_threshold_store(struct kobject *kobj,
+				     struct attribute *attr,
+				     const char *buffer,
+				     size_t count)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc < 0)
+		return rc;
+
+	if (val > INT_MAX)
+		return -ERANGE;
+
+	spin_lock(&svc->srv_lock);
+	svc->srv_steal_threshold = val;
+	spin_unlock(&svc->srv_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(steal_threshold);
+
+static ssize_t reply_cache_max_show(struct kobject *kobj,
+				    struct attribute *attr,
+				    char *buf)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+
+	return sprintf(buf, "%d\n", svc->srv_rs_cache_max);
+}
+
+/*
+ * Idle reply states kept per size class and partition, 0 disables the cache.
+ * Lowering it does not free cached reply states, the caches drain as they
+ * are reused.
+ */
+static ssize_t reply_cache_max_store(struct kobject *kobj,
+				     struct attribute *attr,
+				     const char *buffer,
+				     size_t count)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc < 0)
+		return rc;
+
+	if (val > INT_MAX)
+		return -ERANGE;
+
+	spin_lock(&svc->srv_lock);
+	svc->srv_rs_cache_max = val;
+	spin_unlock(&svc->srv_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(reply_cache_max);
+
 static struct attribute *ptlrpc_svc_attrs[] = {
 	&lustre_attr_threads_min.attr,
 	&lustre_attr_threads_started.attr,
 	&lustre_attr_threads_max.attr,
 	&lustre_attr_high_priority_ratio.attr,
+	&lustre_attr_steal_threshold.attr,
+	&lustre_attr_reply_cache_max.attr,
 	NULL,
 };
 
@@ -1204,6 +1324,9 @@ void ptlrpc_ldebugfs_register_service(struct dentry *entry,
 		{ .name = "timeouts",
 		  .fops = &ptlrpc_lprocfs_timeouts_fops,
 		  .data = svc },
+		{ .name = "cpt_queues",
+		  .fops = &ptlrpc_lprocfs_cpt_queues_fops,
+		  .data = svc },
 		{ .name = "nrs_policies",
 		  .fops = &ptlrpc_lprocfs_nrs_fops,
 		  .data = svc },
@@ -0,0 +1,897 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * lustre/ptlrpc/nrs_slo.c
+ *
+ * Network Request Scheduler (NRS) SLO policy
+ *
+ * This policy schedules requests by earliest deadline, where the deadline of
+ * a request is derived from a per-jobid, per-uid or per-opcode latency
+ * target, or from the RPC deadline for requests that match no target.
+ */
+/**
+ * \addtogoup nrs
+ * @{
+ */
+
+#define DEBUG_SUBSYSTEM S_RPC
+#include <obd_support.h>
+#include <obd_class.h>
+#include "ptlrpc_internal.h"
+
+/**
+ * \name slo
+ *
+ * Queued requests are kept in a binary heap ordered by deadline. Before a
+ * request is handed out, the requests at the top of the heap which can no
+ * longer be served before their deadline, given the current service time
+ * estimate of the policy, are moved to a second heap of late requests.
+ * Late requests are not dropped, since the client would only resend them,
+ * but they are served behind the requests which can still meet their
+ * target: one late request every NRS_SLO_LATE_RATIO requests, or whenever
+ * no on-time request is queued.
+ *
+ * The service time estimate is a running average of the time taken to
+ * handle requests under this policy; until the first request completes it
+ * is the adaptive timeout service estimate of the service partition.
+ *
+ * @{
+ */
+
+#define NRS_POL_NAME_SLO	"slo"
+
+/* Serve one late request for every NRS_SLO_LATE_RATIO on-time requests. */
+#define NRS_SLO_LATE_RATIO	8
+/* Maximum number of requests moved to the late heap per dequeue. */
+#define NRS_SLO_DEMOTE_BATCH	16
+/* Upper bound of a latency target, in milliseconds. */
+#define NRS_SLO_TARGET_MAX	3600000
+
+/**
+ * Binary heap predicate.
+ *
+ * Elements are sorted by deadline, and by arrival order for requests with
+ * the same deadline.
+ *
+ * \retval 0 e1 > e2
+ * \retval 1 e1 <= e2
+ */
+static int slo_req_compare(struct cfs_binheap_node *e1,
+			   struct cfs_binheap_node *e2)
+{
+	struct ptlrpc_nrs_request *nrq1;
+	struct ptlrpc_nrs_request *nrq2;
+
+	nrq1 = container_of(e1, struct ptlrpc_nrs_request, nr_node);
+	nrq2 = container_of(e2, struct ptlrpc_nrs_request, nr_node);
+
+	if (nrq1->nr_u.slo.sr_deadline < nrq2->nr_u.slo.sr_deadline)
+		return 1;
+	if (nrq1->nr_u.slo.sr_deadline > nrq2->nr_u.slo.sr_deadline)
+		return 0;
+
+	return nrq1->nr_u.slo.sr_sequence <= nrq2->nr_u.slo.sr_sequence;
+}
+
+static struct cfs_binheap_ops nrs_slo_heap_ops = {
+	.hop_enter	= NULL,
+	.hop_exit	= NULL,
+	.hop_compare	= slo_req_compare,
+};
+
+/**
+ * Is called before the policy transitions into
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STARTED; allocates and initializes
+ * the SLO-specific private data structure.
+ *
+ * \param[in] policy The policy to start
+ * \param[in] arg    Generic char buffer; unused in this policy
+ *
+ * \retval -ENOMEM OOM error
+ * \retval  0	   success
+ *
+ * \see nrs_policy_register()
+ * \see nrs_policy_ctl()
+ */
+static int nrs_slo_start(struct ptlrpc_nrs_policy *policy, char *arg)
+{
+	struct nrs_slo_head *head;
+	int rc = 0;
+
+	ENTRY;
+
+	OBD_CPT_ALLOC_PTR(head, nrs_pol2cptab(policy), nrs_pol2cptid(policy));
+	if (head == NULL)
+		RETURN(-ENOMEM);
+
+	head->sh_binheap = cfs_binheap_create(&nrs_slo_heap_ops,
+					      CBH_FLAG_ATOMIC_GROW, 4096, NULL,
+					      nrs_pol2cptab(policy),
+					      nrs_pol2cptid(policy));
+	if (head->sh_binheap == NULL)
+		GOTO(out_free, rc = -ENOMEM);
+
+	head->sh_late_binheap = cfs_binheap_create(&nrs_slo_heap_ops,
+						   CBH_FLAG_ATOMIC_GROW, 4096,
+						   NULL, nrs_pol2cptab(policy),
+						   nrs_pol2cptid(policy));
+	if (head->sh_late_binheap == NULL)
+		GOTO(out_binheap, rc = -ENOMEM);
+
+	rwlock_init(&head->sh_rule_lock);
+	INIT_LIST_HEAD(&head->sh_rules);
+
+	policy->pol_private = head;
+
+	RETURN(0);
+
+out_binheap:
+	cfs_binheap_destroy(head->sh_binheap);
+out_free:
+	OBD_FREE_PTR(head);
+	RETURN(rc);
+}
+
+/**
+ * Is called before the policy transitions into
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED; deallocates the SLO-specific
+ * private data structure and the rules of the policy instance.
+ *
+ * \param[in] policy The policy to stop
+ *
+ * \see nrs_policy_stop0()
+ */
+static void nrs_slo_stop(struct ptlrpc_nrs_policy *policy)
+{
+	struct nrs_slo_head *head = policy->pol_private;
+	struct nrs_slo_rule *rule;
+	struct nrs_slo_rule *tmp;
+
+	LASSERT(head != NULL);
+	LASSERT(cfs_binheap_is_empty(head->sh_binheap));
+	LASSERT(cfs_binheap_is_empty(head->sh_late_binheap));
+
+	list_for_each_entry_safe(rule, tmp, &head->sh_rules, sr_linkage) {
+		list_del(&rule->sr_linkage);
+		OBD_FREE_PTR(rule);
+	}
+
+	cfs_binheap_destroy(head->sh_late_binheap);
+	cfs_binheap_destroy(head->sh_binheap);
+
+	OBD_FREE_PTR(head);
+}
+
+/**
+ * Is called for obtaining an SLO policy resource.
+ *
+ * \param[in]  policy	  The policy on which the request is being asked for
+ * \param[in]  nrq	  The request for which resources are being taken
+ * \param[in]  parent	  Parent resource, unused in this policy
+ * \param[out] resp	  Resources references are placed in this array
+ * \param[in]  moving_req Signifies limited caller context; unused in this
+ *			  policy
+ *
+ * \retval 1 The SLO policy only has a one-level resource hierarchy
+ *
+ * \see nrs_resource_get_safe()
+ */
+static int nrs_slo_res_get(struct ptlrpc_nrs_policy *policy,
+			   struct ptlrpc_nrs_request *nrq,
+			   const struct ptlrpc_nrs_resource *parent,
+			   struct ptlrpc_nrs_resource **resp, bool moving_req)
+{
+	*resp = &((struct nrs_slo_head *)policy->pol_private)->sh_res;
+	return 1;
+}
+
+/**
+ * Returns the time a request is expected to take to be handled, in ns.
+ */
+static __u64 nrs_slo_service_time(struct ptlrpc_nrs_policy *policy,
+				  struct nrs_slo_head *head)
+{
+	struct ptlrpc_service_part *svcpt = nrs_pol2svcpt(policy);
+
+	if (head->sh_service_time != 0)
+		return head->sh_service_time;
+
+	return AT_OFF ? 0 :
+	       (__u64)at_get(&svcpt->scp_at_estimate) * NSEC_PER_SEC;
+}
+
+/**
+ * Moves the requests at the top of the on-time heap which cannot be handled
+ * before their deadline any more to the late heap.
+ */
+static void nrs_slo_demote(struct ptlrpc_nrs_policy *policy,
+			   struct nrs_slo_head *head)
+{
+	struct cfs_binheap_node *node;
+	struct ptlrpc_nrs_request *nrq;
+	__u64 finish;
+	int i;
+
+	finish = ktime_get_real_ns() + nrs_slo_service_time(policy, head);
+
+	for (i = 0; i < NRS_SLO_DEMOTE_BATCH; i++) {
+		node = cfs_binheap_root(head->sh_binheap);
+		if (node == NULL)
+			break;
+
+		nrq = container_of(node, struct ptlrpc_nrs_request, nr_node);
+		if (nrq->nr_u.slo.sr_deadline >= finish)
+			break;
+
+		cfs_binheap_remove(head->sh_binheap, node);
+		if (cfs_binheap_insert(head->sh_late_binheap, node) != 0) {
+			/* the on-time heap does not shrink, this can't fail */
+			cfs_binheap_insert(head->sh_binheap, node);
+			break;
+		}
+		nrq->nr_u.slo.sr_late = 1;
+	}
+}
+
+/**
+ * Called when getting a request from the SLO policy for handling, or just
+ * peeking; removes the request from the policy when it is to be handled.
+ *
+ * \param[in] policy The policy
+ * \param[in] peek   When set, signifies that we just want to examine the
+ *		     request, and not handle it, so the request is not removed
+ *		     from the policy.
+ * \param[in] force  Force the policy to return a request; unused in this
+ *		     policy, which always returns a queued request
+ *
+ * \retval The request to be handled
+ * \retval NULL no request available
+ *
+ * \see ptlrpc_nrs_req_get_nolock()
+ * \see nrs_request_get()
+ */
+static
+struct ptlrpc_nrs_request *nrs_slo_req_get(struct ptlrpc_nrs_policy *policy,
+					   bool peek, bool force)
+{
+	struct nrs_slo_head *head = policy->pol_private;
+	struct cfs_binheap_node *node;
+	struct cfs_binheap_node *late;
+	struct ptlrpc_nrs_request *nrq;
+
+	nrs_slo_demote(policy, head);
+
+	node = cfs_binheap_root(head->sh_binheap);
+	late = cfs_binheap_root(head->sh_late_binheap);
+	if (late != NULL &&
+	    (node == NULL || head->sh_since_late >= NRS_SLO_LATE_RATIO))
+		node = late;
+
+	if (node == NULL)
+		return NULL;
+
+	nrq = container_of(node, struct ptlrpc_nrs_request, nr_node);
+	if (likely(!peek)) {
+		if (nrq->nr_u.slo.sr_late) {
+			cfs_binheap_remove(head->sh_late_binheap, node);
+			head->sh_since_late = 0;
+			head->sh_nreqs_late++;
+		} else {
+			cfs_binheap_remove(head->sh_binheap, node);
+			head->sh_since_late++;
+		}
+		head->sh_nreqs++;
+		nrq->nr_u.slo.sr_start = ktime_get();
+	}
+
+	return nrq;
+}
+
+/**
+ * Returns the latency target of request \a req in ms, or 0 if the request
+ * does not match any rule and there is no default target.
+ */
+static __u32 nrs_slo_req_target(struct nrs_slo_head *head,
+				struct ptlrpc_request *req)
+{
+	struct nrs_slo_rule *rule;
+	struct tbf_id id;
+	bool uid_valid = false;
+	__u32 target;
+	char *jobid;
+	__u32 opc;
+
+	jobid = lustre_msg_get_jobid(req->rq_reqmsg);
+	opc = lustre_msg_get_opc(req->rq_reqmsg);
+
+	read_lock(&head->sh_rule_lock);
+	target = head->sh_default_target;
+	list_for_each_entry(rule, &head->sh_rules, sr_linkage) {
+		switch (rule->sr_match) {
+		case NRS_SLO_MATCH_JOBID: {
+			size_t len = strlen(rule->sr_jobid);
+
+			if (jobid == NULL)
+				continue;
+			if (len > 0 && rule->sr_jobid[len - 1] == '*') {
+				if (strncmp(jobid, rule->sr_jobid, len - 1))
+					continue;
+			} else if (strcmp(jobid, rule->sr_jobid)) {
+				continue;
+			}
+			break;
+		}
+		case NRS_SLO_MATCH_UID:
+			if (!uid_valid) {
+				if (nrs_tbf_id_cli_set(req, &id,
+						       NRS_TBF_FLAG_UID))
+					continue;
+				uid_valid = true;
+			}
+			if (id.ti_uid != rule->sr_uid)
+				continue;
+			break;
+		case NRS_SLO_MATCH_OPCODE:
+			if (opc != rule->sr_opcode)
+				continue;
+			break;
+		default:
+			continue;
+		}
+
+		rule->sr_nreqs++;
+		target = rule->sr_target;
+		break;
+	}
+	read_unlock(&head->sh_rule_lock);
+
+	return target;
+}
+
+/**
+ * Adds request \a nrq to an SLO \a policy instance's set of queued requests
+ *
+ * The deadline of the request is its arrival time plus the latency target
+ * of the first rule it matches, or the default target. Requests without a
+ * target use the RPC deadline, so they are only preferred to requests with
+ * a target once they are about to time out.
+ *
+ * \param[in] policy The policy
+ * \param[in] nrq    The request to add
+ *
+ * \retval 0 request added
+ * \retval != 0 error
+ */
+static int nrs_slo_req_add(struct ptlrpc_nrs_policy *policy,
+			   struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_slo_head *head = policy->pol_private;
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+	__u32 target;
+
+	target = nrs_slo_req_target(head, req);
+	if (target != 0)
+		nrq->nr_u.slo.sr_deadline =
+			timespec64_to_ns(&req->rq_arrival_time) +
+			(__u64)target * NSEC_PER_MSEC;
+	else
+		nrq->nr_u.slo.sr_deadline = req->rq_deadline * NSEC_PER_SEC;
+
+	nrq->nr_u.slo.sr_sequence = head->sh_sequence++;
+	nrq->nr_u.slo.sr_late = 0;
+
+	return cfs_binheap_insert(head->sh_binheap, &nrq->nr_node);
+}
+
+/**
+ * Removes request \a nrq from \a policy's set of queued requests.
+ *
+ * \param[in] policy The policy
+ * \param[in] nrq    The request to remove
+ */
+static void nrs_slo_req_del(struct ptlrpc_nrs_policy *policy,
+			    struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_slo_head *head = policy->pol_private;
+
+	if (nrq->nr_u.slo.sr_late)
+		cfs_binheap_remove(head->sh_late_binheap, &nrq->nr_node);
+	else
+		cfs_binheap_remove(head->sh_binheap, &nrq->nr_node);
+}
+
+/**
+ * Updates the service time estimate of the policy instance right before the
+ * request \a nrq stops being handled.
+ *
+ * \param[in] policy The policy handling the request
+ * \param[in] nrq    The request being handled
+ *
+ * \see ptlrpc_server_finish_request()
+ * \see ptlrpc_nrs_req_stop_nolock()
+ */
+static void nrs_slo_req_stop(struct ptlrpc_nrs_policy *policy,
+			     struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_slo_head *head = policy->pol_private;
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+	__u64 elapsed;
+
+	elapsed = ktime_to_ns(ktime_sub(ktime_get(), nrq->nr_u.slo.sr_start));
+	if (head->sh_service_time == 0)
+		head->sh_service_time = elapsed;
+	else
+		head->sh_service_time = (head->sh_service_time * 7 +
+					 elapsed) / 8;
+
+	DEBUG_REQ(D_RPCTRACE, req,
+		  "NRS: finished %s request from %s in %lluus",
+		  nrq->nr_u.slo.sr_late ? "late" : "on-time",
+		  libcfs_id2str(req->rq_peer), elapsed / NSEC_PER_USEC);
+}
+
+static int nrs_slo_rule_dump(struct nrs_slo_rule *rule, struct seq_file *m)
+{
+	switch (rule->sr_match) {
+	case NRS_SLO_MATCH_JOBID:
+		seq_printf(m, "%s jobid=%s", rule->sr_name, rule->sr_jobid);
+		break;
+	case NRS_SLO_MATCH_UID:
+		seq_printf(m, "%s uid=%u", rule->sr_name, rule->sr_uid);
+		break;
+	case NRS_SLO_MATCH_OPCODE:
+		seq_printf(m, "%s opcode=%s", rule->sr_name,
+			   ll_opcode2str(rule->sr_opcode));
+		break;
+	default:
+		return -EINVAL;
+	}
+	seq_printf(m, " target=%u, matched=%llu\n", rule->sr_target,
+		   rule->sr_nreqs);
+
+	return seq_has_overflowed(m) ? -ENOSPC : 0;
+}
+
+static int nrs_slo_rule_dump_all(struct ptlrpc_nrs_policy *policy,
+				 struct nrs_slo_head *head, struct seq_file *m)
+{
+	struct nrs_slo_rule *rule;
+	int rc = 0;
+
+	read_lock(&head->sh_rule_lock);
+	seq_printf(m, "CPT %d:\n", nrs_pol2cptid(policy));
+	seq_printf(m, "default target=%u, service_time=%lluus, queued=%d, late_queued=%d, handled=%llu, handled_late=%llu\n",
+		   head->sh_default_target,
+		   nrs_slo_service_time(policy, head) / NSEC_PER_USEC,
+		   cfs_binheap_size(head->sh_binheap),
+		   cfs_binheap_size(head->sh_late_binheap),
+		   head->sh_nreqs, head->sh_nreqs_late);
+	list_for_each_entry(rule, &head->sh_rules, sr_linkage) {
+		rc = nrs_slo_rule_dump(rule, m);
+		if (rc)
+			break;
+	}
+	read_unlock(&head->sh_rule_lock);
+
+	if (rc == 0 && seq_has_overflowed(m))
+		rc = -ENOSPC;
+
+	return rc;
+}
+
+static struct nrs_slo_rule *
+nrs_slo_rule_find_nolock(struct nrs_slo_head *head, const char *name)
+{
+	struct nrs_slo_rule *rule;
+
+	list_for_each_entry(rule, &head->sh_rules, sr_linkage) {
+		if (strcmp(rule->sr_name, name) == 0)
+			return rule;
+	}
+	return NULL;
+}
+
+static int nrs_slo_command(struct ptlrpc_nrs_policy *policy,
+			   struct nrs_slo_head *head, struct nrs_slo_cmd *cmd)
+{
+	struct nrs_slo_rule *rule;
+	int rc = 0;
+
+	switch (cmd->sc_cmd) {
+	case NRS_SLO_CMD_START:
+		OBD_CPT_ALLOC_GFP(rule, nrs_pol2cptab(policy),
+				  nrs_pol2cptid(policy), sizeof(*rule),
+				  GFP_ATOMIC);
+		if (rule == NULL)
+			return -ENOMEM;
+
+		*rule = cmd->sc_rule;
+		rule->sr_nreqs = 0;
+
+		write_lock(&head->sh_rule_lock);
+		if (nrs_slo_rule_find_nolock(head, rule->sr_name) != NULL) {
+			rc = -EEXIST;
+		} else {
+			/* rules are matched in the order they were started */
+			list_add_tail(&rule->sr_linkage, &head->sh_rules);
+			rule = NULL;
+		}
+		write_unlock(&head->sh_rule_lock);
+
+		if (rule != NULL)
+			OBD_FREE_PTR(rule);
+		break;
+	case NRS_SLO_CMD_STOP:
+		write_lock(&head->sh_rule_lock);
+		rule = nrs_slo_rule_find_nolock(head, cmd->sc_rule.sr_name);
+		if (rule != NULL)
+			list_del(&rule->sr_linkage);
+		write_unlock(&head->sh_rule_lock);
+
+		if (rule == NULL)
+			return -ENOENT;
+		OBD_FREE_PTR(rule);
+		break;
+	case NRS_SLO_CMD_DEFAULT:
+		write_lock(&head->sh_rule_lock);
+		head->sh_default_target = cmd->sc_rule.sr_target;
+		write_unlock(&head->sh_rule_lock);
+		break;
+	default:
+		rc = -EINVAL;
+	}
+
+	return rc;
+}
+
+/**
+ * Performs ctl functions specific to SLO policy instances; similar to ioctl
+ *
+ * \param[in]     policy the policy instance
+ * \param[in]     opc    the opcode
+ * \param[in,out] arg    used for passing parameters and information
+ *
+ * \pre assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ * \post assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ *
+ * \retval 0   operation carried out successfully
+ * \retval -ve error
+ */
+static int nrs_slo_ctl(struct ptlrpc_nrs_policy *policy,
+		       enum ptlrpc_nrs_ctl opc, void *arg)
+{
+	struct nrs_slo_head *head = policy->pol_private;
+	int rc;
+
+	ENTRY;
+
+	assert_spin_locked(&policy->pol_nrs->nrs_lock);
+
+	switch ((enum nrs_ctl_slo)opc) {
+	default:
+		RETURN(-EINVAL);
+
+	case NRS_CTL_SLO_RD_RULE:
+		rc = nrs_slo_rule_dump_all(policy, head,
+					   (struct seq_file *)arg);
+		break;
+
+	case NRS_CTL_SLO_WR_RULE:
+		rc = nrs_slo_command(policy, head, (struct nrs_slo_cmd *)arg);
+		break;
+	}
+
+	RETURN(rc);
+}
+
+/**
+ * debugfs interface
+ */
+
+static int
+ptlrpc_lprocfs_nrs_slo_rules_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service *svc = m->private;
+	int rc;
+
+	seq_printf(m, "regular_requests:\n");
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+				       NRS_POL_NAME_SLO,
+				       NRS_CTL_SLO_RD_RULE,
+				       false, m);
+	/**
+	 * -ENOSPC means buf in the parameter m is overflow, return 0 here to
+	 * let seq_read alloc a larger memory area and do this process again.
+	 * Ignore -ENODEV as the regular NRS head's policy may be in the
+	 * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+	 */
+	if (rc == -ENOSPC)
+		return 0;
+	else if (rc != 0 && rc != -ENODEV)
+		return rc;
+
+	if (!nrs_svc_has_hp(svc))
+		return 0;
+
+	seq_printf(m, "high_priority_requests:\n");
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+				       NRS_POL_NAME_SLO,
+				       NRS_CTL_SLO_RD_RULE,
+				       false, m);
+	if (rc == -ENOSPC || rc == -ENODEV)
+		rc = 0;
+
+	return rc;
+}
+
+/**
+ * Parses a "key=value" token of a rule command into \a rule.
+ */
+static int nrs_slo_parse_value_pair(struct nrs_slo_cmd *cmd, char *buffer)
+{
+	struct nrs_slo_rule *rule = &cmd->sc_rule;
+	char *key;
+	char *val;
+	int rc;
+
+	val = buffer;
+	key = strsep(&val, "=");
+	if (val == NULL || strlen(val) == 0)
+		return -EINVAL;
+
+	if (strcmp(key, "target") == 0) {
+		rc = kstrtouint(val, 10, &rule->sr_target);
+		if (rc)
+			return rc;
+		if (rule->sr_target > NRS_SLO_TARGET_MAX)
+			return -ERANGE;
+		return 0;
+	}
+
+	if (cmd->sc_cmd != NRS_SLO_CMD_START || rule->sr_match != 0)
+		return -EINVAL;
+
+	if (strcmp(key, "jobid") == 0) {
+		if (strlen(val) >= sizeof(rule->sr_jobid))
+			return -E2BIG;
+		strlcpy(rule->sr_jobid, val, sizeof(rule->sr_jobid));
+		rule->sr_match = NRS_SLO_MATCH_JOBID;
+	} else if (strcmp(key, "uid") == 0) {
+		rc = kstrtou32(val, 10, &rule->sr_uid);
+		if (rc)
+			return rc;
+		rule->sr_match = NRS_SLO_MATCH_UID;
+	} else if (strcmp(key, "opcode") == 0) {
+		rc = ll_str2opcode(val);
+		if (rc < 0)
+			return rc;
+		rule->sr_opcode = rc;
+		rule->sr_match = NRS_SLO_MATCH_OPCODE;
+	} else {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * Parses an SLO rule command:
+ *
+ *   start <name> {jobid=<jobid>|uid=<uid>|opcode=<opcode>} target=<ms>
+ *   stop <name>
+ *   default target=<ms>
+ */
+static int nrs_slo_parse_cmd(struct nrs_slo_cmd *cmd, char *buffer)
+{
+	struct nrs_slo_rule *rule = &cmd->sc_rule;
+	bool has_target = false;
+	char *token;
+	char *val;
+	int rc;
+
+	val = strim(buffer);
+	token = strsep(&val, " ");
+	if (strcmp(token, "start") == 0)
+		cmd->sc_cmd = NRS_SLO_CMD_START;
+	else if (strcmp(token, "stop") == 0)
+		cmd->sc_cmd = NRS_SLO_CMD_STOP;
+	else if (strcmp(token, "default") == 0)
+		cmd->sc_cmd = NRS_SLO_CMD_DEFAULT;
+	else
+		return -EINVAL;
+
+	if (cmd->sc_cmd != NRS_SLO_CMD_DEFAULT) {
+		token = strsep(&val, " ");
+		if (token == NULL || strlen(token) == 0 ||
+		    strlen(token) >= sizeof(rule->sr_name))
+			return -EINVAL;
+		strlcpy(rule->sr_name, token, sizeof(rule->sr_name));
+	}
+
+	while (val != NULL && strlen(val) != 0) {
+		token = strsep(&val, " ");
+		if (strlen(token) == 0)
+			continue;
+		rc = nrs_slo_parse_value_pair(cmd, token);
+		if (rc)
+			return rc;
+		if (strncmp(token, "target", 6) == 0)
+			has_target = true;
+	}
+
+	switch (cmd->sc_cmd) {
+	case NRS_SLO_CMD_START:
+		if (rule->sr_match == 0 || !has_target ||
+		    rule->sr_target == 0)
+			return -EINVAL;
+		break;
+	case NRS_SLO_CMD_STOP:
+		if (has_target)
+			return -EINVAL;
+		break;
+	case NRS_SLO_CMD_DEFAULT:
+		if (!has_target)
+			return -EINVAL;
+		break;
+	}
+
+	return 0;
+}
+
+#define LPROCFS_WR_NRS_SLO_MAX_CMD	(4096)
+
+/**
+ * Starts or stops an SLO rule, or sets the default latency target, of SLO
+ * policy instances of a service. The command may be prefixed by "reg" or
+ * "hp" to only apply it to the regular or high-priority NRS head.
+ *
+ * For example:
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_slo_rules=
+ *	"start interactive jobid=vim.* target=50"
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_slo_rules="reg default target=1000"
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_slo_rules="stop interactive"
+ */
+static ssize_t
+ptlrpc_lprocfs_nrs_slo_rules_seq_write(struct file *file,
+				       const char __user *buffer,
+				       size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct ptlrpc_service *svc = m->private;
+	enum ptlrpc_nrs_queue_type queue = PTLRPC_NRS_QUEUE_BOTH;
+	struct nrs_slo_cmd *cmd;
+	char *kernbuf;
+	char *token;
+	char *val;
+	int rc;
+
+	if (count > LPROCFS_WR_NRS_SLO_MAX_CMD - 1)
+		return -EINVAL;
+
+	OBD_ALLOC(kernbuf, LPROCFS_WR_NRS_SLO_MAX_CMD);
+	if (kernbuf == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	OBD_ALLOC_PTR(cmd);
+	if (cmd == NULL)
+		GOTO(out_free_kernbuf, rc = -ENOMEM);
+
+	if (copy_from_user(kernbuf, buffer, count))
+		GOTO(out_free_cmd, rc = -EFAULT);
+
+	val = kernbuf;
+	token = strsep(&val, " ");
+	if (val == NULL)
+		GOTO(out_free_cmd, rc = -EINVAL);
+
+	if (strcmp(token, "reg") == 0) {
+		queue = PTLRPC_NRS_QUEUE_REG;
+	} else if (strcmp(token, "hp") == 0) {
+		queue = PTLRPC_NRS_QUEUE_HP;
+	} else {
+		kernbuf[strlen(token)] = ' ';
+		val = kernbuf;
+	}
+
+	if (queue == PTLRPC_NRS_QUEUE_HP && !nrs_svc_has_hp(svc))
+		GOTO(out_free_cmd, rc = -ENODEV);
+	else if (queue == PTLRPC_NRS_QUEUE_BOTH && !nrs_svc_has_hp(svc))
+		queue = PTLRPC_NRS_QUEUE_REG;
+
+	rc = nrs_slo_parse_cmd(cmd, val);
+	if (rc)
+		GOTO(out_free_cmd, rc);
+
+	/**
+	 * Serialize NRS core lprocfs operations with policy registration/
+	 * unregistration.
+	 */
+	mutex_lock(&nrs_core.nrs_mutex);
+	rc = ptlrpc_nrs_policy_control(svc, queue, NRS_POL_NAME_SLO,
+				       NRS_CTL_SLO_WR_RULE, false, cmd);
+	mutex_unlock(&nrs_core.nrs_mutex);
+
+out_free_cmd:
+	OBD_FREE_PTR(cmd);
+out_free_kernbuf:
+	OBD_FREE(kernbuf, LPROCFS_WR_NRS_SLO_MAX_CMD);
+out:
+	return rc ? rc : count;
+}
+
+LDEBUGFS_SEQ_FOPS(ptlrpc_lprocfs_nrs_slo_rules);
+
+/**
+ * Initializes an SLO policy's lprocfs interface for service \a svc
+ *
+ * \param[in] svc the service
+ *
+ * \retval 0	success
+ * \retval != 0	error
+ */
+static int nrs_slo_lprocfs_init(struct ptlrpc_service *svc)
+{
+	struct lprocfs_vars nrs_slo_lprocfs_vars[] = {
+		{ .name		= "nrs_slo_rules",
+		  .fops		= &ptlrpc_lprocfs_nrs_slo_rules_fops,
+		  .data		= svc },
+		{ NULL }
+	};
+
+	if (IS_ERR_OR_NULL(svc->srv_debugfs_entry))
+		return 0;
+
+	return ldebugfs_add_vars(svc->srv_debugfs_entry, nrs_slo_lprocfs_vars,
+				 NULL);
+}
+
+/**
+ * SLO policy operations
+ */
+static const struct ptlrpc_nrs_pol_ops nrs_slo_ops = {
+	.op_policy_start	= nrs_slo_start,
+	.op_policy_stop		= nrs_slo_stop,
+	.op_policy_ctl		= nrs_slo_ctl,
+	.op_res_get		= nrs_slo_res_get,
+	.op_req_get		= nrs_slo_req_get,
+	.op_req_enqueue		= nrs_slo_req_add,
+	.op_req_dequeue		= nrs_slo_req_del,
+	.op_req_stop		= nrs_slo_req_stop,
+	.op_lprocfs_init	= nrs_slo_lprocfs_init,
+};
+
+/**
+ * SLO policy configuration
+ */
+struct ptlrpc_nrs_pol_conf nrs_conf_slo = {
+	.nc_name		= NRS_POL_NAME_SLO,
+	.nc_ops			= &nrs_slo_ops,
+	.nc_compat		= nrs_policy_compat_all,
+};
+
+/** @} slo */
+
+/** @} nrs */
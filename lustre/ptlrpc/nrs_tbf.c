@@ -67,6 +67,9 @@ static int tbf_depth = 3;
 module_param(tbf_depth, int, 0644);
 MODULE_PARM_DESC(tbf_depth, "How many tokens that a client can save up");
 
+/* Maximum depth of a hierarchy of rules */
+#define NRS_TBF_MAX_LEVEL	4
+
 static enum hrtimer_restart nrs_tbf_timer_cb(struct hrtimer *timer)
 {
 	struct nrs_tbf_head *head = container_of(timer, struct nrs_tbf_head,
@@ -84,12 +87,20 @@ static enum hrtimer_restart nrs_tbf_timer_cb(struct hrtimer *timer)
 
 static void nrs_tbf_rule_fini(struct nrs_tbf_rule *rule)
 {
+	struct nrs_tbf_rule *parent = rule->tr_parent;
+
 	LASSERT(atomic_read(&rule->tr_ref) == 0);
 	LASSERT(list_empty(&rule->tr_cli_list));
 	LASSERT(list_empty(&rule->tr_linkage));
+	LASSERT(list_empty(&rule->tr_sibling));
+	LASSERT(list_empty(&rule->tr_children));
 
 	rule->tr_head->th_ops->o_rule_fini(rule);
 	OBD_FREE_PTR(rule);
+
+	/* Release the reference taken on the parent at rule start */
+	if (parent != NULL && atomic_dec_and_test(&parent->tr_ref))
+		nrs_tbf_rule_fini(parent);
 }
 
 /**
@@ -112,6 +123,146 @@ static inline void nrs_tbf_rule_get(struct nrs_tbf_rule *rule)
 	atomic_inc(&rule->tr_ref);
 }
 
+static inline bool nrs_tbf_rule_is_parent(struct nrs_tbf_rule *rule)
+{
+	return !list_empty(&rule->tr_children);
+}
+
+static void nrs_tbf_rule_set_rate(struct nrs_tbf_rule *rule, __u64 rate)
+{
+	rule->tr_rpc_rate = rate;
+	rule->tr_nsecs = NSEC_PER_SEC;
+	do_div(rule->tr_nsecs, rule->tr_rpc_rate);
+	rule->tr_generation++;
+}
+
+/**
+ * Splits the RPC rate of \a parent between its child rules which have a
+ * share, in proportion to their share. Child rules with an explicit rate
+ * keep it. Called with nrs_tbf_head::th_rule_lock held.
+ */
+static void nrs_tbf_rule_update_shares(struct nrs_tbf_rule *parent)
+{
+	struct nrs_tbf_rule *child;
+	__u64 total = 0;
+	__u64 rate;
+
+	list_for_each_entry(child, &parent->tr_children, tr_sibling)
+		total += child->tr_share;
+
+	if (total == 0)
+		return;
+
+	list_for_each_entry(child, &parent->tr_children, tr_sibling) {
+		if (child->tr_share == 0)
+			continue;
+
+		rate = parent->tr_rpc_rate * child->tr_share;
+		do_div(rate, total);
+		nrs_tbf_rule_set_rate(child, max_t(__u64, rate, 1));
+		nrs_tbf_rule_update_shares(child);
+	}
+}
+
+/**
+ * Refills the aggregate token bucket of parent rule \a rule.
+ *
+ * \retval the number of aggregate tokens available, negative while the
+ *	   bucket is in debt
+ */
+static __s64 nrs_tbf_rule_refill(struct nrs_tbf_rule *rule, __u64 now)
+{
+	__u64 passed;
+	__u64 ntoken;
+
+	if (now <= rule->tr_agg_check_time)
+		return rule->tr_agg_ntoken;
+
+	passed = now - rule->tr_agg_check_time;
+	/* long enough to refill the bucket from the largest debt */
+	if (passed >= 2 * rule->tr_depth * rule->tr_nsecs) {
+		rule->tr_agg_ntoken = rule->tr_depth;
+		rule->tr_agg_check_time = now;
+		return rule->tr_agg_ntoken;
+	}
+
+	ntoken = passed * rule->tr_rpc_rate;
+	do_div(ntoken, NSEC_PER_SEC);
+	if (ntoken == 0)
+		return rule->tr_agg_ntoken;
+
+	/* Keep the remainder of the elapsed time for the next token */
+	rule->tr_agg_check_time += ntoken * rule->tr_nsecs;
+	rule->tr_agg_ntoken = min_t(__s64, rule->tr_agg_ntoken + ntoken,
+				    rule->tr_depth);
+	return rule->tr_agg_ntoken;
+}
+
+/**
+ * Charges a request dispatched with a token of its own class to the
+ * aggregate buckets of the parent rules above the class. The own rate of a
+ * class is guaranteed, so a parent bucket may go into debt, up to its
+ * depth, and nothing is borrowed below it until the debt is paid back.
+ */
+static void nrs_tbf_rule_charge(struct nrs_tbf_rule *rule, __u64 now)
+{
+	for (; rule != NULL; rule = rule->tr_parent) {
+		if (nrs_tbf_rule_is_parent(rule) &&
+		    nrs_tbf_rule_refill(rule, now) > -(__s64)rule->tr_depth)
+			rule->tr_agg_ntoken--;
+	}
+}
+
+/**
+ * Tries to dispatch a request of a class which has run out of tokens with
+ * a token borrowed from the parent rules above it. Borrowing needs a spare
+ * token at every level, so that the rate of a parent rule caps the borrowing
+ * of its whole subtree. Since classes are served by deadline, the spare
+ * tokens of idle siblings are shared in proportion to the class rates.
+ *
+ * \param[in]     rule	    the rule of the class
+ * \param[in]     now	    the current time
+ * \param[in,out] deadline the time the class gets its next token, lowered
+ *			    to when borrowing becomes possible on failure
+ *
+ * \retval true  a token was borrowed
+ * \retval false no token can be borrowed now
+ */
+static bool nrs_tbf_rule_borrow(struct nrs_tbf_rule *rule, __u64 now,
+				__u64 *deadline)
+{
+	struct nrs_tbf_rule *tmp;
+	bool has_parent = false;
+	__u64 next = 0;
+
+	for (tmp = rule; tmp != NULL; tmp = tmp->tr_parent) {
+		if (!nrs_tbf_rule_is_parent(tmp))
+			continue;
+
+		has_parent = true;
+		if (nrs_tbf_rule_refill(tmp, now) <= 0)
+			next = max(next, tmp->tr_agg_check_time +
+					 tmp->tr_nsecs);
+	}
+
+	if (!has_parent)
+		return false;
+
+	if (next != 0) {
+		if (next < *deadline)
+			*deadline = next;
+		return false;
+	}
+
+	for (tmp = rule; tmp != NULL; tmp = tmp->tr_parent) {
+		if (nrs_tbf_rule_is_parent(tmp))
+			tmp->tr_agg_ntoken--;
+	}
+	rule->tr_nborrowed++;
+
+	return true;
+}
+
 static void
 nrs_tbf_cli_rule_put(struct nrs_tbf_client *cli)
 {
@@ -168,7 +319,16 @@ nrs_tbf_cli_reset(struct nrs_tbf_head *head,
 static int
 nrs_tbf_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	return rule->tr_head->th_ops->o_rule_dump(rule, m);
+	int rc;
+
+	rc = rule->tr_head->th_ops->o_rule_dump(rule, m);
+	if (rc == 0 && (rule->tr_parent != NULL ||
+			nrs_tbf_rule_is_parent(rule)))
+		seq_printf(m, "  parent %s, share %u, borrowed %llu\n",
+			   rule->tr_parent ? rule->tr_parent->tr_name : "none",
+			   rule->tr_share, rule->tr_nborrowed);
+
+	return rc;
 }
 
 static int
@@ -286,7 +446,9 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 	struct nrs_tbf_rule	*rule;
 	struct nrs_tbf_rule	*tmp_rule;
 	struct nrs_tbf_rule	*next_rule;
+	struct nrs_tbf_rule	*parent = NULL;
 	char			*next_name = start->u.tc_start.ts_next_name;
+	char			*parent_name = start->u.tc_start.ts_parent_name;
 	int			 rc;
 
 	rule = nrs_tbf_rule_find(head, start->tc_name);
@@ -305,10 +467,15 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 	rule->tr_nsecs = NSEC_PER_SEC;
 	do_div(rule->tr_nsecs, rule->tr_rpc_rate);
 	rule->tr_depth = tbf_depth;
+	rule->tr_share = start->u.tc_start.ts_share;
+	rule->tr_agg_ntoken = rule->tr_depth;
+	rule->tr_agg_check_time = ktime_to_ns(ktime_get());
 	atomic_set(&rule->tr_ref, 1);
 	INIT_LIST_HEAD(&rule->tr_cli_list);
 	INIT_LIST_HEAD(&rule->tr_nids);
 	INIT_LIST_HEAD(&rule->tr_linkage);
+	INIT_LIST_HEAD(&rule->tr_sibling);
+	INIT_LIST_HEAD(&rule->tr_children);
 	spin_lock_init(&rule->tr_rule_lock);
 	rule->tr_head = head;
 
@@ -328,10 +495,30 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 		return -EEXIST;
 	}
 
+	if (parent_name) {
+		/* The reference is kept until the rule is freed */
+		parent = nrs_tbf_rule_find_nolock(head, parent_name);
+		if (!parent) {
+			spin_unlock(&head->th_rule_lock);
+			nrs_tbf_rule_put(rule);
+			return -ENOENT;
+		}
+
+		if (parent->tr_level + 1 >= NRS_TBF_MAX_LEVEL ||
+		    (parent->tr_flags & NTRS_REALTIME)) {
+			spin_unlock(&head->th_rule_lock);
+			nrs_tbf_rule_put(parent);
+			nrs_tbf_rule_put(rule);
+			return -EINVAL;
+		}
+	}
+
 	if (next_name) {
 		next_rule = nrs_tbf_rule_find_nolock(head, next_name);
 		if (!next_rule) {
 			spin_unlock(&head->th_rule_lock);
+			if (parent)
+				nrs_tbf_rule_put(parent);
 			nrs_tbf_rule_put(rule);
 			return -ENOENT;
 		}
@@ -342,6 +529,18 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 		/* Add on the top of the rule list */
 		list_add(&rule->tr_linkage, &head->th_list);
 	}
+
+	if (parent) {
+		rule->tr_parent = parent;
+		rule->tr_level = parent->tr_level + 1;
+		if (!nrs_tbf_rule_is_parent(parent)) {
+			/* Start the aggregate bucket of the parent full */
+			parent->tr_agg_ntoken = parent->tr_depth;
+			parent->tr_agg_check_time = ktime_to_ns(ktime_get());
+		}
+		list_add_tail(&rule->tr_sibling, &parent->tr_children);
+		nrs_tbf_rule_update_shares(parent);
+	}
 	spin_unlock(&head->th_rule_lock);
 	atomic_inc(&head->th_rule_sequence);
 	if (start->u.tc_start.ts_rule_flags & NTRS_DEFAULT) {
@@ -350,8 +549,9 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 		head->th_rule = rule;
 	}
 
-	CDEBUG(D_RPCTRACE, "TBF starts rule@%p rate %llu gen %llu\n",
-	       rule, rule->tr_rpc_rate, rule->tr_generation);
+	CDEBUG(D_RPCTRACE, "TBF starts rule@%p rate %llu gen %llu parent %s\n",
+	       rule, rule->tr_rpc_rate, rule->tr_generation,
+	       parent ? parent->tr_name : "none");
 
 	return 0;
 }
@@ -406,9 +606,11 @@ static int
 nrs_tbf_rule_change_rate(struct ptlrpc_nrs_policy *policy,
 			 struct nrs_tbf_head *head,
 			 char *name,
-			 __u64 rate)
+			 __u64 rate,
+			 __u32 share)
 {
 	struct nrs_tbf_rule *rule;
+	int rc = 0;
 
 	assert_spin_locked(&policy->pol_nrs->nrs_lock);
 
@@ -416,13 +618,26 @@ nrs_tbf_rule_change_rate(struct ptlrpc_nrs_policy *policy,
 	if (rule == NULL)
 		return -ENOENT;
 
-	rule->tr_rpc_rate = rate;
-	rule->tr_nsecs = NSEC_PER_SEC;
-	do_div(rule->tr_nsecs, rule->tr_rpc_rate);
-	rule->tr_generation++;
+	spin_lock(&head->th_rule_lock);
+	if (share != 0) {
+		if (rule->tr_parent == NULL)
+			GOTO(out, rc = -EINVAL);
+
+		rule->tr_share = share;
+		nrs_tbf_rule_update_shares(rule->tr_parent);
+	} else {
+		/* An explicit rate replaces the share of the rule */
+		rule->tr_share = 0;
+		nrs_tbf_rule_set_rate(rule, rate);
+		if (rule->tr_parent != NULL)
+			nrs_tbf_rule_update_shares(rule->tr_parent);
+		nrs_tbf_rule_update_shares(rule);
+	}
+out:
+	spin_unlock(&head->th_rule_lock);
 	nrs_tbf_rule_put(rule);
 
-	return 0;
+	return rc;
 }
 
 static int
@@ -431,12 +646,13 @@ nrs_tbf_rule_change(struct ptlrpc_nrs_policy *policy,
 		    struct nrs_tbf_cmd *change)
 {
 	__u64	 rate = change->u.tc_change.tc_rpc_rate;
+	__u32	 share = change->u.tc_change.tc_share;
 	char	*next_name = change->u.tc_change.tc_next_name;
 	int	 rc;
 
-	if (rate != 0) {
+	if (rate != 0 || share != 0) {
 		rc = nrs_tbf_rule_change_rate(policy, head, change->tc_name,
-					      rate);
+					      rate, share);
 		if (rc)
 			return rc;
 	}
@@ -467,6 +683,20 @@ nrs_tbf_rule_stop(struct ptlrpc_nrs_policy *policy,
 	if (rule == NULL)
 		return -ENOENT;
 
+	spin_lock(&head->th_rule_lock);
+	/* Child rules need to be stopped first */
+	if (nrs_tbf_rule_is_parent(rule)) {
+		spin_unlock(&head->th_rule_lock);
+		nrs_tbf_rule_put(rule);
+		return -EBUSY;
+	}
+
+	if (rule->tr_parent != NULL) {
+		list_del_init(&rule->tr_sibling);
+		nrs_tbf_rule_update_shares(rule->tr_parent);
+	}
+	spin_unlock(&head->th_rule_lock);
+
 	list_del_init(&rule->tr_linkage);
 	rule->tr_flags |= NTRS_STOPPING;
 	nrs_tbf_rule_put(rule);
@@ -1592,8 +1822,8 @@ static int ldlm_tbf_id_cli_set(struct ptlrpc_request *req,
 	return 0;
 }
 
-static int nrs_tbf_id_cli_set(struct ptlrpc_request *req, struct tbf_id *id,
-			      enum nrs_tbf_flag ti_type)
+int nrs_tbf_id_cli_set(struct ptlrpc_request *req, struct tbf_id *id,
+		       enum nrs_tbf_flag ti_type)
 {
 	u32 opc = lustre_msg_get_opc(req->rq_reqmsg);
 	struct req_format *fmt = req_fmt(opc);
@@ -2840,6 +3070,12 @@ static void nrs_tbf_stop(struct ptlrpc_nrs_policy *policy)
 	hrtimer_cancel(&head->th_timer);
 	/* Should cleanup hash first before free rules */
 	cfs_hash_putref(head->th_cli_hash);
+	/* Unlink the hierarchy, a parent rule is freed once the last of
+	 * its children released the reference they hold on it */
+	spin_lock(&head->th_rule_lock);
+	list_for_each_entry(rule, &head->th_list, tr_linkage)
+		list_del_init(&rule->tr_sibling);
+	spin_unlock(&head->th_rule_lock);
 	list_for_each_entry_safe(rule, n, &head->th_list, tr_linkage) {
 		list_del_init(&rule->tr_linkage);
 		nrs_tbf_rule_put(rule);
@@ -3076,6 +3312,7 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 		__u64 ntoken;
 		__u64 deadline;
 		__u64 old_resid = 0;
+		bool borrowed = false;
 
 		deadline = cli->tc_check_time +
 			  cli->tc_nsecs;
@@ -3096,7 +3333,10 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 		} else if (ntoken > cli->tc_depth)
 			ntoken = cli->tc_depth;
 
-		if (ntoken > 0) {
+		if (ntoken == 0 && !(rule->tr_flags & NTRS_REALTIME))
+			borrowed = nrs_tbf_rule_borrow(rule, now, &deadline);
+
+		if (ntoken > 0 || borrowed) {
 			struct ptlrpc_request *req;
 			nrq = list_entry(cli->tc_list.next,
 					     struct ptlrpc_nrs_request,
@@ -3104,7 +3344,10 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 			req = container_of(nrq,
 					   struct ptlrpc_request,
 					   rq_nrq);
-			ntoken--;
+			if (!borrowed) {
+				ntoken--;
+				nrs_tbf_rule_charge(rule, now);
+			}
 			cli->tc_ntoken = ntoken;
 			cli->tc_check_time = now;
 			list_del_init(&nrq->nr_u.tbf.tr_list);
@@ -3120,9 +3363,10 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 			}
 			CDEBUG(D_RPCTRACE,
 			       "TBF dequeues: class@%p rate %llu gen %llu "
-			       "token %llu, rule@%p rate %llu gen %llu\n",
+			       "token %llu%s, rule@%p rate %llu gen %llu\n",
 			       cli, cli->tc_rpc_rate,
 			       cli->tc_rule_generation, cli->tc_ntoken,
+			       borrowed ? " (borrowed)" : "",
 			       cli->tc_rule, cli->tc_rule->tr_rpc_rate,
 			       cli->tc_rule->tr_generation);
 		} else {
@@ -3446,6 +3690,28 @@ nrs_tbf_parse_value_pair(struct nrs_tbf_cmd *cmd, char *buffer)
 
 		if (realtime > 0)
 			cmd->u.tc_start.ts_rule_flags |= NTRS_REALTIME;
+	} else if (strcmp(key, "parent") == 0) {
+		if (!name_is_valid(val) ||
+		    cmd->tc_cmd != NRS_CTL_TBF_START_RULE)
+			return -EINVAL;
+
+		cmd->u.tc_start.ts_parent_name = val;
+	} else if (strcmp(key, "share") == 0) {
+		unsigned int share;
+
+		rc = kstrtouint(val, 10, &share);
+		if (rc)
+			return rc;
+
+		if (share == 0 || share >= LPROCFS_NRS_RATE_MAX)
+			return -EINVAL;
+
+		if (cmd->tc_cmd == NRS_CTL_TBF_START_RULE)
+			cmd->u.tc_start.ts_share = share;
+		else if (cmd->tc_cmd == NRS_CTL_TBF_CHANGE_RULE)
+			cmd->u.tc_change.tc_share = share;
+		else
+			return -EINVAL;
 	} else {
 		return -EINVAL;
 	}
@@ -3469,13 +3735,23 @@ nrs_tbf_parse_value_pairs(struct nrs_tbf_cmd *cmd, char *buffer)
 
 	switch (cmd->tc_cmd) {
 	case NRS_CTL_TBF_START_RULE:
+		/* A share is a part of the parent rate, not a rate of its own */
+		if (cmd->u.tc_start.ts_share != 0 &&
+		    (cmd->u.tc_start.ts_parent_name == NULL ||
+		     cmd->u.tc_start.ts_rpc_rate != 0 ||
+		     (cmd->u.tc_start.ts_rule_flags & NTRS_REALTIME)))
+			return -EINVAL;
 		if (cmd->u.tc_start.ts_rpc_rate == 0)
 			cmd->u.tc_start.ts_rpc_rate = tbf_rate;
 		break;
 	case NRS_CTL_TBF_CHANGE_RULE:
 		if (cmd->u.tc_change.tc_rpc_rate == 0 &&
+		    cmd->u.tc_change.tc_share == 0 &&
 		    cmd->u.tc_change.tc_next_name == NULL)
 			return -EINVAL;
+		if (cmd->u.tc_change.tc_rpc_rate != 0 &&
+		    cmd->u.tc_change.tc_share != 0)
+			return -EINVAL;
 		break;
 	case NRS_CTL_TBF_STOP_RULE:
 		break;
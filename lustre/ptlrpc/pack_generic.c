@@ -326,6 +326,102 @@ void lustre_put_emerg_rs(struct ptlrpc_reply_state *rs)
 	wake_up(&svcpt->scp_rep_waitq);
 }
 
+static int lustre_rs_cache_class(int rs_size)
+{
+	int idx;
+
+	for (idx = 0; idx < PTLRPC_RS_CACHE_CLASSES; idx++) {
+		if (rs_size <= PTLRPC_RS_CACHE_SIZE(idx))
+			return idx;
+	}
+
+	return -1;
+}
+
+/**
+ * Get a zeroed reply state of at least \a rs_size bytes for \a req from the
+ * reply state cache of its service partition, or allocate one of the size
+ * class of \a rs_size so that it can be cached when it is freed.
+ *
+ * \retval NULL if \a rs_size is too large to be cached, the cache is
+ *	   disabled or allocation failed; the caller allocates it then.
+ */
+struct ptlrpc_reply_state *
+lustre_get_cached_rs(struct ptlrpc_request *req, int rs_size)
+{
+	struct ptlrpc_service_part *svcpt;
+	struct ptlrpc_service *svc;
+	struct ptlrpc_reply_state *rs = NULL;
+	int idx;
+
+	if (req->rq_rqbd == NULL)
+		return NULL;
+
+	svcpt = req->rq_rqbd->rqbd_svcpt;
+	svc = svcpt->scp_service;
+	idx = lustre_rs_cache_class(rs_size);
+	if (idx < 0 || svc->srv_rs_cache_max == 0)
+		return NULL;
+
+	spin_lock(&svcpt->scp_rep_lock);
+	if (!list_empty(&svcpt->scp_rs_cache[idx])) {
+		rs = list_entry(svcpt->scp_rs_cache[idx].next,
+				struct ptlrpc_reply_state, rs_list);
+		list_del(&rs->rs_list);
+		svcpt->scp_rs_cached[idx]--;
+	}
+	spin_unlock(&svcpt->scp_rep_lock);
+
+	if (rs != NULL) {
+		/* only the part used by this reply needs to be cleared */
+		memset(rs, 0, rs_size);
+		if (likely(svc->srv_stats != NULL))
+			lprocfs_counter_incr(svc->srv_stats,
+					     PTLRPC_RSCACHE_HIT_CNTR);
+	} else {
+		OBD_CPT_ALLOC_LARGE(rs, svc->srv_cptable, svcpt->scp_cpt,
+				    PTLRPC_RS_CACHE_SIZE(idx));
+		if (rs == NULL)
+			return NULL;
+		if (likely(svc->srv_stats != NULL))
+			lprocfs_counter_incr(svc->srv_stats,
+					     PTLRPC_RSCACHE_MISS_CNTR);
+	}
+
+	rs->rs_size = PTLRPC_RS_CACHE_SIZE(idx);
+	rs->rs_svcpt = svcpt;
+	rs->rs_cached = 1;
+
+	return rs;
+}
+
+/**
+ * Return reply state \a rs obtained by lustre_get_cached_rs() to the cache
+ * of its service partition.
+ *
+ * \retval false if the cache is full, the caller frees \a rs then
+ */
+bool lustre_put_cached_rs(struct ptlrpc_reply_state *rs)
+{
+	struct ptlrpc_service_part *svcpt = rs->rs_svcpt;
+	int idx = lustre_rs_cache_class(rs->rs_size);
+	bool cached = false;
+
+	LASSERT(rs->rs_cached);
+	LASSERT(idx >= 0 && rs->rs_size == PTLRPC_RS_CACHE_SIZE(idx));
+
+	spin_lock(&svcpt->scp_rep_lock);
+	if (svcpt->scp_rs_cached[idx] <
+	    svcpt->scp_service->srv_rs_cache_max) {
+		list_add(&rs->rs_list, &svcpt->scp_rs_cache[idx]);
+		svcpt->scp_rs_cached[idx]++;
+		cached = true;
+	}
+	spin_unlock(&svcpt->scp_rep_lock);
+
+	return cached;
+}
+
 int lustre_pack_reply_v2(struct ptlrpc_request *req, int count,
                          __u32 *lens, char **bufs, int flags)
 {
@@ -1905,6 +2001,14 @@ void lustre_swab_mdt_ioepoch(struct mdt_ioepoch *b)
 	CLASSERT(offsetof(typeof(*b), mio_padding) != 0);
 }
 
+void lustre_swab_mdt_batch_header(struct mdt_batch_header *b)
+{
+	__swab32s(&b->mbh_count);
+	__swab32s(&b->mbh_flags);
+	__swab32s(&b->mbh_reply_size);
+	CLASSERT(offsetof(typeof(*b), mbh_padding) != 0);
+}
+
 void lustre_swab_mgs_target_info(struct mgs_target_info *mti)
 {
 	int i;
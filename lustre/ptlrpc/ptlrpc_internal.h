@@ -52,6 +52,11 @@ extern struct ptlrpc_nrs_pol_conf nrs_conf_orr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_trr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_tbf;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_delay;
+extern struct ptlrpc_nrs_pol_conf nrs_conf_slo;
+
+/* nrs_tbf.c */
+int nrs_tbf_id_cli_set(struct ptlrpc_request *req, struct tbf_id *id,
+		       enum nrs_tbf_flag ti_type);
 #endif /* HAVE_SERVER_SUPPORT */
 
 /**
@@ -268,6 +273,9 @@ void ptlrpc_fill_bulk_md(struct lnet_md *md, struct ptlrpc_bulk_desc *desc,
 struct ptlrpc_reply_state *
 lustre_get_emerg_rs(struct ptlrpc_service_part *svcpt);
 void lustre_put_emerg_rs(struct ptlrpc_reply_state *rs);
+struct ptlrpc_reply_state *
+lustre_get_cached_rs(struct ptlrpc_request *req, int rs_size);
+bool lustre_put_cached_rs(struct ptlrpc_reply_state *rs);
 
 /* pinger.c */
 int ptlrpc_start_pinger(void);
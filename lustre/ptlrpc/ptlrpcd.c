@@ -137,6 +137,16 @@ module_param(ptlrpcd_cpts, charp, 0644);
 MODULE_PARM_DESC(ptlrpcd_cpts,
 		 "CPU partitions ptlrpcd threads should run in");
 
+/*
+ * ptlrpcd_bulk_affinity: Queue requests with a bulk on a ptlrpcd thread
+ * of the CPT holding the bulk pages instead of the CPT of the caller, so
+ * they are checksummed and sent from the NUMA node of the data.
+ */
+static int ptlrpcd_bulk_affinity;
+module_param(ptlrpcd_bulk_affinity, int, 0644);
+MODULE_PARM_DESC(ptlrpcd_bulk_affinity,
+		 "Send bulk RPCs from the CPT of the bulk pages");
+
 /* ptlrpcds_cpt_idx maps cpt numbers to an index in the ptlrpcds array. */
 static int		*ptlrpcds_cpt_idx;
 
@@ -165,17 +175,33 @@ void ptlrpcd_wake(struct ptlrpc_request *req)
 }
 EXPORT_SYMBOL(ptlrpcd_wake);
 
+/* CPT of the first bulk page of \a req, or CFS_CPT_ANY */
+static int ptlrpcd_bulk_cpt(struct ptlrpc_request *req)
+{
+	struct ptlrpc_bulk_desc *desc = req->rq_bulk;
+
+	if (desc == NULL || desc->bd_iov_count == 0 ||
+	    !ptlrpc_is_bulk_desc_kiov(desc->bd_type))
+		return CFS_CPT_ANY;
+
+	return cfs_cpt_of_node(cfs_cpt_table,
+			       page_to_nid(BD_GET_KIOV(desc, 0).kiov_page));
+}
+
 static struct ptlrpcd_ctl *
 ptlrpcd_select_pc(struct ptlrpc_request *req)
 {
 	struct ptlrpcd	*pd;
-	int		cpt;
+	int		cpt = CFS_CPT_ANY;
 	int		idx;
 
 	if (req != NULL && req->rq_send_state != LUSTRE_IMP_FULL)
 		return &ptlrpcd_rcv;
 
-	cpt = cfs_cpt_current(cfs_cpt_table, 1);
+	if (req != NULL && ptlrpcd_bulk_affinity)
+		cpt = ptlrpcd_bulk_cpt(req);
+	if (cpt == CFS_CPT_ANY)
+		cpt = cfs_cpt_current(cfs_cpt_table, 1);
 	if (ptlrpcds_cpt_idx == NULL)
 		idx = cpt;
 	else
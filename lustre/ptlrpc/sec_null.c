@@ -318,6 +318,10 @@ int null_alloc_rs(struct ptlrpc_request *req, int msgsize)
 		/* pre-allocated */
 		LASSERT(rs->rs_size >= rs_size);
 	} else {
+		rs = lustre_get_cached_rs(req, rs_size);
+	}
+
+	if (rs == NULL) {
 		OBD_ALLOC_LARGE(rs, rs_size);
 		if (rs == NULL)
 			return -ENOMEM;
@@ -342,6 +346,9 @@ void null_free_rs(struct ptlrpc_reply_state *rs)
 	LASSERT_ATOMIC_GT(&rs->rs_svc_ctx->sc_refcount, 1);
 	atomic_dec(&rs->rs_svc_ctx->sc_refcount);
 
+	if (rs->rs_cached && lustre_put_cached_rs(rs))
+		return;
+
 	if (!rs->rs_prealloc)
 		OBD_FREE_LARGE(rs, rs->rs_size);
 }
@@ -831,6 +831,10 @@ int plain_alloc_rs(struct ptlrpc_request *req, int msgsize)
 		/* pre-allocated */
 		LASSERT(rs->rs_size >= rs_size);
 	} else {
+		rs = lustre_get_cached_rs(req, rs_size);
+	}
+
+	if (rs == NULL) {
 		OBD_ALLOC_LARGE(rs, rs_size);
 		if (rs == NULL)
 			RETURN(-ENOMEM);
@@ -858,6 +862,9 @@ void plain_free_rs(struct ptlrpc_reply_state *rs)
 	LASSERT(atomic_read(&rs->rs_svc_ctx->sc_refcount) > 1);
 	atomic_dec(&rs->rs_svc_ctx->sc_refcount);
 
+	if (rs->rs_cached && lustre_put_cached_rs(rs))
+		RETURN_EXIT;
+
 	if (!rs->rs_prealloc)
 		OBD_FREE_LARGE(rs, rs->rs_size);
 	EXIT;
@@ -198,6 +198,214 @@ void ptlrpc_save_lock(struct ptlrpc_request *req, struct lustre_handle *lock,
 }
 EXPORT_SYMBOL(ptlrpc_save_lock);
 
+/**
+ * Set up a server request for the message \a msg of \a len bytes packed
+ * inside \a req (e.g. a MDS_REINT inside MDS_BATCH_REINT), which the client
+ * sent with xid \a xid. The sub-request shares the export, the security
+ * context and the service thread of \a req and gets its own reply state, so
+ * it can be handled by the regular handlers, and its transaction is recorded
+ * in last_rcvd under its own xid.
+ *
+ * Sub-requests are never swabbed, so \a req must not need swabbing either.
+ */
+struct ptlrpc_request *ptlrpc_server_subreq_alloc(struct ptlrpc_request *req,
+						  struct lustre_msg *msg,
+						  int len, __u64 xid)
+{
+	struct ptlrpc_request *sub;
+	int rc;
+
+	ENTRY;
+	LASSERT(!ptlrpc_req_need_swab(req));
+
+	sub = ptlrpc_request_cache_alloc(GFP_NOFS);
+	if (sub == NULL)
+		RETURN(ERR_PTR(-ENOMEM));
+
+	*sub = *req;
+	spin_lock_init(&sub->rq_lock);
+	atomic_set(&sub->rq_refcount, 1);
+	sub->rq_reply_state = NULL;
+	sub->rq_repmsg = NULL;
+	sub->rq_replen = 0;
+	sub->rq_transno = 0;
+	sub->rq_status = 0;
+	sub->rq_req_swab_mask = 0;
+	sub->rq_rep_swab_mask = 0;
+	sub->rq_pack_bulk = 0;
+	sub->rq_pack_udesc = 0;
+	sub->rq_packed_final = 0;
+	sub->rq_no_reply = 0;
+	sub->rq_pill_init = 0;
+	sub->rq_reqmsg = msg;
+	sub->rq_reqlen = len;
+	sub->rq_xid = xid;
+	sptlrpc_svc_ctx_addref(sub);
+
+	rc = ptlrpc_unpack_req_msg(sub, len);
+	if (rc == 0 && ptlrpc_req_need_swab(sub))
+		rc = -EPROTO;
+	if (rc == 0)
+		rc = lustre_unpack_req_ptlrpc_body(sub, MSG_PTLRPC_BODY_OFF);
+	if (rc) {
+		DEBUG_REQ(D_ERROR, req, "unpack sub-request failed: rc = %d",
+			  rc);
+		sptlrpc_svc_ctx_decref(sub);
+		ptlrpc_request_cache_free(sub);
+		RETURN(ERR_PTR(rc));
+	}
+
+	req_capsule_init(&sub->rq_pill, sub, RCL_SERVER);
+	RETURN(sub);
+}
+EXPORT_SYMBOL(ptlrpc_server_subreq_alloc);
+
+/**
+ * Pack the reply of \a sub into \a buf of \a buflen bytes for the client.
+ * Only the ptlrpc_body is returned, it carries the status, the transno and
+ * the pre-op versions, which is all the client needs to complete and replay
+ * the sub-request.
+ *
+ * \retval packed size, 8-byte aligned, or negative errno
+ */
+int ptlrpc_server_subreq_reply(struct ptlrpc_request *sub, void *buf,
+			       int buflen)
+{
+	struct lustre_msg *msg = buf;
+	__u32 size = sizeof(struct ptlrpc_body_v2);
+	int len;
+	int rc;
+
+	len = lustre_msg_size_v2(1, &size);
+	if (len > buflen)
+		return -EOVERFLOW;
+
+	if (sub->rq_repmsg == NULL) {
+		rc = lustre_pack_reply(sub, 1, NULL, NULL);
+		if (rc)
+			return rc;
+	}
+
+	lustre_init_msg_v2(msg, 1, &size, NULL);
+	memcpy(lustre_msg_buf(msg, MSG_PTLRPC_BODY_OFF, size),
+	       lustre_msg_buf(sub->rq_repmsg, MSG_PTLRPC_BODY_OFF, size), size);
+	lustre_msg_set_type(msg, PTL_RPC_MSG_REPLY);
+	lustre_msg_set_opc(msg, lustre_msg_get_opc(sub->rq_reqmsg));
+	lustre_msg_set_status(msg, ptlrpc_status_hton(sub->rq_status));
+
+	return cfs_size_round(len);
+}
+EXPORT_SYMBOL(ptlrpc_server_subreq_reply);
+
+/*
+ * Whether \a rs already holds a lock in \a mode on the resource of \a lock
+ * covering the same inodebits, which then keeps conflicting requests away
+ * for as long as \a lock would.
+ */
+static bool ptlrpc_rs_has_lock(struct ptlrpc_reply_state *rs,
+			       struct lustre_handle *lockh, int mode)
+{
+	struct ldlm_lock *lock;
+	bool found = false;
+	int i;
+
+	lock = ldlm_handle2lock(lockh);
+	if (lock == NULL)
+		return false;
+
+	for (i = 0; i < rs->rs_nlocks && !found; i++) {
+		struct ldlm_lock *held;
+
+		if (rs->rs_modes[i] != mode)
+			continue;
+		held = ldlm_handle2lock(&rs->rs_locks[i]);
+		if (held == NULL)
+			continue;
+		found = held->l_resource == lock->l_resource &&
+			(held->l_policy_data.l_inodebits.bits &
+			 lock->l_policy_data.l_inodebits.bits) ==
+			lock->l_policy_data.l_inodebits.bits;
+		LDLM_LOCK_PUT(held);
+	}
+	LDLM_LOCK_PUT(lock);
+
+	return found;
+}
+
+/**
+ * Check whether a lock on \a res_id in \a mode covering \a bits would conflict
+ * with one of the locks saved in \a rs. The batch handlers use this to stop
+ * before a sub-request blocks on a lock kept by an earlier one, which is only
+ * released once the batch reply is sent.
+ */
+bool ptlrpc_rs_lock_conflict(struct ptlrpc_reply_state *rs,
+			     const struct ldlm_res_id *res_id,
+			     enum ldlm_mode mode, __u64 bits)
+{
+	bool conflict = false;
+	int i;
+
+	for (i = 0; i < rs->rs_nlocks && !conflict; i++) {
+		struct ldlm_lock *held;
+
+		if (lockmode_compat(rs->rs_modes[i], mode))
+			continue;
+		held = ldlm_handle2lock(&rs->rs_locks[i]);
+		if (held == NULL)
+			continue;
+		conflict = memcmp(&held->l_resource->lr_name, res_id,
+				  sizeof(*res_id)) == 0 &&
+			   (held->l_policy_data.l_inodebits.bits & bits) != 0;
+		LDLM_LOCK_PUT(held);
+	}
+
+	return conflict;
+}
+EXPORT_SYMBOL(ptlrpc_rs_lock_conflict);
+
+/**
+ * Release \a sub set up by ptlrpc_server_subreq_alloc(). The locks saved in
+ * its reply state are handed over to the reply of \a req, so they are kept
+ * until the batch reply is acked or committed, unless the batch reply already
+ * holds an equivalent one. If there is no room for them they are released
+ * right away, the caller stops batching before that.
+ */
+void ptlrpc_server_subreq_free(struct ptlrpc_request *req,
+			       struct ptlrpc_request *sub)
+{
+	struct ptlrpc_reply_state *rs = sub->rq_reply_state;
+	int i;
+
+	ENTRY;
+	if (rs != NULL && rs->rs_difficult) {
+		for (i = 0; i < rs->rs_nlocks; i++) {
+			if (req->rq_reply_state == NULL ||
+			    req->rq_reply_state->rs_nlocks >= RS_MAX_LOCKS ||
+			    ptlrpc_rs_has_lock(req->rq_reply_state,
+					       &rs->rs_locks[i],
+					       rs->rs_modes[i])) {
+				ldlm_lock_decref(&rs->rs_locks[i],
+						 rs->rs_modes[i]);
+				continue;
+			}
+			ptlrpc_save_lock(req, &rs->rs_locks[i],
+					 rs->rs_modes[i], rs->rs_no_ack,
+					 rs->rs_convert_lock);
+		}
+		rs->rs_nlocks = 0;
+		rs->rs_difficult = 0;
+		rs->rs_no_ack = 0;
+	}
+	if (rs != NULL)
+		ptlrpc_req_drop_rs(sub);
+
+	req_capsule_fini(&sub->rq_pill);
+	sptlrpc_svc_ctx_decref(sub);
+	ptlrpc_request_cache_free(sub);
+	EXIT;
+}
+EXPORT_SYMBOL(ptlrpc_server_subreq_free);
+
 
 struct ptlrpc_hr_partition;
 
@@ -633,6 +841,8 @@ static int ptlrpc_service_part_init(struct ptlrpc_service *svc,
 	spin_lock_init(&svcpt->scp_rep_lock);
 	INIT_LIST_HEAD(&svcpt->scp_rep_active);
 	INIT_LIST_HEAD(&svcpt->scp_rep_idle);
+	for (index = 0; index < PTLRPC_RS_CACHE_CLASSES; index++)
+		INIT_LIST_HEAD(&svcpt->scp_rs_cache[index]);
 	init_waitqueue_head(&svcpt->scp_rep_waitq);
 	atomic_set(&svcpt->scp_nreps_difficult, 0);
 
@@ -811,6 +1021,8 @@ struct ptlrpc_service *ptlrpc_register_service(struct ptlrpc_service_conf *conf,
 	service->srv_thread_name	= conf->psc_thr.tc_thr_name;
 	service->srv_ctx_tags		= conf->psc_thr.tc_ctx_tags;
 	service->srv_hpreq_ratio	= PTLRPC_SVC_HP_RATIO;
+	service->srv_steal_threshold	= PTLRPC_SVC_STEAL_THRESHOLD;
+	service->srv_rs_cache_max	= PTLRPC_RS_CACHE_MAX;
 	service->srv_ops		= conf->psc_ops;
 
 	for (i = 0; i < ncpts; i++) {
@@ -1825,6 +2037,17 @@ static int ptlrpc_server_request_add(struct ptlrpc_service_part *svcpt,
 	RETURN(0);
 }
 
+/*
+ * # of threads of \a svcpt busy with a request: its active requests, less
+ * those served by other partitions, plus those it stole from them
+ */
+static inline int
+ptlrpc_server_nthrs_busy(struct ptlrpc_service_part *svcpt)
+{
+	return svcpt->scp_nreqs_active - svcpt->scp_nreqs_lent +
+	       svcpt->scp_nreqs_stealing;
+}
+
 /**
  * Allow to handle high priority request
  * User can call it w/o any lock but need to hold
@@ -1852,7 +2075,7 @@ static bool ptlrpc_server_allow_high(struct ptlrpc_service_part *svcpt,
 			running += 1;
 	}
 
-	if (svcpt->scp_nreqs_active >= running - 1)
+	if (ptlrpc_server_nthrs_busy(svcpt) >= running - 1)
 		return false;
 
 	if (svcpt->scp_nhreqs_active == 0)
@@ -1897,10 +2120,10 @@ static bool ptlrpc_server_allow_normal(struct ptlrpc_service_part *svcpt,
 	if (ptlrpc_nrs_req_throttling_nolock(svcpt, false))
 		return false;
 
-	if (svcpt->scp_nreqs_active < running - 2)
+	if (ptlrpc_server_nthrs_busy(svcpt) < running - 2)
 		return true;
 
-	if (svcpt->scp_nreqs_active >= running - 1)
+	if (ptlrpc_server_nthrs_busy(svcpt) >= running - 1)
 		return false;
 
 	return svcpt->scp_nhreqs_active > 0 || !nrs_svcpt_has_hp(svcpt);
@@ -1975,6 +2198,201 @@ got_request:
 	RETURN(req);
 }
 
+/*
+ * Work stealing between the partitions of a service.
+ *
+ * Requests are queued on the partition of the CPT that received them, so
+ * a skewed NID hash or NRS policy can leave one partition with a long
+ * queue while the threads of the others are idle. An idle thread may then
+ * serve a normal priority request of another partition, provided that
+ * partition has no idle thread itself and at least srv_steal_threshold
+ * requests queued. The threshold is scaled by the NUMA distance between
+ * the two CPTs, so remote nodes are only helped when clearly overloaded.
+ * HP requests are never stolen.
+ */
+
+/* queue depth of \a victim needed before \a svcpt steals from it */
+static unsigned long
+ptlrpc_server_steal_depth(struct ptlrpc_service_part *svcpt,
+			  struct ptlrpc_service_part *victim)
+{
+	struct ptlrpc_service *svc = svcpt->scp_service;
+	unsigned int local;
+	unsigned int dist;
+
+	local = cfs_cpt_distance(svc->srv_cptable, svcpt->scp_cpt,
+				 svcpt->scp_cpt);
+	dist = cfs_cpt_distance(svc->srv_cptable, svcpt->scp_cpt,
+				victim->scp_cpt);
+	if (local == 0 || dist <= local)
+		return svc->srv_steal_threshold;
+
+	return (unsigned long)svc->srv_steal_threshold * dist / local;
+}
+
+/* whether \a svcpt has a thread to spare for another partition */
+static bool ptlrpc_server_can_steal(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_service *svc = svcpt->scp_service;
+	/* keep one thread for our own HP requests */
+	int reserve = nrs_svcpt_has_hp(svcpt) ? 1 : 0;
+
+	return svc->srv_steal_threshold > 0 && svc->srv_ncpts > 1 &&
+	       svcpt->scp_nthrs_running - ptlrpc_server_nthrs_busy(svcpt) >
+	       reserve;
+}
+
+/**
+ * Find the partition threads of \a svcpt should steal a request from.
+ * Lockless, the result is only a hint.
+ */
+static struct ptlrpc_service_part *
+ptlrpc_server_steal_victim(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_service *svc = svcpt->scp_service;
+	struct ptlrpc_service_part *victim = NULL;
+	struct ptlrpc_service_part *part;
+	unsigned long best = 0;
+	int i;
+
+	if (!ptlrpc_server_can_steal(svcpt))
+		return NULL;
+
+	ptlrpc_service_for_each_part(part, i, svc) {
+		unsigned long queued;
+
+		if (part == svcpt)
+			continue;
+
+		queued = READ_ONCE(part->scp_nrs_reg.nrs_req_queued);
+		if (queued <= best ||
+		    queued < ptlrpc_server_steal_depth(svcpt, part))
+			continue;
+
+		/* the policy holds requests back on purpose, or the
+		 * partition still has threads of its own to serve them */
+		if (ptlrpc_nrs_req_throttling_nolock(part, false) ||
+		    ptlrpc_server_allow_normal(part, false))
+			continue;
+
+		victim = part;
+		best = queued;
+	}
+
+	return victim;
+}
+
+static inline bool
+ptlrpc_server_steal_pending(struct ptlrpc_service_part *svcpt)
+{
+	return ptlrpc_server_steal_victim(svcpt) != NULL;
+}
+
+/**
+ * Fetch a normal priority request queued on another partition for a
+ * thread of \a svcpt. The request stays accounted to its own partition,
+ * which is where ptlrpc_server_finish_active_request() must release it,
+ * after ptlrpc_server_steal_done() gave the thread back to \a svcpt.
+ */
+static struct ptlrpc_request *
+ptlrpc_server_request_steal(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_service_part *victim;
+	struct ptlrpc_request *req;
+
+	ENTRY;
+
+	victim = ptlrpc_server_steal_victim(svcpt);
+	if (victim == NULL)
+		RETURN(NULL);
+
+	spin_lock(&victim->scp_req_lock);
+	if (victim->scp_nrs_reg.nrs_req_queued <
+	    ptlrpc_server_steal_depth(svcpt, victim) ||
+	    ptlrpc_nrs_req_throttling_nolock(victim, false)) {
+		spin_unlock(&victim->scp_req_lock);
+		RETURN(NULL);
+	}
+
+	req = ptlrpc_nrs_req_get_nolock(victim, false, false);
+	if (req == NULL) {
+		spin_unlock(&victim->scp_req_lock);
+		RETURN(NULL);
+	}
+
+	victim->scp_nreqs_active++;
+	victim->scp_nreqs_lent++;
+	victim->scp_nreqs_stolen++;
+	spin_unlock(&victim->scp_req_lock);
+
+	/* the request keeps a thread of ours busy, not one of the victim */
+	spin_lock(&svcpt->scp_req_lock);
+	svcpt->scp_nreqs_stealing++;
+	spin_unlock(&svcpt->scp_req_lock);
+
+	if (likely(req->rq_export))
+		class_export_rpc_inc(req->rq_export);
+
+	if (likely(svcpt->scp_service->srv_stats != NULL))
+		lprocfs_counter_incr(svcpt->scp_service->srv_stats,
+				     PTLRPC_REQSTOLEN_CNTR);
+
+	CDEBUG(D_RPCTRACE, "%s: CPT %d steals x%llu from CPT %d\n",
+	       svcpt->scp_service->srv_name, svcpt->scp_cpt, req->rq_xid,
+	       victim->scp_cpt);
+
+	RETURN(req);
+}
+
+/* the thread of \a thief serving a request of \a victim is done with it */
+static void ptlrpc_server_steal_done(struct ptlrpc_service_part *thief,
+				     struct ptlrpc_service_part *victim)
+{
+	spin_lock(&victim->scp_req_lock);
+	victim->scp_nreqs_lent--;
+	spin_unlock(&victim->scp_req_lock);
+
+	spin_lock(&thief->scp_req_lock);
+	thief->scp_nreqs_stealing--;
+	spin_unlock(&thief->scp_req_lock);
+}
+
+/**
+ * Wake up an idle thread of the nearest partition which can help
+ * \a svcpt with its backlog.
+ */
+static void ptlrpc_server_steal_wakeup(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_service *svc = svcpt->scp_service;
+	struct ptlrpc_service_part *helper = NULL;
+	struct ptlrpc_service_part *part;
+	unsigned int best = UINT_MAX;
+	int i;
+
+	if (svc->srv_steal_threshold == 0 || svc->srv_ncpts < 2 ||
+	    READ_ONCE(svcpt->scp_nrs_reg.nrs_req_queued) <
+	    svc->srv_steal_threshold ||
+	    ptlrpc_server_allow_normal(svcpt, false))
+		return;
+
+	ptlrpc_service_for_each_part(part, i, svc) {
+		unsigned int dist;
+
+		if (part == svcpt || !ptlrpc_server_can_steal(part))
+			continue;
+
+		dist = cfs_cpt_distance(svc->srv_cptable, part->scp_cpt,
+					svcpt->scp_cpt);
+		if (dist < best) {
+			helper = part;
+			best = dist;
+		}
+	}
+
+	if (helper != NULL)
+		wake_up(&helper->scp_waitq);
+}
+
 /**
  * Handle freshly incoming reqs, add to timed early reply list,
  * pass on to regular request queue.
@@ -2137,6 +2555,7 @@ static int ptlrpc_server_handle_req_in(struct ptlrpc_service_part *svcpt,
 		GOTO(err_req, rc);
 
 	wake_up(&svcpt->scp_waitq);
+	ptlrpc_server_steal_wakeup(svcpt);
 	RETURN(1);
 
 err_req:
@@ -2153,6 +2572,7 @@ static int ptlrpc_server_handle_request(struct ptlrpc_service_part *svcpt,
 					struct ptlrpc_thread *thread)
 {
 	struct ptlrpc_service *svc = svcpt->scp_service;
+	struct ptlrpc_service_part *thief = NULL;
 	struct ptlrpc_request *request;
 	ktime_t work_start;
 	ktime_t work_end;
@@ -2164,8 +2584,14 @@ static int ptlrpc_server_handle_request(struct ptlrpc_service_part *svcpt,
 	ENTRY;
 
 	request = ptlrpc_server_request_get(svcpt, false);
-	if (request == NULL)
-		RETURN(0);
+	if (request == NULL) {
+		request = ptlrpc_server_request_steal(svcpt);
+		if (request == NULL)
+			RETURN(0);
+		/* served by this thread, accounted to the victim */
+		thief = svcpt;
+		svcpt = request->rq_rqbd->rqbd_svcpt;
+	}
 
 	if (OBD_FAIL_CHECK(OBD_FAIL_PTLRPC_HPREQ_NOTIMEOUT))
 		fail_opc = OBD_FAIL_PTLRPC_HPREQ_NOTIMEOUT;
@@ -2294,6 +2720,8 @@ put_conn:
 			  div_u64(arrived_usecs, USEC_PER_SEC));
 	}
 
+	if (thief != NULL)
+		ptlrpc_server_steal_done(thief, svcpt);
 	ptlrpc_server_finish_active_request(svcpt, request);
 
 	RETURN(1);
@@ -2642,6 +3070,7 @@ ptlrpc_wait_event(struct ptlrpc_service_part *svcpt,
 				ptlrpc_thread_stopping(thread) ||
 				ptlrpc_server_request_incoming(svcpt) ||
 				ptlrpc_server_request_pending(svcpt, false) ||
+				ptlrpc_server_steal_pending(svcpt) ||
 				ptlrpc_rqbd_pending(svcpt) ||
 				ptlrpc_at_check(svcpt), &lwi);
 
@@ -2789,7 +3218,8 @@ static int ptlrpc_main(void *arg)
 		if (ptlrpc_at_check(svcpt))
 			ptlrpc_at_check_timed(svcpt);
 
-		if (ptlrpc_server_request_pending(svcpt, false)) {
+		if (ptlrpc_server_request_pending(svcpt, false) ||
+		    ptlrpc_server_steal_pending(svcpt)) {
 			lu_context_enter(&env->le_ctx);
 			ptlrpc_server_handle_request(svcpt, thread);
 			lu_context_exit(&env->le_ctx);
@@ -3390,6 +3820,7 @@ ptlrpc_service_purge_all(struct ptlrpc_service *svc)
 	struct ptlrpc_request *req;
 	struct ptlrpc_reply_state *rs;
 	int i;
+	int j;
 
 	ptlrpc_service_for_each_part(svcpt, i, svc) {
 		if (svcpt->scp_service == NULL)
@@ -3453,6 +3884,17 @@ ptlrpc_service_purge_all(struct ptlrpc_service *svc)
 			list_del(&rs->rs_list);
 			OBD_FREE_LARGE(rs, svc->srv_max_reply_size);
 		}
+
+		for (j = 0; j < PTLRPC_RS_CACHE_CLASSES; j++) {
+			while (!list_empty(&svcpt->scp_rs_cache[j])) {
+				rs = list_entry(svcpt->scp_rs_cache[j].next,
+						struct ptlrpc_reply_state,
+						rs_list);
+				list_del(&rs->rs_list);
+				OBD_FREE_LARGE(rs, rs->rs_size);
+			}
+			svcpt->scp_rs_cached[j] = 0;
+		}
 	}
 }
 
@@ -175,7 +175,11 @@ void lustre_assert_wire_constants(void)
 		 (long long)MDS_HSM_CT_UNREGISTER);
 	LASSERTF(MDS_SWAP_LAYOUTS == 61, "found %lld\n",
 		 (long long)MDS_SWAP_LAYOUTS);
-	LASSERTF(MDS_LAST_OPC == 62, "found %lld\n",
+	LASSERTF(MDS_BATCH_GETATTR == 62, "found %lld\n",
+		 (long long)MDS_BATCH_GETATTR);
+	LASSERTF(MDS_BATCH_REINT == 63, "found %lld\n",
+		 (long long)MDS_BATCH_REINT);
+	LASSERTF(MDS_LAST_OPC == 64, "found %lld\n",
 		 (long long)MDS_LAST_OPC);
 	LASSERTF(REINT_SETATTR == 1, "found %lld\n",
 		 (long long)REINT_SETATTR);
@@ -1351,6 +1355,14 @@ void lustre_assert_wire_constants(void)
 		 OBD_CONNECT2_PLAIN_LAYOUT);
 	LASSERTF(OBD_CONNECT2_ASYNC_DISCARD == 0x4000ULL, "found 0x%.16llxULL\n",
 		 OBD_CONNECT2_ASYNC_DISCARD);
+	LASSERTF(OBD_CONNECT2_BATCH_GETATTR == 0x8000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BATCH_GETATTR);
+	LASSERTF(OBD_CONNECT2_MULTI_OBJ_BRW == 0x10000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_MULTI_OBJ_BRW);
+	LASSERTF(OBD_CONNECT2_BATCH_REINT == 0x20000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BATCH_REINT);
+	LASSERTF(OBD_CONNECT2_BATCH_BL_AST == 0x40000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BATCH_BL_AST);
 	LASSERTF(OBD_CKSUM_CRC32 == 0x00000001UL, "found 0x%.8xUL\n",
 		(unsigned)OBD_CKSUM_CRC32);
 	LASSERTF(OBD_CKSUM_ADLER == 0x00000002UL, "found 0x%.8xUL\n",
@@ -2544,6 +2556,26 @@ void lustre_assert_wire_constants(void)
 	LASSERTF((int)sizeof(((struct mdt_ioepoch *)0)->mio_padding) == 4, "found %lld\n",
 		 (long long)(int)sizeof(((struct mdt_ioepoch *)0)->mio_padding));
 
+	/* Checks for struct mdt_batch_header */
+	LASSERTF((int)sizeof(struct mdt_batch_header) == 16, "found %lld\n",
+		 (long long)(int)sizeof(struct mdt_batch_header));
+	LASSERTF((int)offsetof(struct mdt_batch_header, mbh_count) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_header, mbh_count));
+	LASSERTF((int)sizeof(((struct mdt_batch_header *)0)->mbh_count) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_header *)0)->mbh_count));
+	LASSERTF((int)offsetof(struct mdt_batch_header, mbh_flags) == 4, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_header, mbh_flags));
+	LASSERTF((int)sizeof(((struct mdt_batch_header *)0)->mbh_flags) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_header *)0)->mbh_flags));
+	LASSERTF((int)offsetof(struct mdt_batch_header, mbh_reply_size) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_header, mbh_reply_size));
+	LASSERTF((int)sizeof(((struct mdt_batch_header *)0)->mbh_reply_size) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_header *)0)->mbh_reply_size));
+	LASSERTF((int)offsetof(struct mdt_batch_header, mbh_padding) == 12, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_header, mbh_padding));
+	LASSERTF((int)sizeof(((struct mdt_batch_header *)0)->mbh_padding) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_header *)0)->mbh_padding));
+
 	/* Checks for struct mdt_rec_setattr */
 	LASSERTF((int)sizeof(struct mdt_rec_setattr) == 136, "found %lld\n",
 		 (long long)(int)sizeof(struct mdt_rec_setattr));
@@ -185,12 +185,114 @@ out:
 }
 EXPORT_SYMBOL(tgt_validate_obdo);
 
+static int tgt_obdo_map_ids(struct tgt_session_info *tsi, struct obdo *oa)
+{
+	struct lu_nodemap *nodemap;
+
+	nodemap = nodemap_get_from_exp(tsi->tsi_exp);
+	if (IS_ERR(nodemap))
+		return PTR_ERR(nodemap);
+
+	oa->o_uid = nodemap_map_id(nodemap, NODEMAP_UID, NODEMAP_CLIENT_TO_FS,
+				   oa->o_uid);
+	oa->o_gid = nodemap_map_id(nodemap, NODEMAP_GID, NODEMAP_CLIENT_TO_FS,
+				   oa->o_gid);
+	nodemap_putref(nodemap);
+
+	return 0;
+}
+
+/*
+ * Unpack the other objects of a multi-object OST_WRITE. The ost_body of
+ * the object ioo[i] is in RMF_OST_BODIES[i - 1], the RMF_OST_BODY one only
+ * describes ioo[0] and carries the grant and checksum of the whole RPC.
+ *
+ * Objects must be sorted by FID: their local buffers are all prepared before
+ * any of them is committed, so this gives a stable object locking order.
+ * Such writes are only done under client extent locks, never with
+ * OBD_BRW_SRVLOCK.
+ */
+static int tgt_io_data_unpack_multi(struct tgt_session_info *tsi,
+				    struct obd_ioobj *ioo,
+				    struct niobuf_remote *rnb, int obj_count)
+{
+	struct ost_body	*bodies;
+	int		 niocount = ioo[0].ioo_bufcnt;
+	int		 i;
+	int		 rc;
+
+	ENTRY;
+
+	if (!exp_connect_multi_obj_brw(tsi->tsi_exp) ||
+	    lustre_msg_get_opc(tgt_ses_req(tsi)->rq_reqmsg) != OST_WRITE ||
+	    obj_count > PTLRPC_MAX_BRW_PAGES)
+		GOTO(out, rc = -EPROTO);
+
+	if (!req_capsule_field_present(tsi->tsi_pill, &RMF_OST_BODIES,
+				       RCL_CLIENT) ||
+	    req_capsule_get_size(tsi->tsi_pill, &RMF_OST_BODIES, RCL_CLIENT) !=
+	    (obj_count - 1) * sizeof(*bodies))
+		GOTO(out, rc = -EPROTO);
+
+	bodies = req_capsule_client_get(tsi->tsi_pill, &RMF_OST_BODIES);
+	if (bodies == NULL)
+		GOTO(out, rc = -EPROTO);
+
+	for (i = 1; i < obj_count; i++) {
+		struct obdo *oa = &bodies[i - 1].oa;
+
+		if (!(oa->o_valid & OBD_MD_FLID) || ioo[i].ioo_bufcnt == 0)
+			GOTO(out, rc = -EPROTO);
+
+		rc = tgt_validate_obdo(tsi, oa);
+		if (rc)
+			RETURN(rc);
+
+		rc = tgt_obdo_map_ids(tsi, oa);
+		if (rc)
+			RETURN(rc);
+
+		/* grant is only exchanged through the first ost_body */
+		oa->o_valid &= ~(OBD_MD_FLGRANT | OBD_MD_FLBLOCKS |
+				 OBD_MD_FLCKSUM);
+		ioo[i].ioo_oid = oa->o_oi;
+
+		if (lu_fid_cmp(&ioo[i - 1].ioo_oid.oi_fid,
+			       &ioo[i].ioo_oid.oi_fid) >= 0)
+			GOTO(out, rc = -EPROTO);
+
+		niocount += ioo[i].ioo_bufcnt;
+	}
+
+	if (niocount > PTLRPC_MAX_BRW_PAGES) {
+		DEBUG_REQ(D_RPCTRACE, tgt_ses_req(tsi),
+			  "bulk has too many pages (%d)", niocount);
+		RETURN(-EPROTO);
+	}
+
+	if (req_capsule_get_size(tsi->tsi_pill, &RMF_NIOBUF_REMOTE,
+				 RCL_CLIENT) != niocount * sizeof(*rnb))
+		GOTO(out, rc = -EPROTO);
+
+	for (i = 0; i < niocount; i++)
+		if (rnb[i].rnb_flags & OBD_BRW_SRVLOCK)
+			GOTO(out, rc = -EPROTO);
+
+	RETURN(0);
+out:
+	CERROR("%s: client %s sent bad write of %d objects: rc = %d\n",
+	       tgt_name(tsi->tsi_tgt), obd_export_nid2str(tsi->tsi_exp),
+	       obj_count, rc);
+	return rc;
+}
+
 static int tgt_io_data_unpack(struct tgt_session_info *tsi, struct ost_id *oi)
 {
 	unsigned		 max_brw;
 	struct niobuf_remote	*rnb;
 	struct obd_ioobj	*ioo;
 	int			 obj_count;
+	int			 rc;
 
 	ENTRY;
 
@@ -217,10 +319,6 @@ static int tgt_io_data_unpack(struct tgt_session_info *tsi, struct ost_id *oi)
 	if (obj_count == 0) {
 		CERROR("%s: short ioobj\n", tgt_name(tsi->tsi_tgt));
 		RETURN(-EPROTO);
-	} else if (obj_count > 1) {
-		CERROR("%s: too many ioobjs (%d)\n", tgt_name(tsi->tsi_tgt),
-		       obj_count);
-		RETURN(-EPROTO);
 	}
 
 	if (ioo->ioo_bufcnt == 0) {
@@ -228,6 +326,12 @@ static int tgt_io_data_unpack(struct tgt_session_info *tsi, struct ost_id *oi)
 		RETURN(-EPROTO);
 	}
 
+	if (obj_count > 1) {
+		rc = tgt_io_data_unpack_multi(tsi, ioo, rnb, obj_count);
+		if (rc < 0)
+			RETURN(rc);
+	}
+
 	if (ioo->ioo_bufcnt > PTLRPC_MAX_BRW_PAGES) {
 		DEBUG_REQ(D_RPCTRACE, tgt_ses_req(tsi),
 			  "bulk has too many pages (%d)",
@@ -242,7 +346,6 @@ static int tgt_ost_body_unpack(struct tgt_session_info *tsi, __u32 flags)
 {
 	struct ost_body		*body;
 	struct req_capsule	*pill = tsi->tsi_pill;
-	struct lu_nodemap	*nodemap;
 	int			 rc;
 
 	ENTRY;
@@ -255,17 +358,9 @@ static int tgt_ost_body_unpack(struct tgt_session_info *tsi, __u32 flags)
 	if (rc)
 		RETURN(rc);
 
-	nodemap = nodemap_get_from_exp(tsi->tsi_exp);
-	if (IS_ERR(nodemap))
-		RETURN(PTR_ERR(nodemap));
-
-	body->oa.o_uid = nodemap_map_id(nodemap, NODEMAP_UID,
-					NODEMAP_CLIENT_TO_FS,
-					body->oa.o_uid);
-	body->oa.o_gid = nodemap_map_id(nodemap, NODEMAP_GID,
-					NODEMAP_CLIENT_TO_FS,
-					body->oa.o_gid);
-	nodemap_putref(nodemap);
+	rc = tgt_obdo_map_ids(tsi, &body->oa);
+	if (rc)
+		RETURN(rc);
 
 	tsi->tsi_ost_body = body;
 	tsi->tsi_fid = body->oa.o_oi.oi_fid;
@@ -503,6 +598,7 @@ static int tgt_filter_recovery_request(struct ptlrpc_request *req,
 	case MDS_SYNC: /* used in unmounting */
 	case OBD_PING:
 	case MDS_REINT:
+	case MDS_BATCH_REINT:
 	case OUT_UPDATE:
 	case SEQ_QUERY:
 	case FLD_QUERY:
@@ -2460,20 +2556,52 @@ static void tgt_warn_on_cksum(struct ptlrpc_request *req,
 			   client_cksum, server_cksum);
 }
 
+/* attributes of object \a i of a (multi-object) OST_WRITE */
+static inline struct obdo *tgt_brw_oa(struct ost_body *repbody,
+				      struct ost_body *bodies, int i)
+{
+	return i == 0 ? &repbody->oa : &bodies[i - 1].oa;
+}
+
+/*
+ * A multi-object write returns a single ost_body, that of the first object.
+ * Forward the over-quota flags the other objects got if they have the same
+ * owner, the client learns about other IDs from their next write.
+ */
+static void tgt_brw_merge_quota(struct obdo *repoa, struct obdo *oa)
+{
+	if (!(oa->o_valid & OBD_MD_FLALLQUOTA) ||
+	    oa->o_uid != repoa->o_uid || oa->o_gid != repoa->o_gid ||
+	    oa->o_projid != repoa->o_projid)
+		return;
+
+	if (!(repoa->o_valid & OBD_MD_FLFLAGS)) {
+		repoa->o_valid |= OBD_MD_FLFLAGS;
+		repoa->o_flags = 0;
+	}
+	repoa->o_valid |= OBD_MD_FLALLQUOTA;
+	repoa->o_flags |= oa->o_flags & OBD_FL_NO_QUOTA_ALL;
+}
+
 int tgt_brw_write(struct tgt_session_info *tsi)
 {
 	struct ptlrpc_request	*req = tgt_ses_req(tsi);
 	struct ptlrpc_bulk_desc	*desc = NULL;
 	struct obd_export	*exp = req->rq_export;
 	struct niobuf_remote	*remote_nb;
+	struct niobuf_remote	*nb;
 	struct niobuf_local	*local_nb;
+	struct niobuf_local	*lnb;
 	struct obd_ioobj	*ioo;
-	struct ost_body		*body, *repbody;
+	struct ost_body		*body, *repbody, *bodies = NULL;
 	struct l_wait_info	 lwi;
 	struct lustre_handle	 lockh = {0};
 	__u32			*rcs;
 	int			 objcount, niocount, npages;
-	int			 rc, i, j;
+	int			 obj_npages_one;
+	int			*obj_npages = &obj_npages_one;
+	int			 prepared;
+	int			 rc, rc2, old_rc, i, j;
 	enum cksum_types cksum_type = OBD_CKSUM_CRC32;
 	bool			 no_reply = false, mmap;
 	struct tgt_thread_big_cache *tbc = req->rq_svc_thread->t_data;
@@ -2532,6 +2660,17 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 			sizeof(*remote_nb))
 		RETURN(err_serious(-EPROTO));
 
+	/* multi-object write, checked by tgt_io_data_unpack() */
+	if (objcount > 1) {
+		bodies = req_capsule_client_get(&req->rq_pill,
+						&RMF_OST_BODIES);
+		LASSERT(bodies != NULL);
+
+		OBD_ALLOC(obj_npages, objcount * sizeof(*obj_npages));
+		if (obj_npages == NULL)
+			RETURN(-ENOMEM);
+	}
+
 	if ((remote_nb[0].rnb_flags & OBD_BRW_MEMALLOC) &&
 	    ptlrpc_connection_is_local(exp->exp_connection))
 		memory_pressure_set();
@@ -2580,11 +2719,24 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 		GOTO(out_lock, rc = -ENOMEM);
 	repbody->oa = body->oa;
 
-	npages = PTLRPC_MAX_BRW_PAGES;
-	rc = obd_preprw(tsi->tsi_env, OBD_BRW_WRITE, exp, &repbody->oa,
-			objcount, ioo, remote_nb, &npages, local_nb);
-	if (rc < 0)
+	/* prepare the objects one by one, their local buffers follow each
+	 * other in local_nb in the order of the remote ones */
+	npages = 0;
+	for (prepared = 0, nb = remote_nb; prepared < objcount; prepared++) {
+		obj_npages[prepared] = PTLRPC_MAX_BRW_PAGES - npages;
+		rc = obd_preprw(tsi->tsi_env, OBD_BRW_WRITE, exp,
+				tgt_brw_oa(repbody, bodies, prepared), 1,
+				&ioo[prepared], nb, &obj_npages[prepared],
+				local_nb + npages);
+		if (rc < 0)
+			break;
+		npages += obj_npages[prepared];
+		nb += ioo[prepared].ioo_bufcnt;
+	}
+	if (prepared == 0)
 		GOTO(out_lock, rc);
+	if (rc < 0)
+		GOTO(out_commitrw, rc);
 	if (body->oa.o_flags & OBD_FL_SHORT_IO) {
 		int short_io_size;
 		unsigned char *short_io_buf;
@@ -2664,8 +2816,24 @@ skip_transfer:
 
 out_commitrw:
 	/* Must commit after prep above in all cases */
-	rc = obd_commitrw(tsi->tsi_env, OBD_BRW_WRITE, exp, &repbody->oa,
-			  objcount, ioo, remote_nb, npages, local_nb, rc);
+	old_rc = rc;
+	/* every object is committed in its own transaction, each one needs
+	 * its own transno and last_rcvd update, the reply carries the last */
+	if (prepared > 1)
+		tgt_th_info(tsi->tsi_env)->tti_mult_trans =
+			!req_is_replay(req);
+	for (i = 0, nb = remote_nb, lnb = local_nb; i < prepared; i++) {
+		rc2 = obd_commitrw(tsi->tsi_env, OBD_BRW_WRITE, exp,
+				   tgt_brw_oa(repbody, bodies, i), 1, &ioo[i],
+				   nb, obj_npages[i], lnb, old_rc);
+		nb += ioo[i].ioo_bufcnt;
+		lnb += obj_npages[i];
+		if (i > 0)
+			tgt_brw_merge_quota(&repbody->oa, &bodies[i - 1].oa);
+		/* keep the first error, the client resends the whole RPC */
+		if (i == 0 || rc == 0)
+			rc = rc2;
+	}
 	if (rc == -ENOTCONN)
 		/* quota acquire process has been given up because
 		 * either the client has been evicted or the client
@@ -2711,6 +2879,8 @@ out_lock:
 	if (desc)
 		ptlrpc_free_bulk(desc);
 out:
+	if (obj_npages != &obj_npages_one)
+		OBD_FREE(obj_npages, objcount * sizeof(*obj_npages));
 	if (unlikely(no_reply || (exp->exp_obd->obd_no_transno && wait_sync))) {
 		req->rq_no_reply = 1;
 		/* reply out callback would free */
@@ -1893,6 +1893,24 @@ int tgt_txn_stop_cb(const struct lu_env *env, struct thandle *th,
 	return rc;
 }
 
+/**
+ * Forget the transaction of the request handled so far in this session, so
+ * that the next one gets its own transno and last_rcvd record. Used when a
+ * single RPC carries several independent modifying requests.
+ */
+void tgt_txn_reset(const struct lu_env *env)
+{
+	struct tgt_thread_info	*tti = tgt_th_info(env);
+	struct tgt_session_info	*tsi = tgt_ses_info(env);
+
+	tti->tti_has_trans = 0;
+	tti->tti_mult_trans = 0;
+	tti->tti_transno = 0;
+	tsi->tsi_opdata = 0;
+	tsi->tsi_vbr_obj = NULL;
+}
+EXPORT_SYMBOL(tgt_txn_reset);
+
 int tgt_reply_data_init(const struct lu_env *env, struct lu_target *tgt)
 {
 	struct tgt_thread_info	*tti = tgt_th_info(env);
@@ -32,6 +32,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <libgen.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -42,11 +43,16 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <lustre/lustreapi.h>
+
 static void usage(const char *prog)
 {
-	printf("usage: %s {-o [-k]|-m|-d|-l<tgt>} [-u[<unlinkfmt>]] "
-	       "[-t seconds] filenamefmt [[start] count]\n", prog);
-	printf("\t-l\tlink files to existing <tgt> file\n"
+	printf("usage: %s {-o [-k]|-m|-d|-l<tgt>|-c<mode>} [-u[<unlinkfmt>]] "
+	       "[-b batch] [-t seconds] filenamefmt [[start] count]\n", prog);
+	printf("\t-b\tcreate/chmod/unlink <batch> files per call with -m, -d, "
+	       "-c, -u\n"
+	       "\t-c\tchmod existing files to <mode>\n"
+	       "\t-l\tlink files to existing <tgt> file\n"
 	       "\t-m\tmknod regular files (don't create OST objects)\n"
 	       "\t-o\topen+create files with path and printf format\n"
 	       "\t-k\t    keep files open until all files are opened\n"
@@ -71,6 +77,88 @@ static char *get_file_name(const char *fmt, long n, int has_fmt_spec)
 	return filename;
 }
 
+static struct lu_batch_op *batch_ops;
+static char batch_dir[PATH_MAX];
+static int batch_count;
+
+/* execute the operations queued by batch_add() */
+static int batch_flush(void)
+{
+	int dirfd;
+	int rc;
+	int i;
+
+	if (batch_count == 0)
+		return 0;
+
+	dirfd = open(batch_dir, O_RDONLY | O_DIRECTORY);
+	if (dirfd < 0) {
+		printf("open(%s) error: %s\n", batch_dir, strerror(errno));
+		return errno;
+	}
+
+	rc = llapi_batch_ops(dirfd, batch_ops, batch_count);
+	close(dirfd);
+	if (rc < 0) {
+		printf("batch(%s) error: %s\n", batch_dir, strerror(-rc));
+		return -rc;
+	}
+
+	for (i = 0; i < batch_count; i++) {
+		rc = -batch_ops[i].lbo_result;
+		if (rc) {
+			printf("%s(%s/%s) error: %s\n",
+			       batch_ops[i].lbo_opc == LU_BATCH_UNLINK ?
+			       "unlink" :
+			       batch_ops[i].lbo_opc == LU_BATCH_SETATTR ?
+			       "chmod" : "create", batch_dir,
+			       batch_ops[i].lbo_name, strerror(rc));
+			break;
+		}
+	}
+	batch_count = 0;
+
+	return rc;
+}
+
+/* queue an operation on \a filename, flushing the queue when it is full or
+ * \a filename is in another directory */
+static int batch_add(const char *filename, __u32 opc, mode_t mode, int batch)
+{
+	char path[PATH_MAX];
+	struct lu_batch_op *op;
+	char *dir;
+	int rc;
+
+	snprintf(path, sizeof(path), "%s", filename);
+	dir = dirname(path);
+	if (batch_count == batch || strcmp(dir, batch_dir) != 0) {
+		rc = batch_flush();
+		if (rc)
+			return rc;
+		snprintf(batch_dir, sizeof(batch_dir), "%s", dir);
+	}
+
+	op = &batch_ops[batch_count++];
+	memset(op, 0, sizeof(*op));
+	op->lbo_opc = opc;
+	op->lbo_mode = mode;
+	snprintf(path, sizeof(path), "%s", filename);
+	snprintf(op->lbo_name, sizeof(op->lbo_name), "%s", basename(path));
+	if (opc == LU_BATCH_SETATTR) {
+		op->lbo_valid = LU_BATCH_VALID_MODE;
+		rc = llapi_path2fid(filename, &op->lbo_fid);
+		if (rc) {
+			printf("path2fid(%s) error: %s\n", filename,
+			       strerror(-rc));
+			batch_count--;
+			return -rc;
+		}
+	}
+
+	return 0;
+}
+
 double now(void)
 {
 	struct timeval tv;
@@ -82,6 +170,8 @@ int main(int argc, char ** argv)
 {
 	bool do_open = false, do_keep = false, do_link = false;
 	bool do_unlink = false, do_mknod = false, do_mkdir = false;
+	bool do_chmod = false;
+	mode_t chmod_mode = 0;
 	char *filename, *progname;
 	char *fmt = NULL, *fmt_unlink = NULL, *tgt = NULL;
 	char *endp = NULL;
@@ -90,6 +180,7 @@ int main(int argc, char ** argv)
 	int has_fmt_spec = 0, unlink_has_fmt_spec = 0;
 	long i, total, last_i = 0;
 	int c, last_fd = -1, stderr_fd;
+	int batch = 0;
 	int rc = 0;
 
 	/* Handle the deprecated positional last argument "-seconds" */
@@ -108,8 +199,19 @@ int main(int argc, char ** argv)
 	else
 		progname = argv[0];
 
-	while ((c = getopt(argc, argv, "dl:kmor::t:u::")) != -1) {
+	while ((c = getopt(argc, argv, "b:c:dl:kmor::t:u::")) != -1) {
 		switch (c) {
+		case 'b':
+			batch = strtol(optarg, &endp, 0);
+			if (batch <= 0 || *endp != '\0')
+				usage(progname);
+			break;
+		case 'c':
+			do_chmod = true;
+			chmod_mode = strtol(optarg, &endp, 8);
+			if (chmod_mode > 07777 || *endp != '\0')
+				usage(progname);
+			break;
 		case 'd':
 			do_mkdir = true;
 			break;
@@ -142,9 +244,10 @@ int main(int argc, char ** argv)
 		}
 	}
 
-	if (do_open + do_mkdir + do_link + do_mknod > 1 ||
-	    do_open + do_mkdir + do_link + do_mknod + do_unlink == 0) {
-		fprintf(stderr, "error: only one of -o, -m, -l, -d\n");
+	if (do_open + do_mkdir + do_link + do_mknod + do_chmod > 1 ||
+	    do_open + do_mkdir + do_link + do_mknod + do_chmod +
+	    do_unlink == 0) {
+		fprintf(stderr, "error: only one of -o, -m, -l, -d, -c\n");
 		usage(progname);
 	}
 
@@ -153,6 +256,22 @@ int main(int argc, char ** argv)
 		usage(progname);
 	}
 
+	if (batch && (do_open || do_link)) {
+		fprintf(stderr, "error: can only use -b with -m, -d, -c, -u\n");
+		usage(progname);
+	}
+
+	if (batch) {
+		/* create or chmod and unlink of one file take two slots */
+		if (do_unlink && (do_mkdir || do_mknod || do_chmod))
+			batch *= 2;
+		batch_ops = calloc(batch, sizeof(*batch_ops));
+		if (batch_ops == NULL) {
+			fprintf(stderr, "error: cannot allocate batch\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
 	switch (argc - optind) {
 	case 3:
 		begin = strtol(argv[argc - 2], NULL, 0);
@@ -174,7 +293,25 @@ int main(int argc, char ** argv)
 		double tmp;
 
 		filename = get_file_name(fmt, begin, has_fmt_spec);
-		if (do_open) {
+		if (batch) {
+			if (do_mkdir || do_mknod)
+				rc = batch_add(filename, LU_BATCH_CREATE,
+					       do_mkdir ? S_IFDIR | 0755 :
+							  S_IFREG | 0444,
+					       batch);
+			else if (do_chmod)
+				rc = batch_add(filename, LU_BATCH_SETATTR,
+					       chmod_mode, batch);
+			if (!rc && do_unlink) {
+				if (fmt_unlink != NULL)
+					filename = get_file_name(fmt_unlink,
+						begin, unlink_has_fmt_spec);
+				rc = batch_add(filename, LU_BATCH_UNLINK, 0,
+					       batch);
+			}
+			if (rc)
+				break;
+		} else if (do_open) {
 			int fd = open(filename, O_CREAT|O_RDWR, 0644);
 			if (fd < 0) {
 				printf("open(%s) error: %s\n", filename,
@@ -210,8 +347,16 @@ int main(int argc, char ** argv)
 				rc = errno;
 				break;
 			}
+		} else if (do_chmod) {
+			rc = chmod(filename, chmod_mode);
+			if (rc) {
+				printf("chmod(%s) error: %s\n",
+				       filename, strerror(errno));
+				rc = errno;
+				break;
+			}
 		}
-		if (do_unlink) {
+		if (do_unlink && !batch) {
 			if (fmt_unlink != NULL)
 				filename = get_file_name(fmt_unlink, begin,
 							 unlink_has_fmt_spec);
@@ -232,7 +377,8 @@ int main(int argc, char ** argv)
 			       "\n",
 			       do_open ? do_keep ? "open/keep" : "open/close" :
 					do_mkdir ? "mkdir" : do_link ? "link" :
-					do_mknod ? "create" : "",
+					do_mknod ? "create" :
+					do_chmod ? "chmod" : "",
 			       do_unlink ? do_mkdir ? "/rmdir" : "/unlink" : "",
 			       i, tmp, tmp - start,
 			       (i - last_i) / (tmp - last_t));
@@ -240,12 +386,16 @@ int main(int argc, char ** argv)
 			last_i = i;
 		}
 	}
+	if (!rc)
+		rc = batch_flush();
+	free(batch_ops);
 	last_t = now();
 	total = i;
 	printf("total: %ld %s%s in %.2f seconds: %.2f ops/second\n", total,
 	       do_open ? do_keep ? "open/keep" : "open/close" :
 			do_mkdir ? "mkdir" : do_link ? "link" :
-					     do_mknod ? "create" : "",
+					     do_mknod ? "create" :
+					     do_chmod ? "chmod" : "",
 	       do_unlink ? do_mkdir ? "/rmdir" : "/unlink" : "",
 	       last_t - start, ((double)total / (last_t - start)));
 
@@ -1273,6 +1273,115 @@ test_16() {
 }
 run_test 16 "Test detach with different options"
 
+test_17() {
+	local loopfile="$TMP/$tfile"
+	local mntpt="/mnt/pcc.$tdir"
+	local hsm_root="$mntpt/$tdir"
+	local file=$DIR/$tfile
+	local -a lpcc_path
+
+	setup_loopdev $SINGLEAGT $loopfile $mntpt 50
+	setup_pcc_mapping $SINGLEAGT \
+		"projid={100}\ roid=$HSM_ARCHIVE_NUMBER\ ropcc=1"
+
+	do_facet $SINGLEAGT "echo -n ro_data > $file"
+	lpcc_path=$(lpcc_fid2path $hsm_root $file)
+	do_facet $SINGLEAGT $LFS pcc attach -r -i $HSM_ARCHIVE_NUMBER \
+		$file || error "RO-PCC attach $file failed"
+	check_lpcc_state $file "readonly"
+	check_lpcc_data $SINGLEAGT $lpcc_path $file "ro_data"
+
+	echo "Write open should detach and remove the RO-PCC copy"
+	do_facet $SINGLEAGT "echo -n new_data > $file"
+	check_lpcc_state $file "none"
+	do_facet $SINGLEAGT "[ -f $lpcc_path ]" &&
+		error "RO-PCC cached file '$lpcc_path' should be removed"
+	check_file_data $SINGLEAGT $file "new_data"
+
+	echo "Detach with -k keeps the valid RO-PCC copy for reuse"
+	do_facet $SINGLEAGT $LFS pcc attach -r -i $HSM_ARCHIVE_NUMBER \
+		$file || error "RO-PCC attach $file failed"
+	do_facet $SINGLEAGT $LFS pcc detach -k $file ||
+		error "PCC detach $file failed"
+	check_lpcc_state $file "readonly"
+	check_file_data $SINGLEAGT $file "new_data"
+	do_facet $SINGLEAGT $LFS pcc detach $file ||
+		error "PCC detach $file failed"
+	check_lpcc_state $file "none"
+}
+run_test 17 "Test RO-PCC attach, detach and write invalidation"
+
+test_18() {
+	local loopfile="$TMP/$tfile"
+	local mntpt="/mnt/pcc.$tdir"
+	local hsm_root="$mntpt/$tdir"
+	local file=$DIR/$tdir/$tfile.bin
+	local -a lpcc_path
+
+	setup_loopdev $SINGLEAGT $loopfile $mntpt 50
+	setup_pcc_mapping $SINGLEAGT \
+		"fname={*.bin}\ roid=$HSM_ARCHIVE_NUMBER\ ropcc=1"
+
+	mkdir -p $DIR/$tdir || error "mkdir -p $DIR/$tdir failed"
+	do_facet $SINGLEAGT "echo -n auto_ro_data > $file"
+	lpcc_path=$(lpcc_fid2path $hsm_root $file)
+	check_lpcc_state $file "none"
+
+	# The first read-only open fetches the file in the background
+	check_file_data $SINGLEAGT $file "auto_ro_data"
+	wait_update_facet $SINGLEAGT "[ -f $lpcc_path ] && echo cached" \
+		"cached" 30 || error "RO-PCC copy '$lpcc_path' not created"
+	sleep 1
+	check_lpcc_state $file "readonly"
+	check_lpcc_data $SINGLEAGT $lpcc_path $file "auto_ro_data"
+
+	# Layout change invalidates the cached copy
+	$LFS migrate -c 1 $file || error "migrate $file failed"
+	check_file_data $SINGLEAGT $file "auto_ro_data"
+	do_facet $SINGLEAGT $LFS pcc detach $file ||
+		error "PCC detach $file failed"
+}
+run_test 18 "Test RO-PCC auto attach at open by file name rule"
+
+test_19() {
+	local loopfile="$TMP/$tfile"
+	local mntpt="/mnt/pcc.$tdir"
+	local file=$DIR/$tdir/$tfile
+	local evicted
+	local i
+	local param="roid=$HSM_ARCHIVE_NUMBER\ ropcc=1\ hwm=80\ lwm=40"
+
+	setup_loopdev $SINGLEAGT $loopfile $mntpt 50
+	setup_pcc_mapping $SINGLEAGT "projid={100}\ $param\ max_mb=4"
+	do_facet $SINGLEAGT $LCTL set_param llite.*.pcc_stats=clear
+
+	mkdir -p $DIR/$tdir || error "mkdir -p $DIR/$tdir failed"
+	for i in $(seq 1 4); do
+		do_facet $SINGLEAGT dd if=/dev/zero of=$file.$i bs=1M count=1 ||
+			error "dd write $file.$i failed"
+		do_facet $SINGLEAGT $LFS pcc attach -r \
+			-i $HSM_ARCHIVE_NUMBER $file.$i ||
+			error "RO-PCC attach $file.$i failed"
+	done
+	do_facet $SINGLEAGT $LCTL get_param -n llite.*.pcc_stats
+
+	# Eviction runs periodically and skips files used since its last scan
+	wait_update_facet $SINGLEAGT "$LCTL get_param -n llite.*.pcc_stats |
+		grep -c '^evict: [1-9]'" "1" 60 ||
+		error "no cached file evicted above the high watermark"
+	do_facet $SINGLEAGT $LCTL get_param -n llite.*.pcc_stats
+
+	evicted=0
+	for i in $(seq 1 4); do
+		$LFS pcc state $file.$i | grep -q "type: none" &&
+			evicted=$((evicted + 1))
+		check_file_size $SINGLEAGT $file.$i 1048576
+	done
+	(( evicted >= 2 )) ||
+		error "only $evicted files evicted, usage should drop to lwm"
+}
+run_test 19 "Test PCC eviction with watermarks and pcc_stats"
+
 complete $SECONDS
 check_and_cleanup_lustre
 exit_status
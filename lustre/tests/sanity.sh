@@ -4563,6 +4563,43 @@ test_42e() { # bug22074
 }
 run_test 42e "verify sub-RPC writes are not done synchronously"
 
+test_42f() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+
+	local osc=$($LCTL get_param -N osc.$FSNAME-OST0000-osc-[^M]*)
+	local files=100
+	local before
+	local after
+	local old
+
+	$LCTL get_param -n $osc.import | grep -q multi_obj_brw ||
+		skip "OST does not support multi-object writes"
+
+	old=$($LCTL get_param -n $osc.max_objs_per_rpc)
+	stack_trap "$LCTL set_param $osc.max_objs_per_rpc=$old" EXIT
+	$LCTL set_param $osc.max_objs_per_rpc=32
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir
+	for ((i = 0; i < files; i++)); do
+		echo "file $i" > $DIR/$tdir/f$i || error "write f$i failed"
+	done
+
+	before=$(count_ost_writes)
+	sync
+	after=$(count_ost_writes)
+	echo "$files files written back in $((after - before)) RPCs"
+	(( after - before < files / 4 )) ||
+		error "$((after - before)) write RPCs for $files files"
+
+	cancel_lru_locks osc
+	for ((i = 0; i < files; i++)); do
+		[[ "$(cat $DIR/$tdir/f$i)" == "file $i" ]] ||
+			error "bad data in f$i"
+	done
+}
+run_test 42f "aggregate small file writes in multi-object RPCs"
+
 test_43A() { # was test_43
 	test_mkdir $DIR/$tdir
 	cp -p /bin/ls $DIR/$tdir/$tfile
@@ -8603,6 +8640,44 @@ test_101g() {
 }
 run_test 101g "Big bulk(4/16 MiB) readahead"
 
+test_101h() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+
+	local bsize=65536
+	local count=256
+	local backward
+	local hits
+	local cmd="o"
+	local i
+
+	$LFS setstripe -c 1 $DIR/$tfile || error "setstripe failed"
+	dd if=/dev/zero of=$DIR/$tfile bs=$bsize count=$count ||
+		error "dd write failed"
+	cancel_lru_locks osc
+	$LCTL set_param -n llite.*.read_ahead_stats 0
+
+	# read the file backward, one block at a time at absolute offsets,
+	# through a single open file so the read-ahead state is kept
+	for ((i = count - 1; i >= 0; i--)); do
+		cmd+="z$((i * bsize))r$bsize"
+	done
+	$MULTIOP $DIR/$tfile ${cmd}c 2>&1 | grep -q "short read" &&
+		error "short read while reading backward"
+
+	$LCTL get_param llite.*.read_ahead_stats
+	backward=$($LCTL get_param -n llite.*.read_ahead_stats |
+		   get_named_value 'backward read-ahead' | cut -d" " -f1 |
+		   calc_total)
+	[[ $backward -gt 0 ]] || error "backward read-ahead not detected"
+	hits=$($LCTL get_param -n llite.*.read_ahead_stats |
+	       get_named_value 'backward hits' | cut -d" " -f1 | calc_total)
+	# most blocks after the first few should come from read-ahead
+	(( hits >= count / 2 )) ||
+		error "only $hits backward read-ahead hits"
+	rm -f $DIR/$tfile
+}
+run_test 101h "check backward read-ahead"
+
 setup_test102() {
 	test_mkdir $DIR/$tdir
 	chown $RUNAS_ID $DIR/$tdir
@@ -9453,6 +9528,81 @@ test_110() {
 }
 run_test 110 "filename length checking"
 
+test_114() {
+	remote_ost_nodsh && skip "remote OST with nodsh"
+
+	local param="ost.OSS.ost_io"
+	local save_params="$TMP/sanity-$TESTNAME.parameters"
+	local osc="osc.$FSNAME-OST0000-osc-[^M]*.max_rpcs_in_flight"
+	local queues
+	local nthrs
+	local writers
+	local stolen
+	local i
+
+	queues=$(do_facet ost1 $LCTL get_param -n $param.cpt_queues) ||
+		error "cannot read $param.cpt_queues"
+	(( $(echo "$queues" | grep -c "^[0-9]") > 1 )) ||
+		skip_env "ost_io has a single CPT partition"
+	# enough writers to keep every thread of one partition busy
+	nthrs=$(echo "$queues" |
+		awk '/^[0-9]/ { if ($2 > n) n = $2 } END { print n + 0 }')
+	writers=$((nthrs * 2 + 4))
+	(( writers <= 256 )) || writers=256
+
+	save_lustre_params ost1 "$param.steal_threshold" > $save_params
+	stack_trap "restore_lustre_params < $save_params; rm -f $save_params" EXIT
+	do_facet ost1 $LCTL set_param $param.steal_threshold=1 ||
+		error "cannot set $param.steal_threshold"
+	stack_trap "$LCTL set_param $osc=$($LCTL get_param -n $osc)" EXIT
+	$LCTL set_param $osc=$writers
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir
+	# hold every write for a second, so the partition of this client
+	# runs out of threads while the other ones are idle
+	#define OBD_FAIL_OST_BRW_PAUSE_PACK      0x224
+	do_facet ost1 $LCTL set_param fail_val=1 fail_loc=0x224
+	stack_trap "do_facet ost1 $LCTL set_param fail_loc=0 fail_val=0" EXIT
+	for ((i = 0; i < writers; i++)); do
+		dd if=/dev/zero of=$DIR/$tdir/f$i bs=64k count=4 \
+			oflag=direct 2>/dev/null &
+	done
+	wait
+	do_facet ost1 $LCTL set_param fail_loc=0 fail_val=0
+
+	do_facet ost1 $LCTL get_param $param.cpt_queues
+	stolen=$(do_facet ost1 $LCTL get_param -n $param.cpt_queues |
+		 awk '/^[0-9]/ { n += $6 } END { print n + 0 }')
+	(( stolen > 0 )) || error "no request stolen with $writers writers"
+	rm -rf $DIR/$tdir
+}
+run_test 114 "ptlrpc work stealing between CPT partitions"
+
+test_114b() {
+	local param="mds.MDS.mdt"
+	local save_params="$TMP/sanity-$TESTNAME.parameters"
+	local hits
+
+	save_lustre_params mds1 "$param.reply_cache_max" > $save_params
+	stack_trap "restore_lustre_params < $save_params; rm -f $save_params" EXIT
+	do_facet mds1 $LCTL set_param $param.reply_cache_max=64 ||
+		error "cannot set $param.reply_cache_max"
+	do_facet mds1 $LCTL set_param -n $param.stats=clear
+
+	test_mkdir $DIR/$tdir
+	createmany -o $DIR/$tdir/f 500 || error "createmany failed"
+	cancel_lru_locks mdc
+	ls -l $DIR/$tdir > /dev/null || error "ls failed"
+	unlinkmany $DIR/$tdir/f 500 || error "unlinkmany failed"
+
+	do_facet mds1 $LCTL get_param $param.stats | grep rs_cache
+	hits=$(do_facet mds1 $LCTL get_param -n $param.stats |
+		awk '/rs_cache_hit/ { print $2 }')
+	(( ${hits:-0} > 0 )) || error "no reply state reused"
+}
+run_test 114b "ptlrpc reply states are recycled"
+
 #
 # Purpose: To verify dynamic thread (OSS) creation.
 #
@@ -10610,6 +10760,80 @@ test_123b () { # statahead(bug 15027)
 }
 run_test 123b "not panic with network error in statahead enqueue (bug 15027)"
 
+test_123c() { # batched statahead
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	$LCTL get_param -n mdc.*.connect_flags | grep -q batch_getattr ||
+		skip "MDS does not support batched getattr"
+
+	local batch_max=$($LCTL get_param -n llite.*.statahead_batch_max |
+			  head -n 1)
+
+	stack_trap "$LCTL set_param llite.*.statahead_batch_max=$batch_max" EXIT
+	$LCTL set_param llite.*.statahead_batch_max=32
+
+	test_mkdir $DIR/$tdir
+	createmany -o $DIR/$tdir/$tfile- 1000 || error "createmany failed"
+
+	cancel_lru_locks mdc
+	cancel_lru_locks osc
+	$LCTL set_param mdc.*.md_stats=clear > /dev/null
+	ls -l $DIR/$tdir > /dev/null || error "ls -l $DIR/$tdir failed"
+	$LCTL get_param -n llite.*.statahead_stats
+
+	local batches=$($LCTL get_param -n mdc.*.md_stats |
+		awk '/intent_getattr_batch/ { sum += $2 } END { print sum + 0 }')
+
+	(( batches > 0 )) || error "no batched getattr sent by statahead"
+
+	# disabled batching must still work
+	$LCTL set_param llite.*.statahead_batch_max=0
+	cancel_lru_locks mdc
+	$LCTL set_param mdc.*.md_stats=clear > /dev/null
+	ls -l $DIR/$tdir > /dev/null || error "ls -l $DIR/$tdir failed"
+	batches=$($LCTL get_param -n mdc.*.md_stats |
+		awk '/intent_getattr_batch/ { sum += $2 } END { print sum + 0 }')
+	(( batches == 0 )) || error "$batches batches with batching disabled"
+}
+run_test 123c "statahead uses batched getattr RPCs"
+
+test_123d() { # statahead by filename pattern
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	$LCTL get_param -n llite.*.statahead_fname > /dev/null 2>&1 ||
+		skip "client does not support statahead by filename"
+
+	local fname=$($LCTL get_param -n llite.*.statahead_fname | head -n 1)
+	local names
+	local before
+	local after
+
+	stack_trap "$LCTL set_param llite.*.statahead_fname=$fname" EXIT
+	$LCTL set_param llite.*.statahead_fname=1
+
+	test_mkdir $DIR/$tdir
+	names=$(seq -f "$DIR/$tdir/$tfile.%04g" 1 500)
+	touch $names || error "touch failed"
+
+	cancel_lru_locks mdc
+	cancel_lru_locks osc
+	before=$($LCTL get_param -n llite.*.statahead_stats |
+		 awk '/statahead fname:/ { sum += $3 } END { print sum + 0 }')
+	# one process stats names in numeric order without opening the dir
+	stat -c %n $names > /dev/null || error "stat failed"
+	$LCTL get_param -n llite.*.statahead_stats
+	after=$($LCTL get_param -n llite.*.statahead_stats |
+		awk '/statahead fname:/ { sum += $3 } END { print sum + 0 }')
+	(( after > before )) || error "statahead by filename not started"
+
+	$LCTL set_param llite.*.statahead_fname=0
+	cancel_lru_locks mdc
+	before=$after
+	stat -c %n $names > /dev/null || error "stat failed"
+	after=$($LCTL get_param -n llite.*.statahead_stats |
+		awk '/statahead fname:/ { sum += $3 } END { print sum + 0 }')
+	(( after == before )) || error "statahead by filename not disabled"
+}
+run_test 123d "statahead by filename pattern"
+
 test_124a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	$LCTL get_param -n mdc.*.connect_flags | grep -q lru_resize ||
@@ -10819,6 +11043,29 @@ test_124c() {
 }
 run_test 124c "LRUR cancel very aged locks"
 
+test_124d() {
+	local nsdir="ldlm.namespaces.*-MDT0000-mdc-*"
+	local nr=100
+
+	test_mkdir $DIR/$tdir
+	createmany -o $DIR/$tdir/f $nr || error "create $nr files failed"
+	cancel_lru_locks mdc
+	$LCTL set_param -n $nsdir.stats=clear
+
+	# first stat finds no cached resource, the second one should be
+	# resolved by the lockless resource lookup
+	ls -l $DIR/$tdir > /dev/null || error "first ls failed"
+	ls -l $DIR/$tdir > /dev/null || error "second ls failed"
+	$LCTL get_param $nsdir.stats
+
+	local rcu=$($LCTL get_param -n $nsdir.stats |
+		    awk '/^res_lookup_rcu/ { print $2 }')
+	[ -n "$rcu" ] && (( rcu > 0 )) ||
+		error "no lockless resource lookups"
+	unlinkmany $DIR/$tdir/f $nr
+}
+run_test 124d "ldlm resources are looked up locklessly"
+
 test_125() { # 13358
 	$LCTL get_param -n llite.*.client_type | grep -q local ||
 		skip "must run as local client"
@@ -20337,6 +20584,313 @@ test_420()
 }
 run_test 420 "clear SGID bit on non-directories for non-members"
 
+test_421a() {
+	$LCTL get_param -n mdc.*.connect_flags | grep -q batch_reint ||
+		skip "MDS does not support batched reint"
+
+	local batches
+
+	test_mkdir -c 1 $DIR/$tdir
+	# count the MDS_BATCH_REINT RPCs actually sent, md_stats also
+	# counts batches which fell back to single reint RPCs
+	$LCTL set_param mdc.*.stats=clear > /dev/null
+	createmany -m -b 64 $DIR/$tdir/$tfile- 500 ||
+		error "batched create failed"
+	batches=$(calc_stats mdc.*.stats mds_batch_reint)
+	(( ${batches:-0} > 0 )) || error "no MDS_BATCH_REINT sent by create"
+
+	local nr=$(ls $DIR/$tdir | wc -l)
+
+	(( nr == 500 )) || error "$nr files created, expect 500"
+	[ -f $DIR/$tdir/$tfile-499 ] || error "$tfile-499 is not a file"
+	[ $(stat -c %a $DIR/$tdir/$tfile-0) == "444" ] ||
+		error "wrong mode of $tfile-0"
+
+	# create and unlink in the same batches, then unlink the rest
+	createmany -d -u -b 64 $DIR/$tdir/d- 100 ||
+		error "batched mkdir/rmdir failed"
+	$LCTL set_param mdc.*.stats=clear > /dev/null
+	createmany -u -b 64 $DIR/$tdir/$tfile- 500 ||
+		error "batched unlink failed"
+	batches=$(calc_stats mdc.*.stats mds_batch_reint)
+	(( ${batches:-0} > 0 )) || error "no MDS_BATCH_REINT sent by unlink"
+
+	nr=$(ls $DIR/$tdir | wc -l)
+	(( nr == 0 )) || error "$nr files left after unlink"
+	rmdir $DIR/$tdir || error "rmdir $DIR/$tdir failed"
+}
+run_test 421a "create and unlink files with batched reint RPCs"
+
+test_421b() {
+	$LCTL get_param -n mdc.*.connect_flags | grep -q batch_reint ||
+		skip "MDS does not support batched reint"
+
+	local batches
+
+	test_mkdir -c 1 $DIR/$tdir
+	touch $DIR/$tdir/$tfile || error "touch $tfile failed"
+	# setattr through hard links changes the same file in one batch
+	createmany -l $DIR/$tdir/$tfile $DIR/$tdir/l- 4 ||
+		error "link $tfile failed"
+	$LCTL set_param mdc.*.stats=clear > /dev/null
+	createmany -c 0600 -b 8 $DIR/$tdir/l- 4 ||
+		error "batched chmod of one file failed"
+	batches=$(calc_stats mdc.*.stats mds_batch_reint)
+	(( ${batches:-0} > 0 )) || error "no MDS_BATCH_REINT sent by chmod"
+	[ $(stat -c %a $DIR/$tdir/$tfile) == "600" ] ||
+		error "wrong mode of $tfile"
+
+	# and then unlink each link in the same batch
+	createmany -c 0640 -u -b 8 $DIR/$tdir/l- 4 ||
+		error "batched chmod/unlink of one file failed"
+	[ $(stat -c %a $DIR/$tdir/$tfile) == "640" ] ||
+		error "wrong mode of $tfile"
+	[ $(stat -c %h $DIR/$tdir/$tfile) == "1" ] ||
+		error "links of $tfile left after unlink"
+	rm -rf $DIR/$tdir || error "rm $DIR/$tdir failed"
+}
+run_test 421b "setattr of one file several times in a batch"
+
+test_422() {
+	[[ "$NETTYPE" =~ tcp ]] ||
+		skip_env "socklnd test, not useful for NETTYPE=$NETTYPE"
+
+	local nid
+
+	nid=$($LCTL get_param -n osc.$FSNAME-OST0000-osc-[^M]*.import |
+	      awk '/current_connection:/ { print $2 }')
+	[[ -n "$nid" ]] || error "no connection to OST0000"
+	[[ "$nid" != "$($LCTL list_nids | head -n 1)" ]] ||
+		skip_env "OST0000 is local, no socket is used"
+
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile || error "setstripe failed"
+	dd if=/dev/urandom of=$TMP/$tfile bs=1M count=8 ||
+		error "dd to $TMP/$tfile failed"
+	stack_trap "rm -f $TMP/$tfile" EXIT
+	cp $TMP/$tfile $DIR/$tfile || error "cp to $DIR/$tfile failed"
+	cancel_lru_locks osc
+
+	# full RPCs, then bulks of a few pages
+	cmp $TMP/$tfile $DIR/$tfile || error "$tfile is corrupted"
+	cmp $TMP/$tfile <(dd if=$DIR/$tfile bs=12k iflag=direct) ||
+		error "$tfile is corrupted with 12k direct reads"
+}
+run_test 422 "socklnd bulk received through a bvec iterator is intact"
+
+test_423() {
+	local lnetctl=$(which lnetctl 2> /dev/null)
+	local nid=$($LCTL list_nids | head -n 1)
+
+	[[ -n "$lnetctl" ]] || skip_env "without lnetctl support"
+	$lnetctl udsp show > /dev/null 2>&1 ||
+		skip "LNet has no selection policy support"
+	[[ -z "$($lnetctl udsp show)" ]] ||
+		skip "selection policy rules already configured"
+
+	stack_trap "$lnetctl udsp del --all" EXIT
+	$lnetctl udsp add --src $nid --priority 1 ||
+		error "add src rule failed"
+	$lnetctl udsp add --dst "*@${nid#*@}" --priority 2 ||
+		error "add dst rule failed"
+	$lnetctl udsp add --rte $nid --priority 3 --idx 0 ||
+		error "add rte rule failed"
+	$lnetctl udsp add --src $nid --dst $nid --priority 1 &&
+		error "rule with two NID lists added"
+	$lnetctl udsp add --dst "not a nid" --priority 1 &&
+		error "rule with bad NID list added"
+	$lnetctl udsp show
+
+	[[ $($lnetctl udsp show | grep -c "idx:") == 3 ]] ||
+		error "expected 3 rules"
+	$lnetctl udsp show --idx 0 | grep -q "rte: $nid" ||
+		error "rule not inserted at index 0"
+
+	# traffic keeps flowing through the preferred NIs
+	$LFS df $MOUNT > /dev/null || error "lfs df failed"
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=4 conv=fsync ||
+		error "dd failed"
+
+	$lnetctl udsp del --idx 0 || error "del rule 0 failed"
+	[[ $($lnetctl udsp show | grep -c "idx:") == 2 ]] ||
+		error "expected 2 rules"
+	$lnetctl udsp del --idx 5 && error "deleted a missing rule"
+	$lnetctl udsp del --all || error "del all rules failed"
+	[[ -z "$($lnetctl udsp show)" ]] || error "rules left after del --all"
+}
+run_test 423 "LNet user defined selection policy rules"
+
+lnet_numa_bytes() {
+	lnetctl stats show | awk '/numa_(local|remote)_length/ { n += $2 }
+				  END { print n + 0 }'
+}
+
+test_424() {
+	local param=/sys/module/ptlrpc/parameters/ptlrpcd_bulk_affinity
+	local rotor
+	local before
+	local after
+
+	which lnetctl > /dev/null 2>&1 || skip_env "without lnetctl support"
+	lnetctl stats show | grep -q numa_local_length ||
+		skip "LNet has no NUMA locality stats"
+	[[ -w $param ]] || skip "ptlrpcd has no bulk affinity"
+	(( $(check_cpt_number client) > 1 )) ||
+		skip_env "needs more than one CPT"
+	lnetctl net show -v | grep -q "dev cpt: [0-9]" ||
+		skip_env "no NI with a known device CPT"
+
+	rotor=$($LCTL get_param -n portal_rotor | awk '/rotor:/ { print $2 }')
+	stack_trap "$LCTL set_param portal_rotor=$rotor" EXIT
+	stack_trap "echo $(cat $param) > $param" EXIT
+	$LCTL set_param portal_rotor=DEV_CPT ||
+		error "cannot dispatch to the device CPT"
+	echo 1 > $param
+
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile || error "setstripe failed"
+	before=$(lnet_numa_bytes)
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=8 conv=fsync ||
+		error "dd write failed"
+	cancel_lru_locks osc
+	dd if=$DIR/$tfile of=/dev/null bs=1M || error "dd read failed"
+	after=$(lnet_numa_bytes)
+	lnetctl stats show | grep numa_
+
+	(( after - before >= 16 * 1048576 )) ||
+		error "only $((after - before)) bulk bytes accounted for 16MiB"
+}
+run_test 424 "NUMA locality of bulk traffic is accounted"
+
+lnet_pool_stat() {
+	lnetctl stats show | awk "/$1:/ { print \$2 }"
+}
+
+test_425() {
+	local field
+	local cached
+
+	which lnetctl > /dev/null 2>&1 || skip_env "without lnetctl support"
+	lnetctl stats show | grep -q msg_pool_inuse ||
+		skip "LNet has no object pools"
+
+	for field in {msg,me,md}_pool_{inuse,cached}; do
+		[[ -n "$(lnet_pool_stat $field)" ]] ||
+			error "$field missing from lnetctl stats"
+	done
+
+	dd if=/dev/zero of=$DIR/$tfile bs=4k count=1000 oflag=sync ||
+		error "dd write failed"
+	cancel_lru_locks osc
+	dd if=$DIR/$tfile of=/dev/null bs=4k || error "dd read failed"
+	lnetctl stats show | grep _pool_
+
+	cached=$(lnet_pool_stat msg_pool_cached)
+	(( cached > 0 )) || error "no message kept in the pool after I/O"
+	(( cached <= 2 * 4096 * $(check_cpt_number client) )) ||
+		error "$cached messages cached, the pool is not trimmed"
+}
+run_test 425 "LNet object pools cache freed messages"
+
+lnet_rtr_nbuffers() {
+	lnetctl routing show | awk '/nbuffers:/ { n += $2 } END { print n + 0 }'
+}
+
+test_426() {
+	local param=/sys/module/lnet/parameters/router_buffer_autoscale
+	local before
+	local after
+
+	which lnetctl > /dev/null 2>&1 || skip_env "without lnetctl support"
+	[[ -w $param ]] || skip "LNet has no router buffer autoscaling"
+	lnetctl routing show | grep -q "enable: 1" &&
+		skip_env "routing already enabled on $HOSTNAME"
+
+	stack_trap "echo $(cat $param) > $param" EXIT
+	echo 17 > $param 2> /dev/null &&
+		error "router_buffer_autoscale set above its limit"
+	echo 2 > $param
+	lnetctl set routing 1 || skip_env "cannot enable routing"
+	stack_trap "lnetctl set routing 0" EXIT
+
+	before=$(lnet_rtr_nbuffers)
+	(( before > 0 )) || error "no router buffers allocated"
+
+	# the shrinker only takes back buffers added by autoscaling
+	echo 2 > /proc/sys/vm/drop_caches
+	after=$(lnet_rtr_nbuffers)
+	lnetctl routing show
+	(( after == before )) ||
+		error "router buffers $before -> $after under memory pressure"
+
+	# pretend messages are blocked waiting for buffers
+	#define CFS_FAIL_LNET_RTRPOOL_BUSY	0xe001
+	$LCTL set_param fail_loc=0xe001
+	stack_trap "$LCTL set_param fail_loc=0" EXIT
+	wait_update $HOSTNAME "lnetctl routing show |
+		awk '/nbuffers:/ { n += \$2 } END { print (n > $before) }'" \
+		1 10 || error "router buffers did not grow from $before"
+	$LCTL set_param fail_loc=0
+	after=$(lnet_rtr_nbuffers)
+	lnetctl routing show
+	(( after <= 2 * before )) ||
+		error "router buffers $before -> $after, over the limit"
+
+	# idle pools fall back to their configured size
+	echo 1 > $param
+	wait_update $HOSTNAME "lnetctl routing show |
+		awk '/nbuffers:/ { n += \$2 } END { print n + 0 }'" \
+		$before 10 || error "router buffers did not fall back to $before"
+}
+run_test 426 "router buffer pools grow under load and fall back"
+
+test_427() {
+	[[ "$NETTYPE" =~ tcp ]] ||
+		skip_env "socklnd test, not useful for NETTYPE=$NETTYPE"
+
+	local param=/sys/module/ksocklnd/parameters/conns_per_peer
+	local nid
+	local nconns
+
+	[[ -w $param ]] || skip "socklnd has no conns_per_peer"
+	nid=$($LCTL get_param -n osc.$FSNAME-OST0000-osc-[^M]*.import |
+	      awk '/current_connection:/ { print $2 }')
+	[[ -n "$nid" ]] || error "no connection to OST0000"
+	[[ "$nid" != "$($LCTL list_nids | head -n 1)" ]] ||
+		skip_env "OST0000 is local, no socket is used"
+
+	# the peer refuses more conns than its own conns_per_peer
+	stack_trap "do_facet ost1 'echo $(do_facet ost1 cat $param) > $param'" EXIT
+	stack_trap "echo $(cat $param) > $param" EXIT
+	do_facet ost1 "echo 4 > $param"
+	echo 4 > $param
+	$LCTL --net tcp disconnect $nid || error "disconnect $nid failed"
+
+	# reconnect and give connd the time to set up the bulk conns
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile || error "setstripe failed"
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=16 conv=fsync ||
+		error "dd failed"
+	sleep 2
+	$LCTL --net tcp conn_list | grep "^12345-$nid "
+	for type in I O; do
+		nconns=$($LCTL --net tcp conn_list |
+			 grep -c "^12345-$nid *$type\\[")
+		(( nconns == 4 )) ||
+			error "$nconns type $type conns to $nid, not 4"
+	done
+	nconns=$($LCTL --net tcp conn_list | grep -c "^12345-$nid *C\\[")
+	(( nconns == 1 )) || error "$nconns control conns to $nid, not 1"
+
+	# values out of range are clamped
+	do_facet ost1 "echo 100 > $param"
+	echo 100 > $param
+	$LCTL --net tcp disconnect $nid || error "disconnect $nid failed"
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=16 conv=fsync ||
+		error "dd failed"
+	sleep 2
+	nconns=$($LCTL --net tcp conn_list | grep -c "^12345-$nid *O\\[")
+	(( nconns == 16 )) || error "$nconns bulk out conns to $nid, not 16"
+}
+run_test 427 "socklnd keeps conns_per_peer bulk connections to a peer"
+
 prep_801() {
 	[[ $(lustre_version_code mds1) -lt $(version_code 2.9.55) ]] ||
 	[[ $OST1_VERSION -lt $(version_code 2.9.55) ]] &&
@@ -4027,6 +4027,102 @@ test_77n() { #LU-10802
 }
 run_test 77n "check wildcard support for TBF JobID NRS policy"
 
+test_77o() {
+	local nodes=$(comma_list $(osts_nodes))
+
+	do_nodes $nodes $LCTL set_param ost.OSS.ost_io.nrs_policies=slo ||
+		skip "NRS slo policy not supported"
+	stack_trap "do_nodes $nodes $LCTL set_param \
+		ost.OSS.ost_io.nrs_policies=fifo" EXIT
+
+	do_nodes $nodes $LCTL set_param \
+		ost.OSS.ost_io.nrs_slo_rules="start\ dd_slo\ jobid=dd.*\ target=50" \
+		ost.OSS.ost_io.nrs_slo_rules="start\ write_slo\ opcode=ost_write\ target=200" \
+		ost.OSS.ost_io.nrs_slo_rules="default\ target=1000" ||
+		error "failed to start slo rules"
+	do_nodes $nodes $LCTL set_param \
+		ost.OSS.ost_io.nrs_slo_rules="start\ dd_slo\ uid=0\ target=10" &&
+		error "duplicate slo rule name should be rejected"
+	do_nodes $nodes $LCTL set_param \
+		ost.OSS.ost_io.nrs_slo_rules="start\ bad_slo\ target=10" &&
+		error "slo rule without a match should be rejected"
+
+	nrs_write_read
+
+	do_facet ost1 $LCTL get_param -n ost.OSS.ost_io.nrs_slo_rules
+	do_facet ost1 $LCTL get_param -n ost.OSS.ost_io.nrs_slo_rules |
+		grep -q "write_slo opcode=ost_write target=200" ||
+		error "write_slo rule not listed"
+
+	do_nodes $nodes $LCTL set_param \
+		ost.OSS.ost_io.nrs_slo_rules="stop\ dd_slo" \
+		ost.OSS.ost_io.nrs_slo_rules="stop\ write_slo" ||
+		error "failed to stop slo rules"
+	do_facet ost1 $LCTL get_param -n ost.OSS.ost_io.nrs_slo_rules |
+		grep -q "_slo " && error "slo rules not stopped"
+
+	return 0
+}
+run_test 77o "check NRS SLO policy rules"
+
+test_77p() {
+	local nodes=$(comma_list $(osts_nodes))
+
+	# Configure jobid_var
+	local saved_jobid_var=$($LCTL get_param -n jobid_var)
+	if [ $saved_jobid_var != procname_uid ]; then
+		set_persistent_param_and_check client \
+			"jobid_var" "$FSNAME.sys.jobid_var" procname_uid
+	fi
+
+	do_nodes $nodes $LCTL set_param \
+		ost.OSS.ost_io.nrs_policies="tbf\ jobid" \
+		ost.OSS.ost_io.nrs_tbf_rule="start\ proj\ jobid={dd.*\ cp.*}\ rate=40" \
+		ost.OSS.ost_io.nrs_tbf_rule="start\ proj_a\ jobid={dd.*}\ parent=proj\ share=3" \
+		ost.OSS.ost_io.nrs_tbf_rule="start\ proj_b\ jobid={cp.*}\ parent=proj\ share=1" ||
+		error "failed to start hierarchical TBF rules"
+
+	do_facet ost1 $LCTL get_param -n ost.OSS.ost_io.nrs_tbf_rule
+	# proj_a and proj_b split the rate of proj 3:1
+	do_facet ost1 $LCTL get_param -n ost.OSS.ost_io.nrs_tbf_rule |
+		grep -q "proj_a {dd.\*} 30," || error "proj_a should get 30 RPC/s"
+	do_facet ost1 $LCTL get_param -n ost.OSS.ost_io.nrs_tbf_rule |
+		grep -q "parent proj, share 1" || error "proj_b parent not listed"
+	do_nodes $nodes $LCTL set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="stop\ proj" &&
+		error "rule with child rules should not be stopped"
+	do_nodes $nodes $LCTL set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="start\ bad\ jobid={ls.*}\ rate=10\ share=1" &&
+		error "share without a parent rule should be rejected"
+
+	# proj_b is idle, so dd may borrow its part of the rate of proj,
+	# but never more than the rate of proj
+	nrs_write_read
+	tbf_verify 40 40
+
+	do_nodes $nodes $LCTL set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="change\ proj_b\ share=3"
+	do_facet ost1 $LCTL get_param -n ost.OSS.ost_io.nrs_tbf_rule |
+		grep -q "proj_a {dd.\*} 20," || error "proj_a should get 20 RPC/s"
+
+	do_nodes $nodes $LCTL set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="stop\ proj_a" ||
+		error "failed to stop proj_a"
+	# switching policy must free the rules still in a hierarchy
+	do_nodes $nodes $LCTL set_param ost.OSS.ost_io.nrs_policies="fifo" ||
+		error "failed to stop TBF with child rules"
+	do_facet ost1 $LCTL get_param -n ost.OSS.ost_io.nrs_policies |
+		grep -A1 "name: tbf" | grep -q "state: stopped" ||
+		error "TBF not stopped"
+
+	local current_jobid_var=$($LCTL get_param -n jobid_var)
+	if [ $saved_jobid_var != $current_jobid_var ]; then
+		set_persistent_param_and_check client \
+			"jobid_var" "$FSNAME.sys.jobid_var" $saved_jobid_var
+	fi
+}
+run_test 77p "check hierarchical TBF rules with shares and borrowing"
+
 test_78() { #LU-6673
 	local rc
 
@@ -4704,6 +4800,85 @@ test_102() {
 }
 run_test 102 "Test open by handle of unlinked file"
 
+test_103() {
+	$LCTL get_param -n osc.*.connect_flags | grep -q batch_bl_ast ||
+		skip "OST does not support batched blocking AST"
+
+	local nlocks=100
+	local before
+	local after
+	local i
+
+	$LFS setstripe -c 1 -i 0 $DIR1/$tfile || error "setstripe failed"
+	dd if=/dev/zero of=$DIR1/$tfile bs=1M count=1 ||
+		error "dd on $DIR1/$tfile failed"
+	cancel_lru_locks osc
+
+	# many small locks on the same object through the first mount
+	for ((i = 0; i < nlocks; i++)); do
+		$LFS ladvise -a lockahead -m READ -s $((i * 8192)) \
+			-e $((i * 8192 + 4095)) $DIR1/$tfile ||
+			error "lockahead $i failed"
+	done
+	sleep 1
+
+	before=$($LCTL get_param -n ldlm.services.ldlm_cbd.stats |
+		 awk '/ldlm_bl_callback/ { print $2 }')
+	# one write through the second mount conflicts with all of them
+	dd if=/dev/zero of=$DIR2/$tfile bs=1M count=1 conv=notrunc ||
+		error "dd on $DIR2/$tfile failed"
+	after=$($LCTL get_param -n ldlm.services.ldlm_cbd.stats |
+		awk '/ldlm_bl_callback/ { print $2 }')
+
+	echo "$((after - before)) blocking ASTs for $nlocks locks"
+	(( after - before < nlocks / 2 )) ||
+		error "$((after - before)) blocking ASTs for $nlocks locks"
+
+	cmp $DIR1/$tfile $DIR2/$tfile || error "$tfile differs between mounts"
+}
+run_test 103 "blocking ASTs of many locks are batched per client"
+
+test_104() {
+	local hist=$(do_facet ost1 $LCTL get_param -n \
+		     ldlm.namespaces.filter-*.extent_hist_seconds 2>/dev/null |
+		     head -n 1)
+	[ -n "$hist" ] || skip "OST does not support learned extent sizing"
+
+	local count=16
+	local before
+	local after
+	local i
+
+	stack_trap "do_facet ost1 $LCTL set_param \
+		ldlm.namespaces.filter-*.extent_hist_seconds=$hist" EXIT
+	do_facet ost1 $LCTL set_param \
+		ldlm.namespaces.filter-*.extent_hist_seconds=60
+
+	$LFS setstripe -c 1 -i 0 $DIR1/$tfile || error "setstripe failed"
+	cancel_lru_locks osc
+
+	before=$($LCTL get_param -n ldlm.services.ldlm_cbd.stats |
+		 awk '/ldlm_bl_callback/ { print $2 }')
+	# each mount writes its own half of the file, alternating
+	for ((i = 0; i < count; i++)); do
+		dd if=/dev/zero of=$DIR1/$tfile bs=1M count=1 seek=$i \
+			conv=notrunc 2>/dev/null ||
+			error "dd on $DIR1/$tfile failed"
+		dd if=/dev/zero of=$DIR2/$tfile bs=1M count=1 \
+			seek=$((count + i)) conv=notrunc 2>/dev/null ||
+			error "dd on $DIR2/$tfile failed"
+	done
+	after=$($LCTL get_param -n ldlm.services.ldlm_cbd.stats |
+		awk '/ldlm_bl_callback/ { print $2 }')
+
+	echo "$((after - before)) blocking ASTs for $((count * 2)) writes"
+	(( after - before < count / 2 )) ||
+		error "$((after - before)) blocking ASTs for $((count * 2)) writes"
+
+	cmp $DIR1/$tfile $DIR2/$tfile || error "$tfile differs between mounts"
+}
+run_test 104 "shared file writers get locks sized to their region"
+
 log "cleanup: ======================================================"
 
 # kill and wait in each test only guarentee script finish, but command in script
@@ -0,0 +1,82 @@
+/*
+ * LGPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Lesser General Public License
+ * LGPL version 2.1 or (at your discretion) any later version.
+ * LGPL version 2.1 accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/lgpl-2.1.html
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * LGPL HEADER END
+ */
+/*
+ * lustre/utils/liblustreapi_batch.c
+ *
+ * lustreapi library for batched create, setattr and unlink
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+#include <lustre/lustreapi.h>
+#include "lustreapi_internal.h"
+
+/*
+ * Create, setattr or unlink files in a directory, packing as many of them
+ * as possible in each RPC to the MDTs.
+ *
+ * \param dirfd    Directory opened by the caller, names of create and unlink
+ *                 are looked up in it.
+ * \param ops      Operations, the result of each one is returned in its
+ *                 lbo_result, and the fid of each created file in lbo_fid.
+ * \param count    Number of operations.
+ *
+ * \retval 0 if all operations were tried, check lbo_result of each one.
+ * \retval -errno on failure.
+ */
+int llapi_batch_ops(int dirfd, struct lu_batch_op *ops, int count)
+{
+	struct ll_batch_ops *lbo;
+	int done;
+	int rc = 0;
+
+	if (dirfd < 0 || ops == NULL || count <= 0)
+		return -EINVAL;
+
+	lbo = malloc(sizeof(*lbo) + LL_BATCH_OPS_MAX * sizeof(*ops));
+	if (lbo == NULL)
+		return -ENOMEM;
+
+	for (done = 0; done < count; done += lbo->lbo_count) {
+		memset(lbo, 0, sizeof(*lbo));
+		lbo->lbo_magic = LL_BATCH_OPS_MAGIC;
+		lbo->lbo_count = count - done;
+		if (lbo->lbo_count > LL_BATCH_OPS_MAX)
+			lbo->lbo_count = LL_BATCH_OPS_MAX;
+		memcpy(lbo->lbo_ops, ops + done,
+		       lbo->lbo_count * sizeof(*ops));
+
+		rc = ioctl(dirfd, LL_IOC_BATCH_OPS, lbo);
+		if (rc < 0) {
+			rc = -errno;
+			llapi_error(LLAPI_MSG_ERROR, rc,
+				    "cannot batch %u operations",
+				    lbo->lbo_count);
+			break;
+		}
+		memcpy(ops + done, lbo->lbo_ops,
+		       lbo->lbo_count * sizeof(*ops));
+	}
+	free(lbo);
+
+	return rc;
+}
@@ -101,6 +101,46 @@ static int llapi_readwrite_pcc_attach(const char *path, __u32 archive_id)
 	return rc;
 }
 
+/**
+ * Fetch and attach a file to readonly PCC.
+ *
+ */
+static int llapi_readonly_pcc_attach_fd(int fd, __u32 roid)
+{
+	struct lu_pcc_attach attach;
+	int rc;
+
+	attach.pcca_type = LU_PCC_READONLY;
+	attach.pcca_id = roid;
+	rc = ioctl(fd, LL_IOC_PCC_ATTACH, &attach);
+	if (rc) {
+		rc = -errno;
+		llapi_error(LLAPI_MSG_ERROR, rc,
+			    "cannot attach with ID: %u", roid);
+	}
+
+	return rc;
+}
+
+static int llapi_readonly_pcc_attach(const char *path, __u32 roid)
+{
+	int fd;
+	int rc;
+
+	fd = open(path, O_RDONLY | O_NONBLOCK);
+	if (fd < 0) {
+		rc = -errno;
+		llapi_error(LLAPI_MSG_ERROR, rc, "cannot open '%s'",
+			    path);
+		return rc;
+	}
+
+	rc = llapi_readonly_pcc_attach_fd(fd, roid);
+
+	close(fd);
+	return rc;
+}
+
 int llapi_pcc_attach(const char *path, __u32 id, enum lu_pcc_type type)
 {
 	int rc;
@@ -109,6 +149,9 @@ int llapi_pcc_attach(const char *path, __u32 id, enum lu_pcc_type type)
 	case LU_PCC_READWRITE:
 		rc = llapi_readwrite_pcc_attach(path, id);
 		break;
+	case LU_PCC_READONLY:
+		rc = llapi_readonly_pcc_attach(path, id);
+		break;
 	default:
 		rc = -EINVAL;
 		break;
@@ -138,6 +181,28 @@ static int llapi_readwrite_pcc_attach_fid(const char *mntpath,
 	return rc;
 }
 
+static int llapi_readonly_pcc_attach_fid(const char *mntpath,
+					 const struct lu_fid *fid,
+					 __u32 id)
+{
+	int rc;
+	int fd;
+
+	fd = llapi_open_by_fid(mntpath, fid, O_RDONLY | O_NONBLOCK);
+	if (fd < 0) {
+		rc = -errno;
+		llapi_error(LLAPI_MSG_ERROR, rc,
+			    "llapi_open_by_fid for " DFID "failed",
+			    PFID(fid));
+		return rc;
+	}
+
+	rc = llapi_readonly_pcc_attach_fd(fd, id);
+
+	close(fd);
+	return rc;
+}
+
 int llapi_pcc_attach_fid(const char *mntpath, const struct lu_fid *fid,
 			 __u32 id, enum lu_pcc_type type)
 {
@@ -147,6 +212,9 @@ int llapi_pcc_attach_fid(const char *mntpath, const struct lu_fid *fid,
 	case LU_PCC_READWRITE:
 		rc = llapi_readwrite_pcc_attach_fid(mntpath, fid, id);
 		break;
+	case LU_PCC_READONLY:
+		rc = llapi_readonly_pcc_attach_fid(mntpath, fid, id);
+		break;
 	default:
 		rc = -EINVAL;
 		break;
@@ -0,0 +1,102 @@
+/*
+ * LGPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Lesser General Public License
+ * LGPL version 2.1 or (at your discretion) any later version.
+ * LGPL version 2.1 accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/lgpl-2.1.html
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * LGPL HEADER END
+ */
+/*
+ * lustre/utils/liblustreapi_statahead.c
+ *
+ * lustreapi library for metadata statahead by name list
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+#include <lustre/lustreapi.h>
+#include "lustreapi_internal.h"
+
+static int statahead_send(int dirfd, struct ll_statahead_names *lsn)
+{
+	int rc;
+
+	lsn->lsn_magic = LL_STATAHEAD_MAGIC;
+	rc = ioctl(dirfd, LL_IOC_STATAHEAD, lsn);
+	if (rc < 0) {
+		rc = -errno;
+		llapi_error(LLAPI_MSG_ERROR, rc, "cannot statahead %u names",
+			    lsn->lsn_count);
+	}
+	lsn->lsn_count = 0;
+	lsn->lsn_size = 0;
+
+	return rc;
+}
+
+/*
+ * Hand over names in a directory to be stat'ed ahead, so the following
+ * stat() calls by the caller hit the client cache.
+ *
+ * \param dirfd    Directory opened by the caller.
+ * \param names    Names in \a dirfd, in the order the caller will stat them.
+ * \param count    Number of names.
+ *
+ * \retval 0 on success.
+ * \retval -errno on failure.
+ */
+int llapi_statahead(int dirfd, const char **names, int count)
+{
+	struct ll_statahead_names *lsn;
+	int rc = 0;
+	int i;
+
+	if (dirfd < 0 || names == NULL || count <= 0)
+		return -EINVAL;
+
+	lsn = malloc(sizeof(*lsn) + LL_STATAHEAD_SIZE_MAX);
+	if (lsn == NULL)
+		return -ENOMEM;
+
+	memset(lsn, 0, sizeof(*lsn));
+	for (i = 0; i < count; i++) {
+		size_t len = strlen(names[i]) + 1;
+
+		if (len == 1 || len > NAME_MAX + 1 ||
+		    strchr(names[i], '/') != NULL) {
+			rc = -EINVAL;
+			llapi_error(LLAPI_MSG_ERROR, rc, "invalid name '%s'",
+				    names[i]);
+			goto out;
+		}
+
+		if (lsn->lsn_size + len > LL_STATAHEAD_SIZE_MAX) {
+			rc = statahead_send(dirfd, lsn);
+			if (rc < 0)
+				goto out;
+		}
+
+		memcpy(lsn->lsn_names + lsn->lsn_size, names[i], len);
+		lsn->lsn_size += len;
+		lsn->lsn_count++;
+	}
+	rc = statahead_send(dirfd, lsn);
+out:
+	free(lsn);
+
+	return rc;
+}
@@ -612,6 +612,10 @@ check_obd_connect_data(void)
 	CHECK_DEFINE_64X(OBD_CONNECT2_PCC);
 	CHECK_DEFINE_64X(OBD_CONNECT2_PLAIN_LAYOUT);
 	CHECK_DEFINE_64X(OBD_CONNECT2_ASYNC_DISCARD);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BATCH_GETATTR);
+	CHECK_DEFINE_64X(OBD_CONNECT2_MULTI_OBJ_BRW);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BATCH_REINT);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BATCH_BL_AST);
 
 	CHECK_VALUE_X(OBD_CKSUM_CRC32);
 	CHECK_VALUE_X(OBD_CKSUM_ADLER);
@@ -1149,6 +1153,17 @@ check_mdt_ioepoch(void)
 	CHECK_MEMBER(mdt_ioepoch, mio_padding);
 }
 
+static void
+check_mdt_batch_header(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(mdt_batch_header);
+	CHECK_MEMBER(mdt_batch_header, mbh_count);
+	CHECK_MEMBER(mdt_batch_header, mbh_flags);
+	CHECK_MEMBER(mdt_batch_header, mbh_reply_size);
+	CHECK_MEMBER(mdt_batch_header, mbh_padding);
+}
+
 static void
 check_mdt_rec_setattr(void)
 {
@@ -2679,6 +2694,8 @@ main(int argc, char **argv)
 	CHECK_VALUE(MDS_HSM_CT_REGISTER);
 	CHECK_VALUE(MDS_HSM_CT_UNREGISTER);
 	CHECK_VALUE(MDS_SWAP_LAYOUTS);
+	CHECK_VALUE(MDS_BATCH_GETATTR);
+	CHECK_VALUE(MDS_BATCH_REINT);
 	CHECK_VALUE(MDS_LAST_OPC);
 
 	CHECK_VALUE(REINT_SETATTR);
@@ -2865,6 +2882,7 @@ main(int argc, char **argv)
 	check_mds_op_bias();
 	check_mdt_body();
 	check_mdt_ioepoch();
+	check_mdt_batch_header();
 	check_mdt_rec_setattr();
 	check_mdt_rec_create();
 	check_mdt_rec_link();